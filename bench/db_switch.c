@@ -0,0 +1,142 @@
+/// @file
+/// Pomiar czasu przełączania między wieloma bazami przekierowań.
+///
+/// Tworzy bazy o podanej liczbie i wybiera je przez @ref
+/// setOrCreateDatabaseWithName, tak jak operacja @p NEW, w trzech wzorcach:
+/// na zmianę dwie bazy, głównie kilka baz z rzadkimi wyjątkami i po kolei
+/// wszystkie bazy. Na koniec usuwa wszystkie bazy przez @ref
+/// deleteDatabaseWithName. Podaje średni czas na operację.
+///
+/// Użycie: bench_db_switch [liczba baz] [liczba przełączeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "redirections_db.h"
+
+/// Domyślna liczba baz.
+#define BENCH_DEFAULT_DATABASES (500)
+
+/// Domyślna liczba przełączeń w każdym wzorcu.
+#define BENCH_DEFAULT_SWITCHES (10000000)
+
+/// Największa długość nazwy bazy, wliczając zakończenie.
+#define BENCH_NAME_SIZE (32)
+
+/// Liczba często wybieranych baz we wzorcu z wyjątkami.
+#define BENCH_HOT_DATABASES (6)
+
+/// Co ile przełączeń wybierana jest baza spoza często wybieranych.
+#define BENCH_COLD_PERIOD (10)
+
+/// Stan generatora liczb losowych.
+static uint64_t benchRandomState = 88172645463325252ull;
+
+/// @brief Losuje liczbę generatorem xorshift.
+/// @return Kolejna liczba losowa.
+static uint64_t benchRandom(void) {
+  benchRandomState ^= benchRandomState << 13;
+  benchRandomState ^= benchRandomState >> 7;
+  benchRandomState ^= benchRandomState << 17;
+  return benchRandomState;
+}
+
+/// @brief Odczytuje czas monotoniczny.
+/// @return Czas w sekundach.
+static double benchNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/// @brief Wybiera kolejno bazy o podanych indeksach.
+/// @param[in] names – nazwy wszystkich baz.
+/// @param[in] order – indeksy wybieranych baz.
+/// @param[in] count – liczba przełączeń.
+/// @return Średni czas przełączenia w nanosekundach, lub liczba ujemna, gdy
+///         któreś przełączenie nie powiodło się.
+static double benchSwitch(char (*names)[BENCH_NAME_SIZE], const size_t *order,
+                          size_t count) {
+  double start = benchNow();
+  for (size_t i = 0; i < count; ++i)
+    if (!setOrCreateDatabaseWithName(names[order[i]]))
+      return -1;
+
+  return (benchNow() - start) / count * 1e9;
+}
+
+/// @brief Uruchamia pomiar.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba baz i liczba przełączeń.
+/// @return 0 gdy wszystkie operacje powiodły się, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  size_t databases =
+      argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_DATABASES;
+  size_t switches =
+      argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_SWITCHES;
+  if (databases < BENCH_HOT_DATABASES)
+    databases = BENCH_HOT_DATABASES;
+
+  char (*names)[BENCH_NAME_SIZE] = malloc(sizeof(*names) * databases);
+  size_t *order = calloc(switches, sizeof(size_t));
+  if (!names || !order) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  for (size_t i = 0; i < databases; ++i)
+    snprintf(names[i], BENCH_NAME_SIZE, "database%zu", i);
+
+  // Every database is created before the measurements.
+  for (size_t i = 0; i < databases; ++i)
+    if (!setOrCreateDatabaseWithName(names[i])) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+
+  printf("databases %zu, switches %zu\n", databases, switches);
+
+  for (size_t i = 0; i < switches; ++i)
+    order[i] = i % 2;
+  double alternate = benchSwitch(names, order, switches);
+
+  for (size_t i = 0; i < switches; ++i)
+    order[i] = i % BENCH_COLD_PERIOD
+                   ? benchRandom() % BENCH_HOT_DATABASES
+                   : benchRandom() % databases;
+  double hot = benchSwitch(names, order, switches);
+
+  for (size_t i = 0; i < switches; ++i)
+    order[i] = i % databases;
+  double roundRobin = benchSwitch(names, order, switches);
+
+  double start = benchNow();
+  int result = 0;
+  for (size_t i = 0; i < databases; ++i)
+    if (!deleteDatabaseWithName(names[i]))
+      result = 1;
+  double deleted = (benchNow() - start) / databases * 1e9;
+
+  if (alternate < 0 || hot < 0 || roundRobin < 0)
+    result = 1;
+
+  printf("NEW alternating between two:     %.1f ns/op\n", alternate);
+  printf("NEW mostly among %d, 1/%d cold:    %.1f ns/op\n",
+         BENCH_HOT_DATABASES, BENCH_COLD_PERIOD, hot);
+  printf("NEW round robin over all:        %.1f ns/op\n", roundRobin);
+  printf("DEL of every database:           %.1f ns/op\n", deleted);
+  if (result)
+    printf("some operation failed\n");
+
+  clearAllRedirectionsDatabase();
+  free(order);
+  free(names);
+  return result;
+}
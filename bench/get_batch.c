@@ -0,0 +1,128 @@
+/// @file
+/// Pomiar czasu @ref phfwdGetBatch względem kolejnych wywołań @ref
+/// phfwdGetView.
+///
+/// Tworzy strukturę z losowymi przekierowaniami i wyznacza przekierowania
+/// losowych numerów na oba sposoby, podając średni czas na numer. Domyślna
+/// liczba przekierowań daje drzewa kilkukrotnie większe od pamięci
+/// podręcznej ostatniego poziomu. Sprawdza też, czy oba sposoby dają te same
+/// wyniki.
+///
+/// Użycie: bench_get_batch [liczba przekierowań] [liczba numerów]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "phone_forward.h"
+
+/// Domyślna liczba losowych przekierowań.
+#define BENCH_DEFAULT_RULES (2000000)
+
+/// Domyślna liczba wyszukiwanych numerów.
+#define BENCH_DEFAULT_QUERIES (1000000)
+
+/// Długość wyszukiwanych numerów.
+#define BENCH_QUERY_LENGTH (14)
+
+/// Stan generatora liczb losowych.
+static uint64_t benchRandomState = 88172645463325252ull;
+
+/// @brief Losuje liczbę generatorem xorshift.
+/// @return Kolejna liczba losowa.
+static uint64_t benchRandom(void) {
+  benchRandomState ^= benchRandomState << 13;
+  benchRandomState ^= benchRandomState >> 7;
+  benchRandomState ^= benchRandomState << 17;
+  return benchRandomState;
+}
+
+/// @brief Losuje numer.
+/// @param[out] out – bufor na co najmniej @p length + 1 znaków.
+/// @param[in] length – długość numeru.
+static void benchRandomNumber(char *out, int length) {
+  for (int i = 0; i < length; ++i)
+    out[i] = (char)('0' + benchRandom() % 10);
+
+  out[length] = '\0';
+}
+
+/// @brief Odczytuje czas monotoniczny.
+/// @return Czas w sekundach.
+static double benchNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/// @brief Uruchamia pomiar.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba przekierowań i liczba numerów.
+/// @return 0 gdy oba sposoby dały te same wyniki, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  size_t rules = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_RULES;
+  size_t queries =
+      argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_QUERIES;
+
+  struct PhoneForward *pf = phfwdNew();
+  char (*numbers)[BENCH_QUERY_LENGTH + 1] =
+      malloc(sizeof(*numbers) * queries);
+  const char **nums = malloc(sizeof(const char *) * queries);
+  struct PhoneNumberView *out = malloc(sizeof(*out) * queries);
+  if (!pf || !numbers || !nums || !out) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  char num1[BENCH_QUERY_LENGTH + 1];
+  char num2[BENCH_QUERY_LENGTH + 1];
+  for (size_t i = 0; i < rules; ++i) {
+    benchRandomNumber(num1, 6 + benchRandom() % 8);
+    benchRandomNumber(num2, 3 + benchRandom() % 8);
+    phfwdAdd(pf, num1, num2);
+  }
+
+  for (size_t i = 0; i < queries; ++i) {
+    benchRandomNumber(numbers[i], BENCH_QUERY_LENGTH);
+    nums[i] = numbers[i];
+  }
+
+  // The checksums keep the compiler from dropping the lookups.
+  size_t singleChecksum = 0;
+  double start = benchNow();
+  for (size_t i = 0; i < queries; ++i) {
+    const char *prefix;
+    size_t suffixOffset;
+    phfwdGetView(pf, nums[i], &prefix, &suffixOffset);
+    singleChecksum += (uintptr_t)prefix + suffixOffset;
+  }
+  double single = benchNow() - start;
+
+  size_t batchChecksum = 0;
+  start = benchNow();
+  phfwdGetBatch(pf, nums, queries, out);
+  for (size_t i = 0; i < queries; ++i)
+    batchChecksum += (uintptr_t)out[i].prefix + out[i].suffixOffset;
+  double batch = benchNow() - start;
+
+  printf("rules %zu, queries %zu\n", rules, queries);
+  printf("phfwdGetView loop: %.0f ns/op\n", single / queries * 1e9);
+  printf("phfwdGetBatch:     %.0f ns/op\n", batch / queries * 1e9);
+
+  int result = singleChecksum == batchChecksum ? 0 : 1;
+  if (result)
+    printf("results differ\n");
+
+  free(out);
+  free(nums);
+  free(numbers);
+  phfwdDelete(pf);
+  return result;
+}
@@ -5,13 +5,24 @@
 /// @copyright Uniwersytet Warszawski
 /// @date 27.05.2018
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
-#include <ctype.h> // for isspace
+#include <errno.h>
 #include <malloc.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "input_parser.h"
+#include "output_writer.h"
 #include "util.h"
 
 /// @brief Enumeracja opisująca typ pojedyńczego leksemu.
@@ -22,64 +33,214 @@ enum InputType {
   IN_OPERATOR_DEL = 8,       ///< Operator usunięcia bazy.
   IN_OPERATOR_GET = 16,      ///< Operator '?' funckji Get i Reverse.
   IN_OPERATOR_REDIRECT = 32, ///< Operator dodawania przekierowań telefonów.
-  IN_OPERATOR_NON_TRIV = 64  ///< Operator funkcji NonTrivialCount.
+  IN_OPERATOR_NON_TRIV = 64, ///< Operator funkcji NonTrivialCount.
+  IN_OPERATOR_SAVE = 128,    ///< Operator zapisu bazy do pliku.
+  IN_OPERATOR_LOAD = 256,    ///< Operator wczytania bazy z pliku.
+  IN_PATH = 512              ///< Ścieżka do pliku, argument SAVE i LOAD.
 };
 
 /// @brief Pojedyńczy leksem pojawiający się w wejściu.
 /// Jego typ określa enumeracja @ref InputType, w przypadku numerów telefonu
-/// oraz identifikatorów posiada też on zaalokowany text.
+/// oraz identifikatorów jego treść leży w buforze wejścia.
 struct InputUnit {
   /// @brief Typ leksemu.
   /// Typ opisywany przez enumeracje @ref InputType.
   enum InputType type;
 
-  /// @brief Zawartość leksemu, jeśli nie jest on operatorem.
-  /// W przypadku, gdy @ref type nie jest typu @ref IN_PHONE_NUMBER lub @ref
-  /// IN_IDENTIFIER, ma wartość @p NULL.
-  char *value;
+  /// @brief Pozycja pierwszego znaku leksemu w wejściu, licząc od 0.
+  /// Ma znaczenie tylko, gdy @ref type jest typu @ref IN_PHONE_NUMBER, @ref
+  /// IN_IDENTIFIER lub @ref IN_PATH, oraz dla operatorów @ref
+  /// IN_OPERATOR_SAVE i @ref IN_OPERATOR_LOAD, które poza początkiem operacji
+  /// są identyfikatorami.
+  size_t valueOffset;
+
+  /// @brief Długość leksemu, jeśli nie jest on operatorem.
+  /// W przypadku, gdy @ref type nie jest typu @ref IN_PHONE_NUMBER, @ref
+  /// IN_IDENTIFIER lub @ref IN_PATH, ma wartość 0.
+  size_t valueLength;
 };
 
+/// Liczba znaków wczytywanych ze standardowego wejścia na raz.
+#define INPUT_CHUNK_SIZE (64 * 1024)
+
+/// Wartość @ref InputBuffer.retainFrom, gdy nie trzeba zachowywać leksemów.
+#define INPUT_NO_RETAIN ((size_t)-1)
+
+/// @brief Bufor standardowego wejścia.
+/// Wejście wczytywane jest dużymi blokami. Przy wczytywaniu kolejnego bloku z
+/// bufora usuwane są już przetworzone znaki, poza treścią leksemów bieżącej
+/// operacji, które zostają przesunięte na początek bufora.
+struct InputBuffer {
+  /// Zawartość bufora.
+  char *data;
+
+  /// Rozmiar zaalokowanej tablicy @ref data.
+  size_t capacity;
+
+  /// Liczba wczytanych znaków w @ref data.
+  size_t size;
+
+  /// Pozycja w @ref data następnego znaku do przetworzenia.
+  size_t position;
+
+  /// Pozycja w wejściu znaku leżącego w @ref data na pozycji 0.
+  size_t base;
+
+  /// @brief Pozycja w wejściu pierwszego znaku, który musi zostać w buforze.
+  /// Jest to początek pierwszego leksemu bieżącej operacji, lub @ref
+  /// INPUT_NO_RETAIN.
+  size_t retainFrom;
+
+  /// Wartość @p true, gdy napotkano już koniec wejścia.
+  bool eof;
+
+  /// Wartość @p true, gdy nie udało się zaalokować pamięci na bufor.
+  bool failed;
+};
+
+/// Bufor standardowego wejścia.
+static struct InputBuffer input = {NULL, 0, 0, 0, 0, INPUT_NO_RETAIN, false,
+                                   false};
+
+/// @brief Znak zastąpiony przez @p '\0' kończący argument operacji.
+/// Argumenty operacji wskazują na bufor wejścia, więc po wczytaniu całej
+/// operacji znak za każdym z nich zostaje zastąpiony przez @p '\0', a przy
+/// wczytywaniu następnej przywrócony.
+struct InputTerminator {
+  /// Pozycja zastąpionego znaku w wejściu.
+  size_t offset;
+
+  /// Zastąpiony znak.
+  char character;
+};
+
+/// Znaki zastąpione przez zakończenia argumentów ostatniej operacji.
+static struct InputTerminator terminators[2];
+
+/// Liczba elementów tablicy @ref terminators.
+static int terminatorsCount = 0;
+
 /// Index ostatniego wczytanego znaku przez parser, 0, gdy nie został wczytany
-/// jeszcze żadnen znak lub EOF, gdby wczytano EOF.
-static int currentCharacterIdx = 0;
+/// jeszcze żadnen znak. Wczytanie EOF go nie zmienia.
+static size_t currentCharacterIdx = 0;
+
+/// Funkcja wywoływana przed czekaniem na wejście, lub @p NULL.
+static void (*beforeRead)(void) = NULL;
+
+/// @brief Wczytuje do bufora kolejny blok wejścia.
+/// Usuwa z bufora przetworzone znaki, poza tymi od pozycji @ref
+/// InputBuffer.retainFrom, i w razie potrzeby powiększa bufor. Zawsze zostawia
+/// za wczytanymi znakami miejsce na jeden znak @p '\0'. Wczytuje tyle znaków,
+/// ile jest dostępnych, nie więcej niż @ref INPUT_CHUNK_SIZE, więc czeka
+/// tylko wtedy, gdy na wejściu nie ma żadnego znaku.
+/// @return @p true, gdy wczytano jakieś znaki, @p false, gdy napotkano koniec
+///         wejścia lub nie udało się zaalokować pamięci.
+static bool inputRefill() {
+  if (input.eof || input.failed)
+    return false;
+
+  size_t keep = input.position;
+  if (input.retainFrom != INPUT_NO_RETAIN &&
+      input.retainFrom - input.base < keep)
+    keep = input.retainFrom - input.base;
+
+  if (keep > 0) {
+    memmove(input.data, input.data + keep, input.size - keep);
+    input.base += keep;
+    input.size -= keep;
+    input.position -= keep;
+  }
+
+  if (input.capacity - input.size < INPUT_CHUNK_SIZE + 1) {
+    size_t newCapacity = 2 * input.capacity;
+    if (newCapacity < input.size + INPUT_CHUNK_SIZE + 1)
+      newCapacity = input.size + INPUT_CHUNK_SIZE + 1;
+
+    char *newData = realloc(input.data, sizeof(char) * newCapacity);
+    if (!newData) {
+      input.failed = true;
+      return false;
+    }
+
+    input.data = newData;
+    input.capacity = newCapacity;
+  }
+
+  // Whatever waits for the operations read so far is done before the parser
+  // possibly waits for more input.
+  if (beforeRead)
+    beforeRead();
+
+  // Unlike fread, read returns as soon as a line typed on a terminal is
+  // available, instead of waiting for the whole chunk.
+  ssize_t count =
+      read(STDIN_FILENO, input.data + input.size, INPUT_CHUNK_SIZE);
+  while (count < 0 && errno == EINTR)
+    count = read(STDIN_FILENO, input.data + input.size, INPUT_CHUNK_SIZE);
+
+  if (count <= 0) {
+    input.eof = true;
+    return false;
+  }
+
+  input.size += count;
+  return true;
+}
 
 /// @brief Wczytuje kolekny znak z wejścia.
 /// Wczytuje pojedyńczy znak wejścia, zwiększając @ref currentCharacterIdx o
 /// 1. Gdy wczytano EOF, nie zwiększa już @ref currentCharacterIdx.
 /// @return Wczytany znak, (gdy napotkano EOF, zwraca EOF).
-static unsigned char getNextCharacter() {
-  int result = getchar();
-  if (result != EOF)
-    currentCharacterIdx++;
+static char getNextCharacter() {
+  if (input.position == input.size && !inputRefill())
+    return EOF;
 
-  return ((unsigned char)result);
+  currentCharacterIdx++;
+  return input.data[input.position++];
 }
 
 /// @brief Cofa wczytanie ostatniego znaku przez parser.
-/// Wywołuje ungetc by oddać aktualny znak zpowrotem do strumienia wejścia.
-/// Zakłada powodzenie tej operacji. Gdy dostaje EOF, nie robi nic.
-/// @param[in] c – znak, który ma być oddany do strumienia.
+/// Cofa pozycję w buforze wejścia o jeden znak. Gdy dostaje EOF, nie robi nic.
+/// @param[in] c – ostatnio wczytany znak.
 static void ungetPrevCharacter(const char c) {
   if (c == EOF)
     return;
 
-  int return_value = ungetc(c, stdin);
+  assert(input.position > 0);
+  input.position--;
   currentCharacterIdx--;
+}
 
-  // Hide the unused variable warning, when compiling without asserts.
-  (void)return_value;
-  assert(return_value != EOF); // We assume ungetc succeded.
+/// @brief Zwraca pozycję w wejściu następnego znaku do przetworzenia.
+/// @return Liczba znaków wejścia, które zostały przetworzone.
+static inline size_t inputOffset() { return input.base + input.position; }
+
+/// @brief Zwraca treść leksemu jako napis.
+/// Zastępuje znak za leksemem przez @p '\0'. Można wywołać tylko po wczytaniu
+/// wszystkich leksemów operacji, najwyżej dla dwóch leksemów.
+/// @param[in] unit – leksem, którego treść zwracamy.
+/// @return Wskaźnik na treść leksemu w buforze wejścia, ważny do następnego
+///         wywołania @ref inputParseNextOperation.
+static char *inputUnitTerminate(const struct InputUnit *unit) {
+  assert(terminatorsCount < 2);
+  assert(unit->valueOffset >= input.base);
+
+  char *result = input.data + (unit->valueOffset - input.base);
+  terminators[terminatorsCount++] =
+      (struct InputTerminator){unit->valueOffset + unit->valueLength,
+                               result[unit->valueLength]};
+  result[unit->valueLength] = '\0';
+
+  return result;
 }
 
 /// @brief Sprawdza czy znak jest białym znakiem.
-/// Sprawdza czy znak jest białym znakiem. Kożysta z funkcji @p isspace z @p
-/// ctype.h
+/// Sprawdza czy znak jest białym znakiem, tak jak @p isspace z @p ctype.h w
+/// domyślnym locale "C": spacją lub jednym ze znaków od @p '\t' do @p '\r'.
 /// @param[in] c – znak do sprawdzenia.
 /// @return 1, gdy @p c jest uznawane za biały znak, 0 w przeciwnym wypadku.
 static inline int isWhitespace(const char c) {
-  if (isspace(c))
-    return 1;
-  return 0;
+  return (c == ' ' || ('\t' <= c && c <= '\r'));
 }
 
 /// @brief Sprawdza czy znak jest cyfrą.
@@ -97,6 +258,15 @@ static inline int isAlphaNumeric(const char c) {
   return (isNumeric(c) || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z'));
 }
 
+/// @brief Sprawdza czy znak może należeć do ścieżki.
+/// Ścieżka kończy się na białym znaku lub na znaku @p '$', od którego może
+/// zaczynać się komentarz.
+/// @param[in] c – znak do sprawdzenia.
+/// @return 1, gdy @p c może należeć do ścieżki, 0 w przeciwnym wypadku.
+static inline int isPathCharacter(const char c) {
+  return (c != EOF && c != '\0' && c != '$' && !isWhitespace(c));
+}
+
 /// @brief Sprawdza czy znak może być 'cyfrą' numeru telefonu.
 /// Sprawdza czy znak @p c jest cyfrą, ':', ';' (w ascii).
 /// @param[in] c – znak do sprawdzenia.
@@ -106,32 +276,144 @@ static inline int isPhoneNumberDigit(const char c) {
   return ('0' <= c && c <= ';');
 }
 
+/// @brief Liczy znaki numeru telefonu na początku napisu.
+/// Sprawdza po 32 (AVX2) lub 16 (SSE2) znaków na raz, gdy procesor i
+/// kompilator to umożliwiają, a resztę po jednym znaku.
+/// @param[in] text – początek sprawdzanego obszaru.
+/// @param[in] length – długość sprawdzanego obszaru.
+/// @return Długość najdłuższego prefiksu @p text złożonego ze znaków, dla
+///         których @ref isPhoneNumberDigit zwraca 1.
+static size_t scanPhoneNumberDigits(const char *text, size_t length) {
+  size_t result = 0;
+
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i below = _mm256_set1_epi8('0' - 1);
+  const __m256i above = _mm256_set1_epi8(';' + 1);
+  for (; result + 32 <= length; result += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + result));
+    __m256i inSet = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, below),
+                                     _mm256_cmpgt_epi8(above, chunk));
+    uint32_t outside = ~(uint32_t)_mm256_movemask_epi8(inSet);
+    if (outside)
+      return result + __builtin_ctz(outside);
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i below = _mm_set1_epi8('0' - 1);
+  const __m128i above = _mm_set1_epi8(';' + 1);
+  for (; result + 16 <= length; result += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(text + result));
+    __m128i inSet = _mm_and_si128(_mm_cmpgt_epi8(chunk, below),
+                                  _mm_cmpgt_epi8(above, chunk));
+    uint32_t outside = ~(uint32_t)_mm_movemask_epi8(inSet) & 0xFFFF;
+    if (outside)
+      return result + __builtin_ctz(outside);
+  }
+#endif
+
+  while (result < length && isPhoneNumberDigit(text[result]))
+    result++;
+
+  return result;
+}
+
+/// @brief Liczy białe znaki na początku napisu.
+/// Sprawdza po 32 (AVX2) lub 16 (SSE2) znaków na raz, gdy procesor i
+/// kompilator to umożliwiają, a resztę po jednym znaku.
+/// @param[in] text – początek sprawdzanego obszaru.
+/// @param[in] length – długość sprawdzanego obszaru.
+/// @return Długość najdłuższego prefiksu @p text złożonego ze znaków, dla
+///         których @ref isWhitespace zwraca 1.
+static size_t scanWhitespace(const char *text, size_t length) {
+  size_t result = 0;
+
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i below = _mm256_set1_epi8('\t' - 1);
+  const __m256i above = _mm256_set1_epi8('\r' + 1);
+  for (; result + 32 <= length; result += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + result));
+    __m256i inSet = _mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, space),
+        _mm256_and_si256(_mm256_cmpgt_epi8(chunk, below),
+                         _mm256_cmpgt_epi8(above, chunk)));
+    uint32_t outside = ~(uint32_t)_mm256_movemask_epi8(inSet);
+    if (outside)
+      return result + __builtin_ctz(outside);
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i below = _mm_set1_epi8('\t' - 1);
+  const __m128i above = _mm_set1_epi8('\r' + 1);
+  for (; result + 16 <= length; result += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(text + result));
+    __m128i inSet =
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                     _mm_and_si128(_mm_cmpgt_epi8(chunk, below),
+                                   _mm_cmpgt_epi8(above, chunk)));
+    uint32_t outside = ~(uint32_t)_mm_movemask_epi8(inSet) & 0xFFFF;
+    if (outside)
+      return result + __builtin_ctz(outside);
+  }
+#endif
+
+  while (result < length && isWhitespace(text[result]))
+    result++;
+
+  return result;
+}
+
+/// @brief Pomija ciąg znaków w buforze wejścia.
+/// Przesuwa pozycję w buforze wejścia za najdłuższy ciąg nieprzetworzonych
+/// znaków, dla których @p scan zwraca ich długość, tak jakby zostały one
+/// wczytane przez @ref getNextCharacter. Nie wczytuje kolejnych bloków wejścia.
+/// @param[in] scan – funkcja licząca długość pomijanego ciągu.
+static inline void inputSkip(size_t (*scan)(const char *, size_t)) {
+  if (input.position < input.size) {
+    size_t run = scan(input.data + input.position, input.size - input.position);
+    input.position += run;
+    currentCharacterIdx += run;
+  }
+}
+
 /// @brief Zgłasza błąd syntaktyczny parsera.
 /// Wypisuje informacje o błędzie na standardowy wyjście diagnostyczne w
 /// formacjie opisanym w treści drugiej częsci zadania.
-/// @param[in] characterIdx – Znak na, którym zdarzył się bład. (Może być EOF).
-static inline void printSyntaxError(const int characterIdx) {
-  if (characterIdx == EOF)
-    fprintf(stderr, "ERROR EOF\n");
-  else
-    fprintf(stderr, "ERROR %d\n", characterIdx);
+/// @param[in] characterIdx – Znak na, którym zdarzył się bład.
+static inline void printSyntaxError(const size_t characterIdx) {
+  // Everything printed before the error must come out before it.
+  outputFlush();
+  fprintf(stderr, "ERROR %zu\n", characterIdx);
+}
+
+/// @brief Zgłasza nieoczekiwany koniec wejścia.
+/// Wypisuje na standardowe wyjście diagnostyczne informację, że wejście
+/// skończyło się w środku operacji lub komentarza.
+static inline void printEofError() {
+  // Everything printed before the error must come out before it.
+  outputFlush();
+  fprintf(stderr, "ERROR EOF\n");
 }
 
 /// @brief Zwraca liczbę znaków leksemu.
 /// Dla każdego operatora rozmiar jest stały, dla identyfikatorów i numerów
-/// wywoływana jest funckja strlen na atrybucie przekazanej struktury.
+/// zwracana jest długość ich treści.
 /// @param[in] inunit – leksem, dla którego należy policzyć długość.
 /// @return Liczbę znaków przekazanego leksemu.
-static int inputUnitGetSize(struct InputUnit *inunit) {
+static size_t inputUnitGetSize(const struct InputUnit *inunit) {
   switch (inunit->type) {
   case IN_PHONE_NUMBER:
   case IN_IDENTIFIER:
-    return strlen(inunit->value);
+  case IN_PATH:
+    return inunit->valueLength;
 
   case IN_OPERATOR_NEW:
   case IN_OPERATOR_DEL:
     return 3;
 
+  case IN_OPERATOR_SAVE:
+  case IN_OPERATOR_LOAD:
+    return 4;
+
   case IN_OPERATOR_GET:
   case IN_OPERATOR_REDIRECT:
   case IN_OPERATOR_NON_TRIV:
@@ -143,25 +425,73 @@ static int inputUnitGetSize(struct InputUnit *inunit) {
   }
 }
 
+/// @brief Wczytuje ścieżkę.
+/// Wczytuje najdłuższy ciąg znaków, dla których @ref isPathCharacter zwraca 1,
+/// zaczynający się od już wczytanego znaku. Treść ścieżki zostaje w buforze
+/// wejścia do końca bieżącej operacji.
+/// @param[out] out_result – wskaźnik na strukturę przechowująca wynikowy
+///                          leksem.
+/// @return IF_OK, gdy udało się wczytać ścieżkę, IF_ERROR, gdy nie udało się
+///         zaalokować pamięci na bufor wejścia.
+static enum InputFeedback inputGetPath(struct InputUnit *out_result) {
+  size_t start = inputOffset() - 1;
+  if (input.retainFrom == INPUT_NO_RETAIN)
+    input.retainFrom = start;
+
+  size_t end = inputOffset();
+  char next;
+  while (isPathCharacter(next = getNextCharacter()))
+    end = inputOffset();
+
+  if (input.failed) {
+    printSyntaxError(currentCharacterIdx);
+    return IF_ERROR;
+  }
+
+  if (next != EOF)
+    ungetPrevCharacter(next);
+
+  out_result->type = IN_PATH;
+  out_result->valueOffset = start;
+  out_result->valueLength = end - start;
+  return IF_OK;
+}
+
 /// @brief Parsuje następny leskem z weścia.
 /// Pomija białe znaki i komentarze i parsuje następny leksem ze standardowego
-/// wejścia. Alokuje pamięć tylko, gdy zwrócone zostanie @p IF_OK. Gdy zwrócony
-/// jest IF_ERROR, funkcja wypisała już informacje o błędzie na standardowe
-/// wyjście.
+/// wejścia. Treść leksemu zostaje w buforze wejścia do końca bieżącej operacji.
+/// Gdy zwrócony jest IF_ERROR, funkcja wypisała już informacje o błędzie na
+/// standardowe wyjście.
 /// @param[out] out_result – wskaźnik na strukturę przechowująca wynikowy
 ///                          leksem.
 /// @param[out] first_character_idx – wskaźnik na indeks pierwszej litery
 ///                                   wynikowego leksemu.
+/// @param[in] path – gdy @p true, leksem jest wczytywany jako ścieżka, jeśli
+///                   nie zaczyna się komentarzem.
 /// @return Jedną z wartości enumeracji @p InputFeedback. IN_OK, gdy udało się
 ///         wczytać leksem, IF_ERROR, gdy napotkano błąd składniowy, IF_EOF gdy
 ///         zamiast leksemu napotkano EOF.
 static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
-                                           int *first_character_idx) {
+                                           size_t *first_character_idx,
+                                           bool path) {
+  // Whole runs of whitespace that are already in the buffer are skipped at
+  // once.
   char c;
   do {
+    inputSkip(scanWhitespace);
     c = getNextCharacter();
   } while (isWhitespace(c));
 
+  // A path may contain characters that are operators elsewhere.
+  if (path && isPathCharacter(c)) {
+    if (inputGetPath(out_result) == IF_ERROR)
+      return IF_ERROR;
+
+    (*first_character_idx) =
+        currentCharacterIdx + 1 - inputUnitGetSize(out_result);
+    return IF_OK;
+  }
+
   switch (c) {
   // No more reading from input. It does NOT have to be an error, but it
   // can. We just pass information about EOF into previous function.
@@ -185,7 +515,7 @@ static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
     do {
       // EOF when we are inside comment gives always: ERROR EOF
       if (current == EOF) {
-        printSyntaxError(EOF);
+        printEofError();
         return IF_ERROR;
       }
 
@@ -194,24 +524,24 @@ static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
     } while (!(prev == '$' && current == '$'));
 
     // Now after we skip a comment, we call the same function once more.
-    return inputGetNextUnit(out_result, first_character_idx);
+    return inputGetNextUnit(out_result, first_character_idx, path);
   }
 
   case '?': {
     out_result->type = IN_OPERATOR_GET;
-    out_result->value = NULL;
+    out_result->valueLength = 0;
     break;
   }
 
   case '@': {
     out_result->type = IN_OPERATOR_NON_TRIV;
-    out_result->value = NULL;
+    out_result->valueLength = 0;
     break;
   }
 
   case '>': {
     out_result->type = IN_OPERATOR_REDIRECT;
-    out_result->value = NULL;
+    out_result->valueLength = 0;
     break;
   }
 
@@ -230,56 +560,62 @@ static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
         parse_phone_number = 0;
       }
 
-      int buffer_capacity = 32;
-      int buffer_idx = 1;
-      char *buffer = malloc(sizeof(char) * buffer_capacity);
-      buffer[0] = c;
-      buffer[1] = '\0';
-
-      char next = getNextCharacter();
-
-      while (parse_phone_number ? isPhoneNumberDigit(next)
-                                : isAlphaNumeric(next)) {
-        if (buffer_idx >= buffer_capacity - 1) {
-          buffer_capacity *= 2;
-
-          char *newBuffer = realloc(buffer, sizeof(char) * buffer_capacity);
-          if (newBuffer == NULL) {
-            // In case that realloc fails, the old memory is still valid, so we
-            // have to free 'it!
-            free(buffer);
-
-            // If memory error has occured, error is returned with the character
-            // index, that caused buffer overflow.
-            printSyntaxError(currentCharacterIdx);
-            return IF_ERROR;
-          } else
-            buffer = newBuffer;
-
-          assert(buffer_idx < buffer_capacity);
-        }
-
-        buffer[buffer_idx++] = next;
-        buffer[buffer_idx] = '\0';
+      // The content of the unit stays in the input buffer until the whole
+      // operation is read.
+      size_t start = inputOffset() - 1;
+      if (input.retainFrom == INPUT_NO_RETAIN)
+        input.retainFrom = start;
+
+      // A character read as EOF is not always the end of the input, so the
+      // end of the unit is tracked separately.
+      size_t end = inputOffset();
+      char next;
+      for (;;) {
+        // Digits of a phone number that are already in the buffer are
+        // skipped at once.
+        if (parse_phone_number)
+          inputSkip(scanPhoneNumberDigits);
+        end = inputOffset();
 
         next = getNextCharacter();
+        if (!(parse_phone_number ? isPhoneNumberDigit(next)
+                                 : isAlphaNumeric(next)))
+          break;
+
+        end = inputOffset();
+      }
+
+      if (input.failed) {
+        // If memory error has occured, error is returned with the character
+        // index, that caused buffer overflow.
+        printSyntaxError(currentCharacterIdx);
+        return IF_ERROR;
       }
 
       // Push the non-matching character back to the stream.
       if (next != EOF)
         ungetPrevCharacter(next);
 
-      if (strcmp("NEW", buffer) == 0) {
-        free(buffer);
+      size_t length = end - start;
+      const char *value = input.data + (start - input.base);
+      if (length == 3 && memcmp("NEW", value, 3) == 0) {
         out_result->type = IN_OPERATOR_NEW;
-        out_result->value = NULL;
-      } else if (strcmp("DEL", buffer) == 0) {
-        free(buffer);
+        out_result->valueLength = 0;
+      } else if (length == 3 && memcmp("DEL", value, 3) == 0) {
         out_result->type = IN_OPERATOR_DEL;
-        out_result->value = NULL;
+        out_result->valueLength = 0;
+      } else if (length == 4 && memcmp("SAVE", value, 4) == 0) {
+        out_result->type = IN_OPERATOR_SAVE;
+        out_result->valueOffset = start;
+        out_result->valueLength = 0;
+      } else if (length == 4 && memcmp("LOAD", value, 4) == 0) {
+        out_result->type = IN_OPERATOR_LOAD;
+        out_result->valueOffset = start;
+        out_result->valueLength = 0;
       } else {
         out_result->type = parse_phone_number ? IN_PHONE_NUMBER : IN_IDENTIFIER;
-        out_result->value = buffer;
+        out_result->valueOffset = start;
+        out_result->valueLength = length;
       }
     }
 
@@ -301,7 +637,10 @@ static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
 /// @brief Wczytuje leksem określonego typu.
 /// Próbuje wczytać leksem określonego typu; gdy nie ma błędu składniowego, ale
 /// typ wczytanego leksemu nie należy do zbioru oczekiwanych zkłasza bład i
-/// zwraca IF_ERROR.
+/// zwraca IF_ERROR. Słowa @p SAVE i @p LOAD są operatorami tylko tam, gdzie
+/// operatory są oczekiwane, a w pozostałych miejscach identyfikatorami, tak
+/// jak przed wprowadzeniem tych operatorów. Gdy oczekiwana jest @ref IN_PATH,
+/// leksem jest wczytywany jako ścieżka.
 /// @param[out] out_res – wskaźnik na strukturę przechowująca wynikowy leksem.
 /// @param[out] out_first_character_idx – wskaźnik na indeks pierwszej litery
 ///                                       wynikowego leksemu.
@@ -313,13 +652,13 @@ static enum InputFeedback inputGetNextUnit(struct InputUnit *out_result,
 ///                                  bład, wypisany jest stosowny komunikat, a
 ///                                  funckja zwraca IF_ERORR zamiat IF_EOF.
 static enum InputFeedback inputReadUnitWithType(struct InputUnit *out_res,
-                                                int *out_first_character_idx,
+                                                size_t *out_first_character_idx,
                                                 enum InputType expected_type,
                                                 int handle_eof_as_error) {
-  struct InputUnit current_unit = {0, NULL};
-  int current_unit_input_idx = 0;
-  enum InputFeedback feedback =
-      inputGetNextUnit(&current_unit, &current_unit_input_idx);
+  struct InputUnit current_unit = {0, 0, 0};
+  size_t current_unit_input_idx = 0;
+  enum InputFeedback feedback = inputGetNextUnit(
+      &current_unit, &current_unit_input_idx, (expected_type & IN_PATH) != 0);
 
   if (feedback == IF_ERROR)
     return feedback;
@@ -328,7 +667,7 @@ static enum InputFeedback inputReadUnitWithType(struct InputUnit *out_res,
   // reported.
   if (feedback == IF_EOF) {
     if (handle_eof_as_error) {
-      printSyntaxError(EOF);
+      printEofError();
       return IF_ERROR;
     } else
       return IF_EOF;
@@ -336,6 +675,12 @@ static enum InputFeedback inputReadUnitWithType(struct InputUnit *out_res,
 
   assert(feedback == IF_OK);
 
+  if ((current_unit.type & (IN_OPERATOR_SAVE | IN_OPERATOR_LOAD)) &&
+      !(current_unit.type & expected_type) && (expected_type & IN_IDENTIFIER)) {
+    current_unit.type = IN_IDENTIFIER;
+    current_unit.valueLength = 4;
+  }
+
   if (current_unit.type & expected_type) {
     // Fill the out data:
     (*out_res) = current_unit;
@@ -343,10 +688,6 @@ static enum InputFeedback inputReadUnitWithType(struct InputUnit *out_res,
 
     return IF_OK;
   } else {
-    // Free current_unit content, which was allocated.
-    if (current_unit.value)
-      free(current_unit.value);
-
     // Error because unit of this type was not expected in this context.
     printSyntaxError(current_unit_input_idx);
     return IF_ERROR;
@@ -383,13 +724,23 @@ void printOperationError(const struct Operation *op) {
     operator_name = "@";
     break;
 
+  case OT_SAVE:
+    operator_name = "SAVE";
+    break;
+
+  case OT_LOAD:
+    operator_name = "LOAD";
+    break;
+
   // NOTE: Should not reach.
   default:
     assert(!"Unexpected operation type.");
     break;
   }
 
-  fprintf(stderr, "ERROR %s %d\n", operator_name, op->operator_idx);
+  // Everything printed before the error must come out before it.
+  outputFlush();
+  fprintf(stderr, "ERROR %s %zu\n", operator_name, op->operator_idx);
 }
 
 /// @brief Pomocnicze makro wykorzystywane w @ref inputParseNextOperation.
@@ -403,17 +754,19 @@ void printOperationError(const struct Operation *op) {
        : 0)
 
 /// @brief Pomocnicze makro wykorzystywane w @ref inputParseNextOperation.
-/// Czyści tablice leksemów do elementu o numerze IDX i zwraca wynik wczytania
-/// ostatniego z nich.
-#define CLEAR_AND_RETURN_LAST_FEEDBACK(IDX)                                    \
-  do {                                                                         \
-    for (int _i = 0; _i <= (IDX); ++_i)                                        \
-      if (current_unit[_i].value) {                                            \
-        free(current_unit[_i].value);                                          \
-        current_unit[_i].value = NULL;                                         \
-      }                                                                        \
-    return current_feedback[(IDX)];                                            \
-  } while (0)
+/// Zwraca wynik wczytania leksemu o numerze IDX.
+#define RETURN_LAST_FEEDBACK(IDX) return current_feedback[(IDX)]
+
+void inputSetBeforeRead(void (*hook)(void)) {
+  beforeRead = hook;
+}
+
+void inputParserFree() {
+  free(input.data);
+  input =
+      (struct InputBuffer){NULL, 0, 0, 0, 0, INPUT_NO_RETAIN, false, false};
+  terminatorsCount = 0;
+}
 
 enum InputFeedback inputParseNextOperation(struct Operation *out_result) {
   // NOTE: Possible scenarios:
@@ -424,35 +777,46 @@ enum InputFeedback inputParseNextOperation(struct Operation *out_result) {
   //   number ?
   //   ? number
   //   @ number
+  //   SAVE path
+  //   LOAD path
 
   const int MAX_UNITS_IN_STATEMENT = 3;
   struct InputUnit current_unit[MAX_UNITS_IN_STATEMENT];
-  int current_unit_input_idx[MAX_UNITS_IN_STATEMENT];
+  size_t current_unit_input_idx[MAX_UNITS_IN_STATEMENT];
   enum InputFeedback current_feedback[MAX_UNITS_IN_STATEMENT];
   for (int i = 0; i < 3; ++i)
-    current_unit[i] = (struct InputUnit){0};
+    current_unit[i] = (struct InputUnit){0, 0, 0};
+
+  // Arguments of the previous operation are no longer used, so their
+  // terminators are replaced back with the input characters and their content
+  // may be dropped from the buffer.
+  for (int i = terminatorsCount - 1; i >= 0; --i)
+    input.data[terminators[i].offset - input.base] = terminators[i].character;
+  terminatorsCount = 0;
+  input.retainFrom = INPUT_NO_RETAIN;
 
   if (LOAD_UNIT_WITH_TYPE(0,
                           IN_OPERATOR_NEW | IN_OPERATOR_DEL | IN_PHONE_NUMBER |
-                              IN_OPERATOR_GET | IN_OPERATOR_NON_TRIV,
+                              IN_OPERATOR_GET | IN_OPERATOR_NON_TRIV |
+                              IN_OPERATOR_SAVE | IN_OPERATOR_LOAD,
                           0)) {
     switch (current_unit[0].type) {
     case IN_OPERATOR_NEW: {
       if (LOAD_UNIT_WITH_TYPE(1, IN_IDENTIFIER, 1)) {
         (*out_result) =
-            (struct Operation){.args[0] = duplicateStr(current_unit[1].value),
+            (struct Operation){.args[0] = inputUnitTerminate(&current_unit[1]),
                                .args[1] = NULL,
                                .performed_operation = OT_ADD,
                                .operator_idx = current_unit_input_idx[0]};
       }
 
-      CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+      RETURN_LAST_FEEDBACK(1);
     }
 
     case IN_OPERATOR_DEL: {
       if (LOAD_UNIT_WITH_TYPE(1, IN_IDENTIFIER | IN_PHONE_NUMBER, 1)) {
         (*out_result) = (struct Operation){
-            .args[0] = duplicateStr(current_unit[1].value),
+            .args[0] = inputUnitTerminate(&current_unit[1]),
             .args[1] = NULL,
             .performed_operation = current_unit[1].type == IN_IDENTIFIER
                                        ? OT_DEL_DATABASE
@@ -460,14 +824,14 @@ enum InputFeedback inputParseNextOperation(struct Operation *out_result) {
             .operator_idx = current_unit_input_idx[0]};
       }
 
-      CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+      RETURN_LAST_FEEDBACK(1);
     }
 
     case IN_PHONE_NUMBER: {
       if (LOAD_UNIT_WITH_TYPE(1, IN_OPERATOR_GET | IN_OPERATOR_REDIRECT, 1)) {
         if (current_unit[1].type == IN_OPERATOR_GET) {
           (*out_result) =
-              (struct Operation){.args[0] = duplicateStr(current_unit[0].value),
+              (struct Operation){.args[0] = inputUnitTerminate(&current_unit[0]),
                                  .args[1] = NULL,
                                  .performed_operation = OT_GET,
                                  .operator_idx = current_unit_input_idx[1]};
@@ -475,42 +839,56 @@ enum InputFeedback inputParseNextOperation(struct Operation *out_result) {
           assert(current_unit[1].type == IN_OPERATOR_REDIRECT);
           if (LOAD_UNIT_WITH_TYPE(2, IN_PHONE_NUMBER, 1)) {
             (*out_result) = (struct Operation){
-                .args[0] = duplicateStr(current_unit[0].value),
-                .args[1] = duplicateStr(current_unit[2].value),
+                .args[0] = inputUnitTerminate(&current_unit[0]),
+                .args[1] = inputUnitTerminate(&current_unit[2]),
                 .performed_operation = OT_REDIRECT,
                 .operator_idx = current_unit_input_idx[1]};
           }
 
-          CLEAR_AND_RETURN_LAST_FEEDBACK(2);
+          RETURN_LAST_FEEDBACK(2);
         }
 
-        CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+        RETURN_LAST_FEEDBACK(1);
       }
-      CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+      RETURN_LAST_FEEDBACK(1);
     }
 
     case IN_OPERATOR_GET: {
       if (LOAD_UNIT_WITH_TYPE(1, IN_PHONE_NUMBER, 1)) {
         (*out_result) =
-            (struct Operation){.args[0] = duplicateStr(current_unit[1].value),
+            (struct Operation){.args[0] = inputUnitTerminate(&current_unit[1]),
                                .args[1] = NULL,
                                .performed_operation = OT_REVERSE,
                                .operator_idx = current_unit_input_idx[0]};
       }
 
-      CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+      RETURN_LAST_FEEDBACK(1);
     }
 
     case IN_OPERATOR_NON_TRIV: {
       if (LOAD_UNIT_WITH_TYPE(1, IN_PHONE_NUMBER, 1)) {
         (*out_result) =
-            (struct Operation){.args[0] = duplicateStr(current_unit[1].value),
+            (struct Operation){.args[0] = inputUnitTerminate(&current_unit[1]),
                                .args[1] = NULL,
                                .performed_operation = OT_NON_TRIV,
                                .operator_idx = current_unit_input_idx[0]};
       }
 
-      CLEAR_AND_RETURN_LAST_FEEDBACK(1);
+      RETURN_LAST_FEEDBACK(1);
+    }
+
+    case IN_OPERATOR_SAVE:
+    case IN_OPERATOR_LOAD: {
+      if (LOAD_UNIT_WITH_TYPE(1, IN_PATH, 1)) {
+        (*out_result) = (struct Operation){
+            .args[0] = inputUnitTerminate(&current_unit[1]),
+            .args[1] = NULL,
+            .performed_operation =
+                current_unit[0].type == IN_OPERATOR_SAVE ? OT_SAVE : OT_LOAD,
+            .operator_idx = current_unit_input_idx[0]};
+      }
+
+      RETURN_LAST_FEEDBACK(1);
     }
 
     // NOTE: Should not reach.
@@ -519,6 +897,6 @@ enum InputFeedback inputParseNextOperation(struct Operation *out_result) {
       return IF_ERROR;
     }
   } else {
-    CLEAR_AND_RETURN_LAST_FEEDBACK(0);
+    RETURN_LAST_FEEDBACK(0);
   }
 }
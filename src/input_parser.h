@@ -8,6 +8,8 @@
 #ifndef __INPUT_PARSER_H__
 #define __INPUT_PARSER_H__
 
+#include <stddef.h>
+
 /// Typ pojedynczej operacji udostępnianej przez program.
 enum OperationType {
   OT_ADD,           ///< Dodanie nowej bazy przekierowań.
@@ -16,7 +18,9 @@ enum OperationType {
   OT_REDIRECT,      ///< Dodanie przekierowania.
   OT_GET,           ///< Wypisanie przekierowania z numeru.
   OT_REVERSE,       ///< Wypisanie wszystkich przekierowań na numer.
-  OT_NON_TRIV       ///< Policzenie nietrywialnych numerów o znakach danego numeru.
+  OT_NON_TRIV,      ///< Policzenie nietrywialnych numerów o znakach danego numeru.
+  OT_SAVE,          ///< Zapisanie aktualnej bazy do pliku.
+  OT_LOAD           ///< Zastąpienie aktualnej bazy wczytaną z pliku.
 };
 
 /// Informacja zwrotna funckji parsujących wejście. Gdy funckja zwraca IF_ERROR
@@ -31,14 +35,16 @@ enum InputFeedback {
 /// @brief Pojedyńcza operacja.
 /// Struktura pojedynczej operacji jaką udostępnia program.
 struct Operation {
-  /// Argumenty operacji.
+  /// @brief Argumenty operacji.
+  /// Wskazują na bufor wejścia parsera i są ważne do następnego wywołania
+  /// @ref inputParseNextOperation lub @ref inputParserFree.
   char *args[2];
 
   /// Typ operacji. Jedna wartość z enumeracji @p OperationType
   enum OperationType performed_operation;
 
   /// Indeks pierwszego znaku operatora operacji w standardowym wejściu.
-  int operator_idx;
+  size_t operator_idx;
 };
 
 /// @brief Wypisuje błąd użycia operatora.
@@ -56,4 +62,16 @@ void printOperationError(const struct Operation *op);
 ///         przez funkcje które wywołuje ta procedura ).
 enum InputFeedback inputParseNextOperation(struct Operation *out_result);
 
+/// @brief Ustawia funkcję wywoływaną przed czekaniem na wejście.
+/// Parser wywołuje @p hook przed każdym wczytaniem kolejnego bloku wejścia,
+/// które może czekać, aż na wejściu pojawią się znaki. Pozwala to np. wypisać
+/// wyniki dotąd wczytanych operacji.
+/// @param[in] hook – wywoływana funkcja, lub @p NULL.
+void inputSetBeforeRead(void (*hook)(void));
+
+/// @brief Zwalnia pamięć parsera.
+/// Zwalnia bufor wejścia. Argumenty ostatnio wczytanej operacji przestają być
+/// ważne.
+void inputParserFree();
+
 #endif /* __INPUT_PARSER_H__ */
@@ -0,0 +1,103 @@
+/// @file
+/// Implementacja modułu puli pamięci na obiekty stałego rozmiaru.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "mem_pool.h"
+
+void memoryPoolInit(struct MemoryPool *pool, size_t objectSize) {
+  assert(pool);
+  assert(objectSize > 0);
+
+  // Every object must be able to hold the free list link, and all of them
+  // must stay aligned to the pointer size.
+  if (objectSize < sizeof(void *))
+    objectSize = sizeof(void *);
+  objectSize = (objectSize + sizeof(void *) - 1) / sizeof(void *) *
+               sizeof(void *);
+
+  size_t objectsPerSlab =
+      (MEMORY_SLAB_SIZE - sizeof(struct MemorySlab)) / objectSize;
+
+  (*pool) = (struct MemoryPool){.objectSize = objectSize,
+                                .objectsPerSlab =
+                                    objectsPerSlab > 0 ? objectsPerSlab : 1,
+                                .slabs = NULL,
+                                .freeList = NULL,
+                                .bumpCurrent = NULL,
+                                .bumpEnd = NULL};
+}
+
+void *memoryPoolAlloc(struct MemoryPool *pool) {
+  if (pool->freeList) {
+    void *result = pool->freeList;
+    pool->freeList = *(void **)result;
+    return result;
+  }
+
+  if (pool->bumpCurrent == pool->bumpEnd) {
+    size_t objectsBytes = pool->objectSize * pool->objectsPerSlab;
+    struct MemorySlab *slab =
+        malloc(sizeof(struct MemorySlab) + objectsBytes);
+    if (!slab)
+      return NULL;
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->bumpCurrent = (char *)(slab + 1);
+    pool->bumpEnd = pool->bumpCurrent + objectsBytes;
+  }
+
+  void *result = pool->bumpCurrent;
+  pool->bumpCurrent += pool->objectSize;
+  return result;
+}
+
+void memoryPoolFree(struct MemoryPool *pool, void *object) {
+  if (object) {
+    *(void **)object = pool->freeList;
+    pool->freeList = object;
+  }
+}
+
+void memoryPoolMerge(struct MemoryPool *pool, struct MemoryPool *other) {
+  assert(pool->objectSize == other->objectSize);
+
+  if (other->slabs) {
+    struct MemorySlab *last = other->slabs;
+    while (last->next)
+      last = last->next;
+
+    last->next = pool->slabs;
+    pool->slabs = other->slabs;
+  }
+
+  // The objects never handed out by the other pool become free objects.
+  for (; other->bumpCurrent != other->bumpEnd;
+       other->bumpCurrent += other->objectSize)
+    memoryPoolFree(pool, other->bumpCurrent);
+
+  while (other->freeList) {
+    void *object = other->freeList;
+    other->freeList = *(void **)object;
+    memoryPoolFree(pool, object);
+  }
+
+  other->slabs = NULL;
+  other->bumpCurrent = other->bumpEnd = NULL;
+}
+
+void memoryPoolClear(struct MemoryPool *pool) {
+  struct MemorySlab *current = pool->slabs;
+  while (current) {
+    struct MemorySlab *next = current->next;
+    free(current);
+    current = next;
+  }
+
+  memoryPoolInit(pool, pool->objectSize);
+}
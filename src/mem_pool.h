@@ -0,0 +1,83 @@
+/// @file
+/// Interfejs modułu puli pamięci na obiekty stałego rozmiaru.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __MEM_POOL_H__
+#define __MEM_POOL_H__
+
+#include <stddef.h>
+
+/// Przybliżony rozmiar (w bajtach) pojedynczego bloku pamięci puli.
+#define MEMORY_SLAB_SIZE (64 * 1024)
+
+/// @brief Nagłówek pojedynczego bloku pamięci.
+/// Zaraz za nagłówkiem w pamięci znajdują się obiekty przydzielane przez pulę.
+struct MemorySlab {
+  /// Wskaźnik na następny blok puli, lub @p NULL, gdy ten jest ostatni.
+  struct MemorySlab *next;
+};
+
+/// @brief Pula pamięci na obiekty stałego rozmiaru.
+/// Obiekty przydzielane są kolejno z dużych bloków (@ref MemorySlab), a
+/// zwolnione obiekty trafiają na listę wolnych obiektów i są używane ponownie
+/// przed przydzieleniem nowego miejsca. Całą pulę można zwolnić w czasie
+/// proporcjonalnym do liczby bloków, bez przechodzenia po obiektach.
+struct MemoryPool {
+  /// Rozmiar pojedynczego obiektu, zaokrąglony w górę do rozmiaru wskaźnika.
+  size_t objectSize;
+
+  /// Liczba obiektów mieszczących się w jednym bloku.
+  size_t objectsPerSlab;
+
+  /// Lista wszystkich bloków zaalokowanych przez pulę.
+  struct MemorySlab *slabs;
+
+  /// @brief Lista zwolnionych obiektów.
+  /// Pierwsze słowo każdego zwolnionego obiektu wskazuje na następny.
+  void *freeList;
+
+  /// Pierwszy jeszcze nieprzydzielony obiekt w ostatnim bloku.
+  char *bumpCurrent;
+
+  /// Koniec obszaru obiektów w ostatnim bloku.
+  char *bumpEnd;
+};
+
+/// @brief Inicjalizuje pustą pulę.
+/// Nie alokuje pamięci, pierwszy blok zostaje zaalokowany dopiero przy
+/// pierwszym wywołaniu @ref memoryPoolAlloc.
+/// @param[out] pool – wskaźnik na inicjalizowaną pulę.
+/// @param[in] objectSize – rozmiar obiektów przydzielanych przez pulę.
+void memoryPoolInit(struct MemoryPool *pool, size_t objectSize);
+
+/// @brief Przydziela jeden obiekt z puli.
+/// @param[in,out] pool – wskaźnik na pulę.
+/// @return Wskaźnik na niezainicjalizowany obiekt, lub @p NULL, gdy nie udało
+///         się zaalokować pamięci.
+void *memoryPoolAlloc(struct MemoryPool *pool);
+
+/// @brief Zwraca obiekt do puli.
+/// Obiekt musiał zostać przydzielony przez tą samą pulę. Nic nie robi, gdy @p
+/// object jest @p NULL.
+/// @param[in,out] pool – wskaźnik na pulę.
+/// @param[in] object – zwalniany obiekt.
+void memoryPoolFree(struct MemoryPool *pool, void *object);
+
+/// @brief Przenosi całą pamięć jednej puli do drugiej.
+/// Bloki i wolne obiekty puli @p other trafiają do puli @p pool, więc
+/// obiekty przydzielone przez @p other należą odtąd do @p pool. Po wywołaniu
+/// pula @p other jest pusta i może być dalej używana. Działa w czasie
+/// proporcjonalnym do liczby bloków i wolnych obiektów @p other.
+/// @param[in,out] pool – wskaźnik na pulę, do której trafia pamięć.
+/// @param[in,out] other – wskaźnik na pulę obiektów tego samego rozmiaru.
+void memoryPoolMerge(struct MemoryPool *pool, struct MemoryPool *other);
+
+/// @brief Zwalnia całą pamięć puli.
+/// Wszystkie obiekty przydzielone przez pulę przestają być ważne. Po wywołaniu
+/// pula jest pusta i może być dalej używana.
+/// @param[in,out] pool – wskaźnik na pulę.
+void memoryPoolClear(struct MemoryPool *pool);
+
+#endif /* __MEM_POOL_H__ */
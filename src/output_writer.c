@@ -0,0 +1,83 @@
+/// @file
+/// Implementacja modułu buforowanego wypisywania na standardowe wyjście.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "output_writer.h"
+
+/// Zawartość bufora standardowego wyjścia.
+static char outputBuffer[OUTPUT_BUFFER_SIZE];
+
+/// Liczba znaków w @ref outputBuffer.
+static size_t outputSize = 0;
+
+/// @brief Wypisuje napis bezpośrednio na standardowe wyjście.
+/// Powtarza wywołanie @p write, dopóki wszystkie znaki nie zostaną wypisane,
+/// lub nie wystąpi błąd inny niż przerwanie przez sygnał.
+/// @param[in] text – wypisywany napis.
+/// @param[in] length – liczba wypisywanych znaków.
+static void outputWriteAll(const char *text, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(STDOUT_FILENO, text, length);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      // There is nobody to report the error to.
+      return;
+    }
+
+    text += written;
+    length -= written;
+  }
+}
+
+void outputWrite(const char *text, size_t length) {
+  if (outputSize + length > OUTPUT_BUFFER_SIZE) {
+    outputFlush();
+
+    // Long text is not copied into the buffer at all.
+    if (length > OUTPUT_BUFFER_SIZE) {
+      outputWriteAll(text, length);
+      return;
+    }
+  }
+
+  memcpy(outputBuffer + outputSize, text, length);
+  outputSize += length;
+}
+
+void outputWriteString(const char *text) { outputWrite(text, strlen(text)); }
+
+void outputWriteCharacter(char c) {
+  if (outputSize == OUTPUT_BUFFER_SIZE)
+    outputFlush();
+
+  outputBuffer[outputSize++] = c;
+}
+
+void outputWriteSize(size_t value) {
+  // Digits are generated from the least significant one, so they are written
+  // from the end of the array.
+  char digits[3 * sizeof(size_t)];
+  size_t first = sizeof(digits);
+  do {
+    digits[--first] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+
+  outputWrite(digits + first, sizeof(digits) - first);
+}
+
+void outputFlush() {
+  outputWriteAll(outputBuffer, outputSize);
+  outputSize = 0;
+}
@@ -0,0 +1,41 @@
+/// @file
+/// Interfejs modułu buforowanego wypisywania na standardowe wyjście.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __OUTPUT_WRITER_H__
+#define __OUTPUT_WRITER_H__
+
+#include <stddef.h>
+
+/// Rozmiar bufora standardowego wyjścia.
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+/// @brief Wypisuje napis.
+/// Dopisuje @p length znaków napisu @p text do bufora wyjścia. Gdy bufor się
+/// zapełni, zostaje on wypisany.
+/// @param[in] text – wypisywany napis.
+/// @param[in] length – liczba wypisywanych znaków.
+void outputWrite(const char *text, size_t length);
+
+/// @brief Wypisuje napis zakończony znakiem @p '\0'.
+/// @param[in] text – wypisywany napis.
+void outputWriteString(const char *text);
+
+/// @brief Wypisuje jeden znak.
+/// @param[in] c – wypisywany znak.
+void outputWriteCharacter(char c);
+
+/// @brief Wypisuje liczbę.
+/// Wypisuje liczbę @p value w zapisie dziesiętnym, bez użycia @p printf.
+/// @param[in] value – wypisywana liczba.
+void outputWriteSize(size_t value);
+
+/// @brief Wypisuje zawartość bufora.
+/// Wypisuje wszystko, co zostało zapisane do bufora wyjścia. Musi zostać
+/// wywołana przed wypisaniem czegokolwiek na standardowe wyjście
+/// diagnostyczne, oraz przed zakończeniem programu.
+void outputFlush();
+
+#endif /* __OUTPUT_WRITER_H__ */
@@ -0,0 +1,88 @@
+/// @file
+/// Implementacja modułu prostego wykonywania zadań na wielu wątkach.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+
+/// Stan wspólny dla wszystkich wątków jednego wywołania @ref parallelRun.
+struct ParallelJob {
+  /// Wykonywane zadanie.
+  ParallelTask *function;
+
+  /// Kontekst przekazywany do zadań.
+  void *context;
+
+  /// Liczba zadań.
+  size_t tasks;
+
+  /// Numer następnego zadania do pobrania.
+  atomic_size_t next;
+};
+
+/// Argument pojedynczego wątku.
+struct ParallelWorker {
+  /// Wspólny stan wszystkich wątków.
+  struct ParallelJob *job;
+
+  /// Numer wątku.
+  int index;
+};
+
+/// @brief Wykonuje kolejne zadania, dopóki jakieś zostały.
+/// @param[in,out] argument – wskaźnik na strukturę @ref ParallelWorker.
+/// @return Zawsze @p NULL.
+static void *parallelWorkerRun(void *argument) {
+  struct ParallelWorker *worker = argument;
+  struct ParallelJob *job = worker->job;
+
+  size_t task;
+  while ((task = atomic_fetch_add(&job->next, 1)) < job->tasks)
+    job->function(job->context, task, worker->index);
+
+  return NULL;
+}
+
+void parallelRun(int workers, size_t tasks, ParallelTask *function,
+                 void *context) {
+  assert(workers >= 1);
+
+  struct ParallelJob job = {
+      .function = function, .context = context, .tasks = tasks};
+  atomic_init(&job.next, 0);
+
+  if ((size_t)workers > tasks)
+    workers = tasks > 0 ? (int)tasks : 1;
+
+  // Without the arrays everything runs on this thread.
+  pthread_t *threads = malloc(sizeof(pthread_t) * workers);
+  struct ParallelWorker *arguments =
+      malloc(sizeof(struct ParallelWorker) * workers);
+  bool *started = calloc(workers, sizeof(bool));
+  if (!threads || !arguments || !started)
+    workers = 1;
+
+  struct ParallelWorker self = {.job = &job, .index = 0};
+  for (int i = 1; i < workers; ++i) {
+    arguments[i] = (struct ParallelWorker){.job = &job, .index = i};
+    started[i] = pthread_create(&threads[i], NULL, parallelWorkerRun,
+                                &arguments[i]) == 0;
+  }
+
+  parallelWorkerRun(&self);
+
+  for (int i = 1; i < workers; ++i)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+
+  free(threads);
+  free(arguments);
+  free(started);
+}
@@ -0,0 +1,33 @@
+/// @file
+/// Interfejs modułu prostego wykonywania zadań na wielu wątkach.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <stddef.h>
+
+/// @brief Zadanie wykonywane przez @ref parallelRun.
+/// @param[in,out] context – wspólny kontekst wszystkich zadań.
+/// @param[in] task – numer zadania, od @p 0.
+/// @param[in] worker – numer wątku wykonującego zadanie, od @p 0 do liczby
+///                     wątków minus jeden. Zadania wykonywane jednocześnie
+///                     mają różne numery wątków.
+typedef void ParallelTask(void *context, size_t task, int worker);
+
+/// @brief Wykonuje zadania na kilku wątkach.
+/// Wątki pobierają kolejne numery zadań, więc zadania zaczynają się w
+/// kolejności numerów; dłuższe zadania warto dać na początek. Wątek
+/// wywołujący procedurę też wykonuje zadania, jako wątek numer @p 0. Gdy nie
+/// uda się utworzyć któregoś wątku, zadania wykonują pozostałe. Procedura
+/// kończy się po wykonaniu wszystkich zadań.
+/// @param[in] workers – największa liczba wątków, co najmniej @p 1.
+/// @param[in] tasks – liczba zadań.
+/// @param[in] function – wykonywane zadanie.
+/// @param[in,out] context – kontekst przekazywany do zadań.
+void parallelRun(int workers, size_t tasks, ParallelTask *function,
+                 void *context);
+
+#endif /* __PARALLEL_H__ */
@@ -13,10 +13,34 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "parallel.h"
 #include "phone_forward.h"
+#include "result_cache.h"
+#include "snapshot.h"
 #include "trie.h"
+#include "trie_image.h"
 #include "util.h"
 
+/// Liczba wyników @ref phfwdNonTrivialCount zapamiętywanych przez strukturę.
+#define NON_TRIVIAL_CACHE_SIZE (16)
+
+/// @brief Zapamiętany wynik @ref phfwdNonTrivialCount.
+/// Wynik zależy tylko od zbioru cyfr i długości numerów, więc dopóki
+/// struktura się nie zmienia, powtarzane zapytania nie przechodzą drzewa.
+struct NonTrivialCacheEntry {
+  /// Maska bitowa cyfr zbioru, lub 0, gdy wpis jest pusty.
+  uint16_t digitMask;
+
+  /// Długość zliczanych numerów.
+  size_t len;
+
+  /// Wartość @ref PhoneForward.changes, przy której obliczono wynik.
+  uint64_t changes;
+
+  /// Liczba nietrywialnych numerów.
+  size_t result;
+};
+
 /// @brief Struktura przechowująca przekierowania numerów telefonów.
 /// Struktura przechowująca przekierowania numerów telefonów (w postaci drzewa
 /// Trie), i wszystkie prefiksy na które są przekierowania (w postaci drugiego
@@ -27,51 +51,113 @@ struct PhoneForward {
   /// Drzewo Trie które zawiera wszystkie przekierowania, a jako wartości
   /// number na, który przekierowanie następuje. Niezmiennik: Każdy wierzchołek
   /// w tym drzewie zawiera co najwyżej jendną wartość.
-  struct TrieNode *redirections;
+  struct Trie redirections;
 
   /// @brief Drzewo Trie zawierające numery, na które są przekierowania.
   /// Drzewo Trie zawierające prefiksy, na które są przekierowania. Jako
   /// wartości trzymane są numery, które sa przekierowywane.
-  struct TrieNode *prefixes;
+  struct Trie prefixes;
+
+  /// @brief Pamięć wartości obu drzew.
+  /// Wszystkie wartości obu drzew są przydzielane z tej struktury, dzięki czemu
+  /// usunięcie całej struktury nie wymaga przechodzenia po drzewach.
+  struct TrieAllocator allocator;
+
+  /// @brief Odwzorowany w pamięci plik zrzutu, lub @p NULL.
+  /// Gdy nie @p NULL, struktura jest tylko do odczytu, a zapytania są
+  /// wykonywane na drzewach z pliku. Pola @ref redirections, @ref prefixes i
+  /// @ref allocator nie są wtedy używane.
+  struct TrieImageFile *image;
+
+  /// @brief Liczba istniejących migawek struktury.
+  /// Gdy większa od zera, drzewa i ich wartości są kopiowane przy zmianach
+  /// zamiast być zmieniane w miejscu.
+  size_t snapshots;
+
+  /// @brief Liczba wywołań zmieniających strukturę.
+  /// Wpisy @ref nonTrivialCache z inną wartością są nieaktualne.
+  uint64_t changes;
+
+  /// Ostatnie wyniki @ref phfwdNonTrivialCount, według maski i długości.
+  struct NonTrivialCacheEntry nonTrivialCache[NON_TRIVIAL_CACHE_SIZE];
+
+  /// Pamięć wyników @ref phfwdGet i @ref phfwdReverse, lub @p NULL, gdy jest
+  /// wyłączona.
+  struct ResultCache *cache;
+};
+
+/// @brief Migawka struktury przechowującej przekierowania.
+/// Korzenie migawki leżą w drzewach struktury, z którą migawka współdzieli
+/// wszystkie niezmienione od jej utworzenia wierzchołki.
+struct PhoneForwardSnapshot {
+  /// Struktura, której zawartość zachowuje migawka.
+  struct PhoneForward *owner;
+
+  /// Indeks korzenia migawki w drzewie przekierowań.
+  TrieIndex redirections;
+
+  /// Indeks korzenia migawki w drzewie prefiksów.
+  TrieIndex prefixes;
 };
 
 /// @brief Struktura przechowująca ciąg numerów telefonów.
 /// Struktura przechowująca, posortowane leksykograficznie, bez powtórzeń,
 /// numery telefonów. Posiada @ref size numerów, do których dostęp odbywa się za
-/// pomocą funckji @ref phfwdGet.
+/// pomocą funckji @ref phnumGet. Cała struktura, razem z tablicą przesunięć i
+/// treścią numerów, zajmuje jeden blok pamięci.
 struct PhoneNumbers {
   /// Ilość numerów w danej strukturze.
   size_t size;
 
-  /// @brief Maksymalna ilość numerów jakie można dodać.
-  /// Używany podczas tworzania struktury, gdy nie wiadomo ile numerów
-  /// znajdzie się w strukturze.
-  size_t capacity;
+  /// @brief Treść wszystkich numerów.
+  /// Numery leżą jeden za drugim, każdy zakończony znakiem @p '\0'.
+  char *text;
 
-  /// Tablica wskaźników na numery telefonów, posortowana leksykograficznie.
-  char **numbers;
+  /// Przesunięcia początków kolejnych numerów względem @ref text.
+  size_t offsets[];
 };
 
 /// @brief Tworzy nową strukturę.
-/// Tworzy nową strukturę PhoneNumbers, posiadającą miejsce na @p initCapacity
-/// numerów telefonów. Alokuje pamięć, która musi być zwolniona używając @ref
-/// phnumDelete.  Nie jest to cześć interfejsu modułu, ponieważ strukturę
-/// PhoneNumbers można uzyskać jedynie przez @ref phnumGet oraz @ref
+/// Tworzy pustą strukturę PhoneNumbers, posiadającą miejsce na @p capacity
+/// numerów telefonów o łącznej długości @p textSize znaków, wliczając znaki
+/// @p '\0'. Alokuje jeden blok pamięci, który musi być zwolniony używając @ref
+/// phnumDelete. Nie jest to cześć interfejsu modułu, ponieważ strukturę
+/// PhoneNumbers można uzyskać jedynie przez @ref phfwdGet oraz @ref
 /// phfwdReverse.
-/// @param[in] initCapacity – startowa wartość @ref PhoneNumbers.capacity. Musi
-///                           być wieksza od 0.
+/// @param[in] capacity – maksymalna liczba numerów w strukturze.
+/// @param[in] textSize – rozmiar miejsca na treść numerów.
 /// @return Wskaźnik na zaalokowaną strukturę, lub @p NULL, gdy nie udało się
 ///         zaalokować pamięci.
-static inline struct PhoneNumbers *phnumNewEmpty(int initCapacity) {
-  struct PhoneNumbers *result = malloc(sizeof(struct PhoneNumbers));
+static struct PhoneNumbers *phnumNew(size_t capacity, size_t textSize) {
+  struct PhoneNumbers *result = malloc(
+      sizeof(struct PhoneNumbers) + sizeof(size_t) * capacity + textSize);
   if (result) {
-    (*result) = (struct PhoneNumbers){0, initCapacity,
-                                      malloc(sizeof(char *) * initCapacity)};
+    result->size = 0;
+    result->text = (char *)(result->offsets + capacity);
+  }
 
-    if (!result->numbers) {
-      free(result);
-      return NULL;
-    }
+  return result;
+}
+
+/// @brief Kopiuje strukturę.
+/// Tworzy strukturę PhoneNumbers z tymi samymi numerami co @p pnum, bez
+/// nieużytego miejsca.
+/// @param[in] pnum – wskaźnik na kopiowaną strukturę.
+/// @return Wskaźnik na zaalokowaną strukturę, lub @p NULL, gdy nie udało się
+///         zaalokować pamięci.
+static struct PhoneNumbers *phnumCopy(const struct PhoneNumbers *pnum) {
+  // Numbers are written one after another, so the last one ends the text.
+  size_t textSize = 0;
+  if (pnum->size > 0) {
+    size_t lastOffset = pnum->offsets[pnum->size - 1];
+    textSize = lastOffset + strlen(pnum->text + lastOffset) + 1;
+  }
+
+  struct PhoneNumbers *result = phnumNew(pnum->size, textSize);
+  if (result) {
+    result->size = pnum->size;
+    memcpy(result->offsets, pnum->offsets, sizeof(size_t) * pnum->size);
+    memcpy(result->text, pnum->text, textSize);
   }
 
   return result;
@@ -94,383 +180,2716 @@ static bool isValidPhnum(const char *str) {
   return true;
 }
 
+/// @brief Opróżnia pamięć wyników @ref phfwdNonTrivialCount.
+/// Pamięć wyników @ref phfwdGet i @ref phfwdReverse jest wyłączona.
+/// @param[out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                  numerów;
+static void phfwdCountCacheInit(struct PhoneForward *pf) {
+  pf->changes = 0;
+  memset(pf->nonTrivialCache, 0, sizeof(pf->nonTrivialCache));
+  pf->cache = NULL;
+}
+
 struct PhoneForward *phfwdNew(void) {
   struct PhoneForward *result = malloc(sizeof(struct PhoneForward));
   if (result) {
     // Initialize both trie trees.
-    result->redirections = trieNodeNew(NULL);
-    result->prefixes = trieNodeNew(NULL);
-    if (!result->redirections || !result->prefixes) {
-      if (result->prefixes)
-        trieDeleteSubtree(result->prefixes, result->prefixes);
-      if (result->redirections)
-        trieDeleteSubtree(result->redirections, result->redirections);
+    trieAllocatorInit(&result->allocator);
+    if (!trieInit(&result->redirections)) {
+      free(result);
+      return NULL;
+    }
 
+    if (!trieInit(&result->prefixes)) {
+      trieFree(&result->redirections);
+      free(result);
       return NULL;
     }
+
+    result->image = NULL;
+    result->snapshots = 0;
+    phfwdCountCacheInit(result);
     return result;
   }
   return NULL;
 }
 
-void phfwdDelete(struct PhoneForward *pf) {
-  if (pf) {
-    trieDeleteSubtree(pf->prefixes, pf->prefixes);
-    trieDeleteSubtree(pf->redirections, pf->redirections);
-    free(pf);
-  }
+/// Liczba bitów klucza sortowanych w jednym przebiegu @ref buildPairSort.
+#define BUILD_RADIX_BITS (16)
+
+/// Przekierowanie sortowane przez @ref phfwdBuildFromPairs.
+struct BuildPair {
+  /// @brief Klucz sortowania (@ref trieSortKey).
+  /// Jest to klucz prefiksu, według którego przekierowania są w danej chwili
+  /// sortowane.
+  uint64_t key;
+
+  /// Klucz sortowania drugiego prefiksu przekierowania.
+  uint64_t otherKey;
+
+  /// Pozycja przekierowania w tablicy przekazanej przez wywołującego.
+  size_t index;
+
+  /// Wpis drzewa przekierowań, zawierający prefiks @p num2.
+  struct DataNode *redirection;
+
+  /// Wpis drzewa prefiksów, zawierający prefiks @p num1.
+  struct DataNode *reverse;
+
+  /// Prefiks @p num1, który wpis @ref reverse przechowuje spakowany.
+  const char *num1;
+};
+
+/// @brief Sprawdza, czy dwa numery o równych kluczach są równe.
+/// @param[in] key – wspólny klucz sortowania obu numerów.
+/// @param[in] first – pierwszy numer.
+/// @param[in] second – drugi numer.
+/// @return @p true jeśli numery są równe, @p false w przeciwnym wypadku.
+static bool buildSameNumber(uint64_t key, const char *first,
+                            const char *second) {
+  // Only numbers longer than the key can differ further on.
+  return (key & 0xF) == 0 || strcmp(first + TRIE_SORT_KEY_DIGITS,
+                                    second + TRIE_SORT_KEY_DIGITS) == 0;
 }
 
-bool phfwdAdd(struct PhoneForward *pf, const char *num1, const char *num2) {
-  assert(pf);
+/// @brief Porównuje przekierowania o równych kluczach według @p num1.
+/// Przekierowania z tym samym prefiksem są porównywane według pozycji.
+/// Oba prefiksy muszą mieć co najmniej @ref TRIE_SORT_KEY_DIGITS cyfr.
+/// @param[in] first – wskaźnik na pierwszą strukturę @ref BuildPair.
+/// @param[in] second – wskaźnik na drugą strukturę @ref BuildPair.
+/// @return Liczba ujemna, zero lub dodatnia, jeśli @p first jest odpowiednio
+///         mniejszy, równy lub większy od @p second.
+static int buildPairCompareNum1(const void *first, const void *second) {
+  const struct BuildPair *lhs = first;
+  const struct BuildPair *rhs = second;
+  int result = strcmp(lhs->num1 + TRIE_SORT_KEY_DIGITS,
+                      rhs->num1 + TRIE_SORT_KEY_DIGITS);
+  if (result != 0)
+    return result;
 
-  // If num1/2 are not telepfone numbers or if they are equal return false.
-  if (!isValidPhnum(num1) || !isValidPhnum(num2) || strcmp(num1, num2) == 0) {
-    return false;
-  }
+  return (lhs->index > rhs->index) - (lhs->index < rhs->index);
+}
 
-  struct DataNode *dataToAdd = dataNodeNew(num2);
-  if (!dataToAdd)
-    return false;
+/// @brief Porównuje przekierowania o równych kluczach według @p num2.
+/// Przekierowania na ten sam prefiks są porównywane według prefiksów
+/// przekierowywanych. Oba prefiksy @p num2 muszą mieć co najmniej @ref
+/// TRIE_SORT_KEY_DIGITS cyfr.
+/// @param[in] first – wskaźnik na pierwszą strukturę @ref BuildPair.
+/// @param[in] second – wskaźnik na drugą strukturę @ref BuildPair.
+/// @return Liczba ujemna, zero lub dodatnia, jeśli @p first jest odpowiednio
+///         mniejszy, równy lub większy od @p second.
+static int buildPairCompareNum2(const void *first, const void *second) {
+  const struct BuildPair *lhs = first;
+  const struct BuildPair *rhs = second;
+  int result = strcmp(dataNodeText(lhs->redirection) + TRIE_SORT_KEY_DIGITS,
+                      dataNodeText(rhs->redirection) + TRIE_SORT_KEY_DIGITS);
+  if (result != 0)
+    return result;
 
-  // There is no reason to initialize this, except the GCC warning.
-  struct DataNode *prevData = NULL;
+  return strcmp(lhs->num1, rhs->num1);
+}
 
-  if (!trieAddText(pf->redirections, num1, dataToAdd, false, &prevData))
+/// @brief Sortuje przekierowania według kluczy.
+/// Sortowanie pozycyjne od najmłodszych bitów, więc stabilne i niezależne od
+/// długości numerów. Przekierowania o równych kluczach, których numery są
+/// dłuższe od klucza, są następnie sortowane funkcją @p compare.
+/// @param[in,out] pairs – wskaźnik na sortowaną tablicę, zastępowany
+///                        wskaźnikiem na posortowaną.
+/// @param[in,out] buffer – wskaźnik na pomocniczą tablicę tego samego
+///                         rozmiaru, zastępowany wskaźnikiem na drugą z tablic.
+/// @param[in] count – liczba przekierowań.
+/// @param[in] compare – porządek przekierowań o równych kluczach.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+static bool buildPairSort(struct BuildPair **pairs, struct BuildPair **buffer,
+                          size_t count,
+                          int (*compare)(const void *, const void *)) {
+  const uint64_t digitMask = ((uint64_t)1 << BUILD_RADIX_BITS) - 1;
+  size_t *offsets = malloc(sizeof(size_t) << BUILD_RADIX_BITS);
+  if (!offsets)
     return false;
 
-  if (prevData) {
-    assert(!prevData->next);
-    trieRemoveOneEntry(pf->prefixes, prevData->text, num1);
-    dataNodeDelete(prevData);
+  for (int shift = 0; shift < 64 && count > 0; shift += BUILD_RADIX_BITS) {
+    memset(offsets, 0, sizeof(size_t) << BUILD_RADIX_BITS);
+    for (size_t i = 0; i < count; ++i)
+      offsets[((*pairs)[i].key >> shift) & digitMask]++;
+
+    // A pass in which all keys have the same digit would not move anything.
+    if (offsets[((*pairs)[0].key >> shift) & digitMask] == count)
+      continue;
+
+    size_t position = 0;
+    for (uint64_t digit = 0; digit <= digitMask; ++digit) {
+      size_t digitCount = offsets[digit];
+      offsets[digit] = position;
+      position += digitCount;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+      (*buffer)[offsets[((*pairs)[i].key >> shift) & digitMask]++] =
+          (*pairs)[i];
+
+    struct BuildPair *swap = (*pairs);
+    (*pairs) = (*buffer);
+    (*buffer) = swap;
   }
 
-  // Init dataToAdd again, since we now insert to the second tree.
-  dataToAdd = dataNodeNew(num1);
-  if (!dataToAdd)
-    return false;
+  free(offsets);
+
+  for (size_t first = 0; first < count;) {
+    size_t end = first + 1;
+    while (end < count && (*pairs)[end].key == (*pairs)[first].key)
+      end++;
 
-  trieAddText(pf->prefixes, num2, dataToAdd, true, NULL);
+    if (end - first > 1 && ((*pairs)[first].key & 0xF) != 0)
+      qsort((*pairs) + first, end - first, sizeof(struct BuildPair), compare);
+
+    first = end;
+  }
 
   return true;
 }
 
-void phfwdRemove(struct PhoneForward *pf, const char *num) {
-  if (!isValidPhnum(num))
-    return;
+/// Tablice robocze @ref phfwdBuildFromPairs.
+struct BuildArrays {
+  /// Sortowane przekierowania.
+  struct BuildPair *sorted;
 
-  struct TrieNode *currentNode = pf->redirections;
+  /// Pomocnicza tablica sortowania.
+  struct BuildPair *buffer;
 
-  for (int i = 0; num[i] != '\0'; ++i) {
-    int currentBranchIdx = num[i] - '0';
-    assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+  /// Klucze budowanego drzewa.
+  const char **keys;
 
-    if (!currentNode->childs[currentBranchIdx])
-      return;
+  /// Klucze sortowania kluczy budowanego drzewa.
+  uint64_t *sortKeys;
 
-    assert(currentNode->nonNullChilds > 0);
-    currentNode = currentNode->childs[currentBranchIdx];
-  }
-  assert(currentNode->nonNullChilds >= 0);
+  /// Wartości budowanego drzewa.
+  struct DataNode **values;
+};
 
-  trieDeleteSubtree(pf->redirections, currentNode);
+/// @brief Alokuje tablice robocze.
+/// @param[out] arrays – inicjalizowana struktura.
+/// @param[in] count – liczba przekierowań.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Tablice trzeba zwolnić w obu przypadkach.
+static bool buildArraysInit(struct BuildArrays *arrays, size_t count) {
+  arrays->sorted = malloc(sizeof(struct BuildPair) * (count + 1));
+  arrays->buffer = malloc(sizeof(struct BuildPair) * (count + 1));
+  arrays->keys = malloc(sizeof(const char *) * (count + 1));
+  arrays->sortKeys = malloc(sizeof(uint64_t) * (count + 1));
+  arrays->values = malloc(sizeof(struct DataNode *) * (count + 1));
+  return arrays->sorted && arrays->buffer && arrays->keys &&
+         arrays->sortKeys && arrays->values;
 }
 
-struct PhoneNumbers const *phfwdGet(struct PhoneForward *pf, const char *num) {
-  struct PhoneNumbers *result = phnumNewEmpty(1);
-  if (!result)
-    return NULL;
+/// @brief Zwalnia tablice robocze.
+/// @param[in,out] arrays – struktura zainicjalizowana przez @ref
+///                         buildArraysInit.
+static void buildArraysFree(struct BuildArrays *arrays) {
+  free(arrays->sorted);
+  free(arrays->buffer);
+  free(arrays->keys);
+  free(arrays->sortKeys);
+  free(arrays->values);
+}
 
-  // Result is empty, if [num] does not represent the number.
-  if (!isValidPhnum(num))
-    return result;
+/// @brief Tworzy wpisy obu drzew dla jednego przekierowania.
+/// @param[in,out] allocator – pamięć, z której przydzielane są wpisy.
+/// @param[in] pair – poprawne przekierowanie.
+/// @param[in] index – pozycja przekierowania w tablicy wywołującego.
+/// @param[out] result – uzupełniana struktura; jej kluczem jest klucz
+///                      @p num1.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+static bool buildPairNew(struct TrieAllocator *allocator,
+                         const struct PhoneForwardPair *pair, size_t index,
+                         struct BuildPair *result) {
+  struct DataNode *redirection = dataNodeNew(allocator, pair->num2);
+  struct DataNode *reverse = dataNodeNewPacked(allocator, pair->num1);
+  if (!redirection || !reverse)
+    return false;
 
-  struct TrieNode *currentNode = pf->redirections;
-  struct TrieNode *last_forwarded_node = NULL;
-  int last_forwarded_prefix_size = 0;
+  redirection->link = reverse;
+  reverse->link = redirection;
+  (*result) = (struct BuildPair){.key = trieSortKey(pair->num1),
+                                 .otherKey = trieSortKey(pair->num2),
+                                 .index = index,
+                                 .redirection = redirection,
+                                 .reverse = reverse,
+                                 .num1 = pair->num1};
+  return true;
+}
 
-  if (currentNode->data != NULL) {
-    last_forwarded_node = currentNode;
-    last_forwarded_prefix_size = 0;
+/// @brief Buduje drzewo przekierowań.
+/// Sortuje przekierowania według @p num1 i usuwa wszystkie poza ostatnim z
+/// tych o tym samym @p num1. Pozostałe przekierowania trafiają na początek
+/// tablicy @ref BuildArrays.sorted, w kolejności @p num1, z kluczem @p num2.
+/// @param[in,out] allocator – pamięć, z której pochodzą wpisy przekierowań.
+/// @param[in,out] trie – puste drzewo, w którym budowane są przekierowania.
+/// @param[in,out] arrays – tablice robocze; na początku @ref
+///                         BuildArrays.sorted leżą przekierowania w
+///                         kolejności ich pozycji.
+/// @param[in] count – liczba przekierowań.
+/// @param[out] kept – liczba pozostawionych przekierowań.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+static bool buildRedirections(struct TrieAllocator *allocator,
+                              struct Trie *trie, struct BuildArrays *arrays,
+                              size_t count, size_t *kept) {
+  if (!buildPairSort(&arrays->sorted, &arrays->buffer, count,
+                     buildPairCompareNum1))
+    return false;
+
+  // Of the pairs with the same num1 only the last one stays, just like when
+  // each of them replaces the previous one in phfwdAdd.
+  struct BuildPair *sorted = arrays->sorted;
+  (*kept) = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (i + 1 < count && sorted[i].key == sorted[i + 1].key &&
+        buildSameNumber(sorted[i].key, sorted[i].num1, sorted[i + 1].num1)) {
+      dataNodeDelete(allocator, sorted[i].redirection);
+      dataNodeDelete(allocator, sorted[i].reverse);
+      continue;
+    }
+
+    arrays->keys[*kept] = sorted[i].num1;
+    arrays->sortKeys[*kept] = sorted[i].key;
+    arrays->values[*kept] = sorted[i].redirection;
+    sorted[*kept] = sorted[i];
+    sorted[(*kept)++].key = sorted[i].otherKey;
   }
 
-  for (int i = 0; num[i] != '\0'; ++i) {
-    assert(0 <= num[i] - '0' && num[i] - '0' < ALPHABET_SIZE);
-    if (currentNode->childs[num[i] - '0'] == NULL)
-      break;
+  return trieBuildSorted(trie, arrays->keys, arrays->sortKeys, arrays->values,
+                         *kept);
+}
 
-    currentNode = currentNode->childs[num[i] - '0'];
+/// @brief Buduje drzewo prefiksów.
+/// @param[in,out] trie – puste drzewo, w którym budowane są prefiksy.
+/// @param[in,out] arrays – tablice robocze; na początku @ref
+///                         BuildArrays.sorted leżą przekierowania w
+///                         kolejności @p num1, z kluczem @p num2.
+/// @param[in] count – liczba przekierowań.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+static bool buildPrefixes(struct Trie *trie, struct BuildArrays *arrays,
+                          size_t count) {
+  // The sort is stable, so entries with the same num2 stay ordered by num1,
+  // which is the order in which phfwdReverse sorts them.
+  if (!buildPairSort(&arrays->sorted, &arrays->buffer, count,
+                     buildPairCompareNum2))
+    return false;
 
-    if (currentNode->data != NULL) {
-      assert(currentNode->data->text);
-      last_forwarded_node = currentNode;
-      last_forwarded_prefix_size = i + 1;
+  struct BuildPair *sorted = arrays->sorted;
+  size_t keyCount = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0 && sorted[i - 1].key == sorted[i].key &&
+        buildSameNumber(sorted[i].key, dataNodeText(sorted[i - 1].redirection),
+                        dataNodeText(sorted[i].redirection))) {
+      sorted[i - 1].reverse->next = sorted[i].reverse;
+      sorted[i].reverse->prev = sorted[i - 1].reverse;
+      continue;
     }
-  }
 
-  // Decide how does the forwarded prefix look like. Variable
-  // [last_forwarded_prefix_size] tells us how many characters from the input
-  // string are redirected into that prefix. Must be 0 if last_forwarded_node
-  // is NULL!
-  char *forwarded_prefix =
-      last_forwarded_node ? last_forwarded_node->data->text : "";
-  if (!last_forwarded_node)
-    assert(last_forwarded_prefix_size == 0);
+    arrays->keys[keyCount] = dataNodeText(sorted[i].redirection);
+    arrays->sortKeys[keyCount] = sorted[i].key;
+    arrays->values[keyCount++] = sorted[i].reverse;
+  }
 
-  assert(result);
-  int result_redirection_len =
-      strlen(forwarded_prefix) + strlen(num) - last_forwarded_prefix_size;
+  return trieBuildSorted(trie, arrays->keys, arrays->sortKeys, arrays->values,
+                         keyCount);
+}
 
-  // This contains only one number.
-  result->size = 1;
-  result->numbers[0] = malloc(sizeof(char) * (result_redirection_len + 1));
+/// @brief Sprawdza, czy para jest poprawnym przekierowaniem.
+/// @param[in] pair – sprawdzana para.
+/// @return @p true jeśli @ref phfwdAdd przyjęłoby tę parę, @p false w
+///         przeciwnym wypadku.
+static bool buildPairValid(const struct PhoneForwardPair *pair) {
+  return isValidPhnum(pair->num1) && isValidPhnum(pair->num2) &&
+         strcmp(pair->num1, pair->num2) != 0;
+}
 
-  if (!result->numbers[0])
+struct PhoneForward *phfwdBuildFromPairs(const struct PhoneForwardPair *pairs,
+                                         size_t count) {
+  if ((!pairs && count > 0) || count >= SIZE_MAX / sizeof(struct BuildPair))
     return NULL;
 
-  result->numbers[0][0] = '\0';
-  strcat(strcat(result->numbers[0], forwarded_prefix),
-         (num + last_forwarded_prefix_size));
+  struct PhoneForward *result = phfwdNew();
+  struct BuildArrays arrays;
+  bool built = buildArraysInit(&arrays, count) && result;
+
+  // Pairs are read only here, in their order. Later steps work on the
+  // copies of numbers and their keys.
+  for (size_t i = 0; i < count && built; ++i)
+    built = buildPairValid(&pairs[i]) &&
+            buildPairNew(&result->allocator, &pairs[i], i, &arrays.sorted[i]);
+
+  size_t kept = 0;
+  built = built && buildRedirections(&result->allocator, &result->redirections,
+                                     &arrays, count, &kept);
+  built = built && buildPrefixes(&result->prefixes, &arrays, kept);
+
+  buildArraysFree(&arrays);
+  if (!built) {
+    // All values come from the allocator, so they go away with the tries.
+    phfwdDelete(result);
+    return NULL;
+  }
 
   return result;
 }
 
-const char *phnumGet(const struct PhoneNumbers *pnum, size_t idx) {
-  if (idx >= pnum->size)
-    return NULL;
+/// Liczba przekierowań, od której budowa na wielu wątkach się opłaca.
+#define BUILD_PARALLEL_THRESHOLD (1 << 16)
+
+/// Liczba fragmentów tablicy przekierowań przypadających na jeden wątek.
+#define BUILD_CHUNKS_PER_WORKER (8)
+
+/// @brief Stan budowy struktury na wielu wątkach.
+/// Przekierowania są dzielone według pierwszej cyfry @p num1 na części, z
+/// których osobno budowane są poddrzewa drzewa przekierowań, a następnie
+/// według pierwszej cyfry @p num2 na części, z których budowane są poddrzewa
+/// drzewa prefiksów. Poddrzewa nie mają wspólnych wierzchołków, więc na
+/// koniec wystarczy dokleić je pod korzenie.
+struct BuildParallel {
+  /// Budowana struktura.
+  struct PhoneForward *result;
+
+  /// Tablica przekierowań przekazana przez wywołującego.
+  const struct PhoneForwardPair *pairs;
+
+  /// Liczba przekierowań.
+  size_t count;
+
+  /// Liczba przekierowań w jednym fragmencie tablicy @ref pairs.
+  size_t chunkSize;
+
+  /// Liczba przekierowań fragmentu dla każdej pierwszej cyfry @p num1.
+  size_t (*chunkCounts)[ALPHABET_SIZE];
+
+  /// Czy wszystkie przekierowania fragmentu są poprawne.
+  bool *chunkValid;
+
+  /// Początki części w tablicach @ref sorted i @ref buffer.
+  size_t partStart[ALPHABET_SIZE + 1];
+
+  /// Cyfry, według malejących rozmiarów części.
+  int partOrder[ALPHABET_SIZE];
 
-  return pnum->numbers[idx];
+  /// @brief Przekierowania podzielone według pierwszej cyfry @p num1.
+  /// Przed budową części pola @ref BuildPair.index są już uzupełnione.
+  struct BuildPair *sorted;
+
+  /// Pomocnicza tablica sortowania tego samego rozmiaru.
+  struct BuildPair *buffer;
+
+  /// @brief Przekierowania pozostawione w każdej części.
+  /// Leżą w @ref sorted lub @ref buffer, w kolejności @p num1, pogrupowane
+  /// według pierwszej cyfry @p num2.
+  struct BuildPair *kept[ALPHABET_SIZE];
+
+  /// Liczba pozostawionych przekierowań części dla każdej pierwszej cyfry
+  /// @p num2.
+  size_t groupCounts[ALPHABET_SIZE][ALPHABET_SIZE];
+
+  /// Pamięć wartości każdego wątku.
+  struct TrieAllocator *allocators;
+
+  /// Poddrzewa drzewa przekierowań i drzewa prefiksów.
+  struct Trie parts[2][ALPHABET_SIZE];
+
+  /// Doklejenia poddrzew, w kolejności tablicy @ref parts.
+  struct TrieGraft grafts[2 * ALPHABET_SIZE];
+
+  /// Czy budowa danej części się nie powiodła.
+  bool failed[2][ALPHABET_SIZE];
+};
+
+/// @brief Wyznacza zakres fragmentu tablicy przekierowań.
+/// @param[in] build – stan budowy.
+/// @param[in] chunk – numer fragmentu.
+/// @param[out] first – pozycja pierwszego przekierowania fragmentu.
+/// @param[out] end – pozycja za ostatnim przekierowaniem fragmentu.
+static void buildChunkRange(const struct BuildParallel *build, size_t chunk,
+                            size_t *first, size_t *end) {
+  (*first) = chunk * build->chunkSize;
+  (*end) = (*first) + build->chunkSize;
+  if ((*first) > build->count)
+    (*first) = build->count;
+  if ((*end) > build->count)
+    (*end) = build->count;
 }
 
-void phnumDelete(const struct PhoneNumbers *pnum) {
-  if (pnum) {
-    for (unsigned int i = 0; i < pnum->size; ++i)
-      free(pnum->numbers[i]);
-    free(pnum->numbers);
+/// @brief Sprawdza fragment przekierowań i liczy rozmiary jego części.
+/// Zadanie @ref parallelRun wykonywane dla każdego fragmentu.
+/// @param[in,out] context – wskaźnik na strukturę @ref BuildParallel.
+/// @param[in] chunk – numer fragmentu.
+/// @param[in] worker – numer wątku.
+static void buildCountChunk(void *context, size_t chunk, int worker) {
+  (void)worker;
+  struct BuildParallel *build = context;
+  size_t first, end;
+  buildChunkRange(build, chunk, &first, &end);
+
+  size_t *counts = build->chunkCounts[chunk];
+  for (int digit = 0; digit < ALPHABET_SIZE; ++digit)
+    counts[digit] = 0;
+
+  build->chunkValid[chunk] = true;
+  for (size_t i = first; i < end; ++i) {
+    if (!buildPairValid(&build->pairs[i])) {
+      build->chunkValid[chunk] = false;
+      return;
+    }
+
+    counts[build->pairs[i].num1[0] - '0']++;
   }
+}
 
-  free((void *)pnum);
+/// @brief Rozdziela fragment przekierowań na części.
+/// Zadanie @ref parallelRun wykonywane dla każdego fragmentu. Zapisuje
+/// pozycje przekierowań w tablicy @ref BuildParallel.sorted, zachowując ich
+/// kolejność w każdej części. Pola @ref BuildParallel.chunkCounts muszą być
+/// zastąpione początkami fragmentu w częściach.
+/// @param[in,out] context – wskaźnik na strukturę @ref BuildParallel.
+/// @param[in] chunk – numer fragmentu.
+/// @param[in] worker – numer wątku.
+static void buildScatterChunk(void *context, size_t chunk, int worker) {
+  (void)worker;
+  struct BuildParallel *build = context;
+  size_t first, end;
+  buildChunkRange(build, chunk, &first, &end);
+
+  size_t *positions = build->chunkCounts[chunk];
+  for (size_t i = first; i < end; ++i)
+    build->sorted[positions[build->pairs[i].num1[0] - '0']++].index = i;
+}
+
+/// @brief Buduje poddrzewo drzewa przekierowań.
+/// Zadanie @ref parallelRun wykonywane dla każdej cyfry, według malejących
+/// rozmiarów części. Tworzy wpisy przekierowań części, buduje z nich
+/// poddrzewo, i grupuje pozostawione przekierowania według pierwszej cyfry
+/// @p num2.
+/// @param[in,out] context – wskaźnik na strukturę @ref BuildParallel.
+/// @param[in] task – numer zadania.
+/// @param[in] worker – numer wątku.
+static void buildRedirectionsPart(void *context, size_t task, int worker) {
+  struct BuildParallel *build = context;
+  int digit = build->partOrder[task];
+  size_t first = build->partStart[digit];
+  size_t count = build->partStart[digit + 1] - first;
+  struct TrieAllocator *allocator = &build->allocators[worker];
+
+  struct BuildArrays arrays = {.sorted = build->sorted + first,
+                               .buffer = build->buffer + first,
+                               .keys = malloc(sizeof(const char *) * count),
+                               .sortKeys = malloc(sizeof(uint64_t) * count),
+                               .values =
+                                   malloc(sizeof(struct DataNode *) * count)};
+  bool built = count == 0 || (arrays.keys && arrays.sortKeys && arrays.values);
+
+  for (size_t i = 0; i < count && built; ++i) {
+    size_t index = arrays.sorted[i].index;
+    built = buildPairNew(allocator, &build->pairs[index], index,
+                         &arrays.sorted[i]);
+  }
+
+  size_t kept = 0;
+  built = built && buildRedirections(allocator, &build->parts[0][digit],
+                                     &arrays, count, &kept);
+  free(arrays.keys);
+  free(arrays.sortKeys);
+  free(arrays.values);
+  if (!built) {
+    build->failed[0][digit] = true;
+    return;
+  }
+
+  // Keys are never empty, so the top digit of a key is at least one.
+  size_t *groupCounts = build->groupCounts[digit];
+  for (size_t i = 0; i < kept; ++i)
+    groupCounts[(arrays.sorted[i].key >> 60) - 1]++;
+
+  size_t positions[ALPHABET_SIZE];
+  size_t position = 0;
+  for (int group = 0; group < ALPHABET_SIZE; ++group) {
+    positions[group] = position;
+    position += groupCounts[group];
+  }
+
+  for (size_t i = 0; i < kept; ++i)
+    arrays.buffer[positions[(arrays.sorted[i].key >> 60) - 1]++] =
+        arrays.sorted[i];
+
+  build->kept[digit] = arrays.buffer;
+}
+
+/// @brief Buduje poddrzewo drzewa prefiksów.
+/// Zadanie @ref parallelRun wykonywane dla każdej cyfry, według malejących
+/// rozmiarów części. Zbiera przekierowania na prefiksy zaczynające się daną
+/// cyfrą z kolejnych części drzewa przekierowań, więc pozostają one w
+/// kolejności @p num1.
+/// @param[in,out] context – wskaźnik na strukturę @ref BuildParallel.
+/// @param[in] task – numer zadania.
+/// @param[in] worker – numer wątku.
+static void buildPrefixesPart(void *context, size_t task, int worker) {
+  (void)worker;
+  struct BuildParallel *build = context;
+  int digit = build->partOrder[task];
+
+  size_t count = 0;
+  for (int part = 0; part < ALPHABET_SIZE; ++part)
+    count += build->groupCounts[part][digit];
+
+  struct BuildArrays arrays;
+  bool built = buildArraysInit(&arrays, count);
+
+  size_t position = 0;
+  for (int part = 0; part < ALPHABET_SIZE && built; ++part) {
+    size_t groupFirst = 0;
+    for (int group = 0; group < digit; ++group)
+      groupFirst += build->groupCounts[part][group];
+
+    memcpy(arrays.sorted + position, build->kept[part] + groupFirst,
+           sizeof(struct BuildPair) * build->groupCounts[part][digit]);
+    position += build->groupCounts[part][digit];
+  }
+
+  built = built && buildPrefixes(&build->parts[1][digit], &arrays, count);
+  buildArraysFree(&arrays);
+  if (!built)
+    build->failed[1][digit] = true;
+}
+
+/// @brief Kopiuje poddrzewo na jego miejsce w strukturze.
+/// Zadanie @ref parallelRun wykonywane dla każdego doklejenia.
+/// @param[in,out] context – wskaźnik na strukturę @ref BuildParallel.
+/// @param[in] task – numer doklejenia.
+/// @param[in] worker – numer wątku.
+static void buildGraftCopy(void *context, size_t task, int worker) {
+  (void)worker;
+  struct BuildParallel *build = context;
+  struct Trie *trie = task < ALPHABET_SIZE ? &build->result->redirections
+                                           : &build->result->prefixes;
+  trieGraftCopy(trie, &build->grafts[task]);
 }
 
-/// @brief Usuwa powtórzenia z tablicy.
-/// Usuwa powtórzenia z tablicy wskaźników na napisy. Zakłada że tablica jest
-/// posortowana. Jeśli jakiś napis się powtarza zwalnia jego zawartość używając
-/// @p free. Zwraca nowy rozmiar tablicy. Zawartość tablicy za zwróconym
-/// indeksem jest nieokreślona.
-/// @param[in] arr      – Wskaźnik na pierwszy element tablicy.
-/// @param[in] arr_size – Ilość elementów w wejściowej tablicy.
-/// @return Nowy rozmiar tablicy. Rozmiar tablicy nie jest zmieniony, ale
-/// zawartośc poza zwróconym indeksem jest niezdefiniowana.
-static int unique(char **arr, int arr_size) {
-  int write_idx = 0;
-  for (int i = 0; i < arr_size; ++i) {
-    // NOTE: This frees skipped entires in the array.
-    while (i < arr_size - 1 && strcmp(arr[i], arr[i + 1]) == 0) {
-      free(arr[i]);
-      arr[i] = NULL;
-      ++i;
+/// @brief Porządkuje cyfry według malejących rozmiarów części.
+/// @param[out] order – cyfry w kolejności malejących rozmiarów.
+/// @param[in] sizes – rozmiary części dla każdej cyfry.
+static void buildPartOrder(int order[ALPHABET_SIZE],
+                           const size_t sizes[ALPHABET_SIZE]) {
+  for (int i = 0; i < ALPHABET_SIZE; ++i) {
+    int j = i;
+    for (; j > 0 && sizes[order[j - 1]] < sizes[i]; --j)
+      order[j] = order[j - 1];
+
+    order[j] = i;
+  }
+}
+
+struct PhoneForward *
+phfwdBuildFromPairsParallel(const struct PhoneForwardPair *pairs,
+                            size_t count, int threads) {
+  if (threads <= 1 || count < BUILD_PARALLEL_THRESHOLD)
+    return phfwdBuildFromPairs(pairs, count);
+
+  if ((!pairs && count > 0) || count >= SIZE_MAX / sizeof(struct BuildPair))
+    return NULL;
+
+  struct BuildParallel *build = calloc(1, sizeof(struct BuildParallel));
+  struct PhoneForward *result = phfwdNew();
+  if (!build || !result) {
+    free(build);
+    phfwdDelete(result);
+    return NULL;
+  }
+
+  size_t chunks = (size_t)threads * BUILD_CHUNKS_PER_WORKER;
+  build->result = result;
+  build->pairs = pairs;
+  build->count = count;
+  build->chunkSize = (count + chunks - 1) / chunks;
+  build->chunkCounts = malloc(sizeof(*build->chunkCounts) * chunks);
+  build->chunkValid = malloc(sizeof(bool) * chunks);
+  build->sorted = malloc(sizeof(struct BuildPair) * (count + 1));
+  build->buffer = malloc(sizeof(struct BuildPair) * (count + 1));
+  build->allocators = malloc(sizeof(struct TrieAllocator) * threads);
+
+  bool built = build->chunkCounts && build->chunkValid && build->sorted &&
+               build->buffer && build->allocators;
+  if (build->allocators)
+    for (int i = 0; i < threads; ++i)
+      trieAllocatorInit(&build->allocators[i]);
+
+  // Parts that were not initialized have no arrays, so freeing them is safe.
+  for (int i = 0; i < 2 * ALPHABET_SIZE && built; ++i)
+    built = trieInit(&build->parts[i / ALPHABET_SIZE][i % ALPHABET_SIZE]);
+
+  if (built)
+    parallelRun(threads, chunks, buildCountChunk, build);
+
+  // Each chunk starts in each part right after the previous chunk.
+  size_t partSizes[ALPHABET_SIZE] = {0};
+  for (size_t chunk = 0; chunk < chunks && built; ++chunk) {
+    built = build->chunkValid[chunk];
+    for (int digit = 0; digit < ALPHABET_SIZE; ++digit) {
+      size_t chunkCount = build->chunkCounts[chunk][digit];
+      build->chunkCounts[chunk][digit] = partSizes[digit];
+      partSizes[digit] += chunkCount;
+    }
+  }
+
+  if (built) {
+    for (int digit = 0; digit < ALPHABET_SIZE; ++digit) {
+      build->partStart[digit + 1] = build->partStart[digit] + partSizes[digit];
+      for (size_t chunk = 0; chunk < chunks; ++chunk)
+        build->chunkCounts[chunk][digit] += build->partStart[digit];
+    }
+
+    buildPartOrder(build->partOrder, partSizes);
+    parallelRun(threads, chunks, buildScatterChunk, build);
+    parallelRun(threads, ALPHABET_SIZE, buildRedirectionsPart, build);
+  }
+
+  for (int digit = 0; digit < ALPHABET_SIZE && built; ++digit)
+    built = !build->failed[0][digit];
+
+  if (built) {
+    for (int digit = 0; digit < ALPHABET_SIZE; ++digit) {
+      partSizes[digit] = 0;
+      for (int part = 0; part < ALPHABET_SIZE; ++part)
+        partSizes[digit] += build->groupCounts[part][digit];
     }
 
-    assert(i >= write_idx);
-    if (i > write_idx)
-      arr[write_idx] = arr[i];
+    buildPartOrder(build->partOrder, partSizes);
+    parallelRun(threads, ALPHABET_SIZE, buildPrefixesPart, build);
+  }
 
-    ++write_idx;
+  for (int digit = 0; digit < ALPHABET_SIZE && built; ++digit)
+    built = !build->failed[1][digit];
+
+  for (int i = 0; i < 2 * ALPHABET_SIZE; ++i)
+    build->grafts[i].part = &build->parts[i / ALPHABET_SIZE][i % ALPHABET_SIZE];
+
+  built = built &&
+          trieGraftPrepare(&result->redirections, build->grafts,
+                           ALPHABET_SIZE) &&
+          trieGraftPrepare(&result->prefixes, build->grafts + ALPHABET_SIZE,
+                           ALPHABET_SIZE);
+
+  if (built)
+    parallelRun(threads, 2 * ALPHABET_SIZE, buildGraftCopy, build);
+
+  // Values of all parts move to the result, also when they are to be freed.
+  for (int i = 0; i < 2 * ALPHABET_SIZE; ++i)
+    trieFree(&build->parts[i / ALPHABET_SIZE][i % ALPHABET_SIZE]);
+  if (build->allocators)
+    for (int i = 0; i < threads; ++i)
+      trieAllocatorMerge(&result->allocator, &build->allocators[i]);
+
+  free(build->chunkCounts);
+  free(build->chunkValid);
+  free(build->sorted);
+  free(build->buffer);
+  free(build->allocators);
+  free(build);
+  if (!built) {
+    phfwdDelete(result);
+    return NULL;
   }
 
-  return write_idx;
+  return result;
 }
 
-/// @brief Leksykograficzne porównanie dwóch napisów.
-/// Leksykograficzne porównanie dwóch napisów, przekazanych przez void *. Oba
-/// parametry są rzutowane na const char **
-/// @param[in] self  – pierwszy napis do porównania.
-/// @param[in] other – drugi napis do porównania.
-/// @return -1, 0 lub 1, gdy @p self jest mniejszy leksykograficzne, równy, lub
-///         większy od @p other.
-static int lexicographicalCompare(const void *self, const void *other) {
-  const char *_self = *(const char **)self;
-  const char *_other = *(const char **)other;
+void phfwdDelete(struct PhoneForward *pf) {
+  assert(!pf || pf->snapshots == 0);
+
+  if (pf)
+    resultCacheDelete(pf->cache);
 
-  for (int i = 0;; ++i) {
-    if (_self[i] == '\0' && _other[i] == '\0')
-      return 0;
-    else if (_self[i] == '\0' || _self[i] < _other[i])
-      return -1;
-    else if (_other[i] == '\0' || _other[i] < _self[i])
-      return 1;
+  if (pf && pf->image) {
+    trieImageFileClose(pf->image);
+    free(pf->image);
+    free(pf);
+  } else if (pf) {
+    // Both trees live in flat arrays and all of their values in the allocator,
+    // so there is no need to walk them.
+    trieFree(&pf->prefixes);
+    trieFree(&pf->redirections);
+    trieAllocatorClear(&pf->allocator);
+    free(pf);
   }
 }
 
-const struct PhoneNumbers *phfwdReverse(struct PhoneForward *pf,
-                                        const char *num) {
+bool phfwdCacheEnable(struct PhoneForward *pf, size_t capacity) {
   assert(pf);
-  char currentPrefix[strlen(num) + 2];
-  currentPrefix[0] = '\0';
 
-  struct PhoneNumbers *result = phnumNewEmpty(32);
-  if (!result)
-    return NULL;
+  resultCacheDelete(pf->cache);
+  pf->cache = NULL;
+  if (capacity == 0)
+    return true;
 
-  if (!isValidPhnum(num))
-    return result;
+  pf->cache = resultCacheNew(capacity);
+  return pf->cache != NULL;
+}
 
-  struct TrieNode *current = pf->prefixes;
-  int currentPrefixSize = 0;
+void phfwdCacheStats(const struct PhoneForward *pf,
+                     struct PhoneForwardCacheStats *stats) {
+  assert(pf);
 
-  for (const char *currentChar = num; (*currentChar) != '\0'; currentChar++) {
-    int currentBranchIdx = (*currentChar) - '0';
-    assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+  if (pf->cache)
+    resultCacheStats(pf->cache, stats);
+  else
+    (*stats) = (struct PhoneForwardCacheStats){0, 0, 0, 0};
+}
 
-    if (!current->childs[currentBranchIdx])
-      // No more prefixes to find.
-      break;
+/// @brief Unieważnia wyniki phfwdReverse zależne od usuwanego przekierowania.
+/// Funkcja przekazywana do @ref trieVisitSubtree.
+/// @param[in,out] context – wskaźnik na pamięć wyników.
+/// @param[in] data – przekierowanie, którego numer docelowy przestaje być
+///                   przekierowywany.
+static void phfwdCacheTouchTarget(void *context, const struct DataNode *data) {
+  resultCacheTouch(context, RESULT_CACHE_REVERSE, dataNodeText(data));
+}
 
-    current = current->childs[currentBranchIdx];
-    currentPrefix[currentPrefixSize] = (*currentChar);
-    currentPrefixSize++;
-    currentPrefix[currentPrefixSize] = '\0';
-
-    struct DataNode *redirection = current->data;
-    struct DataNode *prev_redirection = NULL;
-
-    while (redirection) {
-      assert(!prev_redirection || prev_redirection->next == redirection);
-      if (!trieValueUnderPrefixExists(pf->redirections, redirection->text,
-                                      currentPrefix)) {
-        // Remove this entry from the list, because its old. This is a lazy
-        // deletion. This entry might have been removed long ago from the
-        // redirections tree.
-
-        // If this is a first one...
-        if (!prev_redirection) {
-          current->data = redirection->next;
-        } else {
-          prev_redirection->next = redirection->next;
-        }
+/// @brief Wyznacza wynik zapytania, korzystając z pamięci wyników.
+/// Zwraca kopię zapamiętanego wyniku, a gdy go nie ma, wyznacza wynik przez
+/// @p query i zapamiętuje jego kopię. Numery niepoprawne i zapytania, gdy
+/// pamięć jest wyłączona, trafiają wprost do @p query.
+/// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                     numerów;
+/// @param[in] kind – rodzaj zapytania.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[in] query – funkcja wyznaczająca wynik.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *
+phfwdCached(struct PhoneForward *pf, enum ResultCacheKind kind,
+            const char *num,
+            const struct PhoneNumbers *(*query)(struct PhoneForward *pf,
+                                                const char *num)) {
+  if (!pf->cache || !isValidPhnum(num))
+    return query(pf, num);
+
+  const struct PhoneNumbers *cached = resultCacheFind(pf->cache, kind, num);
+  if (cached)
+    return phnumCopy(cached);
+
+  const struct PhoneNumbers *result = query(pf, num);
+  if (result) {
+    const struct PhoneNumbers *copy = phnumCopy(result);
+    if (copy)
+      resultCacheInsert(pf->cache, kind, num, copy);
+  }
 
-        struct DataNode *next_redirection = redirection->next;
-        redirection->next = NULL;
-        dataNodeDelete(redirection);
+  return result;
+}
 
-        redirection = next_redirection;
-        continue;
-      }
+bool phfwdAdd(struct PhoneForward *pf, const char *num1, const char *num2) {
+  assert(pf);
 
-      if (result->size == result->capacity) {
-        result->capacity *= 2;
-        result->numbers =
-            realloc(result->numbers, sizeof(char *) * result->capacity);
-        if (!result->numbers)
-          return NULL;
-      }
+  // If num1/2 are not telepfone numbers or if they are equal return false.
+  if (pf->image || !isValidPhnum(num1) || !isValidPhnum(num2) ||
+      strcmp(num1, num2) == 0) {
+    return false;
+  }
 
-      result->numbers[result->size] =
-          malloc(sizeof(char *) * (strlen(redirection->text) + strlen(num) -
-                                   currentPrefixSize + 1));
+  // The reverse entry of a replaced redirection is removed last, which must
+  // not fail, so with snapshots it is prepared before anything changes.
+  const struct DataNode *previous = trieFindData(&pf->redirections, num1);
+  if (previous && !triePrepareRemoveEntry(&pf->allocator, &pf->prefixes,
+                                          dataNodeText(previous)))
+    return false;
 
-      result->numbers[result->size][0] = '\0';
-      strcat(strcat(result->numbers[result->size], redirection->text),
-             num + currentPrefixSize);
-      result->size++;
+  pf->changes++;
 
-      prev_redirection = redirection;
-      redirection = redirection->next;
-    }
+  // Both entries are created upfront, so that a failed allocation leaves the
+  // structure untouched.
+  struct DataNode *redirection = dataNodeNew(&pf->allocator, num2);
+  struct DataNode *reverse = dataNodeNewPacked(&pf->allocator, num1);
+  if (!redirection || !reverse) {
+    dataNodeDelete(&pf->allocator, redirection);
+    dataNodeDelete(&pf->allocator, reverse);
+    return false;
   }
 
-  if (result->size == result->capacity) {
-    result->capacity *= 2;
-    result->numbers =
-        realloc(result->numbers, sizeof(char *) * result->capacity);
-    if (!result->numbers)
-      return NULL;
+  redirection->link = reverse;
+  reverse->link = redirection;
+  if (!trieAddText(&pf->allocator, &pf->prefixes, num2, reverse, true, NULL)) {
+    dataNodeDelete(&pf->allocator, redirection);
+    dataNodeDelete(&pf->allocator, reverse);
+    return false;
   }
 
-  result->numbers[result->size] = duplicateStr(num);
-  if (!result->numbers[result->size])
-    return NULL;
+  // There is no reason to initialize this, except the GCC warning.
+  struct DataNode *prevData = NULL;
 
-  result->size++;
+  if (!trieAddText(&pf->allocator, &pf->redirections, num1, redirection, false,
+                   &prevData)) {
+    trieRemoveEntry(&pf->allocator, &pf->prefixes, num2, reverse);
+    dataNodeDelete(&pf->allocator, redirection);
+    return false;
+  }
 
-  qsort(result->numbers, result->size, sizeof(result->numbers[0]),
-        lexicographicalCompare);
-  int new_size = unique(result->numbers, result->size);
-  result->size = new_size;
+  if (pf->cache) {
+    resultCacheTouch(pf->cache, RESULT_CACHE_GET, num1);
+    resultCacheTouch(pf->cache, RESULT_CACHE_REVERSE, num2);
+    if (prevData)
+      resultCacheTouch(pf->cache, RESULT_CACHE_REVERSE,
+                       dataNodeText(prevData));
+  }
 
-  return result;
+  if (prevData) {
+    assert(!prevData->next);
+    trieRemoveEntry(&pf->allocator, &pf->prefixes, dataNodeText(prevData),
+                    prevData->link);
+    dataNodeDelete(&pf->allocator, prevData);
+  }
+
+  return true;
 }
 
-/// @brief Pomocnicza funckja rekurencyjna wywoływana przez
-/// phfwdNonTrivialCount. Sprawdza czy w wierzchołku znajduje się jakaś aktualna
-/// wartość i na tej podstawie oblicza liczbę nietrywialnych numerów telefonów o
-/// prefiksie pod jakim znajduje się wierzchołek currentRoot.
-/// @param [in] redirectionsRoot – wierzchołek drzewa trie trzymającego
-///                                przekierowania telefonów. Z podowdu 'leniwego
-///                                usuwania' musimy sprawdzać, czy używane przez
-///                                nas wartości są aktualne.
-/// @param [in] currentRoot – wskaźnik na aktualne poddrzewo w drzewie
-///                           prefiksów.
-/// @param [in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
-///                         które zliczamy.
-/// @param [in] current_deep – Głębokośc w drzewie prefiksów, na jakiej znajduje
-///                            się @p currentRoot.
-/// @param [in] len – długość napisów jakie należy zliczyć.
-/// @return Liczbę nietrywialnych numerów telefonów o prefiksie pod jakim
-///         znajduje się wierzchołek currentRoot modulo dwa do potęgi liczba
-///         bitów typu size_t.
-static size_t phfwdNonTrivialCountAux(struct TrieNode *redirectionsRoot,
-                                      struct TrieNode *currentRoot,
-                                      const int *digit_set,
-                                      const size_t current_deep,
-                                      const size_t len) {
-  assert(len >= current_deep);
-  assert(currentRoot);
+bool phfwdRemove(struct PhoneForward *pf, const char *num) {
+  if (pf->image)
+    return false;
+  if (!isValidPhnum(num))
+    return true;
+
+  pf->changes++;
+  if (pf->cache) {
+    resultCacheTouch(pf->cache, RESULT_CACHE_GET, num);
+    if (!trieVisitSubtree(&pf->redirections, num, phfwdCacheTouchTarget,
+                          pf->cache))
+      resultCacheFlush(pf->cache);
+  }
 
-  if (dataListContaisEntryThatExists(redirectionsRoot, currentRoot)) {
-    int numbers_of_digits_in_set = 0;
-    for (int i = 0; i < 12; ++i)
-      if (digit_set[i])
-        numbers_of_digits_in_set++;
+  return trieDeleteSubtree(&pf->allocator, &pf->redirections, num,
+                           &pf->prefixes);
+}
 
-    return power(numbers_of_digits_in_set, len - current_deep);
-  } else if (len == current_deep)
-    // We dont have to go deeper that [len] nodes.
-    return 0;
+/// @brief Wyznacza przekierowanie numeru w odwzorowanym pliku zrzutu.
+/// Działa jak @ref phfwdGetView, dla numeru, który został już sprawdzony.
+/// @param[in] redirections – drzewo przekierowań z pliku.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[out] prefix – początek przekierowanego numeru.
+/// @param[out] suffixOffset – pozycja w @p num, od której zaczyna się koniec
+///                            przekierowanego numeru.
+static void phfwdImageGetView(const struct TrieImage *redirections,
+                              const char *num, const char **prefix,
+                              size_t *suffixOffset) {
+  TrieIndex currentNode = TRIE_ROOT;
+  const struct SnapshotValue *forwarded =
+      trieImageValue(redirections, TRIE_ROOT);
+  size_t forwardedDepth = 0;
+
+  for (size_t i = 0; num[i] != '\0';) {
+    int labelLength;
+    currentNode =
+        trieImageDescend(redirections, currentNode, num + i, &labelLength);
+    if (currentNode == TRIE_NONE)
+      break;
 
-  size_t result = 0;
-  for (int i = 0; i < ';' - '0' + 1; ++i)
-    if (currentRoot->childs[i] && digit_set[i]) {
-      result +=
-          phfwdNonTrivialCountAux(redirectionsRoot, currentRoot->childs[i],
-                                  digit_set, current_deep + 1, len);
+    i += labelLength;
+    const struct SnapshotValue *value =
+        trieImageValue(redirections, currentNode);
+    if (value) {
+      forwarded = value;
+      forwardedDepth = i;
     }
+  }
 
-  return result;
+  (*prefix) = forwarded ? forwarded->text : "";
+  (*suffixOffset) = forwardedDepth;
 }
 
-size_t phfwdNonTrivialCount(struct PhoneForward *pf, const char *set,
-                            size_t len) {
-  if (!pf || !set || !strlen(set) || !len)
-    return 0;
+/// @brief Wyznacza przekierowanie numeru w wersji drzewa przekierowań.
+/// Działa jak @ref phfwdGetView dla drzewa o korzeniu @p root.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] root – indeks korzenia drzewa przekierowań.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[out] prefix – początek przekierowanego numeru.
+/// @param[out] suffixOffset – pozycja w @p num, od której zaczyna się koniec
+///                            przekierowanego numeru.
+/// @return Wartość @p true, jeśli wynik został wyznaczony. Wartość @p false,
+///         jeśli podany napis nie reprezentuje numeru.
+static bool phfwdGetViewFrom(const struct PhoneForward *pf, TrieIndex root,
+                             const char *num, const char **prefix,
+                             size_t *suffixOffset) {
+  if (!isValidPhnum(num))
+    return false;
 
-  int number_mask[12];
-  int found_any_digit = 0;
-  for (int i = 0; i < 12; ++i)
-    number_mask[i] = 0;
+  if (pf->image) {
+    phfwdImageGetView(&pf->image->tries[0], num, prefix, suffixOffset);
+    return true;
+  }
 
-  for (int i = 0; set[i] != '\0'; ++i)
-    if (inRange(set[i], '0', ';')) {
-      number_mask[set[i] - '0'] = 1;
-      found_any_digit = 1;
-    }
+  const struct Trie *redirections = &pf->redirections;
+  TrieIndex currentNode = root;
+  const struct TrieNode *last_forwarded_node = NULL;
+  size_t last_forwarded_prefix_size = 0;
 
-  if (!found_any_digit)
-    return 0;
+  if (redirections->nodes[currentNode].data != NULL) {
+    last_forwarded_node = &redirections->nodes[currentNode];
+    last_forwarded_prefix_size = 0;
+  }
 
-  // We iterate over prefixes tree, and search for numbers that match
-  // reqiurements. There is no point in going deeper than [len] nodes.
-  assert(pf->prefixes);
-  return phfwdNonTrivialCountAux(pf->redirections, pf->prefixes, number_mask, 0,
-                                 len);
+  for (size_t i = 0; num[i] != '\0';) {
+    int labelLength;
+    currentNode = trieDescend(redirections, currentNode, num + i, &labelLength);
+    if (currentNode == TRIE_NONE)
+      break;
+
+    i += labelLength;
+    if (redirections->nodes[currentNode].data != NULL) {
+      last_forwarded_node = &redirections->nodes[currentNode];
+      last_forwarded_prefix_size = i;
+    }
+  }
+
+  // Decide how does the forwarded prefix look like. Variable
+  // [last_forwarded_prefix_size] tells us how many characters from the input
+  // string are redirected into that prefix. Must be 0 if last_forwarded_node
+  // is NULL!
+  (*prefix) =
+      last_forwarded_node ? dataNodeText(last_forwarded_node->data) : "";
+  if (!last_forwarded_node)
+    assert(last_forwarded_prefix_size == 0);
+
+  (*suffixOffset) = last_forwarded_prefix_size;
+  return true;
+}
+
+bool phfwdGetView(const struct PhoneForward *pf, const char *num,
+                  const char **prefix, size_t *suffixOffset) {
+  assert(pf);
+  assert(prefix);
+  assert(suffixOffset);
+
+  return phfwdGetViewFrom(pf, TRIE_ROOT, num, prefix, suffixOffset);
+}
+
+/// Liczba wyszukiwań przeplatanych przez @ref phfwdGetBatch.
+#define GET_BATCH_WIDTH (16)
+
+/// @brief Stan pojedynczego wyszukiwania w @ref phfwdGetBatch.
+/// Każdy krok wyszukiwania odczytuje jedną strukturę, której adres został
+/// pobrany do pamięci podręcznej w poprzednim kroku, i pobiera kolejną.
+struct GetBatchLookup {
+  /// Wyszukiwany numer, lub @p NULL, gdy miejsce jest wolne.
+  const char *num;
+
+  /// Indeks wyszukiwanego numeru w tablicy numerów.
+  size_t idx;
+
+  /// Długość prefiksu numeru, prowadzącego do rodzica @ref node.
+  size_t depth;
+
+  /// Następny wierzchołek do odczytania.
+  TrieIndex node;
+
+  /// @brief Indeks w @ref Trie.slots następnego dziecka.
+  /// Gdy różny od @ref TRIE_NONE, w następnym kroku odczytywane jest dziecko
+  /// zamiast wierzchołka @ref node.
+  TrieIndex slot;
+
+  /// Najgłębszy dotąd znaleziony wierzchołek z wartością, lub @p NULL.
+  const struct DataNode *forwarded;
+
+  /// Długość prefiksu numeru, prowadzącego do @ref forwarded.
+  size_t forwardedDepth;
+};
+
+/// @brief Wykonuje jeden krok wyszukiwania.
+/// @param[in] redirections – drzewo przekierowań.
+/// @param[in,out] lookup – stan wyszukiwania.
+/// @return @p true, jeśli wyszukiwanie wymaga kolejnych kroków, @p false, gdy
+///         zostało zakończone.
+static bool getBatchStep(const struct Trie *redirections,
+                         struct GetBatchLookup *lookup) {
+  if (lookup->slot != TRIE_NONE) {
+    lookup->node = redirections->slots[lookup->slot];
+    lookup->slot = TRIE_NONE;
+    prefetch(&redirections->nodes[lookup->node]);
+    return true;
+  }
+
+  // The first digit of the label was already used to choose the child.
+  const struct TrieNode *node = &redirections->nodes[lookup->node];
+  const char *text = lookup->num + lookup->depth;
+  for (int i = 1; i < node->labelLength; ++i)
+    if (text[i] - '0' != trieLabelDigit(node, i))
+      return false;
+
+  lookup->depth += node->labelLength;
+  if (node->data) {
+    lookup->forwarded = node->data;
+    lookup->forwardedDepth = lookup->depth;
+  }
+
+  int digit = lookup->num[lookup->depth] - '0';
+  if (lookup->num[lookup->depth] == '\0' || !(node->childMask & (1u << digit)))
+    return false;
+
+  lookup->slot = node->childs + bitCount(node->childMask & ((1u << digit) - 1));
+  prefetch(&redirections->slots[lookup->slot]);
+  return true;
+}
+
+/// @brief Zaczyna kolejne wyszukiwanie w @ref phfwdGetBatch.
+/// Napisy, które nie reprezentują numerów, od razu dostają pusty wynik.
+/// @param[in] redirections – drzewo przekierowań.
+/// @param[out] lookup – wolne miejsce na stan wyszukiwania.
+/// @param[in] nums – tablica wyszukiwanych numerów.
+/// @param[in] count – liczba numerów w tablicy @p nums.
+/// @param[in,out] next – indeks następnego numeru do wyszukania.
+/// @param[out] out – tablica wyników.
+/// @return @p true, jeśli wyszukiwanie zostało rozpoczęte, @p false, gdy nie
+///         ma już numerów do wyszukania.
+static bool getBatchStart(const struct Trie *redirections,
+                          struct GetBatchLookup *lookup,
+                          const char *const *nums, size_t count, size_t *next,
+                          struct PhoneNumberView *out) {
+  lookup->num = NULL;
+  while ((*next) < count && !isValidPhnum(nums[*next])) {
+    out[*next] = (struct PhoneNumberView){NULL, 0};
+    (*next)++;
+  }
+
+  if ((*next) == count)
+    return false;
+
+  (*lookup) = (struct GetBatchLookup){.num = nums[*next],
+                                      .idx = (*next),
+                                      .depth = 0,
+                                      .node = TRIE_ROOT,
+                                      .slot = TRIE_NONE,
+                                      .forwarded = NULL,
+                                      .forwardedDepth = 0};
+  prefetch(&redirections->nodes[TRIE_ROOT]);
+  (*next)++;
+  return true;
+}
+
+void phfwdGetBatch(const struct PhoneForward *pf, const char *const *nums,
+                   size_t count, struct PhoneNumberView *out) {
+  assert(pf);
+  assert(!count || (nums && out));
+
+  // Lookups in a mapped file are not interleaved.
+  if (pf->image) {
+    for (size_t i = 0; i < count; ++i)
+      if (!phfwdGetView(pf, nums[i], &out[i].prefix, &out[i].suffixOffset))
+        out[i] = (struct PhoneNumberView){NULL, 0};
+
+    return;
+  }
+
+  const struct Trie *redirections = &pf->redirections;
+  struct GetBatchLookup lookups[GET_BATCH_WIDTH];
+  size_t next = 0;
+  int active = 0;
+
+  for (int i = 0; i < GET_BATCH_WIDTH; ++i)
+    if (getBatchStart(redirections, &lookups[i], nums, count, &next, out))
+      active++;
+
+  // Lookups advance round-robin, so that the memory read by each step is
+  // fetched while the other lookups make their steps. A finished lookup is
+  // immediately replaced with the next number.
+  while (active > 0) {
+    for (int i = 0; i < GET_BATCH_WIDTH; ++i) {
+      struct GetBatchLookup *lookup = &lookups[i];
+      if (!lookup->num || getBatchStep(redirections, lookup))
+        continue;
+
+      out[lookup->idx] = (struct PhoneNumberView){
+          lookup->forwarded ? dataNodeText(lookup->forwarded) : "",
+          lookup->forwardedDepth};
+
+      if (!getBatchStart(redirections, lookup, nums, count, &next, out))
+        active--;
+    }
+  }
+}
+
+/// @brief Tworzy wynik phfwdGet.
+/// @param[in] num – wskaźnik na napis reprezentujący numer, lub @p NULL, gdy
+///                  wynik jest pusty.
+/// @param[in] forwarded_prefix – początek przekierowanego numeru.
+/// @param[in] suffixOffset – pozycja w @p num, od której zaczyna się koniec
+///                           przekierowanego numeru.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static struct PhoneNumbers *phnumFromView(const char *num,
+                                          const char *forwarded_prefix,
+                                          size_t suffixOffset) {
+  // Result is empty, if [num] does not represent the number.
+  if (!num)
+    return phnumNew(0, 0);
+
+  size_t prefixLength = strlen(forwarded_prefix);
+  size_t suffixLength = strlen(num + suffixOffset);
+
+  // This contains only one number.
+  struct PhoneNumbers *result = phnumNew(1, prefixLength + suffixLength + 1);
+  if (!result)
+    return NULL;
+
+  result->size = 1;
+  result->offsets[0] = 0;
+  memcpy(result->text, forwarded_prefix, prefixLength);
+  memcpy(result->text + prefixLength, num + suffixOffset, suffixLength + 1);
+
+  return result;
+}
+
+/// @brief Wyznacza przekierowanie numeru z pominięciem pamięci wyników.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *phfwdGetUncached(struct PhoneForward *pf,
+                                                   const char *num) {
+  return phfwdGetConst(pf, num);
+}
+
+struct PhoneNumbers const *phfwdGet(struct PhoneForward *pf, const char *num) {
+  return phfwdCached(pf, RESULT_CACHE_GET, num, phfwdGetUncached);
+}
+
+const struct PhoneNumbers *phfwdGetConst(const struct PhoneForward *pf,
+                                         const char *num) {
+  const char *forwarded_prefix;
+  size_t suffixOffset;
+
+  if (!phfwdGetView(pf, num, &forwarded_prefix, &suffixOffset))
+    return phnumFromView(NULL, NULL, 0);
+
+  return phnumFromView(num, forwarded_prefix, suffixOffset);
+}
+
+const char *phnumGet(const struct PhoneNumbers *pnum, size_t idx) {
+  if (!pnum || idx >= pnum->size)
+    return NULL;
+
+  return pnum->text + pnum->offsets[idx];
+}
+
+void phnumDelete(const struct PhoneNumbers *pnum) {
+  // Numbers are stored in the same block as the structure.
+  free((void *)pnum);
+}
+
+/// @brief Szuka kolejnego wierzchołka z wartościami na ścieżce numeru.
+/// Schodzi w drzewie prefiksów od wierzchołka @p node wzdłuż napisu @p num,
+/// aż do wierzchołka, do którego przypisana jest jakaś wartość.
+/// @param[in] prefixes – drzewo prefiksów.
+/// @param[in] node – indeks wierzchołka, od którego zaczynamy.
+/// @param[in] num – numer, wzdłuż którego schodzimy.
+/// @param[in,out] depth – długość prefiksu @p num prowadzącego do @p node,
+///                        zastępowana długością prefiksu prowadzącego do
+///                        znalezionego wierzchołka.
+/// @return Indeks znalezionego wierzchołka, lub @ref TRIE_NONE, gdy takiego
+///         nie ma.
+static TrieIndex reverseNextNode(const struct Trie *prefixes, TrieIndex node,
+                                 const char *num, size_t *depth) {
+  while (num[*depth] != '\0') {
+    int labelLength;
+    node = trieDescend(prefixes, node, num + (*depth), &labelLength);
+    if (node == TRIE_NONE)
+      // No more prefixes to find.
+      break;
+
+    (*depth) += labelLength;
+    if (prefixes->nodes[node].data)
+      return node;
+  }
+
+  return TRIE_NONE;
+}
+
+/// @brief Posortowany ciąg wyników phfwdReverse.
+/// Kolejne elementy ciągu to napisy powstałe z doklejenia @ref suffix do
+/// tekstów kolejnych wartości jednego wierzchołka drzewa prefiksów. Wartości
+/// są porównywane spakowane i rozpakowywane dopiero przy zapisie wyniku.
+struct ReverseStream {
+  /// Wartość, z której powstaje bieżący element ciągu, lub @p NULL, gdy
+  /// elementem jest sam @ref suffix.
+  const struct DataNode *source;
+
+  /// Czy ciąg się skończył.
+  bool finished;
+
+  /// Koniec wszystkich elementów ciągu.
+  const char *suffix;
+
+  /// Długość napisu @ref suffix.
+  size_t suffixLength;
+};
+
+/// Kandydat na wynik @ref phfwdReverse w odwzorowanym pliku zrzutu.
+struct ReverseCandidate {
+  /// Początek numeru: tekst wartości z drzewa prefiksów.
+  const char *source;
+
+  /// Koniec numeru.
+  const char *suffix;
+};
+
+/// @brief Porównuje kandydatów na wynik.
+/// @param[in] first – wskaźnik na pierwszą strukturę @ref ReverseCandidate.
+/// @param[in] second – wskaźnik na drugą strukturę @ref ReverseCandidate.
+/// @return Liczbę ujemną, zero lub dodatnią, gdy numer pierwszego kandydata
+///         jest mniejszy leksykograficznie, równy, lub większy od numeru
+///         drugiego.
+static int reverseCandidateCompare(const void *first, const void *second) {
+  const struct ReverseCandidate *a = first;
+  const struct ReverseCandidate *b = second;
+  return concatCompare(a->source, a->suffix, b->source, b->suffix);
+}
+
+/// @brief Tworzy wynik phfwdReverse z nieposortowanych kandydatów.
+/// Sortuje kandydatów i przepisuje ich numery, bez powtórzeń, do nowej
+/// struktury. Zwalnia tablicę @p candidates.
+/// @param[in,out] candidates – tablica kandydatów.
+/// @param[in] count – liczba kandydatów.
+/// @param[in] textSize – łączna długość numerów kandydatów, wliczając znaki
+///                       @p '\0'.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *
+reverseFromCandidates(struct ReverseCandidate *candidates, size_t count,
+                      size_t textSize) {
+  struct PhoneNumbers *result = phnumNew(count, textSize);
+  if (!result) {
+    free(candidates);
+    return NULL;
+  }
+
+  qsort(candidates, count, sizeof(struct ReverseCandidate),
+        reverseCandidateCompare);
+
+  char *write = result->text;
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0 &&
+        reverseCandidateCompare(&candidates[i - 1], &candidates[i]) == 0)
+      continue;
+
+    result->offsets[result->size++] = write - result->text;
+
+    size_t sourceLength = strlen(candidates[i].source);
+    size_t suffixLength = strlen(candidates[i].suffix);
+    memcpy(write, candidates[i].source, sourceLength);
+    memcpy(write + sourceLength, candidates[i].suffix, suffixLength + 1);
+    write += sourceLength + suffixLength + 1;
+  }
+
+  free(candidates);
+  return result;
+}
+
+/// @brief Wyznacza przekierowania na dany numer w odwzorowanym pliku zrzutu.
+/// Działa jak @ref phfwdReverse, dla numeru, który został już sprawdzony.
+/// Listy wartości w pliku nie mogą być sortowane w miejscu, więc wszyscy
+/// kandydaci są zbierani do jednej tablicy i sortowani razem.
+/// @param[in] prefixes – drzewo prefiksów z pliku.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *phfwdImageReverse(
+    const struct TrieImage *prefixes, const char *num) {
+  size_t numLength = strlen(num);
+  size_t count = 1;
+  size_t textSize = numLength + 1;
+  struct ReverseCandidate *candidates = NULL;
+
+  // First pass counts the candidates, second one gathers them.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      candidates = malloc(sizeof(struct ReverseCandidate) * count);
+      if (!candidates)
+        return NULL;
+
+      candidates[0] = (struct ReverseCandidate){"", num};
+      count = 1;
+    }
+
+    TrieIndex node = TRIE_ROOT;
+    size_t depth = 0;
+    int labelLength;
+    while (num[depth] != '\0' &&
+           (node = trieImageDescend(prefixes, node, num + depth,
+                                    &labelLength)) != TRIE_NONE) {
+      depth += labelLength;
+      for (const struct SnapshotValue *value = trieImageValue(prefixes, node);
+           value; value = trieImageValueNext(prefixes, value)) {
+        if (pass == 0)
+          textSize += strlen(value->text) + numLength - depth + 1;
+        else
+          candidates[count] =
+              (struct ReverseCandidate){value->text, num + depth};
+
+        count++;
+      }
+    }
+  }
+
+  return reverseFromCandidates(candidates, count, textSize);
+}
+
+/// @brief Wyznacza przekierowania na dany numer z pominięciem pamięci wyników.
+/// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                     numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *phfwdReverseUncached(struct PhoneForward *pf,
+                                                       const char *num) {
+  if (!isValidPhnum(num))
+    return phnumNew(0, 0);
+
+  if (pf->image)
+    return phfwdImageReverse(&pf->image->tries[1], num);
+
+  // Lists shared with snapshots cannot be sorted in place.
+  if (pf->snapshots > 0)
+    return phfwdReverseConst(pf, num);
+
+  // First pass: sort the values of every node on the path of [num], so that
+  // each of them gives a sorted stream of results, and count the space needed.
+  // The number itself is the only element of one more stream.
+  size_t numLength = strlen(num);
+  size_t streamsCount = 1;
+  size_t count = 1;
+  size_t textSize = numLength + 1;
+
+  size_t depth = 0;
+  for (TrieIndex node = reverseNextNode(&pf->prefixes, TRIE_ROOT, num, &depth);
+       node != TRIE_NONE;
+       node = reverseNextNode(&pf->prefixes, node, num, &depth)) {
+    dataListSort(&pf->prefixes.nodes[node].data, num + depth);
+    streamsCount++;
+
+    for (const struct DataNode *source = pf->prefixes.nodes[node].data; source;
+         source = source->next) {
+      count++;
+      textSize += dataNodeLength(source) + numLength - depth + 1;
+    }
+  }
+
+  struct PhoneNumbers *result = phnumNew(count, textSize);
+  if (!result)
+    return NULL;
+
+  struct ReverseStream streams[streamsCount];
+  streams[0] = (struct ReverseStream){NULL, false, num, numLength};
+
+  depth = 0;
+  size_t streamIdx = 1;
+  for (TrieIndex node = reverseNextNode(&pf->prefixes, TRIE_ROOT, num, &depth);
+       node != TRIE_NONE;
+       node = reverseNextNode(&pf->prefixes, node, num, &depth))
+    streams[streamIdx++] = (struct ReverseStream){
+        pf->prefixes.nodes[node].data, false, num + depth, numLength - depth};
+  assert(streamIdx == streamsCount);
+
+  // Second pass: k-way merge of the streams. Equal numbers may come only from
+  // different streams, and they are adjacent in the merged sequence. Values
+  // are compared packed, and each one is unpacked once, into the result.
+  char *write = result->text;
+  for (;;) {
+    struct ReverseStream *min = NULL;
+    for (size_t i = 0; i < streamsCount; ++i)
+      if (!streams[i].finished &&
+          (!min || dataNodeConcatCompare(streams[i].source, streams[i].suffix,
+                                         min->source, min->suffix) < 0))
+        min = &streams[i];
+
+    if (!min)
+      break;
+
+    // The number is written before it is compared with the previous one, so
+    // that both are compared unpacked.
+    size_t sourceLength =
+        min->source ? dataNodeCopyText(min->source, write) : 0;
+    memcpy(write + sourceLength, min->suffix, min->suffixLength + 1);
+    if (result->size == 0 ||
+        strcmp(write, result->text + result->offsets[result->size - 1]) != 0) {
+      result->offsets[result->size++] = write - result->text;
+      write += sourceLength + min->suffixLength + 1;
+    }
+
+    min->source = min->source ? min->source->next : NULL;
+    min->finished = !min->source;
+  }
+
+  return result;
+}
+
+const struct PhoneNumbers *phfwdReverse(struct PhoneForward *pf,
+                                        const char *num) {
+  assert(pf);
+
+  return phfwdCached(pf, RESULT_CACHE_REVERSE, num, phfwdReverseUncached);
+}
+
+/// @brief Zbiera kandydatów na wynik phfwdReverse w wersji drzewa prefiksów.
+/// Pierwszym kandydatem jest sam numer, a kolejnymi wszystkie wartości
+/// wierzchołków na ścieżce numeru, w kolejności ich list.
+/// @param[in] prefixes – drzewo prefiksów.
+/// @param[in] root – indeks korzenia drzewa prefiksów.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[out] count – liczba kandydatów.
+/// @param[out] textSize – łączna długość numerów kandydatów, wliczając znaki
+///                        @p '\0'.
+/// @return Tablica kandydatów, którą należy zwolnić, lub @p NULL, gdy nie
+///         udało się zaalokować pamięci. Rozpakowane teksty wartości leżą w
+///         tym samym bloku pamięci, za kandydatami.
+static struct ReverseCandidate *reverseCollect(const struct Trie *prefixes,
+                                               TrieIndex root,
+                                               const char *num, size_t *count,
+                                               size_t *textSize) {
+  size_t numLength = strlen(num);
+  size_t sourcesSize = 0;
+  struct ReverseCandidate *candidates = NULL;
+  char *unpacked = NULL;
+  (*count) = 1;
+  (*textSize) = numLength + 1;
+
+  // Like in phfwdImageReverse, the lists are not sorted in place, so all
+  // candidates are sorted together.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      candidates = malloc(sizeof(struct ReverseCandidate) * (*count) +
+                          sourcesSize);
+      if (!candidates)
+        return NULL;
+
+      candidates[0] = (struct ReverseCandidate){"", num};
+      unpacked = (char *)(candidates + (*count));
+      (*count) = 1;
+    }
+
+    size_t depth = 0;
+    for (TrieIndex node = reverseNextNode(prefixes, root, num, &depth);
+         node != TRIE_NONE; node = reverseNextNode(prefixes, node, num, &depth))
+      for (const struct DataNode *source = prefixes->nodes[node].data; source;
+           source = source->next) {
+        if (pass == 0) {
+          size_t sourceLength = dataNodeLength(source);
+          (*textSize) += sourceLength + numLength - depth + 1;
+          sourcesSize += sourceLength + 1;
+        } else {
+          candidates[*count] = (struct ReverseCandidate){unpacked, num + depth};
+          unpacked += dataNodeCopyText(source, unpacked) + 1;
+        }
+
+        (*count)++;
+      }
+  }
+
+  return candidates;
+}
+
+/// @brief Wyznacza przekierowania na dany numer w wersji drzewa prefiksów.
+/// Działa jak @ref phfwdReverseConst dla drzewa o korzeniu @p root.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] root – indeks korzenia drzewa prefiksów.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+static const struct PhoneNumbers *
+phfwdReverseFrom(const struct PhoneForward *pf, TrieIndex root,
+                 const char *num) {
+  if (!isValidPhnum(num))
+    return phnumNew(0, 0);
+
+  if (pf->image)
+    return phfwdImageReverse(&pf->image->tries[1], num);
+
+  size_t count, textSize;
+  struct ReverseCandidate *candidates =
+      reverseCollect(&pf->prefixes, root, num, &count, &textSize);
+  if (!candidates)
+    return NULL;
+
+  return reverseFromCandidates(candidates, count, textSize);
+}
+
+const struct PhoneNumbers *phfwdReverseConst(const struct PhoneForward *pf,
+                                             const char *num) {
+  assert(pf);
+
+  return phfwdReverseFrom(pf, TRIE_ROOT, num);
+}
+
+/// Liczba kandydatów, od której phfwdReverseParallel używa wielu wątków.
+#define REVERSE_PARALLEL_THRESHOLD (1 << 14)
+
+/// Liczba fragmentów tablicy kandydatów przypadających na jeden wątek.
+#define REVERSE_CHUNKS_PER_WORKER (4)
+
+/// @brief Stan wyznaczania wyniku phfwdReverse na wielu wątkach.
+/// Tablica kandydatów jest dzielona na fragmenty sortowane osobno, które są
+/// potem scalane parami, aż zostanie jeden posortowany ciąg. Na koniec każdy
+/// fragment ciągu przepisuje swoje numery, bez powtórzeń, do wyniku.
+struct ReverseParallel {
+  /// Posortowane ciągi kandydatów.
+  struct ReverseCandidate *sorted;
+
+  /// Miejsce na ciągi scalone w bieżącej rundzie.
+  struct ReverseCandidate *merged;
+
+  /// Liczba kandydatów.
+  size_t count;
+
+  /// Liczba kandydatów we fragmencie, poza ostatnim.
+  size_t chunkSize;
+
+  /// Długość ciągów scalanych w bieżącej rundzie.
+  size_t width;
+
+  /// Liczba różnych numerów w każdym fragmencie.
+  size_t *chunkNumbers;
+
+  /// Łączna długość różnych numerów w każdym fragmencie, ze znakami @p '\0'.
+  size_t *chunkText;
+
+  /// Tworzony wynik.
+  struct PhoneNumbers *result;
+};
+
+/// @brief Wyznacza granice fragmentu tablicy kandydatów.
+/// @param[in] reverse – stan wyznaczania wyniku.
+/// @param[in] chunk – numer fragmentu.
+/// @param[out] begin – pozycja pierwszego kandydata fragmentu.
+/// @param[out] end – pozycja za ostatnim kandydatem fragmentu.
+static void reverseChunkRange(const struct ReverseParallel *reverse,
+                              size_t chunk, size_t *begin, size_t *end) {
+  (*begin) = chunk * reverse->chunkSize;
+  (*end) = (*begin) + reverse->chunkSize;
+  if ((*begin) > reverse->count)
+    (*begin) = reverse->count;
+  if ((*end) > reverse->count)
+    (*end) = reverse->count;
+}
+
+/// @brief Sortuje jeden fragment tablicy kandydatów.
+/// Zadanie @ref parallelRun.
+/// @param[in,out] context – wskaźnik na strukturę @ref ReverseParallel.
+/// @param[in] chunk – numer fragmentu.
+/// @param[in] worker – numer wątku, nieużywany.
+static void reverseSortChunk(void *context, size_t chunk, int worker) {
+  (void)worker;
+  struct ReverseParallel *reverse = context;
+  size_t begin, end;
+  reverseChunkRange(reverse, chunk, &begin, &end);
+  qsort(reverse->sorted + begin, end - begin, sizeof(struct ReverseCandidate),
+        reverseCandidateCompare);
+}
+
+/// @brief Scala dwa sąsiednie posortowane ciągi kandydatów.
+/// Zadanie @ref parallelRun. Scala ciągi długości @ref ReverseParallel.width
+/// zaczynające się na pozycjach @p 2 * @p pair * width i o width dalej.
+/// @param[in,out] context – wskaźnik na strukturę @ref ReverseParallel.
+/// @param[in] pair – numer pary ciągów.
+/// @param[in] worker – numer wątku, nieużywany.
+static void reverseMergePair(void *context, size_t pair, int worker) {
+  (void)worker;
+  struct ReverseParallel *reverse = context;
+  size_t begin = 2 * pair * reverse->width;
+  size_t middle = begin + reverse->width;
+  size_t end = middle + reverse->width;
+  if (middle > reverse->count)
+    middle = reverse->count;
+  if (end > reverse->count)
+    end = reverse->count;
+
+  const struct ReverseCandidate *sorted = reverse->sorted;
+  struct ReverseCandidate *out = reverse->merged + begin;
+  size_t i = begin, j = middle;
+  while (i < middle && j < end)
+    *(out++) = reverseCandidateCompare(&sorted[j], &sorted[i]) < 0
+                   ? sorted[j++]
+                   : sorted[i++];
+
+  memcpy(out, sorted + i, sizeof(struct ReverseCandidate) * (middle - i));
+  out += middle - i;
+  memcpy(out, sorted + j, sizeof(struct ReverseCandidate) * (end - j));
+}
+
+/// @brief Sprawdza, czy kandydat jest pierwszym ze swoim numerem.
+/// @param[in] reverse – stan wyznaczania wyniku z posortowanymi kandydatami.
+/// @param[in] i – pozycja kandydata.
+/// @return @p true jeśli numer kandydata różni się od numeru poprzedniego, @p
+///         false w przeciwnym wypadku.
+static bool reverseIsFirst(const struct ReverseParallel *reverse, size_t i) {
+  return i == 0 || reverseCandidateCompare(&reverse->sorted[i - 1],
+                                           &reverse->sorted[i]) != 0;
+}
+
+/// @brief Liczy różne numery jednego fragmentu posortowanych kandydatów.
+/// Zadanie @ref parallelRun.
+/// @param[in,out] context – wskaźnik na strukturę @ref ReverseParallel.
+/// @param[in] chunk – numer fragmentu.
+/// @param[in] worker – numer wątku, nieużywany.
+static void reverseMeasureChunk(void *context, size_t chunk, int worker) {
+  (void)worker;
+  struct ReverseParallel *reverse = context;
+  size_t begin, end;
+  reverseChunkRange(reverse, chunk, &begin, &end);
+
+  size_t numbers = 0, text = 0;
+  for (size_t i = begin; i < end; ++i)
+    if (reverseIsFirst(reverse, i)) {
+      numbers++;
+      text += strlen(reverse->sorted[i].source) +
+              strlen(reverse->sorted[i].suffix) + 1;
+    }
+
+  reverse->chunkNumbers[chunk] = numbers;
+  reverse->chunkText[chunk] = text;
+}
+
+/// @brief Przepisuje różne numery jednego fragmentu do wyniku.
+/// Zadanie @ref parallelRun. Pola @ref ReverseParallel.chunkNumbers i @ref
+/// ReverseParallel.chunkText muszą zawierać pozycje, od których fragment
+/// zapisuje numery.
+/// @param[in,out] context – wskaźnik na strukturę @ref ReverseParallel.
+/// @param[in] chunk – numer fragmentu.
+/// @param[in] worker – numer wątku, nieużywany.
+static void reverseWriteChunk(void *context, size_t chunk, int worker) {
+  (void)worker;
+  struct ReverseParallel *reverse = context;
+  size_t begin, end;
+  reverseChunkRange(reverse, chunk, &begin, &end);
+
+  struct PhoneNumbers *result = reverse->result;
+  size_t idx = reverse->chunkNumbers[chunk];
+  char *write = result->text + reverse->chunkText[chunk];
+  for (size_t i = begin; i < end; ++i) {
+    if (!reverseIsFirst(reverse, i))
+      continue;
+
+    result->offsets[idx++] = write - result->text;
+
+    const struct ReverseCandidate *candidate = &reverse->sorted[i];
+    size_t sourceLength = strlen(candidate->source);
+    size_t suffixLength = strlen(candidate->suffix);
+    memcpy(write, candidate->source, sourceLength);
+    memcpy(write + sourceLength, candidate->suffix, suffixLength + 1);
+    write += sourceLength + suffixLength + 1;
+  }
+}
+
+const struct PhoneNumbers *phfwdReverseParallel(const struct PhoneForward *pf,
+                                                const char *num,
+                                                int threads) {
+  assert(pf);
+
+  if (threads <= 1 || pf->image || !isValidPhnum(num))
+    return phfwdReverseConst(pf, num);
+
+  size_t count, textSize;
+  struct ReverseCandidate *candidates =
+      reverseCollect(&pf->prefixes, TRIE_ROOT, num, &count, &textSize);
+  if (!candidates)
+    return NULL;
+
+  if (count < REVERSE_PARALLEL_THRESHOLD)
+    return reverseFromCandidates(candidates, count, textSize);
+
+  size_t chunks = (size_t)threads * REVERSE_CHUNKS_PER_WORKER;
+  struct ReverseParallel reverse = {
+      .sorted = candidates,
+      .merged = malloc(sizeof(struct ReverseCandidate) * count),
+      .count = count,
+      .chunkSize = (count + chunks - 1) / chunks,
+      .chunkNumbers = malloc(sizeof(size_t) * chunks),
+      .chunkText = malloc(sizeof(size_t) * chunks),
+      .result = phnumNew(count, textSize)};
+
+  // Without the memory for merging the candidates are sorted on one thread,
+  // which needs only the result.
+  if (!reverse.merged || !reverse.chunkNumbers || !reverse.chunkText ||
+      !reverse.result) {
+    free(reverse.merged);
+    free(reverse.chunkNumbers);
+    free(reverse.chunkText);
+    free(reverse.result);
+    return reverseFromCandidates(candidates, count, textSize);
+  }
+
+  parallelRun(threads, chunks, reverseSortChunk, &reverse);
+
+  // Each round merges pairs of sorted runs into runs twice as long.
+  for (reverse.width = reverse.chunkSize; reverse.width < count;
+       reverse.width *= 2) {
+    size_t pairs = (count + 2 * reverse.width - 1) / (2 * reverse.width);
+    parallelRun(threads, pairs, reverseMergePair, &reverse);
+
+    struct ReverseCandidate *swapped = reverse.sorted;
+    reverse.sorted = reverse.merged;
+    reverse.merged = swapped;
+  }
+
+  // Positions of the chunks in the result follow from the sizes of the
+  // previous ones.
+  parallelRun(threads, chunks, reverseMeasureChunk, &reverse);
+  size_t numbers = 0, text = 0;
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    size_t chunkNumbers = reverse.chunkNumbers[chunk];
+    size_t chunkText = reverse.chunkText[chunk];
+    reverse.chunkNumbers[chunk] = numbers;
+    reverse.chunkText[chunk] = text;
+    numbers += chunkNumbers;
+    text += chunkText;
+  }
+
+  parallelRun(threads, chunks, reverseWriteChunk, &reverse);
+  reverse.result->size = numbers;
+
+  free(reverse.sorted);
+  free(reverse.merged);
+  free(reverse.chunkNumbers);
+  free(reverse.chunkText);
+  return reverse.result;
+}
+
+/// Liczba zadań zliczania na wielu wątkach przypadających na jeden wątek.
+#define NON_TRIVIAL_TASKS_PER_WORKER (16)
+
+/// Liczba elementów stosu @ref NonTrivialStack, które nie wymagają alokacji.
+#define NON_TRIVIAL_STACK_SIZE (256)
+
+/// Wierzchołek drzewa prefiksów czekający na odwiedzenie przy zliczaniu.
+struct NonTrivialFrame {
+  /// Indeks wierzchołka.
+  TrieIndex node;
+
+  /// Głębokość wierzchołka w drzewie prefiksów.
+  size_t depth;
+};
+
+/// @brief Stos wierzchołków odwiedzanych przy zliczaniu.
+/// Zaczyna od tablicy @ref local, a gdy ta się zapełni, przenosi się na
+/// stertę.
+struct NonTrivialStack {
+  /// Elementy stosu, @ref local lub tablica na stercie.
+  struct NonTrivialFrame *frames;
+
+  /// Liczba elementów stosu.
+  size_t size;
+
+  /// Rozmiar tablicy @ref frames.
+  size_t capacity;
+
+  /// Początkowa tablica elementów.
+  struct NonTrivialFrame local[NON_TRIVIAL_STACK_SIZE];
+};
+
+/// @brief Inicjalizuje pusty stos.
+/// @param[out] stack – inicjalizowany stos.
+static void nonTrivialStackInit(struct NonTrivialStack *stack) {
+  stack->frames = stack->local;
+  stack->size = 0;
+  stack->capacity = NON_TRIVIAL_STACK_SIZE;
+}
+
+/// @brief Zwalnia pamięć stosu.
+/// @param[in,out] stack – zwalniany stos.
+static void nonTrivialStackFree(struct NonTrivialStack *stack) {
+  if (stack->frames != stack->local)
+    free(stack->frames);
+}
+
+/// @brief Wkłada wierzchołek na stos.
+/// @param[in,out] stack – stos.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] depth – głębokość wierzchołka.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///         zaalokować pamięci. Wtedy stos pozostaje niezmieniony.
+static bool nonTrivialStackPush(struct NonTrivialStack *stack, TrieIndex node,
+                                size_t depth) {
+  if (stack->size == stack->capacity) {
+    struct NonTrivialFrame *frames =
+        stack->frames == stack->local
+            ? malloc(sizeof(struct NonTrivialFrame) * stack->capacity * 2)
+            : realloc(stack->frames,
+                      sizeof(struct NonTrivialFrame) * stack->capacity * 2);
+    if (!frames)
+      return false;
+
+    if (stack->frames == stack->local)
+      memcpy(frames, stack->local, sizeof(stack->local));
+
+    stack->frames = frames;
+    stack->capacity *= 2;
+  }
+
+  stack->frames[stack->size++] = (struct NonTrivialFrame){node, depth};
+  return true;
+}
+
+/// @brief Wyznacza dziecko, w którym należy kontynuować zliczanie.
+/// @param[in] prefixes – drzewo prefiksów.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra dziecka.
+/// @param[in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                        które zliczamy.
+/// @param[in,out] depth – głębokość wierzchołka @p node; zastępowana
+///                        głębokością dziecka.
+/// @param[in] len – długość napisów jakie należy zliczyć.
+/// @return Indeks dziecka, lub @ref TRIE_NONE, gdy nie ma go albo pod nim nie
+///         ma numerów z cyframi ze zbioru krótszych niż @p len.
+static TrieIndex phfwdNonTrivialChild(const struct Trie *prefixes,
+                                      TrieIndex node, int digit,
+                                      const int *digit_set, size_t *depth,
+                                      size_t len) {
+  TrieIndex child = trieChild(prefixes, node, digit);
+  if (child == TRIE_NONE || !digit_set[digit])
+    return TRIE_NONE;
+
+  // Whole label of the edge must consist of digits from the set, and there
+  // is no point in going deeper than [len].
+  const struct TrieNode *childNode = &prefixes->nodes[child];
+  if ((*depth) + childNode->labelLength > len)
+    return TRIE_NONE;
+
+  for (int j = 1; j < childNode->labelLength; ++j)
+    if (!digit_set[trieLabelDigit(childNode, j)])
+      return TRIE_NONE;
+
+  (*depth) += childNode->labelLength;
+  return child;
+}
+
+/// @brief Pomocnicza funckja rekurencyjna wywoływana przez
+/// phfwdNonTrivialCount. Sprawdza czy w wierzchołku znajduje się jakaś aktualna
+/// wartość i na tej podstawie oblicza liczbę nietrywialnych numerów telefonów o
+/// prefiksie pod jakim znajduje się wierzchołek currentRoot. Używana tylko,
+/// gdy zabraknie pamięci na stos @ref phfwdNonTrivialCountWalk.
+/// @param [in] prefixes – drzewo prefiksów.
+/// @param [in] currentRoot – indeks aktualnego poddrzewa w drzewie
+///                           prefiksów.
+/// @param [in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                         które zliczamy.
+/// @param [in] set_size – Liczba cyfr w zbiorze @p digit_set.
+/// @param [in] current_deep – Głębokośc w drzewie prefiksów, na jakiej znajduje
+///                            się @p currentRoot.
+/// @param [in] len – długość napisów jakie należy zliczyć.
+/// @return Liczbę nietrywialnych numerów telefonów o prefiksie pod jakim
+///         znajduje się wierzchołek currentRoot modulo dwa do potęgi liczba
+///         bitów typu size_t.
+static size_t phfwdNonTrivialCountAux(const struct Trie *prefixes,
+                                      TrieIndex currentRoot,
+                                      const int *digit_set,
+                                      const size_t set_size,
+                                      const size_t current_deep,
+                                      const size_t len) {
+  assert(len >= current_deep);
+
+  if (prefixes->nodes[currentRoot].data)
+    return power(set_size, len - current_deep);
+
+  size_t result = 0;
+  for (int i = 0; i < ALPHABET_SIZE; ++i) {
+    size_t depth = current_deep;
+    TrieIndex child =
+        phfwdNonTrivialChild(prefixes, currentRoot, i, digit_set, &depth, len);
+    if (child != TRIE_NONE)
+      result += phfwdNonTrivialCountAux(prefixes, child, digit_set, set_size,
+                                        depth, len);
+  }
+
+  return result;
+}
+
+/// @brief Zlicza nietrywialne numery bez rekurencji.
+/// Przechodzi drzewo prefiksów do pierwszych wierzchołków z wartościami, czyli
+/// najkrótszych prefiksów, na które są przekierowania, osiągalnych przez cyfry
+/// ze zbioru. Każdy taki prefiks głębokości @p d daje @p set_size do potęgi
+/// @p len - @p d numerów, więc koszt zależy tylko od liczby odwiedzonych
+/// wierzchołków, a nie od @p len.
+/// @param [in] prefixes – drzewo prefiksów.
+/// @param [in] root – indeks korzenia przechodzonego poddrzewa.
+/// @param [in] depth – głębokość wierzchołka @p root.
+/// @param [in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                         które zliczamy.
+/// @param [in] set_size – Liczba cyfr w zbiorze @p digit_set.
+/// @param [in] len – długość napisów jakie należy zliczyć.
+/// @return Liczba nietrywialnych numerów o prefiksie, pod którym leży @p
+///         root, modulo dwa do potęgi liczba bitów typu size_t.
+static size_t phfwdNonTrivialCountWalk(const struct Trie *prefixes,
+                                       TrieIndex root, size_t depth,
+                                       const int *digit_set, size_t set_size,
+                                       size_t len) {
+  struct NonTrivialStack stack;
+  nonTrivialStackInit(&stack);
+  nonTrivialStackPush(&stack, root, depth);
+
+  size_t result = 0;
+  while (stack.size > 0) {
+    struct NonTrivialFrame frame = stack.frames[--stack.size];
+    if (prefixes->nodes[frame.node].data) {
+      result += power(set_size, len - frame.depth);
+      continue;
+    }
+
+    // Children are pushed in reverse, so that they are visited in order.
+    for (int i = ALPHABET_SIZE - 1; i >= 0; --i) {
+      size_t depth = frame.depth;
+      TrieIndex child =
+          phfwdNonTrivialChild(prefixes, frame.node, i, digit_set, &depth, len);
+      if (child != TRIE_NONE && !nonTrivialStackPush(&stack, child, depth))
+        result += phfwdNonTrivialCountAux(prefixes, child, digit_set,
+                                          set_size, depth, len);
+    }
+  }
+
+  nonTrivialStackFree(&stack);
+  return result;
+}
+
+/// @brief Wyznacza dziecko, w którym należy kontynuować zliczanie w
+/// odwzorowanym pliku zrzutu. Działa jak @ref phfwdNonTrivialChild.
+/// @param[in] prefixes – drzewo prefiksów z pliku.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra dziecka.
+/// @param[in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                        które zliczamy.
+/// @param[in,out] depth – głębokość wierzchołka @p node; zastępowana
+///                        głębokością dziecka.
+/// @param[in] len – długość napisów jakie należy zliczyć.
+/// @return Indeks dziecka, lub @ref TRIE_NONE.
+static TrieIndex phfwdImageNonTrivialChild(const struct TrieImage *prefixes,
+                                           TrieIndex node, int digit,
+                                           const int *digit_set,
+                                           size_t *depth, size_t len) {
+  TrieIndex child = trieImageChild(prefixes, node, digit);
+  if (child == TRIE_NONE || !digit_set[digit])
+    return TRIE_NONE;
+
+  // Empty labels would never end the walk.
+  const struct SnapshotNode *childNode = trieImageNode(prefixes, child);
+  if (childNode->labelLength == 0 ||
+      childNode->labelLength > TRIE_LABEL_CAPACITY ||
+      (*depth) + childNode->labelLength > len)
+    return TRIE_NONE;
+
+  for (int j = 1; j < childNode->labelLength; ++j) {
+    int labelDigit = trieImageLabelDigit(childNode, j);
+    if (labelDigit >= ALPHABET_SIZE || !digit_set[labelDigit])
+      return TRIE_NONE;
+  }
+
+  (*depth) += childNode->labelLength;
+  return child;
+}
+
+/// @brief Pomocnicza funckja rekurencyjna wywoływana przez
+/// phfwdNonTrivialCount dla odwzorowanego pliku zrzutu. Działa jak @ref
+/// phfwdNonTrivialCountAux.
+/// @param [in] prefixes – drzewo prefiksów z pliku.
+/// @param [in] currentRoot – indeks aktualnego poddrzewa w drzewie
+///                           prefiksów.
+/// @param [in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                         które zliczamy.
+/// @param [in] set_size – Liczba cyfr w zbiorze @p digit_set.
+/// @param [in] current_deep – Głębokośc w drzewie prefiksów, na jakiej znajduje
+///                            się @p currentRoot.
+/// @param [in] len – długość napisów jakie należy zliczyć.
+/// @return Liczbę nietrywialnych numerów telefonów o prefiksie pod jakim
+///         znajduje się wierzchołek currentRoot modulo dwa do potęgi liczba
+///         bitów typu size_t.
+static size_t phfwdImageNonTrivialCountAux(const struct TrieImage *prefixes,
+                                           TrieIndex currentRoot,
+                                           const int *digit_set,
+                                           const size_t set_size,
+                                           const size_t current_deep,
+                                           const size_t len) {
+  assert(len >= current_deep);
+
+  if (trieImageValue(prefixes, currentRoot))
+    return power(set_size, len - current_deep);
+
+  size_t result = 0;
+  for (int i = 0; i < ALPHABET_SIZE; ++i) {
+    size_t depth = current_deep;
+    TrieIndex child = phfwdImageNonTrivialChild(prefixes, currentRoot, i,
+                                                digit_set, &depth, len);
+    if (child != TRIE_NONE)
+      result += phfwdImageNonTrivialCountAux(prefixes, child, digit_set,
+                                             set_size, depth, len);
+  }
+
+  return result;
+}
+
+/// @brief Zlicza nietrywialne numery w odwzorowanym pliku zrzutu bez
+/// rekurencji. Działa jak @ref phfwdNonTrivialCountWalk.
+/// @param [in] prefixes – drzewo prefiksów z pliku.
+/// @param [in] digit_set – Zbiór dozwolonych znaków jakie mogą zawierać numery,
+///                         które zliczamy.
+/// @param [in] set_size – Liczba cyfr w zbiorze @p digit_set.
+/// @param [in] len – długość napisów jakie należy zliczyć.
+/// @return Wynik taki jak @ref phfwdNonTrivialCount.
+static size_t phfwdImageNonTrivialCountWalk(const struct TrieImage *prefixes,
+                                            const int *digit_set,
+                                            size_t set_size, size_t len) {
+  struct NonTrivialStack stack;
+  nonTrivialStackInit(&stack);
+  nonTrivialStackPush(&stack, TRIE_ROOT, 0);
+
+  size_t result = 0;
+  while (stack.size > 0) {
+    struct NonTrivialFrame frame = stack.frames[--stack.size];
+    if (trieImageValue(prefixes, frame.node)) {
+      result += power(set_size, len - frame.depth);
+      continue;
+    }
+
+    for (int i = ALPHABET_SIZE - 1; i >= 0; --i) {
+      size_t depth = frame.depth;
+      TrieIndex child = phfwdImageNonTrivialChild(prefixes, frame.node, i,
+                                                  digit_set, &depth, len);
+      if (child != TRIE_NONE && !nonTrivialStackPush(&stack, child, depth))
+        result += phfwdImageNonTrivialCountAux(prefixes, child, digit_set,
+                                               set_size, depth, len);
+    }
+  }
+
+  nonTrivialStackFree(&stack);
+  return result;
+}
+
+/// @brief Wyznacza maskę bitową cyfr zbioru.
+/// @param[in] set – zbiór cyfr, może zawierać dowolne znaki.
+/// @return Maska, której bit @p i jest ustawiony, gdy @p set zawiera cyfrę o
+///         wartości @p i.
+static uint16_t phfwdDigitMask(const char *set) {
+  uint16_t result = 0;
+  for (int i = 0; set[i] != '\0'; ++i)
+    if (inRange(set[i], '0', ';'))
+      result |= 1u << (set[i] - '0');
+
+  return result;
+}
+
+/// @brief Oblicza liczbę nietrywialnych numerów w wersji drzewa prefiksów.
+/// Działa jak @ref phfwdNonTrivialCount dla drzewa o korzeniu @p root.
+/// @param[in] pf – wskaźnik na strukturę przechowującą ciąg numerów;
+/// @param[in] root – indeks korzenia drzewa prefiksów.
+/// @param[in] digitMask – maska bitowa cyfr zbioru (@ref phfwdDigitMask),
+///                        różna od zera.
+/// @param[in] len – długość numerów z szukanego zbioru, większa od zera.
+/// @return Wynik taki jak @ref phfwdNonTrivialCount.
+static size_t phfwdNonTrivialCountFrom(const struct PhoneForward *pf,
+                                       TrieIndex root, uint16_t digitMask,
+                                       size_t len) {
+  int number_mask[12];
+  for (int i = 0; i < 12; ++i)
+    number_mask[i] = (digitMask >> i) & 1;
+
+  size_t set_size = bitCount(digitMask);
+
+  // We iterate over prefixes tree, and search for numbers that match
+  // reqiurements. There is no point in going deeper than [len] nodes.
+  if (pf->image)
+    return phfwdImageNonTrivialCountWalk(&pf->image->tries[1], number_mask,
+                                         set_size, len);
+
+  return phfwdNonTrivialCountWalk(&pf->prefixes, root, 0, number_mask,
+                                  set_size, len);
+}
+
+size_t phfwdNonTrivialCount(struct PhoneForward *pf, const char *set,
+                            size_t len) {
+  if (!pf || !set || !len)
+    return 0;
+
+  uint16_t digitMask = phfwdDigitMask(set);
+  if (!digitMask)
+    return 0;
+
+  // Queries repeat the same few sets, and the trie does not have to be
+  // walked again until it changes.
+  struct NonTrivialCacheEntry *entry =
+      &pf->nonTrivialCache[(digitMask * 31 + len) % NON_TRIVIAL_CACHE_SIZE];
+  if (entry->digitMask != digitMask || entry->len != len ||
+      entry->changes != pf->changes) {
+    (*entry) = (struct NonTrivialCacheEntry){
+        .digitMask = digitMask,
+        .len = len,
+        .changes = pf->changes,
+        .result = phfwdNonTrivialCountFrom(pf, TRIE_ROOT, digitMask, len)};
+  }
+
+  return entry->result;
+}
+
+size_t phfwdNonTrivialCountConst(const struct PhoneForward *pf,
+                                 const char *set, size_t len) {
+  if (!pf || !set || !len)
+    return 0;
+
+  uint16_t digitMask = phfwdDigitMask(set);
+  return digitMask ? phfwdNonTrivialCountFrom(pf, TRIE_ROOT, digitMask, len)
+                   : 0;
+}
+
+/// @brief Stan zliczania nietrywialnych numerów na wielu wątkach.
+/// Każde zadanie zlicza numery w jednym poddrzewie i zapisuje wynik osobno,
+/// a wyniki są sumowane po zakończeniu wszystkich zadań.
+struct NonTrivialParallel {
+  /// Drzewo prefiksów.
+  const struct Trie *prefixes;
+
+  /// Zbiór dozwolonych cyfr.
+  int digit_set[ALPHABET_SIZE];
+
+  /// Liczba cyfr w zbiorze @ref digit_set.
+  size_t set_size;
+
+  /// Długość zliczanych numerów.
+  size_t len;
+
+  /// Korzenie poddrzew zadań.
+  const struct NonTrivialFrame *tasks;
+
+  /// Wyniki zadań.
+  size_t *sums;
+};
+
+/// @brief Zlicza numery w poddrzewie jednego zadania.
+/// Zadanie @ref parallelRun.
+/// @param[in,out] context – wskaźnik na strukturę @ref NonTrivialParallel.
+/// @param[in] task – numer zadania.
+/// @param[in] worker – numer wątku, nieużywany.
+static void nonTrivialCountTask(void *context, size_t task, int worker) {
+  (void)worker;
+  struct NonTrivialParallel *count = context;
+  const struct NonTrivialFrame *root = &count->tasks[task];
+  count->sums[task] =
+      phfwdNonTrivialCountWalk(count->prefixes, root->node, root->depth,
+                               count->digit_set, count->set_size, count->len);
+}
+
+/// @brief Dzieli drzewo prefiksów na poddrzewa do zliczenia.
+/// Rozwija drzewo wszerz, aż poddrzew będzie co najmniej @p target lub drzewo
+/// się skończy. Wierzchołki z wartościami napotkane po drodze są zliczane od
+/// razu.
+/// @param[in,out] count – stan zliczania; ustawiane jest pole @ref
+///                        NonTrivialParallel.tasks.
+/// @param[in,out] frontier – pusty stos, na którym zostają korzenie poddrzew.
+/// @param[in,out] tasks – pożądana liczba poddrzew; zastępowana ich liczbą.
+/// @param[out] sum – liczba numerów w wierzchołkach napotkanych po drodze.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///         zaalokować pamięci.
+static bool nonTrivialSplit(struct NonTrivialParallel *count,
+                            struct NonTrivialStack *frontier, size_t *tasks,
+                            size_t *sum) {
+  (*sum) = 0;
+
+  // The stack is used as a queue; expanded nodes stay below [head].
+  size_t head = 0;
+  bool result = nonTrivialStackPush(frontier, TRIE_ROOT, 0);
+  while (result && head < frontier->size && frontier->size - head < *tasks) {
+    struct NonTrivialFrame frame = frontier->frames[head++];
+    if (count->prefixes->nodes[frame.node].data) {
+      (*sum) += power(count->set_size, count->len - frame.depth);
+      continue;
+    }
+
+    for (int digit = 0; digit < ALPHABET_SIZE && result; ++digit) {
+      size_t depth = frame.depth;
+      TrieIndex child =
+          phfwdNonTrivialChild(count->prefixes, frame.node, digit,
+                               count->digit_set, &depth, count->len);
+      if (child != TRIE_NONE)
+        result = nonTrivialStackPush(frontier, child, depth);
+    }
+  }
+
+  count->tasks = frontier->frames + head;
+  (*tasks) = frontier->size - head;
+  return result;
+}
+
+size_t phfwdNonTrivialCountParallel(const struct PhoneForward *pf,
+                                    const char *set, size_t len,
+                                    int threads) {
+  if (threads <= 1 || !pf || pf->image)
+    return phfwdNonTrivialCountConst(pf, set, len);
+
+  if (!set || !len)
+    return 0;
+
+  uint16_t digitMask = phfwdDigitMask(set);
+  if (!digitMask)
+    return 0;
+
+  struct NonTrivialParallel *count = malloc(sizeof(struct NonTrivialParallel));
+  struct NonTrivialStack *frontier = malloc(sizeof(struct NonTrivialStack));
+  if (!count || !frontier) {
+    free(count);
+    free(frontier);
+    return phfwdNonTrivialCountConst(pf, set, len);
+  }
+
+  count->prefixes = &pf->prefixes;
+  for (int i = 0; i < ALPHABET_SIZE; ++i)
+    count->digit_set[i] = (digitMask >> i) & 1;
+  count->set_size = bitCount(digitMask);
+  count->len = len;
+
+  // Many more subtrees than threads are made, and idle threads take the
+  // next one, so large subtrees do not leave the other threads waiting.
+  size_t sum;
+  nonTrivialStackInit(frontier);
+  size_t tasks = (size_t)threads * NON_TRIVIAL_TASKS_PER_WORKER;
+  bool split = nonTrivialSplit(count, frontier, &tasks, &sum);
+  count->sums = split ? malloc(sizeof(size_t) * (tasks + 1)) : NULL;
+
+  size_t result;
+  if (count->sums) {
+    parallelRun(threads, tasks, nonTrivialCountTask, count);
+
+    // Sums wrap modulo the size of size_t, so the order does not matter.
+    result = sum;
+    for (size_t i = 0; i < tasks; ++i)
+      result += count->sums[i];
+  } else {
+    result = phfwdNonTrivialCountConst(pf, set, len);
+  }
+
+  free(count->sums);
+  nonTrivialStackFree(frontier);
+  free(frontier);
+  free(count);
+  return result;
+}
+
+/// Przyrostek nazwy pliku, do którego @ref phfwdSave zapisuje dane.
+#define SNAPSHOT_TEMPORARY_SUFFIX ".tmp"
+
+/// Wartość drzewa razem z jej numerem.
+struct SnapshotLink {
+  /// Wartość drzewa prefiksów.
+  const struct DataNode *entry;
+
+  /// Numer wartości w kolejności zapisu.
+  uint64_t idx;
+};
+
+/// @brief Porównuje adresy wartości.
+/// @param[in] first – wskaźnik na pierwszą strukturę @ref SnapshotLink.
+/// @param[in] second – wskaźnik na drugą strukturę @ref SnapshotLink.
+/// @return Liczbę ujemną, zero lub dodatnią, gdy adres pierwszej wartości jest
+///         odpowiednio mniejszy, równy lub większy od adresu drugiej.
+static int snapshotLinkCompare(const void *first, const void *second) {
+  uintptr_t a = (uintptr_t)((const struct SnapshotLink *)first)->entry;
+  uintptr_t b = (uintptr_t)((const struct SnapshotLink *)second)->entry;
+  return (a > b) - (a < b);
+}
+
+/// @brief Wyznacza numery wpisów drzewa prefiksów powiązanych z
+/// przekierowaniami.
+/// Wpisy i przekierowania są sortowane według adresów wpisów, więc nie trzeba
+/// szukać każdego wpisu w drzewie.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] count – liczba przekierowań.
+/// @return Tablicę @p count numerów: element @p i jest numerem wpisu
+///         powiązanego z przekierowaniem numer @p i. Musi zostać zwolniona
+///         przez @p free. @p NULL, gdy nie udało się zaalokować pamięci.
+static uint64_t *phfwdSnapshotLinks(const struct PhoneForward *pf,
+                                    uint64_t count) {
+  uint64_t *result = malloc(sizeof(uint64_t) * (count + 1));
+  struct SnapshotLink *entries =
+      malloc(sizeof(struct SnapshotLink) * (count + 1));
+  struct SnapshotLink *redirections =
+      malloc(sizeof(struct SnapshotLink) * (count + 1));
+
+  if (result && entries && redirections) {
+    uint64_t entriesCount = 0;
+    for (TrieIndex i = 0; i < pf->prefixes.nodesSize; ++i)
+      for (const struct DataNode *entry = pf->prefixes.nodes[i].data; entry;
+           entry = entry->next, ++entriesCount)
+        entries[entriesCount] = (struct SnapshotLink){entry, entriesCount};
+
+    uint64_t redirectionsCount = 0;
+    for (TrieIndex i = 0; i < pf->redirections.nodesSize; ++i)
+      for (const struct DataNode *redirection = pf->redirections.nodes[i].data;
+           redirection; redirection = redirection->next, ++redirectionsCount)
+        redirections[redirectionsCount] =
+            (struct SnapshotLink){redirection->link, redirectionsCount};
+
+    assert(entriesCount == count && redirectionsCount == count);
+    qsort(entries, count, sizeof(struct SnapshotLink), snapshotLinkCompare);
+    qsort(redirections, count, sizeof(struct SnapshotLink),
+          snapshotLinkCompare);
+
+    // Every entry is linked with exactly one redirection.
+    for (uint64_t i = 0; i < count; ++i) {
+      assert(entries[i].entry == redirections[i].entry);
+      result[redirections[i].idx] = entries[i].idx;
+    }
+  } else {
+    free(result);
+    result = NULL;
+  }
+
+  free(entries);
+  free(redirections);
+  return result;
+}
+
+/// @brief Zapisuje strukturę do otwartego pliku.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in,out] file – plik otwarty do zapisu.
+/// @return @p true jeśli wszystkie dane zostały zapisane, @p false w
+///         przeciwnym wypadku.
+static bool phfwdSaveToFile(const struct PhoneForward *pf, FILE *file) {
+  // A mapped file already is a snapshot.
+  if (pf->image)
+    return fwrite(pf->image->address, 1, pf->image->size, file) ==
+           pf->image->size;
+
+  const struct Trie *tries[SNAPSHOT_TRIES] = {&pf->redirections,
+                                              &pf->prefixes};
+
+  struct SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.headerSize = sizeof(header);
+
+  uint64_t offset = sizeof(header);
+  for (int i = 0; i < SNAPSHOT_TRIES; ++i)
+    trieSnapshotLayout(tries[i], &header.tries[i], &offset);
+  header.fileSize = offset;
+
+  // Links are stored as numbers of the entries, so that loading does not
+  // have to look them up.
+  assert(header.tries[0].valuesCount == header.tries[1].valuesCount);
+  uint64_t *links = phfwdSnapshotLinks(pf, header.tries[0].valuesCount);
+  struct SnapshotWriter *writer = malloc(sizeof(struct SnapshotWriter));
+
+  // The header is written last, when the checksum of the rest is known.
+  bool result =
+      links && writer && fwrite(&header, sizeof(header), 1, file) == 1;
+  if (result) {
+    snapshotWriterInit(writer, file, sizeof(header));
+    trieSnapshotWrite(tries[0], &header.tries[0], links, writer);
+    trieSnapshotWrite(tries[1], &header.tries[1], NULL, writer);
+
+    result = snapshotWriterFlush(writer);
+    assert(!result || writer->size == header.fileSize);
+    header.bodyChecksum = writer->checksum;
+    header.headerChecksum =
+        snapshotChecksum(SNAPSHOT_CHECKSUM_INIT, &header,
+                         offsetof(struct SnapshotHeader, headerChecksum));
+
+    result = result && fseek(file, 0, SEEK_SET) == 0 &&
+             fwrite(&header, sizeof(header), 1, file) == 1;
+  }
+
+  free(links);
+  free(writer);
+  return result;
+}
+
+/// @brief Sprawdza, czy strukturę można zapisać.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @return @p true jeśli format pliku jest obsługiwany i struktura nie ma
+///         migawek, @p false w przeciwnym wypadku.
+static bool phfwdSavable(const struct PhoneForward *pf) {
+  // Until the last snapshot is collected, the arrays of the tries hold nodes
+  // of older versions, whose values might not exist any more.
+  return snapshotSupported() &&
+         (pf->image ||
+          (pf->snapshots == 0 && pf->allocator.frozenVersion == 0 &&
+           pf->redirections.frozenNodes == 0 &&
+           pf->prefixes.frozenNodes == 0));
+}
+
+bool phfwdSave(const struct PhoneForward *pf, const char *path) {
+  assert(pf);
+
+  if (!path || !phfwdSavable(pf))
+    return false;
+
+  size_t pathLength = strlen(path);
+  char *temporaryPath = malloc(pathLength + sizeof(SNAPSHOT_TEMPORARY_SUFFIX));
+  if (!temporaryPath)
+    return false;
+
+  memcpy(temporaryPath, path, pathLength);
+  memcpy(temporaryPath + pathLength, SNAPSHOT_TEMPORARY_SUFFIX,
+         sizeof(SNAPSHOT_TEMPORARY_SUFFIX));
+
+  FILE *file = fopen(temporaryPath, "wb");
+  bool result = false;
+  if (file) {
+    result = phfwdSaveToFile(pf, file);
+    if (fclose(file) != 0)
+      result = false;
+
+    if (result)
+      result = rename(temporaryPath, path) == 0;
+    if (!result)
+      remove(temporaryPath);
+  }
+
+  free(temporaryPath);
+  return result;
+}
+
+bool phfwdSaveImage(const struct PhoneForward *pf, char **image,
+                    size_t *size) {
+  assert(pf);
+
+  if (!phfwdSavable(pf))
+    return false;
+
+  // The header is written after the rest, so the file has to be seekable.
+  FILE *file = tmpfile();
+  if (!file)
+    return false;
+
+  char *result = NULL;
+  long length;
+  bool saved = phfwdSaveToFile(pf, file) && fseek(file, 0, SEEK_END) == 0 &&
+               (length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0 &&
+               (result = malloc(length)) &&
+               fread(result, 1, length, file) == (size_t)length;
+
+  fclose(file);
+  if (!saved) {
+    free(result);
+    return false;
+  }
+
+  (*image) = result;
+  (*size) = length;
+  return true;
+}
+
+/// @brief Tworzy strukturę z zawartości pliku zrzutu.
+/// @param[in] image – zawartość pliku, wyrównana do @ref SNAPSHOT_ALIGNMENT.
+/// @param[in] size – rozmiar pliku.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy plik jest
+///         niepoprawny lub nie udało się zaalokować pamięci.
+static struct PhoneForward *phfwdFromSnapshot(const char *image,
+                                              uint64_t size) {
+  const struct SnapshotHeader *header = (const struct SnapshotHeader *)image;
+  if (size < sizeof(struct SnapshotHeader) ||
+      !snapshotHeaderValid(header, size) ||
+      header->bodyChecksum !=
+          snapshotChecksum(SNAPSHOT_CHECKSUM_INIT, image + header->headerSize,
+                           size - header->headerSize))
+    return NULL;
+
+  // Every redirection has exactly one entry in the prefixes trie.
+  uint64_t count = header->tries[1].valuesCount;
+  if (header->tries[0].valuesCount != count || count > SIZE_MAX / 8)
+    return NULL;
+
+  struct PhoneForward *result = malloc(sizeof(struct PhoneForward));
+  struct DataNode **entries = malloc(sizeof(struct DataNode *) * (count + 1));
+  if (!result || !entries) {
+    free(result);
+    free(entries);
+    return NULL;
+  }
+
+  // The prefixes trie is loaded first, so that redirections can be linked
+  // with its entries by their numbers. Each entry is linked exactly once, but
+  // whether the texts of linked values match is left to the checksum.
+  trieAllocatorInit(&result->allocator);
+  result->image = NULL;
+  result->snapshots = 0;
+  phfwdCountCacheInit(result);
+  bool loaded = false;
+  if (trieSnapshotLoad(&result->allocator, &result->prefixes,
+                       &header->tries[1], image, entries, NULL, 0, true)) {
+    loaded = trieSnapshotLoad(&result->allocator, &result->redirections,
+                              &header->tries[0], image, NULL, entries, count,
+                              false);
+    if (!loaded)
+      trieFree(&result->prefixes);
+  }
+
+  free(entries);
+  if (!loaded) {
+    trieAllocatorClear(&result->allocator);
+    free(result);
+    return NULL;
+  }
+
+  return result;
+}
+
+struct PhoneForward *phfwdLoad(const char *path) {
+  if (!path || !snapshotSupported())
+    return NULL;
+
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return NULL;
+
+  // The whole file is read at once and the tries are built from its arrays.
+  struct PhoneForward *result = NULL;
+  char *image = NULL;
+  long size;
+  if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 &&
+      fseek(file, 0, SEEK_SET) == 0 && (image = malloc(size)) &&
+      fread(image, 1, size, file) == (size_t)size)
+    result = phfwdFromSnapshot(image, size);
+
+  free(image);
+  fclose(file);
+  return result;
+}
+
+struct PhoneForward *phfwdLoadImage(const char *image, size_t size) {
+  if (!image || !snapshotSupported())
+    return NULL;
+
+  if ((uintptr_t)image % SNAPSHOT_ALIGNMENT == 0)
+    return phfwdFromSnapshot(image, size);
+
+  // Arrays of the tries are read in place, so they have to be aligned.
+  char *copy = malloc(size);
+  if (!copy)
+    return NULL;
+
+  memcpy(copy, image, size);
+  struct PhoneForward *result = phfwdFromSnapshot(copy, size);
+  free(copy);
+  return result;
+}
+
+struct PhoneForward *phfwdMap(const char *path) {
+  if (!path)
+    return NULL;
+
+  struct PhoneForward *result = malloc(sizeof(struct PhoneForward));
+  struct TrieImageFile *image = malloc(sizeof(struct TrieImageFile));
+  if (!result || !image || !trieImageFileOpen(image, path)) {
+    free(result);
+    free(image);
+    return NULL;
+  }
+
+  result->image = image;
+  result->snapshots = 0;
+  phfwdCountCacheInit(result);
+  return result;
+}
+
+/// @brief Odzyskuje pamięć, która należała tylko do migawek.
+/// Wywoływana, gdy struktura nie ma już migawek. Gdy nie udało się
+/// zaalokować pamięci, struktura pozostaje w trybie kopiowania przy zmianach
+/// do następnej próby.
+/// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                     numerów;
+static void phfwdCollect(struct PhoneForward *pf) {
+  assert(pf->snapshots == 0);
+
+  // Replaced values are freed only when no node of either trie refers to
+  // them.
+  if (!trieCollect(&pf->redirections) || !trieCollect(&pf->prefixes))
+    return;
+
+  trieAllocatorCollect(&pf->allocator);
+}
+
+struct PhoneForwardSnapshot *phfwdSnapshot(struct PhoneForward *pf) {
+  assert(pf);
+
+  struct PhoneForwardSnapshot *result =
+      malloc(sizeof(struct PhoneForwardSnapshot));
+  if (!result)
+    return NULL;
+
+  result->owner = pf;
+  result->redirections = result->prefixes = TRIE_ROOT;
+
+  // A mapped file never changes, so it is its own snapshot.
+  if (!pf->image) {
+    if (pf->snapshots == 0)
+      phfwdCollect(pf);
+
+    result->redirections = trieFreeze(&pf->redirections);
+    if (result->redirections != TRIE_NONE)
+      result->prefixes = trieFreeze(&pf->prefixes);
+
+    if (result->redirections == TRIE_NONE || result->prefixes == TRIE_NONE) {
+      if (pf->snapshots == 0)
+        phfwdCollect(pf);
+
+      free(result);
+      return NULL;
+    }
+
+    trieAllocatorFreeze(&pf->allocator);
+  }
+
+  pf->snapshots++;
+  return result;
+}
+
+void phfwdSnapshotDelete(struct PhoneForwardSnapshot *snapshot) {
+  if (!snapshot)
+    return;
+
+  struct PhoneForward *pf = snapshot->owner;
+  assert(pf->snapshots > 0);
+  if (--pf->snapshots == 0 && !pf->image)
+    phfwdCollect(pf);
+
+  free(snapshot);
+}
+
+const struct PhoneNumbers *
+phfwdSnapshotGet(const struct PhoneForwardSnapshot *snapshot,
+                 const char *num) {
+  assert(snapshot);
+
+  const char *forwarded_prefix;
+  size_t suffixOffset;
+  if (!phfwdGetViewFrom(snapshot->owner, snapshot->redirections, num,
+                        &forwarded_prefix, &suffixOffset))
+    return phnumFromView(NULL, NULL, 0);
+
+  return phnumFromView(num, forwarded_prefix, suffixOffset);
+}
+
+const struct PhoneNumbers *
+phfwdSnapshotReverse(const struct PhoneForwardSnapshot *snapshot,
+                     const char *num) {
+  assert(snapshot);
+
+  return phfwdReverseFrom(snapshot->owner, snapshot->prefixes, num);
+}
+
+size_t
+phfwdSnapshotNonTrivialCount(const struct PhoneForwardSnapshot *snapshot,
+                             const char *set, size_t len) {
+  if (!snapshot || !set || !len)
+    return 0;
+
+  uint16_t digitMask = phfwdDigitMask(set);
+  return digitMask ? phfwdNonTrivialCountFrom(snapshot->owner,
+                                              snapshot->prefixes, digitMask,
+                                              len)
+                   : 0;
 }
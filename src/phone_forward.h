@@ -14,17 +14,88 @@
 
 struct PhoneForward;
 
+/// @brief Przekierowany numer, wyznaczony bez alokowania pamięci.
+/// Numer składa się z napisu @ref prefix, po którym następuje napis
+/// przekierowywanego numeru od pozycji @ref suffixOffset.
+struct PhoneNumberView {
+  /// @brief Początek numeru.
+  /// Należy do struktury przechowującej przekierowania i jest ważny do jej
+  /// następnej modyfikacji. Wartość @p NULL oznacza brak wyniku.
+  const char *prefix;
+
+  /// Pozycja w przekierowywanym numerze, od której zaczyna się koniec numeru.
+  size_t suffixOffset;
+};
+
+/// Przekierowanie dodawane przez @ref phfwdBuildFromPairs.
+struct PhoneForwardPair {
+  /// Prefiks numerów przekierowywanych, jak parametr @p num1 @ref phfwdAdd.
+  const char *num1;
+
+  /// Prefiks, na który jest wykonywane przekierowanie, jak parametr @p num2
+  /// @ref phfwdAdd.
+  const char *num2;
+};
+
 struct PhoneNumbers;
 
+struct PhoneForwardSnapshot;
+
+/// Liczniki trafień pamięci wyników włączonej przez @ref phfwdCacheEnable.
+struct PhoneForwardCacheStats {
+  /// Liczba wywołań @ref phfwdGet, których wynik był zapamiętany.
+  size_t getHits;
+
+  /// Liczba wywołań @ref phfwdGet, których wynik trzeba było wyznaczyć.
+  size_t getMisses;
+
+  /// Liczba wywołań @ref phfwdReverse, których wynik był zapamiętany.
+  size_t reverseHits;
+
+  /// Liczba wywołań @ref phfwdReverse, których wynik trzeba było wyznaczyć.
+  size_t reverseMisses;
+};
+
 /// @brief Tworzy nową strukturę.
 /// Tworzy nową strukturę niezawierającą żadnych przekierowań.
 /// @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
 ///         zaalokować pamięci.
 struct PhoneForward *phfwdNew(void);
 
+/// @brief Tworzy strukturę z gotowego zbioru przekierowań.
+/// Tworzy strukturę taką, jak po wywołaniu @ref phfwdAdd kolejno dla
+/// wszystkich par z tablicy @p pairs na nowej strukturze; z przekierowań o
+/// tym samym parametrze @p num1 zostaje ostatnie. Pary są sortowane, a oba
+/// drzewa budowane jednym przebiegiem, co jest wielokrotnie szybsze od
+/// dodawania przekierowań po jednym.
+/// @param[in] pairs – tablica przekierowań.
+/// @param[in] count – liczba elementów tablicy @p pairs.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy któraś para nie
+///         jest poprawnym przekierowaniem (@ref phfwdAdd zwróciłoby dla niej
+///         @p false) lub nie udało się zaalokować pamięci.
+struct PhoneForward *phfwdBuildFromPairs(const struct PhoneForwardPair *pairs,
+                                         size_t count);
+
+/// @brief Tworzy strukturę z gotowego zbioru przekierowań na wielu wątkach.
+/// Działa jak @ref phfwdBuildFromPairs, ale dzieli przekierowania według
+/// pierwszych cyfr prefiksów i buduje poddrzewa dla każdej z nich na osobnych
+/// wątkach, każdy z własną pamięcią wartości. Gotowe poddrzewa są doklejane
+/// pod korzenie obu drzew. Cyfr jest dwanaście, więc zysk z więcej niż kilku
+/// wątków zależy od tego, jak równo przekierowania rozkładają się na cyfry.
+/// Dla małych tablic działa na jednym wątku.
+/// @param[in] pairs – tablica przekierowań.
+/// @param[in] count – liczba elementów tablicy @p pairs.
+/// @param[in] threads – największa liczba wątków.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy któraś para nie
+///         jest poprawnym przekierowaniem lub nie udało się zaalokować
+///         pamięci.
+struct PhoneForward *
+phfwdBuildFromPairsParallel(const struct PhoneForwardPair *pairs,
+                            size_t count, int threads);
+
 /// @brief Usuwa strukturę.
 /// Usuwa strukturę wskazywaną przez @p pf. Nic nie robi, jeśli wskaźnik ten ma
-/// wartość NULL.
+/// wartość NULL. Wszystkie migawki struktury muszą zostać wcześniej usunięte.
 /// @param[in,out] pf – wskaźnik na usuwaną strukturę.
 void phfwdDelete(struct PhoneForward *pf);
 
@@ -53,7 +124,12 @@ bool phfwdAdd(struct PhoneForward *pf, const char *num1, const char *num2);
 /// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
 ///                     numerów;
 /// @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
-void phfwdRemove(struct PhoneForward *pf, const char *num);
+/// @return Wartość @p false, jeśli struktura jest odwzorowana z pliku (@ref
+///         phfwdMap) lub, gdy struktura ma migawki, nie udało się zaalokować
+///         pamięci na kopie. Wtedy struktura pozostaje niezmieniona. W
+///         przeciwnym wypadku wartość @p true, także gdy nie było czego
+///         usuwać.
+bool phfwdRemove(struct PhoneForward *pf, const char *num);
 
 /// @brief Wyznacza przekierowanie numeru.
 /// Wyznacza przekierowanie podanego numeru. Szuka najdłuższego pasującego
@@ -69,6 +145,73 @@ void phfwdRemove(struct PhoneForward *pf, const char *num);
 ///         udało się zaalokować pamięci.
 const struct PhoneNumbers *phfwdGet(struct PhoneForward *pf, const char *num);
 
+/// @brief Wyznacza przekierowanie numeru bez modyfikowania struktury.
+/// Działa jak @ref phfwdGet, ale nie korzysta z pamięci wyników, więc może być
+/// wywoływana jednocześnie na wielu wątkach.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *phfwdGetConst(const struct PhoneForward *pf,
+                                         const char *num);
+
+/// @brief Włącza pamięć ostatnich wyników zapytań.
+/// Od tej chwili @ref phfwdGet i @ref phfwdReverse zapamiętują do @p capacity
+/// ostatnio używanych wyników dla poprawnych numerów i zwracają ich kopie,
+/// dopóki są aktualne. Zmiana przekierowań unieważnia tylko wyniki numerów,
+/// których prefiksy dotyczy. Wcześniejsza pamięć wyników i jej liczniki są
+/// usuwane.
+/// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                     numerów;
+/// @param[in] capacity – największa liczba zapamiętanych wyników; wartość 0
+///                       wyłącza pamięć.
+/// @return Wartość @p true, jeśli operacja powiodła się, @p false, gdy nie
+///         udało się zaalokować pamięci; pamięć jest wtedy wyłączona.
+bool phfwdCacheEnable(struct PhoneForward *pf, size_t capacity);
+
+/// @brief Odczytuje liczniki trafień pamięci wyników.
+/// Gdy pamięć wyników jest wyłączona, wszystkie liczniki są zerami.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[out] stats – liczniki trafień i chybień.
+void phfwdCacheStats(const struct PhoneForward *pf,
+                     struct PhoneForwardCacheStats *stats);
+
+/// @brief Wyznacza przekierowanie numeru bez alokowania pamięci.
+/// Działa jak @ref phfwdGet, ale zamiast tworzyć strukturę @p PhoneNumbers
+/// zwraca wynik jako dwie części: przekierowany numer to napis @p *prefix,
+/// po którym następuje napis @p num od pozycji @p *suffixOffset. Gdy numer nie
+/// został przekierowany, @p *prefix jest pusty, a @p *suffixOffset równy 0.
+/// Napis @p *prefix należy do struktury @p pf i jest ważny do jej następnej
+/// modyfikacji.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[out] prefix – początek przekierowanego numeru.
+/// @param[out] suffixOffset – pozycja w @p num, od której zaczyna się koniec
+///                            przekierowanego numeru.
+/// @return Wartość @p true, jeśli wynik został wyznaczony. Wartość @p false,
+///         jeśli podany napis nie reprezentuje numeru.
+bool phfwdGetView(const struct PhoneForward *pf, const char *num,
+                  const char **prefix, size_t *suffixOffset);
+
+/// @brief Wyznacza przekierowania wielu numerów.
+/// Dla każdego numeru z tablicy @p nums wyznacza wynik taki jak @ref
+/// phfwdGetView. Wyszukiwania są przeplatane: podczas gdy jedno czeka na
+/// pamięć, kolejne posuwają się w dół drzewa, dzięki czemu duże zbiory
+/// przekierowań są przeszukiwane znacznie szybciej niż kolejnymi wywołaniami
+/// @ref phfwdGetView. Nie alokuje pamięci.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] nums – tablica wskaźników na napisy reprezentujące numery.
+/// @param[in] count – liczba numerów w tablicy @p nums.
+/// @param[out] out – tablica @p count wyników. Wynik dla napisu, który nie
+///                   reprezentuje numeru, ma pole @ref PhoneNumberView.prefix
+///                   równe @p NULL.
+void phfwdGetBatch(const struct PhoneForward *pf, const char *const *nums,
+                   size_t count, struct PhoneNumberView *out);
+
 /// @brief Wyznacza przekierowania na dany numer.
 /// Wyznacza wszystkie przekierowania na podany numer. Wynikowy ciąg zawiera też
 /// dany numer. Wynikowe numery są posortowane leksykograficznie i nie mogą się
@@ -83,11 +226,41 @@ const struct PhoneNumbers *phfwdGet(struct PhoneForward *pf, const char *num);
 const struct PhoneNumbers *phfwdReverse(struct PhoneForward *pf,
                                         const char *num);
 
+/// @brief Wyznacza przekierowania na dany numer bez modyfikowania struktury.
+/// Działa jak @ref phfwdReverse, ale nie porządkuje list wartości w miejscu,
+/// tylko sortuje wszystkie wyniki razem. Jest wolniejsza dla numerów z wieloma
+/// przekierowaniami, ale może być wywoływana jednocześnie na wielu wątkach.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *phfwdReverseConst(const struct PhoneForward *pf,
+                                             const char *num);
+
+/// @brief Wyznacza przekierowania na dany numer na wielu wątkach.
+/// Działa jak @ref phfwdReverseConst, ale gdy kandydatów jest wiele, sortuje
+/// ich fragmenty na osobnych wątkach, scala je parami i przepisuje numery do
+/// wyniku również na wielu wątkach. Wynik jest taki sam jak @ref
+/// phfwdReverseConst. Dla odwzorowanych plików zrzutu oraz gdy nie uda się
+/// zaalokować pamięci na scalanie działa na jednym wątku. Może być wywoływana
+/// jednocześnie na wielu wątkach.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @param[in] threads – największa liczba wątków.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *phfwdReverseParallel(const struct PhoneForward *pf,
+                                                const char *num, int threads);
+
 /// @brief Oblicza liczbę nietrywialnych numerów danej długości o cyfrach z
 /// danego zbioru.
 /// Oblicza liczbę nietrywialnych numerów długości len zawierających tylko
 /// cyfry, które znajdują się w napisie @p set. Obliczenia dokonywane są modulo
-/// dwa do potęgi liczba bitów reprezentacji typu @p size_t.
+/// dwa do potęgi liczba bitów reprezentacji typu @p size_t. Ostatnie wyniki
+/// są zapamiętywane w strukturze do następnego wywołania @ref phfwdAdd lub
+/// @ref phfwdRemove.
 /// @param[in,out] pf – wskaźnik na strukturę przechowującą ciąg numerów;
 /// @param[in] set – zbiór cyfr jakie są dopuszczalne w zbiorze wynikowym. Może
 ///                  zawierać dowolne znaki.
@@ -100,6 +273,150 @@ const struct PhoneNumbers *phfwdReverse(struct PhoneForward *pf,
 size_t phfwdNonTrivialCount(struct PhoneForward *pf, const char *set,
                             size_t len);
 
+/// @brief Oblicza liczbę nietrywialnych numerów bez modyfikowania struktury.
+/// Działa jak @ref phfwdNonTrivialCount, ale nie korzysta z zapamiętanych
+/// wyników i nie zapamiętuje nowych, więc może być wywoływana jednocześnie na
+/// wielu wątkach.
+/// @param[in] pf – wskaźnik na strukturę przechowującą ciąg numerów;
+/// @param[in] set – zbiór cyfr jakie są dopuszczalne w zbiorze wynikowym.
+/// @param[in] len – długość numerów z szukanego zbioru.
+/// @return Wynik taki jak @ref phfwdNonTrivialCount.
+size_t phfwdNonTrivialCountConst(const struct PhoneForward *pf,
+                                 const char *set, size_t len);
+
+/// @brief Oblicza liczbę nietrywialnych numerów na wielu wątkach.
+/// Działa jak @ref phfwdNonTrivialCountConst, ale dzieli drzewo prefiksów na
+/// wiele poddrzew, które wątki zliczają, pobierając kolejne, gdy skończą
+/// poprzednie. Wynik jest taki sam jak przy zliczaniu na jednym wątku. Dla
+/// odwzorowanych plików zrzutu działa na jednym wątku.
+/// @param[in] pf – wskaźnik na strukturę przechowującą ciąg numerów;
+/// @param[in] set – zbiór cyfr jakie są dopuszczalne w zbiorze wynikowym.
+/// @param[in] len – długość numerów z szukanego zbioru.
+/// @param[in] threads – największa liczba wątków.
+/// @return Wynik taki jak @ref phfwdNonTrivialCount.
+size_t phfwdNonTrivialCountParallel(const struct PhoneForward *pf,
+                                    const char *set, size_t len, int threads);
+
+/// @brief Zapisuje strukturę do pliku.
+/// Zapisuje oba drzewa struktury @p pf do pliku @p path w wersjonowanym
+/// formacie binarnym z sumami kontrolnymi, opisanym w snapshot.h. Dane trafiają
+/// najpierw do pliku o nazwie z przyrostkiem @p ".tmp", który po udanym
+/// zapisie zastępuje plik @p path, więc błąd zapisu nie uszkadza poprzedniej
+/// zawartości pliku.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[in] path – nazwa pliku.
+/// @return Wartość @p true, jeśli struktura została zapisana. Wartość @p
+///         false, jeśli wystąpił błąd zapisu, nie udało się zaalokować
+///         pamięci, lub struktura ma migawki (@ref phfwdSnapshot).
+bool phfwdSave(const struct PhoneForward *pf, const char *path);
+
+/// @brief Wczytuje strukturę z pliku.
+/// Tworzy nową strukturę z pliku zapisanego przez @ref phfwdSave. Tablice obu
+/// drzew są odtwarzane bezpośrednio z pliku, bez dodawania kolejnych
+/// przekierowań. Plik z niezgodną wersją, błędną sumą kontrolną lub
+/// niespójną zawartością jest odrzucany.
+/// @param[in] path – nazwa pliku.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+///         odczytać pliku, plik jest niepoprawny lub nie udało się zaalokować
+///         pamięci.
+struct PhoneForward *phfwdLoad(const char *path);
+
+/// @brief Zapisuje strukturę do pamięci.
+/// Działa jak @ref phfwdSave, ale zamiast do pliku zapisuje zawartość pliku
+/// zrzutu do zaalokowanej tablicy.
+/// @param[in] pf – wskaźnik na strukturę przechowującą przekierowania
+///                 numerów;
+/// @param[out] image – wskaźnik na tablicę z zawartością pliku zrzutu, którą
+///                     trzeba zwolnić przez @p free.
+/// @param[out] size – rozmiar tablicy @p image.
+/// @return Wartość @p true, jeśli struktura została zapisana. Wartość @p
+///         false, jeśli nie udało się zaalokować pamięci, wystąpił błąd
+///         zapisu pliku pomocniczego lub struktura ma migawki.
+bool phfwdSaveImage(const struct PhoneForward *pf, char **image,
+                    size_t *size);
+
+/// @brief Wczytuje strukturę z pamięci.
+/// Działa jak @ref phfwdLoad dla pliku o zawartości @p image.
+/// @param[in] image – zawartość pliku zapisanego przez @ref phfwdSave lub
+///                    @ref phfwdSaveImage.
+/// @param[in] size – rozmiar tablicy @p image.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy zawartość jest
+///         niepoprawna lub nie udało się zaalokować pamięci.
+struct PhoneForward *phfwdLoadImage(const char *image, size_t size);
+
+/// @brief Odwzorowuje plik zrzutu w pamięci.
+/// Tworzy strukturę tylko do odczytu, której zapytania @ref phfwdGet, @ref
+/// phfwdReverse i @ref phfwdNonTrivialCount są wykonywane bezpośrednio na
+/// stronach pliku zapisanego przez @ref phfwdSave. Działa w czasie
+/// niezależnym od rozmiaru pliku, a procesy odwzorowujące ten sam plik
+/// współdzielą jego strony. Sprawdzany jest tylko nagłówek pliku, ale
+/// zapytania nie wychodzą poza jego sekcje. @ref phfwdAdd i @ref phfwdRemove
+/// zawsze zwracają @p false. Plik nie może być zmieniany, dopóki struktura
+/// istnieje, ale może zostać zastąpiony przez @ref phfwdSave.
+/// @param[in] path – nazwa pliku.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+///         odwzorować pliku, jego nagłówek jest niepoprawny lub nie udało się
+///         zaalokować pamięci.
+struct PhoneForward *phfwdMap(const char *path);
+
+/// @brief Tworzy migawkę struktury.
+/// Migawka zachowuje zawartość struktury z chwili jej utworzenia, niezależnie
+/// od późniejszych wywołań @ref phfwdAdd i @ref phfwdRemove. Działa w czasie
+/// stałym: migawka współdzieli ze strukturą wszystkie wierzchołki drzew i
+/// wartości. Dopóki struktura ma migawki, zmiany kopiują wierzchołki na
+/// ścieżce od korzenia do zmienianego miejsca i zmieniane listy wartości, a
+/// pamięć zastąpionych wierzchołków i wartości jest odzyskiwana dopiero po
+/// usunięciu wszystkich migawek. Gdy wtedy zabraknie pamięci na kopie, @ref
+/// phfwdAdd i @ref phfwdRemove zwracają @p false, nie zmieniając struktury.
+/// Migawki i struktura nie mogą być używane jednocześnie na wielu wątkach.
+/// @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+///                     numerów;
+/// @return Wskaźnik na migawkę, która musi zostać usunięta przez @ref
+///         phfwdSnapshotDelete przed usunięciem struktury, lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+struct PhoneForwardSnapshot *phfwdSnapshot(struct PhoneForward *pf);
+
+/// @brief Usuwa migawkę.
+/// Po usunięciu ostatniej migawki odzyskuje pamięć wierzchołków i wartości
+/// należących tylko do migawek. Nic nie robi, jeśli wskaźnik @p snapshot ma
+/// wartość NULL.
+/// @param[in] snapshot – wskaźnik na usuwaną migawkę.
+void phfwdSnapshotDelete(struct PhoneForwardSnapshot *snapshot);
+
+/// @brief Wyznacza przekierowanie numeru w migawce.
+/// Działa jak @ref phfwdGet dla zawartości struktury z chwili utworzenia
+/// migawki.
+/// @param[in] snapshot – wskaźnik na migawkę.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *
+phfwdSnapshotGet(const struct PhoneForwardSnapshot *snapshot,
+                 const char *num);
+
+/// @brief Wyznacza przekierowania na dany numer w migawce.
+/// Działa jak @ref phfwdReverseConst dla zawartości struktury z chwili
+/// utworzenia migawki.
+/// @param[in] snapshot – wskaźnik na migawkę.
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *
+phfwdSnapshotReverse(const struct PhoneForwardSnapshot *snapshot,
+                     const char *num);
+
+/// @brief Oblicza liczbę nietrywialnych numerów w migawce.
+/// Działa jak @ref phfwdNonTrivialCount dla zawartości struktury z chwili
+/// utworzenia migawki.
+/// @param[in] snapshot – wskaźnik na migawkę.
+/// @param[in] set – zbiór cyfr jakie są dopuszczalne w zbiorze wynikowym.
+/// @param[in] len – długość numerów z szukanego zbioru.
+/// @return Wynik taki jak @ref phfwdNonTrivialCount.
+size_t
+phfwdSnapshotNonTrivialCount(const struct PhoneForwardSnapshot *snapshot,
+                             const char *set, size_t len);
+
 /// @brief Usuwa strukturę.
 /// Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten
 /// ma wartość NULL.
@@ -7,11 +7,14 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "input_parser.h"
+#include "output_writer.h"
 #include "phone_forward.h"
 #include "redirections_db.h"
+#include "write_ahead_log.h"
 
 /// @brief Wywołuje operację @p op.
 /// @param[in] op – Struktura typu @ref Operation; Operacja, która ma zostać
@@ -32,9 +35,7 @@ int preformOperation(const struct Operation *op) {
     if (!current_database)
       return 0;
 
-    // We assume that this function cannot fail...
-    phfwdRemove(current_database->phfwd, op->args[0]);
-    return 1;
+    return phfwdRemove(current_database->phfwd, op->args[0]);
   }
 
   case OT_REDIRECT: {
@@ -57,7 +58,8 @@ int preformOperation(const struct Operation *op) {
 
     size_t result =
         phfwdNonTrivialCount(current_database->phfwd, op->args[0], len);
-    printf("%zu\n", result);
+    outputWriteSize(result);
+    outputWriteCharacter('\n');
     return 1;
   }
 
@@ -66,16 +68,18 @@ int preformOperation(const struct Operation *op) {
     if (!current_database)
       return 0;
 
-    const struct PhoneNumbers *result =
-        phfwdGet(current_database->phfwd, op->args[0]);
+    const char *prefix;
+    size_t suffixOffset;
 
-    if (result) {
-      printf("%s\n", phnumGet(result, 0));
-      assert(!phnumGet(result, 1));
-      phnumDelete(result);
-      return 1;
-    } else
-      return 0;
+    // The parser only accepts numbers, so the view is always there.
+    if (phfwdGetView(current_database->phfwd, op->args[0], &prefix,
+                     &suffixOffset)) {
+      outputWriteString(prefix);
+      outputWriteString(op->args[0] + suffixOffset);
+      outputWriteCharacter('\n');
+    }
+
+    return 1;
   }
 
   case OT_REVERSE: {
@@ -89,14 +93,38 @@ int preformOperation(const struct Operation *op) {
     if (result) {
       const char *num;
       int idx = 0;
-      while ((num = phnumGet(result, idx++)) != NULL)
-        printf("%s\n", num);
+      while ((num = phnumGet(result, idx++)) != NULL) {
+        outputWriteString(num);
+        outputWriteCharacter('\n');
+      }
       phnumDelete(result);
       return 1;
     } else
       return 0;
   }
 
+  case OT_SAVE: {
+    assert(op->args[0]);
+    if (!current_database)
+      return 0;
+
+    return phfwdSave(current_database->phfwd, op->args[0]);
+  }
+
+  case OT_LOAD: {
+    assert(op->args[0]);
+    if (!current_database)
+      return 0;
+
+    struct PhoneForward *loaded = phfwdLoad(op->args[0]);
+    if (!loaded)
+      return 0;
+
+    phfwdDelete(current_database->phfwd);
+    current_database->phfwd = loaded;
+    return 1;
+  }
+
   // NOTE: Should not reach.
   default:
     assert(!"Unexpected operation type.");
@@ -104,31 +132,114 @@ int preformOperation(const struct Operation *op) {
   }
 }
 
-/// Entry point parsera i programu a przekierowaniach numerów telefonów.
-int main() {
+/// @brief Dopisuje do dziennika zawartość bazy.
+/// @param[in] db – zapisywana baza.
+/// @return 1 Gdy operacja powiodła się, 0 w przypadku błędu zapisu.
+static int logDatabase(const struct RedirectionsDatabase *db) {
+  char *image;
+  size_t size;
+  if (!phfwdSaveImage(db->phfwd, &image, &size))
+    return 0;
+
+  int result = walAppendImage(db->name, image, size);
+  free(image);
+  return result;
+}
+
+/// @brief Dopisuje operację do dziennika.
+/// Operacja @p LOAD jest zapisywana jako zawartość wczytanej bazy, a nie
+/// ścieżka, bo plik może zostać później zmieniony lub usunięty.
+/// @param[in] op – wykonana z powodzeniem operacja.
+/// @return 1 Gdy operacja powiodła się, 0 w przypadku błędu zapisu.
+static int logOperation(const struct Operation *op) {
+  if (op->performed_operation == OT_LOAD && walIsOpen())
+    return logDatabase(current_database);
+
+  return walAppend(op);
+}
+
+/// @brief Odtwarza zawartość bazy zapisaną w dzienniku.
+/// @param[in] name – nazwa bazy.
+/// @param[in] image – zawartość pliku zrzutu bazy.
+/// @param[in] size – rozmiar @p image.
+/// @return 1 Gdy operacja powiodła się, 0 w przypadku błędu wykonania.
+static int restoreDatabase(const char *name, const char *image, size_t size) {
+  struct PhoneForward *phfwd = phfwdLoadImage(image, size);
+  if (!phfwd)
+    return 0;
+
+  if (!replaceDatabaseWithName(name, phfwd)) {
+    phfwdDelete(phfwd);
+    return 0;
+  }
+
+  return 1;
+}
+
+/// @brief Dopisuje do punktu kontrolnego dziennika stan wszystkich baz.
+/// Zapisuje zawartości baz, a następnie wybiera aktualną bazę.
+/// @return 1 Gdy operacja powiodła się, 0 w przypadku błędu zapisu.
+static int writeCheckpoint(void) {
+  if (!visitAllDatabases(logDatabase))
+    return 0;
+
+  if (!current_database)
+    return 1;
+
+  struct Operation op = {.args = {current_database->name, NULL},
+                         .performed_operation = OT_ADD,
+                         .operator_idx = 0};
+  return walAppend(&op);
+}
+
+/// @brief Kończy obsługę wczytanych dotąd operacji.
+/// Wywoływana przez parser przed czekaniem na wejście: zapisuje na dysk
+/// dopisane do dziennika zmiany jako jedną grupę i wypisuje wyniki.
+static void beforeInputRead(void) {
+  walSync();
+  outputFlush();
+}
+
+/// @brief Entry point parsera i programu a przekierowaniach numerów telefonów.
+/// Jedynym, opcjonalnym argumentem programu jest ścieżka do dziennika zmian
+/// (@ref walOpen). Zapisane w nim operacje są wykonywane przed wczytaniem
+/// wejścia, a nowe zmiany są do niego dopisywane.
+/// @param[in] argc – liczba argumentów programu.
+/// @param[in] argv – argumenty programu.
+/// @return 0, gdy program zakończył się powodzeniem, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
   struct Operation nextOperation;
-  int feedback;
-
-  while ((feedback = inputParseNextOperation(&nextOperation)) == IF_OK) {
-    if (!preformOperation(&nextOperation)) {
-      for (int i = 0; i < 2; ++i)
-        if (nextOperation.args[i]) {
-          free(nextOperation.args[i]);
-          nextOperation.args[i] = NULL;
-        }
+  int feedback = IF_OK;
+
+  inputSetBeforeRead(beforeInputRead);
+  if (argc > 1 && !walOpen(argv[1], preformOperation, restoreDatabase)) {
+    fprintf(stderr, "ERROR LOG\n");
+    feedback = IF_ERROR;
+  }
+
+  // Only operations that succeeded are logged, so replaying them cannot fail.
+  while (feedback == IF_OK &&
+         (feedback = inputParseNextOperation(&nextOperation)) == IF_OK) {
+    if (!preformOperation(&nextOperation) || !logOperation(&nextOperation)) {
       printOperationError(&nextOperation);
       feedback = IF_ERROR;
       break;
     }
 
-    for (int i = 0; i < 2; ++i)
-      if (nextOperation.args[i]) {
-        free(nextOperation.args[i]);
-        nextOperation.args[i] = NULL;
-      }
+    // A failed checkpoint either leaves the current log, which is still
+    // complete, or fails the log, which the next change or walClose reports.
+    if (walCheckpointDue())
+      walCheckpoint(writeCheckpoint);
+  }
+
+  outputFlush();
+  if (!walClose() && feedback != IF_ERROR) {
+    fprintf(stderr, "ERROR LOG\n");
+    feedback = IF_ERROR;
   }
 
   clearAllRedirectionsDatabase();
+  inputParserFree();
 
   if (feedback == IF_ERROR)
     return 1;
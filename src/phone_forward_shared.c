@@ -0,0 +1,239 @@
+/// @file
+/// Implementacja struktury przekierowań współdzielonej przez wiele wątków.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "phone_forward_shared.h"
+#include "util.h"
+
+/// @brief Struktura przekierowań współdzielona przez wiele wątków.
+/// Czytelnicy zgłaszają się w jednym z dwóch liczników wejść i wyjść, a
+/// piszący, zanim zmieni kopię, na której mogą być czytelnicy, przełącza ich
+/// na drugi licznik i czeka, aż oba liczniki się opróżnią. To opóźnione
+/// zwalnianie zastępuje epoki: stare wierzchołki i wartości nie są widoczne
+/// dla nikogo, gdy kopia jest zmieniana.
+struct PhoneForwardShared {
+  /// Dwie kopie przekierowań.
+  struct PhoneForward *copies[2];
+
+  /// Numer kopii, której używają nowi czytelnicy.
+  atomic_int readable;
+
+  /// Numer licznika, w którym zgłaszają się nowi czytelnicy.
+  atomic_int version;
+
+  /// Liczba czytelników, którzy zgłosili się w danym liczniku.
+  atomic_size_t arrived[2];
+
+  /// Liczba czytelników zgłoszonych w danym liczniku, którzy już skończyli.
+  atomic_size_t departed[2];
+
+  /// Blokada, pod którą wykonywane są zmiany.
+  pthread_mutex_t writer;
+
+  /// @brief Przekierowanie dodane tylko do kopii czytanej, lub @p NULL.
+  /// Gdy nie udało się go dodać do drugiej kopii, zmiana jest ponawiana
+  /// przed następną.
+  char *pendingNum1;
+
+  /// Prefiks, na który wykonywane jest przekierowanie @ref pendingNum1.
+  char *pendingNum2;
+};
+
+struct PhoneForwardShared *phfwdSharedNew(void) {
+  struct PhoneForwardShared *result = malloc(sizeof(struct PhoneForwardShared));
+  if (!result)
+    return NULL;
+
+  result->copies[0] = phfwdNew();
+  result->copies[1] = phfwdNew();
+  if (!result->copies[0] || !result->copies[1] ||
+      pthread_mutex_init(&result->writer, NULL) != 0) {
+    phfwdDelete(result->copies[0]);
+    phfwdDelete(result->copies[1]);
+    free(result);
+    return NULL;
+  }
+
+  atomic_init(&result->readable, 0);
+  atomic_init(&result->version, 0);
+  for (int i = 0; i < 2; ++i) {
+    atomic_init(&result->arrived[i], 0);
+    atomic_init(&result->departed[i], 0);
+  }
+
+  result->pendingNum1 = result->pendingNum2 = NULL;
+  return result;
+}
+
+void phfwdSharedDelete(struct PhoneForwardShared *shared) {
+  if (shared) {
+    phfwdDelete(shared->copies[0]);
+    phfwdDelete(shared->copies[1]);
+    pthread_mutex_destroy(&shared->writer);
+    free(shared->pendingNum1);
+    free(shared->pendingNum2);
+    free(shared);
+  }
+}
+
+/// @brief Zgłasza czytelnika.
+/// @param[in,out] shared – wskaźnik na strukturę.
+/// @param[out] version – numer licznika, w którym zgłosił się czytelnik.
+/// @return Kopia, której czytelnik może używać do wywołania @ref
+///         sharedDepart.
+static const struct PhoneForward *
+sharedArrive(struct PhoneForwardShared *shared, int *version) {
+  (*version) = atomic_load(&shared->version);
+  atomic_fetch_add(&shared->arrived[*version], 1);
+  return shared->copies[atomic_load(&shared->readable)];
+}
+
+/// @brief Wypisuje czytelnika.
+/// @param[in,out] shared – wskaźnik na strukturę.
+/// @param[in] version – numer licznika zwrócony przez @ref sharedArrive.
+static void sharedDepart(struct PhoneForwardShared *shared, int version) {
+  atomic_fetch_add(&shared->departed[version], 1);
+}
+
+/// @brief Czeka, aż wszyscy czytelnicy zgłoszeni w liczniku skończą.
+/// @param[in] shared – wskaźnik na strukturę.
+/// @param[in] version – numer licznika.
+static void sharedWaitEmpty(struct PhoneForwardShared *shared, int version) {
+  // Reading departures first never shows a reader that is still there as
+  // gone, since it has arrived before it departs.
+  for (;;) {
+    size_t departed = atomic_load(&shared->departed[version]);
+    if (departed == atomic_load(&shared->arrived[version]))
+      return;
+
+    sched_yield();
+  }
+}
+
+/// @brief Czeka, aż żaden czytelnik nie będzie używał kopii, która przestała
+/// być czytana.
+/// @param[in,out] shared – wskaźnik na strukturę.
+static void sharedWaitReaders(struct PhoneForwardShared *shared) {
+  int previous = atomic_load(&shared->version);
+  int next = 1 - previous;
+
+  // Readers of the other counter could still see the older copy, before the
+  // previous change.
+  sharedWaitEmpty(shared, next);
+  atomic_store(&shared->version, next);
+  sharedWaitEmpty(shared, previous);
+}
+
+/// @brief Zmiana struktury wykonywana na obu kopiach.
+/// @param[in,out] pf – zmieniana kopia.
+/// @param[in] num1 – pierwszy argument zmiany.
+/// @param[in] num2 – drugi argument zmiany, lub @p NULL dla usunięcia.
+/// @return @p true jeśli zmiana powiodła się, @p false w przeciwnym wypadku;
+///         wtedy kopia jest niezmieniona.
+static bool sharedApply(struct PhoneForward *pf, const char *num1,
+                        const char *num2) {
+  if (!num2)
+    return phfwdRemove(pf, num1);
+
+  return phfwdAdd(pf, num1, num2);
+}
+
+/// @brief Wykonuje zmianę na obu kopiach.
+/// @param[in,out] shared – wskaźnik na strukturę.
+/// @param[in] num1 – pierwszy argument zmiany.
+/// @param[in] num2 – drugi argument zmiany, lub @p NULL dla usunięcia.
+/// @return @p true jeśli zmiana jest widoczna dla czytelników, @p false w
+///         przeciwnym wypadku.
+static bool sharedUpdate(struct PhoneForwardShared *shared, const char *num1,
+                         const char *num2) {
+  pthread_mutex_lock(&shared->writer);
+
+  int readable = atomic_load(&shared->readable);
+  struct PhoneForward *hidden = shared->copies[1 - readable];
+
+  // The hidden copy has to catch up first.
+  if (shared->pendingNum1) {
+    if (!phfwdAdd(hidden, shared->pendingNum1, shared->pendingNum2)) {
+      pthread_mutex_unlock(&shared->writer);
+      return false;
+    }
+
+    free(shared->pendingNum1);
+    free(shared->pendingNum2);
+    shared->pendingNum1 = shared->pendingNum2 = NULL;
+  }
+
+  // Copies never have snapshots, so removing cannot fail, and only an added
+  // redirection may become pending.
+  // It is copied upfront, so that keeping it cannot fail later on.
+  char *pendingNum1 = num2 ? duplicateStr(num1) : NULL;
+  char *pendingNum2 = num2 ? duplicateStr(num2) : NULL;
+  if ((num2 && (!pendingNum1 || !pendingNum2)) ||
+      !sharedApply(hidden, num1, num2)) {
+    free(pendingNum1);
+    free(pendingNum2);
+    pthread_mutex_unlock(&shared->writer);
+    return false;
+  }
+
+  atomic_store(&shared->readable, 1 - readable);
+  sharedWaitReaders(shared);
+
+  // Readers see the change already, so if the other copy cannot have it
+  // yet, it stays hidden until the next change.
+  if (sharedApply(shared->copies[readable], num1, num2)) {
+    free(pendingNum1);
+    free(pendingNum2);
+  } else {
+    shared->pendingNum1 = pendingNum1;
+    shared->pendingNum2 = pendingNum2;
+  }
+
+  pthread_mutex_unlock(&shared->writer);
+  return true;
+}
+
+bool phfwdSharedAdd(struct PhoneForwardShared *shared, const char *num1,
+                    const char *num2) {
+  return num1 && num2 && sharedUpdate(shared, num1, num2);
+}
+
+bool phfwdSharedRemove(struct PhoneForwardShared *shared, const char *num) {
+  return sharedUpdate(shared, num, NULL);
+}
+
+const struct PhoneNumbers *phfwdSharedGet(struct PhoneForwardShared *shared,
+                                          const char *num) {
+  int version;
+  const struct PhoneForward *pf = sharedArrive(shared, &version);
+  const struct PhoneNumbers *result = phfwdGetConst(pf, num);
+  sharedDepart(shared, version);
+  return result;
+}
+
+const struct PhoneNumbers *
+phfwdSharedReverse(struct PhoneForwardShared *shared, const char *num) {
+  int version;
+  const struct PhoneForward *pf = sharedArrive(shared, &version);
+  const struct PhoneNumbers *result = phfwdReverseConst(pf, num);
+  sharedDepart(shared, version);
+  return result;
+}
+
+size_t phfwdSharedNonTrivialCount(struct PhoneForwardShared *shared,
+                                  const char *set, size_t len) {
+  int version;
+  const struct PhoneForward *pf = sharedArrive(shared, &version);
+  size_t result = phfwdNonTrivialCountConst(pf, set, len);
+  sharedDepart(shared, version);
+  return result;
+}
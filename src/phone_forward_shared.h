@@ -0,0 +1,91 @@
+/// @file
+/// Interfejs struktury przekierowań współdzielonej przez wiele wątków.
+///
+/// Struktura przechowuje dwie kopie przekierowań. Czytelnicy zawsze używają
+/// jednej z nich i nigdy nie czekają: każdy odczyt to stała liczba operacji
+/// atomowych i zwykłe zapytanie na kopii, której nikt w tym czasie nie
+/// zmienia. Zmiana trafia najpierw do kopii nieużywanej przez czytelników,
+/// która następnie zostaje udostępniona, a po wyjściu wszystkich czytelników
+/// z drugiej kopii zmiana trafia także do niej. Zmiany są wykonywane po
+/// jednej, więc piszący mogą na siebie czekać.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __PHONE_FORWARD_SHARED_H__
+#define __PHONE_FORWARD_SHARED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+struct PhoneForwardShared;
+
+/// @brief Tworzy nową współdzieloną strukturę.
+/// Tworzy strukturę niezawierającą żadnych przekierowań.
+/// @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+///         zaalokować pamięci.
+struct PhoneForwardShared *phfwdSharedNew(void);
+
+/// @brief Usuwa współdzieloną strukturę.
+/// Nie może być wywołana jednocześnie z żadną inną operacją na strukturze.
+/// Nic nie robi, jeśli wskaźnik ten ma wartość NULL.
+/// @param[in] shared – wskaźnik na usuwaną strukturę.
+void phfwdSharedDelete(struct PhoneForwardShared *shared);
+
+/// @brief Dodaje przekierowanie.
+/// Działa jak @ref phfwdAdd. Czytelnicy widzą przekierowanie, zanim funkcja
+/// się zakończy.
+/// @param[in,out] shared – wskaźnik na strukturę;
+/// @param[in] num1 – wskaźnik na napis reprezentujący prefiks numerów
+///                   przekierowywanych;
+/// @param[in] num2 – wskaźnik na napis reprezentujący prefiks numerów, na które
+///                   jest wykonywane przekierowanie.
+/// @return Wartość @p true, jeśli przekierowanie zostało dodane.
+///         Wartość @p false, jeśli wystąpił błąd, np. podany napis nie
+///         reprezentuje numeru, oba podane numery są identyczne lub nie udało
+///         się zaalokować pamięci. Wtedy czytelnicy nie widzą żadnej zmiany.
+bool phfwdSharedAdd(struct PhoneForwardShared *shared, const char *num1,
+                    const char *num2);
+
+/// @brief Usuwa przekierowania.
+/// Działa jak @ref phfwdRemove.
+/// @param[in,out] shared – wskaźnik na strukturę;
+/// @param[in] num – wskaźnik na napis reprezentujący prefiks numerów.
+/// @return Wartość @p true, jeśli zmiana została wykonana, @p false, gdy nie
+///         udało się zaalokować pamięci. Wtedy czytelnicy nie widzą żadnej
+///         zmiany.
+bool phfwdSharedRemove(struct PhoneForwardShared *shared, const char *num);
+
+/// @brief Wyznacza przekierowanie numeru.
+/// Działa jak @ref phfwdGet. Może być wywoływana na wielu wątkach
+/// jednocześnie ze sobą i ze zmianami struktury.
+/// @param[in] shared – wskaźnik na strukturę;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *phfwdSharedGet(struct PhoneForwardShared *shared,
+                                          const char *num);
+
+/// @brief Wyznacza przekierowania na dany numer.
+/// Działa jak @ref phfwdReverse. Może być wywoływana na wielu wątkach
+/// jednocześnie ze sobą i ze zmianami struktury.
+/// @param[in] shared – wskaźnik na strukturę;
+/// @param[in] num – wskaźnik na napis reprezentujący numer.
+/// @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+///         udało się zaalokować pamięci.
+const struct PhoneNumbers *
+phfwdSharedReverse(struct PhoneForwardShared *shared, const char *num);
+
+/// @brief Oblicza liczbę nietrywialnych numerów.
+/// Działa jak @ref phfwdNonTrivialCount. Może być wywoływana na wielu wątkach
+/// jednocześnie ze sobą i ze zmianami struktury.
+/// @param[in] shared – wskaźnik na strukturę;
+/// @param[in] set – zbiór cyfr jakie są dopuszczalne w zbiorze wynikowym.
+/// @param[in] len – długość numerów z szukanego zbioru.
+/// @return Liczbę nietrywialnych numerów, jak @ref phfwdNonTrivialCount.
+size_t phfwdSharedNonTrivialCount(struct PhoneForwardShared *shared,
+                                  const char *set, size_t len);
+
+#endif /* __PHONE_FORWARD_SHARED_H__ */
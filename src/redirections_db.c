@@ -5,27 +5,55 @@
 /// @copyright Uniwersytet Warszawski
 /// @date 27.05.2018
 
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "phone_forward.h"
 #include "redirections_db.h"
+#include "util.h"
 
-/// Pojedyńczy węzeł kolekcji baz przekierowań, który implementujemy jak listę.
+/// Początkowa liczba kubełków tablicy haszującej baz przekierowań.
+#define REDIRECTIONS_DB_INITIAL_CAPACITY (16)
+
+/// Pojedyńczy węzeł kolekcji baz przekierowań, leżący w liście jednego kubełka.
 struct RedirationsDBNode {
   /// Aktualna wartość w wierzchołku.
   struct RedirectionsDatabase *phone_forward_data;
 
-  /// Wskaźnik na następny element.
+  /// Wartość funkcji haszującej nazwy bazy.
+  size_t hash;
+
+  /// Wskaźnik na następny element kubełka.
   struct RedirationsDBNode *next;
 };
 
-/// @brief Początek struktury bazy przekierowań.
-/// Wskaźnik na początek listy wszystkich przechowywanych baz przekierowań
-/// telefonów.
-struct RedirationsDBNode *redirections_database_head = NULL;
+/// @brief Tablica haszująca wszystkich baz przekierowań.
+/// Kubełki są listami węzłów, a ich liczba jest potęgą dwójki.
+static struct RedirationsDBNode **redirections_database_buckets = NULL;
+
+/// Liczba kubełków w @ref redirections_database_buckets.
+static size_t redirections_database_capacity = 0;
+
+/// Liczba baz przekierowań.
+static size_t redirections_database_size = 0;
 
 struct RedirectionsDatabase *current_database = NULL;
 
+/// @brief Haszuje nazwę bazy.
+/// Używa funkcji FNV-1a.
+/// @param[in] name – haszowana nazwa.
+/// @return Wartość funkcji haszującej dla @p name.
+static size_t redirectionsDBHash(const char *name) {
+  uint64_t result = 14695981039346656037ull;
+  for (; *name != '\0'; ++name) {
+    result ^= (unsigned char)(*name);
+    result *= 1099511628211ull;
+  }
+
+  return (size_t)result;
+}
+
 /// @brief Tworzy nową strukturę.
 /// Tworzy nowy obiekt typu redirectionsDBNew posiadający nazwę @p name.
 /// @param[in] name – Nazwa jaka zostanie nadana stworzonej strukturze.
@@ -37,19 +65,14 @@ static struct RedirectionsDatabase *redirectionsDBNew(const char *name) {
 
   if (result) {
     result->phfwd = phfwdNew();
-    result->name = malloc(sizeof(char) * (strlen(name) + 2));
-    if (!name) {
+    result->name = duplicateStr(name);
+    if (!result->phfwd || !result->name) {
       phfwdDelete(result->phfwd);
+      free(result->name);
       free(result);
 
       return NULL;
     }
-
-    strcpy(result->name, name);
-    if (!result->phfwd) {
-      free(result);
-      return NULL;
-    }
   }
 
   return result;
@@ -67,86 +90,159 @@ static inline void redirectionsDBDelete(struct RedirectionsDatabase *red_db) {
   }
 }
 
-/// @brief Szuka stkrukutry bazy przekierowań. w bazie danych struktur
-/// przekierowań. Szuka stkrukutry bazy przekierowań w bazie danych struktur
-/// przekierowań.
+/// @brief Szuka węzła bazy przekierowań.
+/// Szuka w tablicy haszującej węzła bazy przekierowań o nazwie @p name.
 /// @param[in] name – Nazwa stkrukutry jaką należy wyszukać.
-/// @return Wskaźnik na znalezioną strukturę, lub @p NULL, gdy taka nie
-///         istnieje.
-static inline struct RedirectionsDatabase *
-redirectionsDBFind(const char *name) {
-  struct RedirationsDBNode *current = redirections_database_head;
+/// @param[in] hash – Wartość funkcji haszującej dla @p name.
+/// @return Wskaźnik na wskaźnik na znaleziony węzeł, przez który można go
+///         odpiąć z kubełka, lub @p NULL, gdy taki nie istnieje.
+static struct RedirationsDBNode **redirectionsDBFind(const char *name,
+                                                     size_t hash) {
+  if (redirections_database_capacity == 0)
+    return NULL;
+
+  struct RedirationsDBNode **current =
+      &redirections_database_buckets[hash &
+                                     (redirections_database_capacity - 1)];
+
+  while (*current) {
+    if ((*current)->hash == hash &&
+        strcmp((*current)->phone_forward_data->name, name) == 0)
+      return current;
+
+    current = &(*current)->next;
+  }
 
-  while (current) {
-    if (strcmp(current->phone_forward_data->name, name) == 0)
-      return current->phone_forward_data;
+  return NULL;
+}
 
-    current = current->next;
+/// @brief Powiększa tablicę haszującą.
+/// Podwaja liczbę kubełków i rozdziela między nie wszystkie węzły.
+/// @return 1, gdy operacja się powiodła, 0 gdy nie udało się zaalokować
+///         pamięci.
+static int redirectionsDBGrow() {
+  size_t newCapacity = redirections_database_capacity
+                           ? 2 * redirections_database_capacity
+                           : REDIRECTIONS_DB_INITIAL_CAPACITY;
+  struct RedirationsDBNode **newBuckets =
+      calloc(newCapacity, sizeof(struct RedirationsDBNode *));
+  if (!newBuckets)
+    return 0;
+
+  for (size_t i = 0; i < redirections_database_capacity; ++i) {
+    struct RedirationsDBNode *current = redirections_database_buckets[i];
+    while (current) {
+      struct RedirationsDBNode *next = current->next;
+      struct RedirationsDBNode **bucket =
+          &newBuckets[current->hash & (newCapacity - 1)];
+      current->next = (*bucket);
+      (*bucket) = current;
+      current = next;
+    }
   }
 
-  return NULL;
+  free(redirections_database_buckets);
+  redirections_database_buckets = newBuckets;
+  redirections_database_capacity = newCapacity;
+  return 1;
 }
 
 int setOrCreateDatabaseWithName(const char *name) {
-  struct RedirectionsDatabase *db = redirectionsDBFind(name);
-  if (!db) {
-    db = redirectionsDBNew(name);
-    if (!db)
-      return 0;
-
-    struct RedirationsDBNode *prev_head = redirections_database_head;
+  // Scripts usually switch back to the database they are using, which does
+  // not need hashing. Other recent databases are found through the table,
+  // since comparing their names one by one is slower than hashing.
+  if (current_database && strcmp(current_database->name, name) == 0)
+    return 1;
+
+  size_t hash = redirectionsDBHash(name);
+  struct RedirationsDBNode **found = redirectionsDBFind(name, hash);
+  if (found) {
+    current_database = (*found)->phone_forward_data;
+    return 1;
+  }
 
-    redirections_database_head = malloc(sizeof(struct RedirationsDBNode));
+  // A table that can not grow still works, only slower.
+  if (redirections_database_size >= redirections_database_capacity &&
+      !redirectionsDBGrow() && redirections_database_capacity == 0)
+    return 0;
 
-    if (!redirections_database_head) // Memory error - could not allocate
-                                     // memory.
-      return 0;
+  struct RedirationsDBNode *node = malloc(sizeof(struct RedirationsDBNode));
+  if (!node) // Memory error - could not allocate memory.
+    return 0;
 
-    (*redirections_database_head) = (struct RedirationsDBNode){db, prev_head};
-    current_database = db;
+  struct RedirectionsDatabase *db = redirectionsDBNew(name);
+  if (!db) {
+    free(node);
+    return 0;
   }
 
+  struct RedirationsDBNode **bucket =
+      &redirections_database_buckets[hash &
+                                     (redirections_database_capacity - 1)];
+  (*node) = (struct RedirationsDBNode){db, hash, (*bucket)};
+  (*bucket) = node;
+  redirections_database_size++;
+
   current_database = db;
   return 1;
 }
 
 int deleteDatabaseWithName(const char *name) {
-  struct RedirationsDBNode *current = redirections_database_head;
-  struct RedirationsDBNode *prev = NULL;
+  struct RedirationsDBNode **found =
+      redirectionsDBFind(name, redirectionsDBHash(name));
+  if (!found)
+    return 0;
 
-  while (current) {
-    if (strcmp(current->phone_forward_data->name, name) == 0) {
-      if (prev)
-        prev->next = current->next;
-      else
-        redirections_database_head = current->next;
+  struct RedirationsDBNode *node = (*found);
+  (*found) = node->next;
+  redirections_database_size--;
 
-      if (current->phone_forward_data == current_database)
-        current_database = NULL;
+  if (node->phone_forward_data == current_database)
+    current_database = NULL;
 
-      redirectionsDBDelete(current->phone_forward_data);
-      free(current);
+  redirectionsDBDelete(node->phone_forward_data);
+  free(node);
 
-      return 1;
-    }
+  return 1;
+}
 
-    prev = current;
-    current = current->next;
-  }
+int replaceDatabaseWithName(const char *name, struct PhoneForward *phfwd) {
+  struct RedirectionsDatabase *previous = current_database;
+  if (!setOrCreateDatabaseWithName(name))
+    return 0;
 
-  return 0;
+  phfwdDelete(current_database->phfwd);
+  current_database->phfwd = phfwd;
+  current_database = previous;
+  return 1;
+}
+
+int visitAllDatabases(int (*visit)(const struct RedirectionsDatabase *db)) {
+  for (size_t i = 0; i < redirections_database_capacity; ++i)
+    for (struct RedirationsDBNode *current = redirections_database_buckets[i];
+         current; current = current->next)
+      if (!visit(current->phone_forward_data))
+        return 0;
+
+  return 1;
 }
 
 void clearAllRedirectionsDatabase() {
-  struct RedirationsDBNode *current = redirections_database_head;
-  while (current) {
-    redirectionsDBDelete(current->phone_forward_data);
+  for (size_t i = 0; i < redirections_database_capacity; ++i) {
+    struct RedirationsDBNode *current = redirections_database_buckets[i];
+    while (current) {
+      redirectionsDBDelete(current->phone_forward_data);
 
-    struct RedirationsDBNode *next = current->next;
-    free(current);
+      struct RedirationsDBNode *next = current->next;
+      free(current);
 
-    current = next;
+      current = next;
+    }
   }
 
-  redirections_database_head = NULL;
+  free(redirections_database_buckets);
+  redirections_database_buckets = NULL;
+  redirections_database_capacity = 0;
+  redirections_database_size = 0;
+  current_database = NULL;
 }
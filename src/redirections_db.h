@@ -39,6 +39,24 @@ int setOrCreateDatabaseWithName(const char *name);
 /// @return 1, gdy operacja się powiodła, 0 gdy wystąpił błąd wykonania.
 int deleteDatabaseWithName(const char *name);
 
+/// @brief Zastępuje zawartość bazy przekierowań.
+/// Zastępuje przekierowania bazy o nazwie @p name strukturą @p phfwd. Jeśli
+/// nie istnieje baza o nazwie @p name, to zostaje ona stworzona. Nie zmienia
+/// aktualnej bazy.
+/// @param[in] name – Nazwa zmienianej bazy danych.
+/// @param[in] phfwd – Nowa zawartość bazy, którą baza przejmuje, gdy operacja
+///                    się powiodła.
+/// @return 1, gdy operacja się powiodła, 0 gdy wystąpił błąd wykonania.
+int replaceDatabaseWithName(const char *name, struct PhoneForward *phfwd);
+
+/// @brief Odwiedza wszystkie bazy przekierowań.
+/// Wywołuje @p visit dla każdej bazy, w dowolnej kolejności, dopóki @p visit
+/// zwraca 1.
+/// @param[in] visit – Funkcja wywoływana dla każdej bazy.
+/// @return 1, gdy @p visit zwróciła 1 dla wszystkich baz, 0 w przeciwnym
+///         wypadku.
+int visitAllDatabases(int (*visit)(const struct RedirectionsDatabase *db));
+
 /// @brief Usuwa wszystkie bazy przekierowań.
 /// Usuwa całą kolekcję danych baz przekierowań, nie ma po tej operacji
 /// aktualnej bazy.
@@ -0,0 +1,415 @@
+/// @file
+/// Implementacja modułu pamięci ostatnich wyników zapytań o przekierowania.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "result_cache.h"
+#include "util.h"
+
+/// Indeks oznaczający brak wpisu.
+#define RESULT_CACHE_NONE ((size_t)-1)
+
+/// Bit maski długości zmienionych prefiksów, wspólny dla wszystkich dłuższych.
+#define RESULT_CACHE_LONG_PREFIX (63)
+
+/// Zapamiętany wynik zapytania.
+struct ResultCacheEntry {
+  /// Numer, o który pytano, lub @p NULL, gdy wpis jest wolny.
+  char *num;
+
+  /// Skrót numeru i rodzaju zapytania.
+  uint64_t hash;
+
+  /// Pokolenie, w którym zapamiętano wynik.
+  uint64_t generation;
+
+  /// Wynik zapytania.
+  const struct PhoneNumbers *result;
+
+  /// Rodzaj zapytania.
+  enum ResultCacheKind kind;
+
+  /// Następny wpis w kubełku lub na liście wolnych wpisów.
+  size_t chain;
+
+  /// Wpis używany później od tego.
+  size_t newer;
+
+  /// Wpis używany wcześniej od tego.
+  size_t older;
+};
+
+/// Pokolenie ostatniej zmiany prefiksu.
+struct ResultCacheTouched {
+  /// Skrót prefiksu i rodzaju zapytania, lub 0, gdy miejsce jest puste.
+  uint64_t hash;
+
+  /// Pokolenie ostatniej zmiany.
+  uint64_t generation;
+};
+
+/// Pamięć ostatnich wyników zapytań.
+struct ResultCache {
+  /// Tablica wpisów.
+  struct ResultCacheEntry *entries;
+
+  /// Rozmiar tablicy @ref entries.
+  size_t capacity;
+
+  /// Liczba wpisów na początku @ref entries, które były kiedyś używane.
+  size_t used;
+
+  /// Pierwszy wolny wpis spośród używanych.
+  size_t freeEntry;
+
+  /// Ostatnio używany wpis.
+  size_t newest;
+
+  /// Najdawniej używany wpis.
+  size_t oldest;
+
+  /// Pierwsze wpisy list kubełków, według skrótu numeru.
+  size_t *buckets;
+
+  /// Liczba kubełków minus jeden; liczba kubełków jest potęgą dwójki.
+  size_t bucketMask;
+
+  /// Tablica pokoleń zmienionych prefiksów, z adresowaniem otwartym.
+  struct ResultCacheTouched *touched;
+
+  /// Rozmiar tablicy @ref touched minus jeden; rozmiar jest potęgą dwójki.
+  size_t touchedMask;
+
+  /// Liczba zajętych miejsc tablicy @ref touched.
+  size_t touchedCount;
+
+  /// Maski długości zmienionych prefiksów, dla każdego rodzaju zapytań.
+  uint64_t touchedLengths[RESULT_CACHE_KINDS];
+
+  /// Pokolenie ostatniej zmiany.
+  uint64_t generation;
+
+  /// Wyniki zapamiętane przed tym pokoleniem są nieaktualne.
+  uint64_t validFrom;
+
+  /// Liczba trafień dla każdego rodzaju zapytań.
+  size_t hits[RESULT_CACHE_KINDS];
+
+  /// Liczba chybień dla każdego rodzaju zapytań.
+  size_t misses[RESULT_CACHE_KINDS];
+};
+
+/// @brief Zwraca najmniejszą potęgę dwójki nie mniejszą od @p value.
+/// @param[in] value – ograniczenie dolne.
+/// @return Najmniejsza potęga dwójki nie mniejsza od @p value.
+static size_t resultCachePowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value)
+    result *= 2;
+
+  return result;
+}
+
+/// @brief Zwraca skrót pustego prefiksu.
+/// @param[in] kind – rodzaj zapytania.
+/// @return Skrót pustego napisu dla zapytań rodzaju @p kind.
+static uint64_t resultCacheHashStart(enum ResultCacheKind kind) {
+  return 14695981039346656037ULL ^ ((uint64_t)kind + 1);
+}
+
+/// @brief Wydłuża skrót prefiksu o jeden znak.
+/// @param[in] hash – skrót prefiksu.
+/// @param[in] digit – kolejny znak numeru.
+/// @return Skrót prefiksu wydłużonego o @p digit.
+static uint64_t resultCacheHashStep(uint64_t hash, char digit) {
+  return (hash ^ (unsigned char)digit) * 1099511628211ULL;
+}
+
+/// @brief Wyznacza pozycję skrótu w tablicy o rozmiarze będącym potęgą dwójki.
+/// @param[in] hash – skrót.
+/// @param[in] mask – rozmiar tablicy minus jeden.
+/// @return Pozycja skrótu.
+static size_t resultCacheSlot(uint64_t hash, size_t mask) {
+  return (size_t)(hash ^ (hash >> 29)) & mask;
+}
+
+/// @brief Zwraca bit maski długości dla prefiksu danej długości.
+/// @param[in] length – długość prefiksu, dodatnia.
+/// @return Bit maski długości.
+static uint64_t resultCacheLengthBit(size_t length) {
+  return (uint64_t)1 << (length < RESULT_CACHE_LONG_PREFIX
+                             ? length
+                             : RESULT_CACHE_LONG_PREFIX);
+}
+
+/// @brief Szuka pokolenia ostatniej zmiany prefiksu.
+/// @param[in] cache – wskaźnik na pamięć wyników.
+/// @param[in] hash – niezerowy skrót prefiksu.
+/// @return Pokolenie ostatniej zmiany prefiksu lub 0, gdy prefiks nie
+///         zmienił się od ostatniego czyszczenia tablicy.
+static uint64_t resultCacheTouchedGeneration(const struct ResultCache *cache,
+                                             uint64_t hash) {
+  for (size_t slot = resultCacheSlot(hash, cache->touchedMask);;
+       slot = (slot + 1) & cache->touchedMask) {
+    if (cache->touched[slot].hash == hash)
+      return cache->touched[slot].generation;
+    if (cache->touched[slot].hash == 0)
+      return 0;
+  }
+}
+
+/// @brief Sprawdza, czy zapamiętany wynik jest aktualny.
+/// @param[in] cache – wskaźnik na pamięć wyników.
+/// @param[in] entry – sprawdzany wpis.
+/// @return @p true jeśli żaden prefiks numeru wpisu nie zmienił się od
+///         zapamiętania wyniku, @p false w przeciwnym wypadku.
+static bool resultCacheValid(const struct ResultCache *cache,
+                             const struct ResultCacheEntry *entry) {
+  if (entry->generation < cache->validFrom)
+    return false;
+
+  // Only prefixes of lengths that were ever changed have to be looked up.
+  uint64_t lengths = cache->touchedLengths[entry->kind];
+  uint64_t hash = resultCacheHashStart(entry->kind);
+  for (size_t length = 1; lengths && entry->num[length - 1] != '\0';
+       ++length) {
+    hash = resultCacheHashStep(hash, entry->num[length - 1]);
+    if ((lengths & resultCacheLengthBit(length)) && hash != 0 &&
+        resultCacheTouchedGeneration(cache, hash) > entry->generation)
+      return false;
+  }
+
+  return true;
+}
+
+/// @brief Wyznacza skrót numeru.
+/// @param[in] kind – rodzaj zapytania.
+/// @param[in] num – numer.
+/// @return Skrót numeru @p num dla zapytań rodzaju @p kind.
+static uint64_t resultCacheHash(enum ResultCacheKind kind, const char *num) {
+  uint64_t hash = resultCacheHashStart(kind);
+  for (; (*num) != '\0'; ++num)
+    hash = resultCacheHashStep(hash, *num);
+
+  return hash;
+}
+
+/// @brief Odpina wpis od listy wpisów według czasu użycia.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] idx – indeks wpisu.
+static void resultCacheUnlink(struct ResultCache *cache, size_t idx) {
+  struct ResultCacheEntry *entry = &cache->entries[idx];
+  if (entry->newer != RESULT_CACHE_NONE)
+    cache->entries[entry->newer].older = entry->older;
+  else
+    cache->newest = entry->older;
+
+  if (entry->older != RESULT_CACHE_NONE)
+    cache->entries[entry->older].newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+}
+
+/// @brief Dopina wpis na początek listy wpisów według czasu użycia.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] idx – indeks wpisu.
+static void resultCachePushNewest(struct ResultCache *cache, size_t idx) {
+  struct ResultCacheEntry *entry = &cache->entries[idx];
+  entry->newer = RESULT_CACHE_NONE;
+  entry->older = cache->newest;
+  if (cache->newest != RESULT_CACHE_NONE)
+    cache->entries[cache->newest].newer = idx;
+  else
+    cache->oldest = idx;
+
+  cache->newest = idx;
+}
+
+/// @brief Usuwa wpis razem z wynikiem.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] idx – indeks zajętego wpisu.
+static void resultCacheRemove(struct ResultCache *cache, size_t idx) {
+  struct ResultCacheEntry *entry = &cache->entries[idx];
+
+  size_t *link = &cache->buckets[resultCacheSlot(entry->hash,
+                                                 cache->bucketMask)];
+  while ((*link) != idx)
+    link = &cache->entries[*link].chain;
+  (*link) = entry->chain;
+
+  resultCacheUnlink(cache, idx);
+  free(entry->num);
+  phnumDelete(entry->result);
+
+  entry->num = NULL;
+  entry->result = NULL;
+  entry->chain = cache->freeEntry;
+  cache->freeEntry = idx;
+}
+
+/// @brief Czyści tablicę pokoleń zmienionych prefiksów.
+/// Wszystkie zapamiętane wcześniej wyniki stają się nieaktualne.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+static void resultCacheClearTouched(struct ResultCache *cache) {
+  cache->generation++;
+  cache->validFrom = cache->generation;
+  cache->touchedCount = 0;
+  memset(cache->touched, 0,
+         sizeof(struct ResultCacheTouched) * (cache->touchedMask + 1));
+  memset(cache->touchedLengths, 0, sizeof(cache->touchedLengths));
+}
+
+struct ResultCache *resultCacheNew(size_t capacity) {
+  assert(capacity > 0);
+
+  struct ResultCache *cache = calloc(1, sizeof(struct ResultCache));
+  if (!cache)
+    return NULL;
+
+  size_t buckets = resultCachePowerOfTwo(2 * capacity);
+  size_t touched = resultCachePowerOfTwo(4 * capacity);
+  if (touched < RESULT_CACHE_MIN_TOUCHED)
+    touched = RESULT_CACHE_MIN_TOUCHED;
+
+  cache->entries = malloc(sizeof(struct ResultCacheEntry) * capacity);
+  cache->buckets = malloc(sizeof(size_t) * buckets);
+  cache->touched = calloc(touched, sizeof(struct ResultCacheTouched));
+  if (!cache->entries || !cache->buckets || !cache->touched) {
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache->touched);
+    free(cache);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < buckets; ++i)
+    cache->buckets[i] = RESULT_CACHE_NONE;
+
+  cache->capacity = capacity;
+  cache->freeEntry = RESULT_CACHE_NONE;
+  cache->newest = RESULT_CACHE_NONE;
+  cache->oldest = RESULT_CACHE_NONE;
+  cache->bucketMask = buckets - 1;
+  cache->touchedMask = touched - 1;
+  return cache;
+}
+
+void resultCacheDelete(struct ResultCache *cache) {
+  if (!cache)
+    return;
+
+  for (size_t i = 0; i < cache->used; ++i) {
+    free(cache->entries[i].num);
+    phnumDelete(cache->entries[i].result);
+  }
+
+  free(cache->entries);
+  free(cache->buckets);
+  free(cache->touched);
+  free(cache);
+}
+
+const struct PhoneNumbers *resultCacheFind(struct ResultCache *cache,
+                                           enum ResultCacheKind kind,
+                                           const char *num) {
+  uint64_t hash = resultCacheHash(kind, num);
+  size_t idx = cache->buckets[resultCacheSlot(hash, cache->bucketMask)];
+  while (idx != RESULT_CACHE_NONE &&
+         (cache->entries[idx].hash != hash ||
+          cache->entries[idx].kind != kind ||
+          strcmp(cache->entries[idx].num, num) != 0))
+    idx = cache->entries[idx].chain;
+
+  // A stale result is dropped right away, to make room for the new one.
+  if (idx != RESULT_CACHE_NONE &&
+      !resultCacheValid(cache, &cache->entries[idx])) {
+    resultCacheRemove(cache, idx);
+    idx = RESULT_CACHE_NONE;
+  }
+
+  if (idx == RESULT_CACHE_NONE) {
+    cache->misses[kind]++;
+    return NULL;
+  }
+
+  cache->hits[kind]++;
+  resultCacheUnlink(cache, idx);
+  resultCachePushNewest(cache, idx);
+  return cache->entries[idx].result;
+}
+
+void resultCacheInsert(struct ResultCache *cache, enum ResultCacheKind kind,
+                       const char *num, const struct PhoneNumbers *result) {
+  char *key = duplicateStr(num);
+  if (!key) {
+    phnumDelete(result);
+    return;
+  }
+
+  if (cache->freeEntry == RESULT_CACHE_NONE && cache->used == cache->capacity)
+    resultCacheRemove(cache, cache->oldest);
+
+  size_t idx;
+  if (cache->freeEntry != RESULT_CACHE_NONE) {
+    idx = cache->freeEntry;
+    cache->freeEntry = cache->entries[idx].chain;
+  } else {
+    idx = cache->used++;
+  }
+
+  uint64_t hash = resultCacheHash(kind, num);
+  size_t *bucket = &cache->buckets[resultCacheSlot(hash, cache->bucketMask)];
+  cache->entries[idx] = (struct ResultCacheEntry){
+      .num = key,
+      .hash = hash,
+      .generation = cache->generation,
+      .result = result,
+      .kind = kind,
+      .chain = *bucket};
+  (*bucket) = idx;
+  resultCachePushNewest(cache, idx);
+}
+
+void resultCacheTouch(struct ResultCache *cache, enum ResultCacheKind kind,
+                      const char *prefix) {
+  // Only results of numbers at least as long as the prefix may change, and
+  // the empty prefix changes all of them.
+  size_t length = strlen(prefix);
+  uint64_t hash = resultCacheHash(kind, prefix);
+  if (length == 0 || hash == 0 ||
+      2 * (cache->touchedCount + 1) > cache->touchedMask + 1) {
+    resultCacheClearTouched(cache);
+    return;
+  }
+
+  cache->generation++;
+  size_t slot = resultCacheSlot(hash, cache->touchedMask);
+  while (cache->touched[slot].hash != 0 && cache->touched[slot].hash != hash)
+    slot = (slot + 1) & cache->touchedMask;
+
+  if (cache->touched[slot].hash == 0) {
+    cache->touched[slot].hash = hash;
+    cache->touchedCount++;
+  }
+
+  cache->touched[slot].generation = cache->generation;
+  cache->touchedLengths[kind] |= resultCacheLengthBit(length);
+}
+
+void resultCacheFlush(struct ResultCache *cache) {
+  resultCacheClearTouched(cache);
+}
+
+void resultCacheStats(const struct ResultCache *cache,
+                      struct PhoneForwardCacheStats *stats) {
+  stats->getHits = cache->hits[RESULT_CACHE_GET];
+  stats->getMisses = cache->misses[RESULT_CACHE_GET];
+  stats->reverseHits = cache->hits[RESULT_CACHE_REVERSE];
+  stats->reverseMisses = cache->misses[RESULT_CACHE_REVERSE];
+}
@@ -0,0 +1,95 @@
+/// @file
+/// Interfejs modułu pamięci ostatnich wyników zapytań o przekierowania.
+///
+/// Pamięć przechowuje ograniczoną liczbę wyników @ref phfwdGet i @ref
+/// phfwdReverse, według numeru, i usuwa najdawniej używane, gdy brakuje
+/// miejsca. Wynik zapytania o numer zależy tylko od przekierowań z prefiksów
+/// tego numeru (dla @ref phfwdGet) lub na prefiksy tego numeru (dla @ref
+/// phfwdReverse), więc zmiana przekierowań jest zgłaszana jako zmiana
+/// poddrzewa numerów o danym prefiksie. Każda zmiana dostaje kolejny numer
+/// pokolenia, zapamiętywany osobno dla każdego zmienionego prefiksu, a wynik
+/// jest aktualny, jeśli żaden z prefiksów jego numeru nie zmienił się od jego
+/// zapamiętania.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __RESULT_CACHE_H__
+#define __RESULT_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "phone_forward.h"
+
+/// Rodzaj zapytania, którego wyniki przechowuje pamięć.
+enum ResultCacheKind {
+  /// Wyniki @ref phfwdGet.
+  RESULT_CACHE_GET = 0,
+
+  /// Wyniki @ref phfwdReverse.
+  RESULT_CACHE_REVERSE = 1,
+
+  /// Liczba rodzajów zapytań.
+  RESULT_CACHE_KINDS = 2
+};
+
+/// @brief Najmniejszy rozmiar tablicy pokoleń zmienionych prefiksów.
+/// Gdy tablica zapełni się do połowy, jest czyszczona, a wszystkie
+/// zapamiętane wcześniej wyniki stają się nieaktualne.
+#define RESULT_CACHE_MIN_TOUCHED (1024)
+
+struct ResultCache;
+
+/// @brief Tworzy pustą pamięć wyników.
+/// @param[in] capacity – największa liczba przechowywanych wyników, dodatnia.
+/// @return Wskaźnik na utworzoną pamięć lub @p NULL, gdy nie udało się
+///         zaalokować pamięci.
+struct ResultCache *resultCacheNew(size_t capacity);
+
+/// @brief Usuwa pamięć wyników razem z przechowywanymi wynikami.
+/// Nic nie robi, gdy @p cache jest @p NULL.
+/// @param[in] cache – wskaźnik na usuwaną pamięć.
+void resultCacheDelete(struct ResultCache *cache);
+
+/// @brief Szuka aktualnego wyniku zapytania.
+/// Znaleziony wynik staje się ostatnio używanym, a nieaktualny jest usuwany.
+/// Zlicza trafienia i chybienia.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] kind – rodzaj zapytania.
+/// @param[in] num – numer, o który pytano.
+/// @return Wskaźnik na wynik, należący do pamięci i ważny do jej następnej
+///         zmiany, lub @p NULL, gdy nie ma aktualnego wyniku.
+const struct PhoneNumbers *resultCacheFind(struct ResultCache *cache,
+                                           enum ResultCacheKind kind,
+                                           const char *num);
+
+/// @brief Zapamiętuje wynik zapytania.
+/// Gdy brakuje miejsca, usuwa najdawniej używany wynik. Gdy nie uda się
+/// zaalokować pamięci, wynik nie jest zapamiętywany.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] kind – rodzaj zapytania.
+/// @param[in] num – numer, o który pytano, nieobecny w pamięci.
+/// @param[in] result – wynik zapytania; przechodzi na własność pamięci, która
+///                     zwalnia go przez @ref phnumDelete.
+void resultCacheInsert(struct ResultCache *cache, enum ResultCacheKind kind,
+                       const char *num, const struct PhoneNumbers *result);
+
+/// @brief Unieważnia wyniki zapytań o numery o danym prefiksie.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+/// @param[in] kind – rodzaj unieważnianych zapytań.
+/// @param[in] prefix – prefiks numerów, których wyniki mogły się zmienić.
+void resultCacheTouch(struct ResultCache *cache, enum ResultCacheKind kind,
+                      const char *prefix);
+
+/// @brief Unieważnia wszystkie wyniki.
+/// @param[in,out] cache – wskaźnik na pamięć wyników.
+void resultCacheFlush(struct ResultCache *cache);
+
+/// @brief Odczytuje liczniki trafień.
+/// @param[in] cache – wskaźnik na pamięć wyników.
+/// @param[out] stats – liczniki trafień i chybień.
+void resultCacheStats(const struct ResultCache *cache,
+                      struct PhoneForwardCacheStats *stats);
+
+#endif /* __RESULT_CACHE_H__ */
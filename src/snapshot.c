@@ -0,0 +1,131 @@
+/// @file
+/// Implementacja modułu binarnego formatu zrzutu struktury przekierowań.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include <assert.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+/// Mnożnik sumy kontrolnej FNV-1a.
+#define SNAPSHOT_CHECKSUM_PRIME UINT64_C(1099511628211)
+
+uint64_t snapshotChecksum(uint64_t checksum, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    checksum ^= word;
+    checksum *= SNAPSHOT_CHECKSUM_PRIME;
+    bytes += sizeof(word);
+  }
+
+  for (; size > 0; --size) {
+    checksum ^= *(bytes++);
+    checksum *= SNAPSHOT_CHECKSUM_PRIME;
+  }
+
+  return checksum;
+}
+
+bool snapshotSupported() {
+  const uint32_t probe = 1;
+  return *(const unsigned char *)&probe == 1;
+}
+
+void snapshotWriterInit(struct SnapshotWriter *writer, FILE *file,
+                        uint64_t offset) {
+  writer->file = file;
+  writer->checksum = SNAPSHOT_CHECKSUM_INIT;
+  writer->size = offset;
+  writer->failed = false;
+  writer->bufferSize = 0;
+}
+
+bool snapshotWriterFlush(struct SnapshotWriter *writer) {
+  writer->checksum =
+      snapshotChecksum(writer->checksum, writer->buffer, writer->bufferSize);
+  if (!writer->failed && writer->bufferSize > 0 &&
+      fwrite(writer->buffer, 1, writer->bufferSize, writer->file) !=
+          writer->bufferSize)
+    writer->failed = true;
+
+  writer->bufferSize = 0;
+  return !writer->failed;
+}
+
+void snapshotWrite(struct SnapshotWriter *writer, const void *data,
+                   size_t size) {
+  writer->size += size;
+
+  const char *bytes = data;
+  while (size > 0) {
+    if (writer->bufferSize == SNAPSHOT_BUFFER_SIZE)
+      snapshotWriterFlush(writer);
+
+    size_t chunk = SNAPSHOT_BUFFER_SIZE - writer->bufferSize;
+    if (chunk > size)
+      chunk = size;
+
+    memcpy(writer->buffer + writer->bufferSize, bytes, chunk);
+    writer->bufferSize += chunk;
+    bytes += chunk;
+    size -= chunk;
+  }
+}
+
+void snapshotWritePadding(struct SnapshotWriter *writer) {
+  static const char zeros[SNAPSHOT_ALIGNMENT] = {0};
+  snapshotWrite(writer, zeros, snapshotAlign(writer->size) - writer->size);
+}
+
+/// @brief Sprawdza, czy sekcja leży w pliku.
+/// @param[in] offset – przesunięcie początku sekcji.
+/// @param[in] count – liczba elementów sekcji.
+/// @param[in] elementSize – rozmiar elementu sekcji.
+/// @param[in] headerSize – rozmiar nagłówka pliku.
+/// @param[in] fileSize – rozmiar pliku.
+/// @return @p true jeśli sekcja jest wyrównana i leży w pliku za nagłówkiem,
+///         @p false w przeciwnym wypadku.
+static bool snapshotSectionValid(uint64_t offset, uint64_t count,
+                                 uint64_t elementSize, uint64_t headerSize,
+                                 uint64_t fileSize) {
+  if (offset % SNAPSHOT_ALIGNMENT != 0 || offset < headerSize ||
+      offset > fileSize)
+    return false;
+
+  // Counts are at most 32-bit, so the product cannot overflow.
+  return count * elementSize <= fileSize - offset;
+}
+
+bool snapshotHeaderValid(const struct SnapshotHeader *header,
+                         uint64_t fileSize) {
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->headerSize != sizeof(struct SnapshotHeader) ||
+      header->fileSize != fileSize ||
+      header->headerChecksum !=
+          snapshotChecksum(SNAPSHOT_CHECKSUM_INIT, header,
+                           offsetof(struct SnapshotHeader, headerChecksum)))
+    return false;
+
+  for (int i = 0; i < SNAPSHOT_TRIES; ++i) {
+    const struct SnapshotTrieHeader *trie = &header->tries[i];
+
+    // Every trie has at least the root and the unused first slot.
+    if (trie->nodesSize == 0 || trie->slotsSize == 0 ||
+        !snapshotSectionValid(trie->nodesOffset, trie->nodesSize,
+                              sizeof(struct SnapshotNode), header->headerSize,
+                              fileSize) ||
+        !snapshotSectionValid(trie->slotsOffset, trie->slotsSize,
+                              sizeof(TrieIndex), header->headerSize,
+                              fileSize) ||
+        !snapshotSectionValid(trie->valuesOffset, 1, trie->valuesSize,
+                              header->headerSize, fileSize))
+      return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,236 @@
+/// @file
+/// Interfejs modułu binarnego formatu zrzutu struktury przekierowań.
+///
+/// Plik zrzutu zaczyna się nagłówkiem @ref SnapshotHeader, po którym dla
+/// każdego drzewa następują kolejno: tablica wierzchołków @ref SnapshotNode,
+/// tablica bloków dzieci i ciąg wartości @ref SnapshotValue. Wszystkie liczby
+/// są zapisane w porządku little-endian, a wszystkie sekcje są wyrównane do 8
+/// bajtów. Zamiast wskaźników plik zawiera przesunięcia, więc może być
+/// używany bezpośrednio po odwzorowaniu w pamięci.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "trie.h"
+
+/// Napis rozpoczynający każdy plik zrzutu.
+#define SNAPSHOT_MAGIC "PHFWSNAP"
+
+/// Wersja formatu zapisywana przez ten moduł.
+#define SNAPSHOT_VERSION (1)
+
+/// Liczba drzew w pliku zrzutu: drzewo przekierowań i drzewo prefiksów.
+#define SNAPSHOT_TRIES (2)
+
+/// Przesunięcie oznaczające brak wartości.
+#define SNAPSHOT_NONE UINT64_MAX
+
+/// Wyrównanie wszystkich sekcji i rekordów pliku.
+#define SNAPSHOT_ALIGNMENT (8)
+
+/// Rozmiar bufora zapisu pliku zrzutu.
+#define SNAPSHOT_BUFFER_SIZE (64 * 1024)
+
+/// @brief Początkowa wartość sumy kontrolnej.
+/// Suma kontrolna to FNV-1a liczona 64-bitowymi słowami little-endian.
+#define SNAPSHOT_CHECKSUM_INIT UINT64_C(14695981039346656037)
+
+/// @brief Opis jednego drzewa w pliku zrzutu.
+/// Tablice wierzchołków i bloków dzieci są zapisane w całości, razem z
+/// wolnymi elementami, więc indeksy w pliku są takie same jak w pamięci.
+struct SnapshotTrieHeader {
+  /// Liczba wierzchołków, @ref Trie.nodesSize.
+  uint32_t nodesSize;
+
+  /// Liczba pól bloków dzieci, @ref Trie.slotsSize.
+  uint32_t slotsSize;
+
+  /// Pierwszy wierzchołek listy wolnych, @ref Trie.freeNodes.
+  uint32_t freeNodes;
+
+  /// Listy wolnych bloków, @ref Trie.freeSlots.
+  uint32_t freeSlots[CHILD_BLOCK_CLASSES];
+
+  /// Przesunięcie tablicy @ref SnapshotNode.
+  uint64_t nodesOffset;
+
+  /// Przesunięcie tablicy indeksów dzieci.
+  uint64_t slotsOffset;
+
+  /// Przesunięcie ciągu wartości.
+  uint64_t valuesOffset;
+
+  /// Rozmiar ciągu wartości w bajtach.
+  uint64_t valuesSize;
+
+  /// Liczba wartości drzewa.
+  uint64_t valuesCount;
+};
+
+/// Nagłówek pliku zrzutu.
+struct SnapshotHeader {
+  /// Napis @ref SNAPSHOT_MAGIC, bez znaku @p '\0'.
+  char magic[8];
+
+  /// Wersja formatu.
+  uint32_t version;
+
+  /// Rozmiar nagłówka w bajtach.
+  uint32_t headerSize;
+
+  /// Rozmiar całego pliku w bajtach.
+  uint64_t fileSize;
+
+  /// Suma kontrolna wszystkiego, co następuje po nagłówku.
+  uint64_t bodyChecksum;
+
+  /// Opisy drzewa przekierowań i drzewa prefiksów.
+  struct SnapshotTrieHeader tries[SNAPSHOT_TRIES];
+
+  /// Suma kontrolna nagłówka bez tego pola.
+  uint64_t headerChecksum;
+};
+
+/// @brief Wierzchołek drzewa w pliku zrzutu.
+/// Odpowiada strukturze @ref TrieNode, ale zamiast wskaźnika na listę
+/// wartości przechowuje przesunięcie pierwszej z nich.
+struct SnapshotNode {
+  /// Maska bitowa dzieci, @ref TrieNode.childMask.
+  uint16_t childMask;
+
+  /// Długość etykiety, @ref TrieNode.labelLength.
+  uint8_t labelLength;
+
+  /// Nieużywane, zawsze 0.
+  uint8_t reserved;
+
+  /// Indeks bloku dzieci, @ref TrieNode.childs.
+  uint32_t childs;
+
+  /// Etykieta krawędzi, @ref TrieNode.label.
+  uint64_t label;
+
+  /// Przesunięcie pierwszej wartości względem początku ciągu wartości drzewa,
+  /// lub @ref SNAPSHOT_NONE.
+  uint64_t data;
+};
+
+/// @brief Wartość drzewa w pliku zrzutu.
+/// Rekord zajmuje @ref snapshotValueSize bajtów. Wartości drzewa są
+/// numerowane od zera w kolejności zapisu: według indeksów wierzchołków, a w
+/// jednym wierzchołku według kolejności na liście.
+struct SnapshotValue {
+  /// Przesunięcie następnej wartości listy względem początku ciągu wartości
+  /// drzewa, lub @ref SNAPSHOT_NONE. Zawsze większe od przesunięcia tej.
+  uint64_t next;
+
+  /// Numer powiązanej wartości (@ref DataNode.link) w drugim drzewie, lub
+  /// @ref SNAPSHOT_NONE.
+  uint64_t link;
+
+  /// Długość napisu @ref text.
+  uint32_t length;
+
+  /// Napis zakończony znakiem @p '\0'.
+  char text[];
+};
+
+/// @brief Buforowany zapis pliku zrzutu.
+/// Liczy sumę kontrolną zapisanych danych. Dane trafiają do pliku całymi
+/// buforami, więc suma jest taka sama jak liczona od razu dla całego pliku.
+struct SnapshotWriter {
+  /// Plik, do którego trafiają dane.
+  FILE *file;
+
+  /// Suma kontrolna danych, które trafiły już do pliku.
+  uint64_t checksum;
+
+  /// Pozycja w pliku za ostatnim zapisanym bajtem.
+  uint64_t size;
+
+  /// @p true, gdy któryś zapis się nie powiódł.
+  bool failed;
+
+  /// Liczba bajtów w buforze @ref buffer.
+  size_t bufferSize;
+
+  /// Dane czekające na zapisanie do pliku.
+  char buffer[SNAPSHOT_BUFFER_SIZE];
+};
+
+/// @brief Wyznacza rozmiar sekcji.
+/// @param[in] size – rozmiar danych sekcji.
+/// @return Rozmiar @p size wyrównany do @ref SNAPSHOT_ALIGNMENT.
+static inline uint64_t snapshotAlign(uint64_t size) {
+  return (size + SNAPSHOT_ALIGNMENT - 1) & ~(uint64_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+/// @brief Wyznacza rozmiar rekordu wartości.
+/// @param[in] length – długość napisu wartości.
+/// @return Rozmiar rekordu @ref SnapshotValue z napisem długości @p length,
+///         wyrównany do @ref SNAPSHOT_ALIGNMENT.
+static inline uint64_t snapshotValueSize(uint64_t length) {
+  return snapshotAlign(offsetof(struct SnapshotValue, text) + length + 1);
+}
+
+/// @brief Aktualizuje sumę kontrolną.
+/// Dolicza do sumy kontrolnej kolejne bajty danych. Dane dzielone na części
+/// dają tę samą sumę co w całości tylko wtedy, gdy każda część poza ostatnią
+/// ma rozmiar podzielny przez 8.
+/// @param[in] checksum – suma kontrolna dotychczasowych danych.
+/// @param[in] data – wskaźnik na dane.
+/// @param[in] size – liczba bajtów danych.
+/// @return Sumę kontrolną danych uzupełnionych o @p size bajtów @p data.
+uint64_t snapshotChecksum(uint64_t checksum, const void *data, size_t size);
+
+/// @brief Sprawdza, czy ten komputer może czytać i pisać pliki zrzutu.
+/// Struktury pliku są zapisywane bezpośrednio, więc wymagają porządku
+/// little-endian.
+/// @return @p true, jeśli porządek bajtów komputera jest zgodny z formatem.
+bool snapshotSupported();
+
+/// @brief Inicjalizuje zapis pliku zrzutu.
+/// @param[out] writer – inicjalizowana struktura.
+/// @param[in,out] file – plik otwarty do zapisu.
+/// @param[in] offset – bieżąca pozycja w pliku, od której zaczyna się zapis.
+void snapshotWriterInit(struct SnapshotWriter *writer, FILE *file,
+                        uint64_t offset);
+
+/// @brief Zapisuje dane.
+/// @param[in,out] writer – zapis pliku zrzutu.
+/// @param[in] data – wskaźnik na dane.
+/// @param[in] size – liczba bajtów danych.
+void snapshotWrite(struct SnapshotWriter *writer, const void *data,
+                   size_t size);
+
+/// @brief Uzupełnia zapisane dane zerami do wielokrotności @ref
+/// SNAPSHOT_ALIGNMENT.
+/// @param[in,out] writer – zapis pliku zrzutu.
+void snapshotWritePadding(struct SnapshotWriter *writer);
+
+/// @brief Zapisuje zawartość bufora do pliku.
+/// @param[in,out] writer – zapis pliku zrzutu.
+/// @return @p true jeśli wszystkie dotąd zapisane dane trafiły do pliku,
+///         @p false w przeciwnym wypadku.
+bool snapshotWriterFlush(struct SnapshotWriter *writer);
+
+/// @brief Sprawdza nagłówek pliku zrzutu.
+/// Sprawdza wersję, sumę kontrolną nagłówka, oraz czy wszystkie sekcje leżą w
+/// pliku rozmiaru @p fileSize i są wyrównane. Nie sprawdza sumy kontrolnej
+/// reszty pliku.
+/// @param[in] header – nagłówek pliku.
+/// @param[in] fileSize – rzeczywisty rozmiar pliku.
+/// @return @p true jeśli nagłówek jest poprawny, @p false w przeciwnym
+///         wypadku.
+bool snapshotHeaderValid(const struct SnapshotHeader *header,
+                         uint64_t fileSize);
+
+#endif /* __SNAPSHOT_H__ */
@@ -9,268 +9,2112 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "snapshot.h"
 #include "trie.h"
 #include "util.h"
 
+/// Pojemności bloków dzieci kolejnych klas.
+static const int childBlockCapacity[CHILD_BLOCK_CLASSES] = {1, 2, 4, 8, 12};
+
+/// Początkowy rozmiar tablic drzewa.
+#define TRIE_INITIAL_CAPACITY (16)
+
+/// @brief Wyznacza rozmiar obiektów klasy.
+/// @param[in] sizeClass – klasa rozmiaru obiektu DataNode.
+/// @return Rozmiar w bajtach obiektów klasy @p sizeClass.
+static size_t dataNodeClassSize(int sizeClass) {
+  if (sizeClass < 32)
+    return (size_t)8 * (sizeClass + 1);
+
+  return (size_t)256 << (sizeClass - 31);
+}
+
+/// @brief Wyznacza klasę rozmiaru obiektu DataNode.
+/// @param[in] valueSize – liczba bajtów napisu przechowywanego w strukturze,
+///                        wliczając jego zakończenie.
+/// @return Najmniejszą klasę, której obiekty mieszczą strukturę z napisem
+///         zajmującym @p valueSize bajtów.
+static int dataNodeSizeClass(size_t valueSize) {
+  size_t size = offsetof(struct DataNode, value) + valueSize;
+  if (size <= 256)
+    return (int)((size + 7) / 8) - 1;
+
+  int result = 32;
+  while (dataNodeClassSize(result) < size)
+    result++;
+
+  assert(result < DATA_NODE_SIZE_CLASSES);
+  return result;
+}
+
+/// @brief Wyznacza klasę bloku dzieci.
+/// @param[in] childCount – liczba dzieci wierzchołka, od 1 do @p
+///                         ALPHABET_SIZE.
+/// @return Klasę najmniejszego bloku, który mieści @p childCount dzieci.
+static int childBlockClass(int childCount) {
+  assert(inRange(childCount, 1, ALPHABET_SIZE));
+
+  int result = 0;
+  while (childBlockCapacity[result] < childCount)
+    result++;
+
+  return result;
+}
+
+/// @brief Sprawdza, czy wierzchołek należy do migawki.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @return @p true jeśli wierzchołka nie wolno zmieniać, @p false w
+///         przeciwnym wypadku.
+static bool trieNodeFrozen(const struct Trie *trie, TrieIndex node) {
+  return node != TRIE_ROOT && node < trie->frozenNodes;
+}
+
+/// @brief Sprawdza, czy blok dzieci należy do migawki.
+/// @param[in] trie – drzewo, w którym leży blok.
+/// @param[in] block – indeks pierwszego pola bloku, lub @ref TRIE_NONE.
+/// @return @p true jeśli bloku nie wolno zmieniać, @p false w przeciwnym
+///         wypadku.
+static bool childBlockFrozen(const struct Trie *trie, TrieIndex block) {
+  return block != TRIE_NONE && block < trie->frozenSlots;
+}
+
+/// @brief Sprawdza, czy wartość należy do migawki.
+/// @param[in] allocator – pamięć, z której przydzielono wartość.
+/// @param[in] node – wartość.
+/// @return @p true jeśli wartości nie wolno zmieniać ani zwalniać, @p false w
+///         przeciwnym wypadku.
+static bool dataNodeFrozen(const struct TrieAllocator *allocator,
+                           const struct DataNode *node) {
+  return node->version < allocator->frozenVersion;
+}
+
+/// @brief Powiększa tablicę drzewa.
+/// Upewnia się, że tablica @p array ma miejsce na co najmniej @p needed
+/// elementów rozmiaru @p elementSize, w razie potrzeby podwajając jej rozmiar.
+/// @param[in,out] array – wskaźnik na tablicę.
+/// @param[in,out] capacity – wskaźnik na rozmiar tablicy.
+/// @param[in] needed – wymagana liczba elementów.
+/// @param[in] elementSize – rozmiar pojedynczego elementu.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy tablica pozostaje niezmieniona.
+static bool trieReserve(void **array, TrieIndex *capacity, uint64_t needed,
+                        size_t elementSize) {
+  if (needed <= (*capacity))
+    return true;
+
+  uint64_t newCapacity = (*capacity) ? (*capacity) : TRIE_INITIAL_CAPACITY;
+  while (newCapacity < needed)
+    newCapacity *= 2;
+
+  // Indices are 32-bit, so the arrays cannot grow any further.
+  if (newCapacity > UINT32_MAX)
+    newCapacity = UINT32_MAX;
+  if (newCapacity < needed)
+    return false;
+
+  void *newArray = realloc(*array, newCapacity * elementSize);
+  if (!newArray)
+    return false;
+
+  (*array) = newArray;
+  (*capacity) = (TrieIndex)newCapacity;
+  return true;
+}
+
+/// @brief Tworzy nowy wierzchołek.
+/// Bierze wierzchołek z listy wolnych, lub przydziela nowy na końcu tablicy.
+/// Wierzchołek nie ma dzieci ani wartości. Wywołujący procedurę musi sam
+/// podpiąć go do drzewa. Może przesunąć tablicę @ref Trie.nodes.
+/// @param[in,out] trie – drzewo, w którym tworzony jest wierzchołek.
+/// @return Indeks nowego wierzchołka, lub @ref TRIE_NONE, gdy nie udało się
+///         zaalokować pamięci.
+static TrieIndex trieNodeNew(struct Trie *trie) {
+  TrieIndex result = trie->freeNodes;
+  if (result != TRIE_NONE)
+    trie->freeNodes = trie->nodes[result].childs;
+  else {
+    if (!trieReserve((void **)&trie->nodes, &trie->nodesCapacity,
+                     (uint64_t)trie->nodesSize + 1, sizeof(struct TrieNode)))
+      return TRIE_NONE;
+
+    result = trie->nodesSize++;
+  }
+
+  trie->nodes[result] = (struct TrieNode){.childMask = 0,
+                                          .labelLength = 0,
+                                          .childs = TRIE_NONE,
+                                          .label = 0,
+                                          .data = NULL};
+  return result;
+}
+
+/// @brief Zwraca wierzchołek na listę wolnych.
+/// Wierzchołek nie może mieć już dzieci ani wartości. Wierzchołki należące do
+/// migawek pozostają na miejscu.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks zwalnianego wierzchołka.
+static void trieNodeDelete(struct Trie *trie, TrieIndex node) {
+  assert(node != TRIE_ROOT);
+  if (trieNodeFrozen(trie, node))
+    return;
+
+  assert(!trie->nodes[node].childMask && !trie->nodes[node].data);
+
+  trie->nodes[node].childs = trie->freeNodes;
+  trie->freeNodes = node;
+}
+
+/// @brief Przydziela blok dzieci.
+/// Gdy brak wolnego bloku danej klasy, dzieli najmniejszy większy wolny blok.
+/// Może przesunąć tablicę @ref Trie.slots.
+/// @param[in,out] trie – drzewo, w którym przydzielany jest blok.
+/// @param[in] blockClass – klasa przydzielanego bloku.
+/// @return Indeks pierwszego pola bloku, lub @ref TRIE_NONE, gdy nie udało się
+///         zaalokować pamięci.
+static TrieIndex childBlockNew(struct Trie *trie, int blockClass) {
+  TrieIndex result = trie->freeSlots[blockClass];
+  if (result != TRIE_NONE) {
+    trie->freeSlots[blockClass] = trie->slots[result];
+    return result;
+  }
+
+  // Large blocks left by a collection would otherwise never be reused.
+  for (int larger = blockClass + 1; larger < CHILD_BLOCK_CLASSES; ++larger) {
+    result = trie->freeSlots[larger];
+    if (result == TRIE_NONE)
+      continue;
+
+    trie->freeSlots[larger] = trie->slots[result];
+    TrieIndex slot = result + childBlockCapacity[blockClass];
+    TrieIndex end = result + childBlockCapacity[larger];
+    while (slot < end) {
+      int restClass = larger - 1;
+      while ((TrieIndex)childBlockCapacity[restClass] > end - slot)
+        restClass--;
+
+      trie->slots[slot] = trie->freeSlots[restClass];
+      trie->freeSlots[restClass] = slot;
+      slot += childBlockCapacity[restClass];
+    }
+
+    return result;
+  }
+
+  if (!trieReserve((void **)&trie->slots, &trie->slotsCapacity,
+                   (uint64_t)trie->slotsSize + childBlockCapacity[blockClass],
+                   sizeof(TrieIndex)))
+    return TRIE_NONE;
+
+  result = trie->slotsSize;
+  trie->slotsSize += childBlockCapacity[blockClass];
+  return result;
+}
+
+/// @brief Zwraca blok dzieci na listę wolnych bloków jego klasy.
+/// Bloki należące do migawek pozostają na miejscu.
+/// @param[in,out] trie – drzewo, w którym leży blok.
+/// @param[in] block – indeks pierwszego pola bloku.
+/// @param[in] blockClass – klasa zwalnianego bloku.
+static void childBlockDelete(struct Trie *trie, TrieIndex block,
+                             int blockClass) {
+  if (childBlockFrozen(trie, block))
+    return;
+
+  trie->slots[block] = trie->freeSlots[blockClass];
+  trie->freeSlots[blockClass] = block;
+}
+
+/// @brief Dodaje dziecko do wierzchołka.
+/// Wstawia @p child do spakowanej tablicy dzieci wierzchołka @p node, w razie
+/// potrzeby przenosząc ją do większego bloku, lub do kopii bloku należącego do
+/// migawki. Wierzchołek nie może mieć jeszcze dziecka dla cyfry @p digit.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra, pod którą dodawane jest dziecko.
+/// @param[in] child – indeks dodawanego dziecka.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+static bool trieAttachChild(struct Trie *trie, TrieIndex node, int digit,
+                            TrieIndex child) {
+  unsigned int mask = trie->nodes[node].childMask;
+  assert(!(mask & (1u << digit)));
+
+  int count = bitCount(mask);
+  int position = bitCount(mask & ((1u << digit) - 1));
+  TrieIndex block = trie->nodes[node].childs;
+
+  if (count == 0 || childBlockClass(count) != childBlockClass(count + 1) ||
+      childBlockFrozen(trie, block)) {
+    TrieIndex newBlock = childBlockNew(trie, childBlockClass(count + 1));
+    if (newBlock == TRIE_NONE)
+      return false;
+
+    if (count > 0) {
+      memcpy(trie->slots + newBlock, trie->slots + block,
+             sizeof(TrieIndex) * count);
+      childBlockDelete(trie, block, childBlockClass(count));
+    }
+
+    block = newBlock;
+    trie->nodes[node].childs = block;
+  }
+
+  memmove(trie->slots + block + position + 1, trie->slots + block + position,
+          sizeof(TrieIndex) * (count - position));
+  trie->slots[block + position] = child;
+  trie->nodes[node].childMask = mask | (1u << digit);
+
+  return true;
+}
+
+/// @brief Odpina dziecko od wierzchołka.
+/// Usuwa dziecko dla cyfry @p digit ze spakowanej tablicy dzieci wierzchołka
+/// @p node. Gdy tablica mieści się w bloku mniejszej klasy, koniec bloku
+/// zostaje oddzielony i trafia na listę wolnych bloków, więc operacja wymaga
+/// alokacji pamięci tylko wtedy, gdy blok należy do migawki i musi zostać
+/// skopiowany. Samo dziecko nie jest usuwane.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra, pod którą znajduje się dziecko.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy drzewo pozostaje niezmienione.
+static bool trieDetachChild(struct Trie *trie, TrieIndex node, int digit) {
+  unsigned int mask = trie->nodes[node].childMask;
+  assert(mask & (1u << digit));
+
+  int count = bitCount(mask);
+  int position = bitCount(mask & ((1u << digit) - 1));
+  TrieIndex block = trie->nodes[node].childs;
+
+  if (childBlockFrozen(trie, block)) {
+    TrieIndex newBlock = TRIE_NONE;
+    if (count > 1) {
+      newBlock = childBlockNew(trie, childBlockClass(count - 1));
+      if (newBlock == TRIE_NONE)
+        return false;
+
+      memcpy(trie->slots + newBlock, trie->slots + block,
+             sizeof(TrieIndex) * position);
+      memcpy(trie->slots + newBlock + position,
+             trie->slots + block + position + 1,
+             sizeof(TrieIndex) * (count - position - 1));
+    }
+
+    trie->nodes[node].childs = newBlock;
+    trie->nodes[node].childMask = mask & ~(1u << digit);
+    return true;
+  }
+
+  memmove(trie->slots + block + position, trie->slots + block + position + 1,
+          sizeof(TrieIndex) * (count - position - 1));
+  trie->nodes[node].childMask = mask & ~(1u << digit);
+
+  if (count == 1) {
+    childBlockDelete(trie, block, childBlockClass(count));
+    trie->nodes[node].childs = TRIE_NONE;
+  } else if (childBlockClass(count) != childBlockClass(count - 1)) {
+    // Capacity of every class differs from the previous one by a capacity of
+    // some class, so the rest of the block is a valid free block.
+    int oldCapacity = childBlockCapacity[childBlockClass(count)];
+    int newCapacity = childBlockCapacity[childBlockClass(count - 1)];
+    childBlockDelete(trie, block + newCapacity,
+                     childBlockClass(oldCapacity - newCapacity));
+  }
+
+  return true;
+}
+
+/// @brief Kopiuje blok dzieci należący do migawki.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka, który nie należy do migawki.
+/// @return @p true jeśli blok dzieci wierzchołka @p node można zmieniać, @p
+///            false, gdy nie udało się zaalokować pamięci na jego kopię.
+static bool trieOwnBlock(struct Trie *trie, TrieIndex node) {
+  TrieIndex block = trie->nodes[node].childs;
+  if (!childBlockFrozen(trie, block))
+    return true;
+
+  int count = bitCount(trie->nodes[node].childMask);
+  TrieIndex newBlock = childBlockNew(trie, childBlockClass(count));
+  if (newBlock == TRIE_NONE)
+    return false;
+
+  memcpy(trie->slots + newBlock, trie->slots + block,
+         sizeof(TrieIndex) * count);
+  trie->nodes[node].childs = newBlock;
+  return true;
+}
+
+/// @brief Kopiuje dziecko należące do migawki.
+/// Gdy dziecko wierzchołka @p node dla cyfry @p digit należy do migawki,
+/// zastępuje je w drzewie jego kopią. Kopia współdzieli z oryginałem blok
+/// dzieci i listę wartości.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka, który nie należy do migawki.
+/// @param[in] digit – cyfra, pod którą znajduje się dziecko.
+/// @return Indeks dziecka, które można zmieniać, lub @ref TRIE_NONE, gdy nie
+///         udało się zaalokować pamięci.
+static TrieIndex trieOwnChild(struct Trie *trie, TrieIndex node, int digit) {
+  TrieIndex child = trieChild(trie, node, digit);
+  assert(child != TRIE_NONE);
+  if (!trieNodeFrozen(trie, child))
+    return child;
+
+  // A block of a node that is not frozen can hold only frozen children, if
+  // it is frozen itself.
+  TrieIndex copy;
+  if (!trieOwnBlock(trie, node) || (copy = trieNodeNew(trie)) == TRIE_NONE)
+    return TRIE_NONE;
+
+  unsigned int mask = trie->nodes[node].childMask;
+  trie->nodes[copy] = trie->nodes[child];
+  trie->slots[trie->nodes[node].childs +
+              bitCount(mask & ((1u << digit) - 1))] = copy;
+  return copy;
+}
+
+/// @brief Porównuje etykietę wierzchołka z napisem.
+/// @param[in] node – wskaźnik na wierzchołek.
+/// @param[in] text – porównywany napis.
+/// @return Długość najdłuższego wspólnego prefiksu etykiety wierzchołka @p
+///         node i napisu @p text.
+static int trieLabelMatch(const struct TrieNode *node, const char *text) {
+  int result = 0;
+  while (result < node->labelLength &&
+         text[result] - '0' == trieLabelDigit(node, result))
+    result++;
+
+  return result;
+}
+
+/// @brief Koduje etykietę.
+/// @param[in] text – napis, którego początek staje się etykietą.
+/// @param[in] length – liczba cyfr etykiety, co najwyżej @ref
+///                     TRIE_LABEL_CAPACITY.
+/// @return Etykieta złożona z pierwszych @p length znaków @p text.
+static uint64_t trieLabelFromText(const char *text, int length) {
+  assert(inRange(length, 0, TRIE_LABEL_CAPACITY));
+
+  uint64_t result = 0;
+  for (int i = 0; i < length; ++i)
+    result |= (uint64_t)(text[i] - '0') << (4 * i);
+
+  return result;
+}
+
+/// @brief Dzieli krawędź prowadzącą do wierzchołka.
+/// Wstawia nowy wierzchołek bez wartości na krawędzi prowadzącej od @p parent
+/// do jego dziecka @p child, po pierwszych @p position cyfrach jej etykiety.
+/// Może przesunąć tablice drzewa.
+/// @param[in,out] trie – drzewo, w którym leży krawędź.
+/// @param[in] parent – indeks ojca dzielonej krawędzi.
+/// @param[in] child – indeks dziecka dzielonej krawędzi.
+/// @param[in] position – długość etykiety nowego wierzchołka, większa od zera i
+///                       mniejsza od długości etykiety @p child.
+/// @return Indeks nowego wierzchołka, lub @ref TRIE_NONE, gdy nie udało się
+///         zaalokować pamięci. Wtedy drzewo pozostaje niezmienione.
+static TrieIndex trieSplitEdge(struct Trie *trie, TrieIndex parent,
+                               TrieIndex child, int position) {
+  assert(inRange(position, 1, trie->nodes[child].labelLength - 1));
+
+  TrieIndex middle = trieNodeNew(trie);
+  if (middle == TRIE_NONE)
+    return TRIE_NONE;
+
+  int firstDigit = trieLabelDigit(&trie->nodes[child], 0);
+  if (!trieAttachChild(trie, middle,
+                       trieLabelDigit(&trie->nodes[child], position), child)) {
+    trieNodeDelete(trie, middle);
+    return TRIE_NONE;
+  }
+
+  struct TrieNode *middleNode = &trie->nodes[middle];
+  struct TrieNode *childNode = &trie->nodes[child];
+  middleNode->labelLength = position;
+  middleNode->label = childNode->label & ((UINT64_C(1) << (4 * position)) - 1);
+  childNode->labelLength -= position;
+  childNode->label >>= 4 * position;
+
+  // The middle node starts with the same digit, so it takes the same place
+  // in the parent's packed array.
+  unsigned int parentMask = trie->nodes[parent].childMask;
+  trie->slots[trie->nodes[parent].childs +
+              bitCount(parentMask & ((1u << firstDigit) - 1))] = middle;
+
+  return middle;
+}
+
+/// @brief Scala wierzchołek z jedynym dzieckiem.
+/// Jeśli wierzchołek @p node nie jest korzeniem, nie ma wartości, ma dokładnie
+/// jedno dziecko i ich etykiety mieszczą się razem w jednej, to przejmuje on
+/// etykietę, wartość i dzieci tego dziecka, a samo dziecko zostaje usunięte. W
+/// przeciwnym wypadku nic nie robi.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka, który nie należy do migawki.
+static void trieMergeWithChild(struct Trie *trie, TrieIndex node) {
+  struct TrieNode *parentNode = &trie->nodes[node];
+  if (node == TRIE_ROOT || parentNode->data ||
+      bitCount(parentNode->childMask) != 1)
+    return;
+
+  TrieIndex child = trie->slots[parentNode->childs];
+  struct TrieNode *childNode = &trie->nodes[child];
+  if (parentNode->labelLength + childNode->labelLength > TRIE_LABEL_CAPACITY)
+    return;
+
+  childBlockDelete(trie, parentNode->childs, childBlockClass(1));
+  parentNode->label |= childNode->label << (4 * parentNode->labelLength);
+  parentNode->labelLength += childNode->labelLength;
+  parentNode->childMask = childNode->childMask;
+  parentNode->childs = childNode->childs;
+  parentNode->data = childNode->data;
+
+  // A frozen child keeps its fields, which are now shared with the parent.
+  if (!trieNodeFrozen(trie, child)) {
+    childNode->childMask = 0;
+    childNode->childs = TRIE_NONE;
+    childNode->data = NULL;
+    trieNodeDelete(trie, child);
+  }
+}
+
+/// @brief Usuwa wierzchołek, którego dzieci zostały już zapamiętane.
+/// Zwalnia blok dzieci i wartości wierzchołka, a jeśli nie jest on korzeniem,
+/// także sam wierzchołek. Wierzchołki i wartości należące do migawek nie są
+/// zmieniane.
+/// @param[in,out] allocator – pamięć, do której wracają usunięte wartości.
+/// @param[in,out] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] current – indeks usuwanego wierzchołka.
+/// @param[in,out] linked – drzewo, z którego usuwane są powiązane wpisy
+///                         usuwanych wartości, lub @p NULL.
+static void trieFreeNode(struct TrieAllocator *allocator, struct Trie *trie,
+                         TrieIndex current, struct Trie *linked) {
+  struct TrieNode *node = &trie->nodes[current];
+  int count = bitCount(node->childMask);
+  if (count > 0)
+    childBlockDelete(trie, node->childs, childBlockClass(count));
+
+  if (linked)
+    for (struct DataNode *data = node->data; data; data = data->next)
+      if (data->link)
+        trieRemoveEntry(allocator, linked, dataNodeText(data), data->link);
+
+  dataNodeDelete(allocator, node->data);
+  if (trieNodeFrozen(trie, current))
+    return;
+
+  node->childMask = 0;
+  node->childs = TRIE_NONE;
+  node->data = NULL;
+
+  if (current != TRIE_ROOT)
+    trieNodeDelete(trie, current);
+}
+
+/// @brief Całkowicie usuwa poddrzewo rekurencyjnie.
+/// Działa jak @ref trieFreeSubtree, ale nie potrzebuje pamięci na stos, a
+/// głębokość rekurencji jest ograniczona długością najdłuższego napisu w
+/// poddrzewie.
+/// @param[in,out] allocator – pamięć, do której wracają usunięte wartości.
+/// @param[in,out] trie – drzewo, w którym leży poddrzewo.
+/// @param[in] rootToDelete – indeks korzenia usuwanego poddrzewa.
+/// @param[in,out] linked – drzewo, z którego usuwane są powiązane wpisy
+///                         usuwanych wartości, lub @p NULL.
+static void trieFreeSubtreeRecursive(struct TrieAllocator *allocator,
+                                     struct Trie *trie, TrieIndex rootToDelete,
+                                     struct Trie *linked) {
+  int count = bitCount(trie->nodes[rootToDelete].childMask);
+  for (int i = 0; i < count; ++i)
+    trieFreeSubtreeRecursive(
+        allocator, trie, trie->slots[trie->nodes[rootToDelete].childs + i],
+        linked);
+
+  trieFreeNode(allocator, trie, rootToDelete, linked);
+}
+
 /// @brief Całkowicie usuwa poddrzewo.
 /// Całkowicie usuwa wkazywane przez @p rootToDelete poddrzewo. Usuwa wszystkie
-/// dane z drzewa, łącznie z wartościami w węzłach, ale nawet jeśli @p
-/// rootToDelete nie jest korzeniem drzewa, i posiada ojca, nie zmienia reszty
+/// dane z drzewa, łącznie z wartościami w węzłach, ale nie zmienia reszty
 /// drzewa. To znaczy, że jeśli wywołujący funkcje usuwa tylko część swojej
-/// struktury Trie, musi zadbać o to, żeby wartości @ref TrieNode.nonNullChilds
-/// oraz @ref TrieNode.childs w przodkach korzenia usuwanego poddrzewa zostały
-/// zaktualizowane.
-/// @param[in] rootToDelete – wskaźnik na korzeń usuwanego poddrzewa.
-static void trieFreeSubtree(struct TrieNode *rootToDelete) {
-  for (int i = 0; i < ALPHABET_SIZE; ++i)
-    if (rootToDelete->childs[i])
-      trieFreeSubtree(rootToDelete->childs[i]);
+/// struktury Trie, musi wcześniej odpiąć @p rootToDelete od ojca. Korzeń
+/// drzewa jest jedynie czyszczony. Wierzchołki i wartości należące do migawek
+/// nie są zmieniane. Przechodzi drzewo bez rekurencji; gdy zabraknie pamięci
+/// na stos, pozostałe poddrzewa usuwa rekurencyjnie, więc nigdy nie zawodzi.
+/// @param[in,out] allocator – pamięć, do której wracają usunięte wartości.
+/// @param[in,out] trie – drzewo, w którym leży poddrzewo.
+/// @param[in] rootToDelete – indeks korzenia usuwanego poddrzewa.
+/// @param[in,out] linked – drzewo, z którego usuwane są powiązane wpisy
+///                         usuwanych wartości, lub @p NULL.
+static void trieFreeSubtree(struct TrieAllocator *allocator, struct Trie *trie,
+                            TrieIndex rootToDelete, struct Trie *linked) {
+  size_t stackSize = 0;
+  size_t stackCapacity = 64;
+  TrieIndex *stack = malloc(sizeof(TrieIndex) * stackCapacity);
+  if (!stack) {
+    trieFreeSubtreeRecursive(allocator, trie, rootToDelete, linked);
+    return;
+  }
+
+  stack[stackSize++] = rootToDelete;
+  while (stackSize > 0) {
+    TrieIndex current = stack[--stackSize];
+    const struct TrieNode *node = &trie->nodes[current];
+    int count = bitCount(node->childMask);
+
+    if (stackSize + count > stackCapacity) {
+      TrieIndex *newStack =
+          realloc(stack, sizeof(TrieIndex) * stackCapacity * 2);
+      if (newStack) {
+        stack = newStack;
+        stackCapacity *= 2;
+      }
+    }
 
-  if (rootToDelete->data) {
-    dataNodeDelete(rootToDelete->data);
-    rootToDelete->data = NULL;
+    // Children that do not fit on the stack are removed right away.
+    for (int i = 0; i < count; ++i) {
+      TrieIndex child = trie->slots[node->childs + i];
+      if (stackSize < stackCapacity)
+        stack[stackSize++] = child;
+      else
+        trieFreeSubtreeRecursive(allocator, trie, child, linked);
+    }
+
+    trieFreeNode(allocator, trie, current, linked);
   }
 
-  free(rootToDelete);
+  free(stack);
+}
+
+void trieAllocatorInit(struct TrieAllocator *allocator) {
+  for (int i = 0; i < DATA_NODE_SIZE_CLASSES; ++i)
+    memoryPoolInit(&allocator->dataNodes[i], dataNodeClassSize(i));
+
+  allocator->version = 0;
+  allocator->frozenVersion = 0;
+  allocator->retired = NULL;
+  allocator->retiredSize = allocator->retiredCapacity = 0;
+}
+
+void trieAllocatorClear(struct TrieAllocator *allocator) {
+  for (int i = 0; i < DATA_NODE_SIZE_CLASSES; ++i)
+    memoryPoolClear(&allocator->dataNodes[i]);
+
+  // Retired values lie in the pools, so only the array is left.
+  free(allocator->retired);
+  allocator->retired = NULL;
+  allocator->retiredSize = allocator->retiredCapacity = 0;
+  allocator->frozenVersion = 0;
 }
 
-struct DataNode *dataNodeNew(const char *text) {
-  struct DataNode *result = malloc(sizeof(struct DataNode));
+void trieAllocatorMerge(struct TrieAllocator *allocator,
+                        struct TrieAllocator *other) {
+  assert(!allocator->frozenVersion && !other->frozenVersion);
+
+  for (int i = 0; i < DATA_NODE_SIZE_CLASSES; ++i)
+    memoryPoolMerge(&allocator->dataNodes[i], &other->dataNodes[i]);
+}
+
+void trieAllocatorFreeze(struct TrieAllocator *allocator) {
+  allocator->frozenVersion = ++allocator->version;
+}
+
+/// @brief Zwraca pamięć wartości do puli.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartość.
+/// @param[in] node – zwalniana wartość.
+static void dataNodeFree(struct TrieAllocator *allocator,
+                         struct DataNode *node) {
+  memoryPoolFree(&allocator->dataNodes[node->sizeClass], node);
+}
+
+void trieAllocatorCollect(struct TrieAllocator *allocator) {
+  for (size_t i = 0; i < allocator->retiredSize; ++i)
+    dataNodeFree(allocator, allocator->retired[i]);
+
+  free(allocator->retired);
+  allocator->retired = NULL;
+  allocator->retiredSize = allocator->retiredCapacity = 0;
+  allocator->frozenVersion = 0;
+}
+
+/// @brief Odkłada wartość należącą do migawki.
+/// Wartość zostanie zwolniona przez @ref trieAllocatorCollect. Gdy nie udało
+/// się zaalokować pamięci na tablicę odłożonych wartości, wartość nie zostanie
+/// zwolniona aż do zwolnienia całej pamięci.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartość.
+/// @param[in] node – wartość usunięta z drzewa.
+static void dataNodeRetire(struct TrieAllocator *allocator,
+                           struct DataNode *node) {
+  if (allocator->retiredSize == allocator->retiredCapacity) {
+    size_t newCapacity =
+        allocator->retiredCapacity ? 2 * allocator->retiredCapacity : 64;
+    struct DataNode **newRetired =
+        realloc(allocator->retired, sizeof(struct DataNode *) * newCapacity);
+    if (!newRetired)
+      return;
+
+    allocator->retired = newRetired;
+    allocator->retiredCapacity = newCapacity;
+  }
+
+  allocator->retired[allocator->retiredSize++] = node;
+}
+
+/// @brief Przydziela strukturę bez napisu.
+/// @param[in,out] allocator – pamięć, z której przydzielana jest struktura.
+/// @param[in] valueSize – liczba bajtów napisu, wliczając jego zakończenie.
+/// @param[in] packed – czy napis będzie spakowany.
+/// @return Wskaźnik na strukturę z niezainicjalizowanym napisem lub NULL, gdy
+///         nie udało się zaalokować pamięci.
+static struct DataNode *dataNodeAlloc(struct TrieAllocator *allocator,
+                                      size_t valueSize, bool packed) {
+  int sizeClass = dataNodeSizeClass(valueSize);
+  struct DataNode *result = memoryPoolAlloc(&allocator->dataNodes[sizeClass]);
   if (result) {
     result->next = NULL;
-    result->text = duplicateStr(text);
-    if (!result->text) {
-      free(result);
-      return NULL;
-    }
+    result->prev = NULL;
+    result->link = NULL;
+    result->version = allocator->version;
+    result->sizeClass = (uint8_t)sizeClass;
+    result->packed = packed;
   }
 
   return result;
 }
 
-void dataNodeDelete(struct DataNode *node_to_delete) {
-  if (node_to_delete) {
-    if (node_to_delete->next)
-      dataNodeDelete(node_to_delete->next);
+struct DataNode *dataNodeNew(struct TrieAllocator *allocator,
+                             const char *text) {
+  size_t textLength = strlen(text);
+  struct DataNode *result = dataNodeAlloc(allocator, textLength + 1, false);
+  if (result)
+    memcpy(result->value, text, textLength + 1);
+
+  return result;
+}
+
+struct DataNode *dataNodeNewPacked(struct TrieAllocator *allocator,
+                                   const char *text) {
+  // Two digits per byte, and half a byte for the end.
+  size_t textLength = strlen(text);
+  struct DataNode *result = dataNodeAlloc(allocator, textLength / 2 + 1, true);
+  if (!result)
+    return NULL;
+
+  unsigned char *write = result->value;
+  for (size_t i = 0; i + 1 < textLength; i += 2)
+    *(write++) = (unsigned char)(((text[i] - '0' + 1) << 4) |
+                                 (text[i + 1] - '0' + 1));
+
+  (*write) = textLength % 2 ? (unsigned char)((text[textLength - 1] - '0' + 1)
+                                              << 4)
+                            : 0;
+  return result;
+}
+
+size_t dataNodeLength(const struct DataNode *node) {
+  if (!node->packed)
+    return strlen(dataNodeText(node));
+
+  size_t bytes = 0;
+  while ((node->value[bytes] & 0xF) != 0)
+    bytes++;
+
+  return 2 * bytes + ((node->value[bytes] >> 4) != 0);
+}
+
+size_t dataNodeCopyText(const struct DataNode *node, char *out) {
+  if (!node->packed) {
+    size_t length = strlen(dataNodeText(node));
+    memcpy(out, node->value, length + 1);
+    return length;
+  }
 
-    free(node_to_delete->text);
-    free(node_to_delete);
+  // Only the last byte may hold fewer than two digits.
+  const unsigned char *read = node->value;
+  char *write = out;
+  for (; ((*read) & 0xF) != 0; ++read) {
+    write[0] = (char)('0' + ((*read) >> 4) - 1);
+    write[1] = (char)('0' + ((*read) & 0xF) - 1);
+    write += 2;
   }
+
+  if (((*read) >> 4) != 0)
+    *(write++) = (char)('0' + ((*read) >> 4) - 1);
+
+  (*write) = '\0';
+  return write - out;
 }
 
-struct TrieNode *trieNodeNew(struct TrieNode *parent) {
-  struct TrieNode *result = malloc(sizeof(struct TrieNode));
+/// @brief Kopiuje strukturę.
+/// Kopia ma ten sam napis, w tej samej postaci, ale nie należy do żadnej
+/// listy ani nie jest z niczym powiązana.
+/// @param[in,out] allocator – pamięć, z której przydzielana jest kopia.
+/// @param[in] node – kopiowana struktura.
+/// @return Wskaźnik na kopię lub NULL, gdy nie udało się zaalokować pamięci.
+static struct DataNode *dataNodeClone(struct TrieAllocator *allocator,
+                                      const struct DataNode *node) {
+  struct DataNode *result = memoryPoolAlloc(
+      &allocator->dataNodes[node->sizeClass]);
   if (result) {
-    for (int i = 0; i < ALPHABET_SIZE; ++i)
-      result->childs[i] = NULL;
-
-    result->data = NULL;
-    result->nonNullChilds = 0;
-    result->parent = parent;
+    memcpy(result, node, dataNodeClassSize(node->sizeClass));
+    result->next = NULL;
+    result->prev = NULL;
+    result->link = NULL;
+    result->version = allocator->version;
   }
 
   return result;
 }
 
-bool dataListContaisEntryThatExists(struct TrieNode *redirectionsRoot,
-                                    struct TrieNode *trieNode) {
-  struct DataNode *currentData = trieNode->data;
+void dataNodeDelete(struct TrieAllocator *allocator,
+                    struct DataNode *node_to_delete) {
+  while (node_to_delete) {
+    struct DataNode *next = node_to_delete->next;
+    if (dataNodeFrozen(allocator, node_to_delete))
+      dataNodeRetire(allocator, node_to_delete);
+    else
+      dataNodeFree(allocator, node_to_delete);
 
-  while (currentData) {
-    if (trieValueUnderPrefixExists(redirectionsRoot, currentData->text, NULL))
-      return true;
-    else {
-      trieNode->data = currentData->next;
-      currentData->next = NULL;
-      dataNodeDelete(currentData);
-      currentData = trieNode->data;
+    node_to_delete = next;
+  }
+}
+
+/// @brief Kopiuje listę wartości należącą do migawki.
+/// Zastępuje listę @p list jej kopią, a oryginały odkłada do zwolnienia przez
+/// @ref trieAllocatorCollect. Powiązane wartości wskazują odtąd na kopie.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartości.
+/// @param[in,out] list – wskaźnik na pierwszy element listy.
+/// @param[in] skip – wartość listy, która nie jest kopiowana, lub @p NULL.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy lista pozostaje niezmieniona.
+static bool dataListCopy(struct TrieAllocator *allocator,
+                         struct DataNode **list, const struct DataNode *skip) {
+  struct DataNode *head = NULL;
+  struct DataNode *tail = NULL;
+
+  for (const struct DataNode *value = *list; value; value = value->next) {
+    if (value == skip)
+      continue;
+
+    struct DataNode *copy = dataNodeClone(allocator, value);
+    if (!copy) {
+      dataNodeDelete(allocator, head);
+      return false;
     }
+
+    copy->link = value->link;
+    copy->prev = tail;
+    if (tail)
+      tail->next = copy;
+    else
+      head = copy;
+
+    tail = copy;
   }
 
-  return false;
+  // Links of values shared with snapshots may change, since snapshots never
+  // follow them.
+  for (struct DataNode *copy = head; copy; copy = copy->next)
+    if (copy->link)
+      copy->link->link = copy;
+
+  dataNodeDelete(allocator, *list);
+  (*list) = head;
+  return true;
 }
 
-bool trieAddText(struct TrieNode *trieRoot, const char *text,
-                 struct DataNode *data, bool append,
+/// @brief Kursor czytający kolejne cyfry napisu struktury z doklejonym końcem.
+struct DataNodeCursor {
+  /// Spakowany napis, lub @p NULL, gdy czytany jest już @ref text.
+  const unsigned char *packed;
+
+  /// Pozycja następnej cyfry w napisie @ref packed.
+  size_t position;
+
+  /// Czytany niespakowany napis: napis struktury lub doklejony koniec.
+  const char *text;
+
+  /// Koniec doklejany po napisie @ref text, lub @p NULL.
+  const char *suffix;
+};
+
+/// @brief Ustawia kursor na początku napisu.
+/// @param[out] cursor – ustawiany kursor.
+/// @param[in] node – struktura, lub @p NULL dla pustego napisu.
+/// @param[in] suffix – koniec doklejany do napisu, lub @p NULL.
+/// @param[in] position – pozycja pierwszej czytanej cyfry, parzysta i nie
+///                       większa od długości spakowanego napisu @p node.
+static inline void dataNodeCursorInit(struct DataNodeCursor *cursor,
+                                      const struct DataNode *node,
+                                      const char *suffix, size_t position) {
+  if (node && node->packed) {
+    (*cursor) = (struct DataNodeCursor){node->value, position,
+                                        suffix ? suffix : "", NULL};
+  } else {
+    assert(position == 0);
+    (*cursor) = (struct DataNodeCursor){
+        NULL, 0, node ? dataNodeText(node) : "", suffix};
+  }
+}
+
+/// @brief Czyta kolejną cyfrę napisu.
+/// @param[in,out] cursor – kursor.
+/// @return Przeczytana cyfra, lub @p '\0' na końcu całości.
+static inline char dataNodeCursorNext(struct DataNodeCursor *cursor) {
+  if (cursor->packed) {
+    unsigned char byte = cursor->packed[cursor->position / 2];
+    unsigned char half = cursor->position % 2 ? byte & 0xF : byte >> 4;
+    if (half != 0) {
+      cursor->position++;
+      return (char)('0' + half - 1);
+    }
+
+    cursor->packed = NULL;
+  }
+
+  while (*cursor->text == '\0' && cursor->suffix) {
+    cursor->text = cursor->suffix;
+    cursor->suffix = NULL;
+  }
+
+  return *cursor->text == '\0' ? '\0' : *(cursor->text++);
+}
+
+int dataNodeConcatCompare(const struct DataNode *first,
+                          const char *firstSuffix,
+                          const struct DataNode *second,
+                          const char *secondSuffix) {
+  // A byte with both halves non-zero holds two digits, and the end of a value
+  // is a zero half, so equal leading bytes are skipped at once. Halves are
+  // digits increased by 1, so the first differing pair of non-zero halves
+  // decides, whatever the suffixes.
+  size_t bytes = 0;
+  if (first && second && first->packed && second->packed) {
+    while (first->value[bytes] == second->value[bytes] &&
+           (first->value[bytes] & 0xF) != 0)
+      bytes++;
+
+    int lhsHigh = first->value[bytes] >> 4, rhsHigh = second->value[bytes] >> 4;
+    int lhsLow = first->value[bytes] & 0xF, rhsLow = second->value[bytes] & 0xF;
+    if (lhsHigh != 0 && rhsHigh != 0 && lhsHigh != rhsHigh)
+      return lhsHigh - rhsHigh;
+    if (lhsHigh == rhsHigh && lhsLow != 0 && rhsLow != 0)
+      return lhsLow - rhsLow;
+  }
+
+  struct DataNodeCursor lhs, rhs;
+  dataNodeCursorInit(&lhs, first, firstSuffix, 2 * bytes);
+  dataNodeCursorInit(&rhs, second, secondSuffix, 2 * bytes);
+  for (;;) {
+    char lhsDigit = dataNodeCursorNext(&lhs);
+    char rhsDigit = dataNodeCursorNext(&rhs);
+    if (lhsDigit != rhsDigit || lhsDigit == '\0')
+      return (unsigned char)lhsDigit - (unsigned char)rhsDigit;
+  }
+}
+
+void dataListSort(struct DataNode **list, const char *suffix) {
+  assert(list);
+
+  bool sorted = true;
+  for (struct DataNode *current = *list; current && current->next && sorted;
+       current = current->next)
+    sorted =
+        dataNodeConcatCompare(current, suffix, current->next, suffix) <= 0;
+
+  if (sorted)
+    return;
+
+  // Bottom-up merge sort: in every pass, neighbouring sorted runs of [width]
+  // elements are merged, until a single run is left. The prev links are
+  // rebuilt along the way.
+  for (size_t width = 1;; width *= 2) {
+    struct DataNode *left = *list;
+    struct DataNode *head = NULL;
+    struct DataNode *tail = NULL;
+    size_t merges = 0;
+
+    while (left) {
+      merges++;
+      struct DataNode *right = left;
+      size_t leftSize = 0;
+      while (leftSize < width && right) {
+        leftSize++;
+        right = right->next;
+      }
+
+      size_t rightSize = width;
+      while (leftSize > 0 || (rightSize > 0 && right)) {
+        struct DataNode *chosen;
+        if (leftSize > 0 &&
+            (rightSize == 0 || !right ||
+             dataNodeConcatCompare(left, suffix, right, suffix) <= 0)) {
+          chosen = left;
+          left = left->next;
+          leftSize--;
+        } else {
+          chosen = right;
+          right = right->next;
+          rightSize--;
+        }
+
+        if (tail)
+          tail->next = chosen;
+        else
+          head = chosen;
+
+        chosen->prev = tail;
+        tail = chosen;
+      }
+
+      left = right;
+    }
+
+    tail->next = NULL;
+    (*list) = head;
+    if (merges <= 1)
+      return;
+  }
+}
+
+bool trieInit(struct Trie *trie) {
+  (*trie) = (struct Trie){.nodes = NULL,
+                          .nodesSize = 0,
+                          .nodesCapacity = 0,
+                          .freeNodes = TRIE_NONE,
+                          .slots = NULL,
+                          // The first slot is never used, so that TRIE_NONE
+                          // never is a valid block.
+                          .slotsSize = 1,
+                          .slotsCapacity = 0};
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i)
+    trie->freeSlots[i] = TRIE_NONE;
+
+  if (!trieReserve((void **)&trie->slots, &trie->slotsCapacity,
+                   TRIE_INITIAL_CAPACITY, sizeof(TrieIndex)) ||
+      trieNodeNew(trie) != TRIE_ROOT) {
+    trieFree(trie);
+    return false;
+  }
+
+  return true;
+}
+
+void trieFree(struct Trie *trie) {
+  free(trie->nodes);
+  free(trie->slots);
+  trie->nodes = NULL;
+  trie->slots = NULL;
+  trie->nodesSize = trie->nodesCapacity = 0;
+  trie->slotsSize = trie->slotsCapacity = 0;
+}
+
+TrieIndex trieDescend(const struct Trie *trie, TrieIndex node,
+                      const char *text, int *labelLength) {
+  int currentBranchIdx = text[0] - '0';
+  assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+
+  TrieIndex child = trieChild(trie, node, currentBranchIdx);
+  if (child == TRIE_NONE)
+    return TRIE_NONE;
+
+  const struct TrieNode *childNode = &trie->nodes[child];
+  if (trieLabelMatch(childNode, text) < childNode->labelLength)
+    return TRIE_NONE;
+
+  (*labelLength) = childNode->labelLength;
+  return child;
+}
+
+/// @brief Znajduje wierzchołek pod prefiksem.
+/// @param[in] trie – przeszukiwane drzewo.
+/// @param[in] text – szukany prefiks.
+/// @return Indeks wierzchołka pod prefiksem @p text, lub @ref TRIE_NONE, gdy
+///         takiego nie ma w drzewie (w szczególności, gdy @p text kończy się
+///         w środku etykiety krawędzi).
+static TrieIndex trieFind(const struct Trie *trie, const char *text) {
+  TrieIndex currentNode = TRIE_ROOT;
+
+  while ((*text) != '\0') {
+    int labelLength;
+    currentNode = trieDescend(trie, currentNode, text, &labelLength);
+    if (currentNode == TRIE_NONE)
+      return TRIE_NONE;
+
+    text += labelLength;
+  }
+
+  return currentNode;
+}
+
+/// @brief Kopiuje ścieżkę należącą do migawki.
+/// Działa jak @ref trieFind, ale po drodze zastępuje kopiami wszystkie
+/// wierzchołki należące do migawki, więc znaleziony wierzchołek i wszystkie
+/// wierzchołki nad nim można zmieniać. Gdy zabraknie pamięci, część ścieżki
+/// może zostać skopiowana, co nie zmienia zawartości drzewa.
+/// @param[in,out] trie – przeszukiwane drzewo.
+/// @param[in] text – szukany prefiks.
+/// @param[in] length – długość prefiksu, prowadzącego do wierzchołka.
+/// @param[out] node – indeks wierzchołka pod prefiksem; może nim być korzeń.
+/// @return @p true jeśli wierzchołek został znaleziony, @p false, gdy takiego
+///            nie ma w drzewie lub nie udało się zaalokować pamięci.
+static bool trieOwnPath(struct Trie *trie, const char *text, size_t length,
+                        TrieIndex *node) {
+  TrieIndex currentNode = TRIE_ROOT;
+
+  for (size_t depth = 0; depth < length;) {
+    int labelLength;
+    if (trieDescend(trie, currentNode, text + depth, &labelLength) ==
+        TRIE_NONE)
+      return false;
+
+    currentNode = trieOwnChild(trie, currentNode, text[depth] - '0');
+    if (currentNode == TRIE_NONE)
+      return false;
+
+    depth += labelLength;
+  }
+
+  (*node) = currentNode;
+  return true;
+}
+
+bool trieAddText(struct TrieAllocator *allocator, struct Trie *trie,
+                 const char *text, struct DataNode *data, bool insert,
                  struct DataNode **prevData) {
-  assert(trieRoot);
+  assert(trie);
   assert(text);
   assert(data);
 
-  struct TrieNode *currentNode = trieRoot;
+  TrieIndex currentNode = TRIE_ROOT;
 
-  for (int i = 0; text[i] != '\0'; ++i) {
-    int currentBranchIdx = text[i] - '0';
+  while ((*text) != '\0') {
+    int currentBranchIdx = (*text) - '0';
     assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
 
-    struct TrieNode *nextNode = currentNode->childs[currentBranchIdx];
-    // If the node doesn't exist create it before going there.
-    if (!nextNode) {
-      nextNode = trieNodeNew(currentNode);
+    TrieIndex nextNode = trieChild(trie, currentNode, currentBranchIdx);
+    // If the node doesn't exist create it before going there. Its label takes
+    // as much of the remaining text as it can.
+    if (nextNode == TRIE_NONE) {
+      nextNode = trieNodeNew(trie);
 
-      if (!nextNode)
+      if (nextNode == TRIE_NONE)
         return false; // An error has occured. Memory not allocated!
 
-      currentNode->childs[currentBranchIdx] = nextNode;
-      currentNode->nonNullChilds++;
+      int labelLength = 0;
+      while (labelLength < TRIE_LABEL_CAPACITY && text[labelLength] != '\0')
+        labelLength++;
+
+      trie->nodes[nextNode].labelLength = labelLength;
+      trie->nodes[nextNode].label = trieLabelFromText(text, labelLength);
+
+      if (!trieAttachChild(trie, currentNode, currentBranchIdx, nextNode)) {
+        trieNodeDelete(trie, nextNode);
+        return false;
+      }
+    } else {
+      // The whole path changes, so the nodes shared with snapshots are copied.
+      if (trieNodeFrozen(trie, nextNode) &&
+          (nextNode = trieOwnChild(trie, currentNode, currentBranchIdx)) ==
+              TRIE_NONE)
+        return false;
+
+      // If the text leaves the edge in the middle, split it there.
+      int matched = trieLabelMatch(&trie->nodes[nextNode], text);
+      if (matched < trie->nodes[nextNode].labelLength) {
+        nextNode = trieSplitEdge(trie, currentNode, nextNode, matched);
+
+        if (nextNode == TRIE_NONE)
+          return false;
+      }
     }
 
+    text += trie->nodes[nextNode].labelLength;
     currentNode = nextNode;
   }
 
-  // If there is no data, append and replace do the same thing.
-  if (!currentNode->data) {
-    currentNode->data = data;
+  struct TrieNode *node = &trie->nodes[currentNode];
+
+  // Values shared with snapshots cannot be linked with the new one.
+  if (insert && node->data && dataNodeFrozen(allocator, node->data) &&
+      !dataListCopy(allocator, &node->data, NULL))
+    return false;
 
-    if (!append)
+  // If there is no data, insert and replace do the same thing.
+  if (!node->data) {
+    node->data = data;
+    data->prev = NULL;
+
+    if (!insert)
       (*prevData) = NULL;
   } else {
-    if (append) {
-      struct DataNode *current = currentNode->data;
-      while (current->next)
-        current = current->next;
-      current->next = data;
+    if (insert) {
+      // The order of the list does not matter, so the new value becomes its
+      // head, which does not depend on the length of the list.
+      data->next = node->data;
+      data->prev = NULL;
+      node->data->prev = data;
+      node->data = data;
     } else {
       // We first save the prevous data in the prevData variable and then
       // insert a new one.
-      (*prevData) = currentNode->data;
-      currentNode->data = data;
+      (*prevData) = node->data;
+      node->data = data;
     }
   }
 
   return true;
 }
 
-void trieDeleteSubtree(struct TrieNode *treeRoot,
-                       struct TrieNode *rootToDelete) {
-  if (treeRoot == rootToDelete)
-    trieFreeSubtree(rootToDelete);
-  else {
-    // Cannot move to root, but move upwards unless there is a value in the
-    // node, or there is more than one child.
-    while (rootToDelete->parent != treeRoot &&
-           rootToDelete->parent->nonNullChilds == 1 &&
-           !rootToDelete->parent->data) {
-      rootToDelete = rootToDelete->parent;
+/// Kontekst przygotowania usunięcia powiązanych wpisów poddrzewa.
+struct TriePrepareContext {
+  /// Pamięć wartości obu drzew.
+  struct TrieAllocator *allocator;
+
+  /// Drzewo, w którym leżą powiązane wpisy.
+  struct Trie *linked;
+
+  /// Czy wszystkie dotychczasowe wpisy zostały przygotowane.
+  bool prepared;
+};
+
+/// @brief Przygotowuje usunięcie wpisu powiązanego z wartością.
+/// Wywoływana przez @ref trieVisitSubtree dla każdej wartości poddrzewa.
+/// @param[in,out] context – wskaźnik na @ref TriePrepareContext.
+/// @param[in] data – wartość, której powiązany wpis zostanie usunięty.
+static void triePrepareLinked(void *context, const struct DataNode *data) {
+  struct TriePrepareContext *prepare = context;
+  if (prepare->prepared && data->link)
+    prepare->prepared = triePrepareRemoveEntry(
+        prepare->allocator, prepare->linked, dataNodeText(data));
+}
+
+bool trieDeleteSubtree(struct TrieAllocator *allocator, struct Trie *trie,
+                       const char *prefix, struct Trie *linked) {
+  // Removing linked entries has to succeed once the subtree is detached, so
+  // with snapshots every one of them is prepared first.
+  if (linked && (linked->frozenNodes > 0 || allocator->frozenVersion != 0)) {
+    struct TriePrepareContext context = {allocator, linked, true};
+    if (!trieVisitSubtree(trie, prefix, triePrepareLinked, &context) ||
+        !context.prepared)
+      return false;
+  }
+
+  if (prefix[0] == '\0') {
+    trieFreeSubtree(allocator, trie, TRIE_ROOT, linked);
+    return true;
+  }
+
+  // Cannot cut off the root, but cut as high as possible: right below the
+  // deepest node on the path, that has a value or more than one child.
+  TrieIndex cutNode = TRIE_ROOT;
+  size_t cutDepth = 0;
+  int cutBranchIdx = prefix[0] - '0';
+  TrieIndex currentNode = TRIE_ROOT;
+  size_t depth = 0;
+
+  while (true) {
+    int currentBranchIdx = prefix[depth] - '0';
+    assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+
+    TrieIndex nextNode = trieChild(trie, currentNode, currentBranchIdx);
+    if (nextNode == TRIE_NONE)
+      return true;
+
+    // The prefix may end in the middle of an edge; then the whole subtree
+    // below that edge is removed.
+    int matched = trieLabelMatch(&trie->nodes[nextNode], prefix + depth);
+    if (matched < trie->nodes[nextNode].labelLength &&
+        prefix[depth + matched] != '\0')
+      return true;
+
+    if (trie->nodes[currentNode].data ||
+        bitCount(trie->nodes[currentNode].childMask) > 1) {
+      cutNode = currentNode;
+      cutDepth = depth;
+      cutBranchIdx = currentBranchIdx;
     }
 
-    // Update the number of childs of the parent node, and find an index to
-    // the current node.
-    rootToDelete->parent->nonNullChilds--;
-    int idxInParent = -1;
-    for (int i = 0; i < ALPHABET_SIZE; ++i)
-      if (rootToDelete->parent->childs[i] == rootToDelete) {
-        idxInParent = i;
-        break;
+    depth += matched;
+    if (prefix[depth] == '\0')
+      break;
+
+    currentNode = nextNode;
+  }
+
+  // Only the path down to the cut changes, so only that part is copied.
+  if (trie->frozenNodes > 0 && !trieOwnPath(trie, prefix, cutDepth, &cutNode))
+    return false;
+
+  TrieIndex rootToDelete = trieChild(trie, cutNode, cutBranchIdx);
+  if (!trieDetachChild(trie, cutNode, cutBranchIdx))
+    return false;
+
+  trieFreeSubtree(allocator, trie, rootToDelete, linked);
+
+  // A node that had two children might now be a plain part of an edge.
+  trieMergeWithChild(trie, cutNode);
+  return true;
+}
+
+bool trieVisitSubtree(const struct Trie *trie, const char *prefix,
+                      void (*visit)(void *context,
+                                    const struct DataNode *data),
+                      void *context) {
+  assert(trie);
+  assert(prefix);
+
+  // The subtree starts at the highest node below the end of the prefix, which
+  // may end in the middle of its edge.
+  TrieIndex subtreeRoot = TRIE_ROOT;
+  size_t depth = 0;
+  while (prefix[depth] != '\0') {
+    subtreeRoot = trieChild(trie, subtreeRoot, prefix[depth] - '0');
+    if (subtreeRoot == TRIE_NONE)
+      return true;
+
+    int matched = trieLabelMatch(&trie->nodes[subtreeRoot], prefix + depth);
+    if (matched < trie->nodes[subtreeRoot].labelLength &&
+        prefix[depth + matched] != '\0')
+      return true;
+
+    depth += matched;
+  }
+
+  size_t stackSize = 0;
+  size_t stackCapacity = 64;
+  TrieIndex *stack = malloc(sizeof(TrieIndex) * stackCapacity);
+  if (!stack)
+    return false;
+
+  stack[stackSize++] = subtreeRoot;
+  while (stackSize > 0) {
+    const struct TrieNode *node = &trie->nodes[stack[--stackSize]];
+    int count = bitCount(node->childMask);
+
+    if (stackSize + count > stackCapacity) {
+      TrieIndex *newStack =
+          realloc(stack, sizeof(TrieIndex) * stackCapacity * 2);
+      if (!newStack) {
+        free(stack);
+        return false;
       }
 
-    assert(idxInParent >= 0);
-    assert(rootToDelete->parent->nonNullChilds > 0 ||
-           rootToDelete->parent->data || rootToDelete->parent == treeRoot);
+      stack = newStack;
+      stackCapacity *= 2;
+    }
 
-    // NULL-out the referece to the root of the removed subtree,
-    // and now it is save to perform treeFreeSubtree.
-    rootToDelete->parent->childs[idxInParent] = NULL;
-    trieFreeSubtree(rootToDelete);
+    for (int i = 0; i < count; ++i)
+      stack[stackSize++] = trie->slots[node->childs + i];
+
+    for (const struct DataNode *data = node->data; data; data = data->next)
+      visit(context, data);
   }
+
+  free(stack);
+  return true;
+}
+
+bool triePrepareRemoveEntry(struct TrieAllocator *allocator,
+                            struct Trie *trie, const char *text) {
+  if (trie->frozenNodes == 0 && allocator->frozenVersion == 0)
+    return true;
+
+  // Copies of the path and of the list do not change the contents, so if
+  // one of them fails, the part that was copied may stay.
+  TrieIndex currentNode;
+  if (!trieOwnPath(trie, text, strlen(text), &currentNode))
+    return false;
+
+  struct TrieNode *node = &trie->nodes[currentNode];
+  return !node->data || !dataNodeFrozen(allocator, node->data) ||
+         dataListCopy(allocator, &node->data, NULL);
 }
 
-void trieRemoveOneEntry(struct TrieNode *root, const char *text,
-                        const char *entryToRemove) {
-  assert(root);
+const struct DataNode *trieFindData(const struct Trie *trie,
+                                    const char *text) {
+  TrieIndex node = trieFind(trie, text);
+  return node == TRIE_NONE ? NULL : trie->nodes[node].data;
+}
+
+void trieRemoveEntry(struct TrieAllocator *allocator, struct Trie *trie,
+                     const char *text, struct DataNode *entry) {
+  assert(trie);
   assert(text);
-  assert(entryToRemove);
+  assert(entry);
 
-  struct TrieNode *currentNode = root;
+  // A list shared with snapshots is never changed, so it must have been
+  // replaced by a copy in advance.
+  assert(!dataNodeFrozen(allocator, entry));
 
-  for (const char *currentChar = text; (*currentChar) != '\0'; currentChar++) {
-    int currentBranchIdx = (*currentChar) - '0';
-    assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+  if (entry->next)
+    entry->next->prev = entry->prev;
 
-    if (!currentNode->childs[currentBranchIdx]) {
-      assert(!"This assumes that [text] matches the TRIE!");
-      return;
+  // Only the head of the list is referenced from the tree, so unless this is
+  // the head, there is no need to look for the node.
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+    entry->next = NULL;
+    dataNodeDelete(allocator, entry);
+    return;
+  }
+
+  // A prepared path has been copied already, so owning it only finds the node.
+  TrieIndex currentNode = TRIE_NONE;
+  if (trie->frozenNodes == 0)
+    currentNode = trieFind(trie, text);
+  else if (!trieOwnPath(trie, text, strlen(text), &currentNode))
+    currentNode = TRIE_NONE;
+
+  if (currentNode == TRIE_NONE || trie->nodes[currentNode].data != entry) {
+    assert(!"This assumes that [entry] exists in the trie under [text]");
+    return;
+  }
+
+  struct TrieNode *node = &trie->nodes[currentNode];
+  node->data = entry->next;
+  entry->next = NULL;
+  dataNodeDelete(allocator, entry);
+
+  if (!node->data) {
+    if (node->childMask == 0)
+      trieDeleteSubtree(allocator, trie, text, NULL);
+    else
+      trieMergeWithChild(trie, currentNode);
+  }
+}
+
+TrieIndex trieFreeze(struct Trie *trie) {
+  TrieIndex result = trieNodeNew(trie);
+  if (result == TRIE_NONE)
+    return TRIE_NONE;
+
+  trie->nodes[result] = trie->nodes[TRIE_ROOT];
+  trie->frozenNodes = trie->nodesSize;
+  trie->frozenSlots = trie->slotsSize;
+
+  // Free nodes and blocks lie below the marks now, so they cannot be reused
+  // until the next collection.
+  trie->freeNodes = TRIE_NONE;
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i)
+    trie->freeSlots[i] = TRIE_NONE;
+
+  return result;
+}
+
+bool trieCollect(struct Trie *trie) {
+  if (trie->frozenNodes == 0 && trie->frozenSlots == 0)
+    return true;
+
+  uint8_t *nodesUsed = calloc((size_t)trie->nodesSize + trie->slotsSize, 1);
+  TrieIndex *stack = malloc(sizeof(TrieIndex) * trie->nodesSize);
+  if (!nodesUsed || !stack) {
+    free(nodesUsed);
+    free(stack);
+    return false;
+  }
+
+  // Only the current version is reachable from the root.
+  uint8_t *slotsUsed = nodesUsed + trie->nodesSize;
+  size_t stackSize = 0;
+  nodesUsed[TRIE_ROOT] = 1;
+  slotsUsed[TRIE_NONE] = 1;
+  stack[stackSize++] = TRIE_ROOT;
+
+  while (stackSize > 0) {
+    const struct TrieNode *node = &trie->nodes[stack[--stackSize]];
+    int count = bitCount(node->childMask);
+    if (count == 0)
+      continue;
+
+    memset(slotsUsed + node->childs, 1,
+           childBlockCapacity[childBlockClass(count)]);
+    for (int i = 0; i < count; ++i) {
+      TrieIndex child = trie->slots[node->childs + i];
+      nodesUsed[child] = 1;
+      stack[stackSize++] = child;
+    }
+  }
+
+  trie->frozenNodes = trie->frozenSlots = 0;
+  trie->freeNodes = TRIE_NONE;
+  for (TrieIndex node = trie->nodesSize - 1; node != TRIE_ROOT; --node)
+    if (!nodesUsed[node]) {
+      trie->nodes[node] = (struct TrieNode){.childMask = 0,
+                                            .labelLength = 0,
+                                            .childs = TRIE_NONE,
+                                            .label = 0,
+                                            .data = NULL};
+      trieNodeDelete(trie, node);
+    }
+
+  // Every run of free slots is split into the largest blocks that fit.
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i)
+    trie->freeSlots[i] = TRIE_NONE;
+
+  for (TrieIndex slot = 0; slot < trie->slotsSize;) {
+    if (slotsUsed[slot]) {
+      slot++;
+      continue;
     }
 
-    currentNode = currentNode->childs[currentBranchIdx];
+    TrieIndex runEnd = slot;
+    while (runEnd < trie->slotsSize && !slotsUsed[runEnd])
+      runEnd++;
+
+    while (slot < runEnd) {
+      int blockClass = CHILD_BLOCK_CLASSES - 1;
+      while ((TrieIndex)childBlockCapacity[blockClass] > runEnd - slot)
+        blockClass--;
+
+      childBlockDelete(trie, slot, blockClass);
+      slot += childBlockCapacity[blockClass];
+    }
   }
 
-  struct DataNode *currentData = currentNode->data;
-  struct DataNode *prevData = NULL;
+  free(nodesUsed);
+  free(stack);
+  return true;
+}
 
-  if (!currentData) {
-    assert(
-        !"This assumes that [entryToRemove] exists in the trie under [text]");
-    return;
+/// Poddrzewo, które @ref trieBuildSorted ma jeszcze zbudować.
+struct TrieBuildTask {
+  /// Indeks korzenia poddrzewa, już podpiętego do drzewa.
+  TrieIndex node;
+
+  /// Długość napisu prowadzącego do korzenia poddrzewa.
+  size_t depth;
+
+  /// Indeks pierwszego klucza poddrzewa.
+  size_t first;
+
+  /// Liczba kluczy poddrzewa.
+  size_t count;
+};
+
+/// @brief Zwraca cyfrę klucza sortowania.
+/// @param[in] sortKey – klucz sortowania napisu.
+/// @param[in] position – numer cyfry, mniejszy od @ref TRIE_SORT_KEY_DIGITS.
+/// @return Cyfrę napisu na pozycji @p position powiększoną o 1, lub 0, gdy
+///         napis jest krótszy.
+static int trieSortKeyDigit(uint64_t sortKey, size_t position) {
+  return (int)((sortKey >> (4 * (TRIE_SORT_KEY_DIGITS - 1 - position))) &
+               0xF);
+}
+
+/// @brief Wyznacza długość klucza.
+/// @param[in] key – klucz.
+/// @param[in] sortKey – klucz sortowania @p key.
+/// @return Długość napisu @p key.
+static size_t trieKeyLength(const char *key, uint64_t sortKey) {
+  if (trieSortKeyDigit(sortKey, TRIE_SORT_KEY_DIGITS - 1) != 0)
+    return TRIE_SORT_KEY_DIGITS + strlen(key + TRIE_SORT_KEY_DIGITS);
+
+  size_t result = 0;
+  while (trieSortKeyDigit(sortKey, result) != 0)
+    result++;
+
+  return result;
+}
+
+/// @brief Wyznacza długość wspólnego prefiksu dwóch różnych kluczy.
+/// @param[in] first – pierwszy klucz.
+/// @param[in] firstSortKey – klucz sortowania @p first.
+/// @param[in] second – drugi klucz.
+/// @param[in] secondSortKey – klucz sortowania @p second.
+/// @return Długość najdłuższego wspólnego prefiksu @p first i @p second.
+static size_t trieKeyCommon(const char *first, uint64_t firstSortKey,
+                            const char *second, uint64_t secondSortKey) {
+  size_t result = 0;
+  if (firstSortKey == secondSortKey) {
+    // Different keys are equal only on their first digits.
+    result = TRIE_SORT_KEY_DIGITS;
+    while (first[result] != '\0' && first[result] == second[result])
+      result++;
+  } else {
+    // Keys that differ, differ before the end of the shorter one.
+    while (trieSortKeyDigit(firstSortKey, result) ==
+           trieSortKeyDigit(secondSortKey, result))
+      result++;
   }
 
-  if (!currentData->next) {
-    // If there is only one element in the data, we assert that this the one we
-    // search for, because we assume that this one exists under the prefix in
-    // the Trie.
-    assert(strcmp(currentData->text, entryToRemove) == 0);
-    dataNodeDelete(currentNode->data);
-    currentNode->data = NULL;
+  return result;
+}
 
-    if (currentNode->nonNullChilds == 0)
-      trieDeleteSubtree(root, currentNode);
+bool trieBuildSorted(struct Trie *trie, const char *const *keys,
+                     const uint64_t *sortKeys, struct DataNode *const *values,
+                     size_t count) {
+  assert(trie->nodesSize == 1 && !trie->nodes[TRIE_ROOT].data &&
+         !trie->nodes[TRIE_ROOT].childMask);
 
-    return;
+  size_t *lengths = malloc(sizeof(size_t) * (count + 1));
+  size_t *common = malloc(sizeof(size_t) * (count + 1));
+  size_t stackSize = 0;
+  size_t stackCapacity = 64;
+  struct TrieBuildTask *stack =
+      malloc(sizeof(struct TrieBuildTask) * stackCapacity);
+  bool result = lengths && common && stack;
+
+  // The shape of the tree follows from the lengths of the keys and of their
+  // common prefixes with the previous keys alone.
+  for (size_t i = 0; i < count && result; ++i) {
+    assert(i == 0 || sortKeys[i - 1] <= sortKeys[i]);
+    lengths[i] = trieKeyLength(keys[i], sortKeys[i]);
+    common[i] = i == 0 ? 0
+                       : trieKeyCommon(keys[i - 1], sortKeys[i - 1], keys[i],
+                                       sortKeys[i]);
   }
 
-  /// Search for entryToRemove in the list. We assume it is there!
-  while (currentData) {
-    if (strcmp(currentData->text, entryToRemove) == 0)
+  if (result && count > 0)
+    stack[stackSize++] = (struct TrieBuildTask){
+        .node = TRIE_ROOT, .depth = 0, .first = 0, .count = count};
+
+  while (stackSize > 0 && result) {
+    struct TrieBuildTask task = stack[--stackSize];
+    size_t first = task.first;
+    size_t end = task.first + task.count;
+
+    // Keys are sorted, so the key that ends here is the first one.
+    if (lengths[first] == task.depth)
+      trie->nodes[task.node].data = values[first++];
+
+    // All keys below one child share more than [depth] digits.
+    int childCount = 0;
+    for (size_t i = first; i < end; ++i)
+      if (i == first || common[i] == task.depth)
+        childCount++;
+
+    if (childCount == 0)
+      continue;
+
+    if (stackSize + childCount > stackCapacity) {
+      struct TrieBuildTask *newStack =
+          realloc(stack, sizeof(struct TrieBuildTask) * stackCapacity * 2);
+      if (!newStack) {
+        result = false;
+        break;
+      }
+
+      stack = newStack;
+      stackCapacity *= 2;
+    }
+
+    TrieIndex block = childBlockNew(trie, childBlockClass(childCount));
+    if (block == TRIE_NONE) {
+      result = false;
       break;
+    }
 
-    if (!currentData->next) {
-      assert(!"[entryToremove] was not found at the [text] in the trie!");
-      return;
+    trie->nodes[task.node].childs = block;
+
+    // Children of one node are created one after another, so they lie next
+    // to each other in the nodes array, just like in their block.
+    for (size_t i = first; i < end; block++) {
+      // The label of a child is the common prefix of all of its keys.
+      size_t groupFirst = i;
+      size_t labelEnd = lengths[i];
+      for (i++; i < end && common[i] > task.depth; ++i)
+        if (common[i] < labelEnd)
+          labelEnd = common[i];
+
+      int labelLength = TRIE_LABEL_CAPACITY;
+      if (labelEnd - task.depth < TRIE_LABEL_CAPACITY)
+        labelLength = (int)(labelEnd - task.depth);
+
+      TrieIndex child = trieNodeNew(trie);
+      if (child == TRIE_NONE) {
+        result = false;
+        break;
+      }
+
+      uint64_t label = 0;
+      if (task.depth + labelLength <= TRIE_SORT_KEY_DIGITS) {
+        for (int j = 0; j < labelLength; ++j)
+          label |= (uint64_t)(trieSortKeyDigit(sortKeys[groupFirst],
+                                               task.depth + j) -
+                              1)
+                   << (4 * j);
+      } else {
+        label = trieLabelFromText(keys[groupFirst] + task.depth, labelLength);
+      }
+
+      trie->nodes[child].labelLength = labelLength;
+      trie->nodes[child].label = label;
+      trie->nodes[task.node].childMask |= 1u << (label & 0xF);
+      trie->slots[block] = child;
+
+      stack[stackSize++] =
+          (struct TrieBuildTask){.node = child,
+                                 .depth = task.depth + labelLength,
+                                 .first = groupFirst,
+                                 .count = i - groupFirst};
     }
+  }
 
-    prevData = currentData;
-    currentData = currentData->next;
+  free(lengths);
+  free(common);
+  free(stack);
+  return result;
+}
+
+bool trieGraftPrepare(struct Trie *trie, struct TrieGraft *grafts,
+                      size_t count) {
+  // The roots of the parts are not copied, only their children.
+  uint64_t nodesSize = trie->nodesSize;
+  uint64_t slotsSize = trie->slotsSize;
+  for (size_t i = 0; i < count; ++i) {
+    nodesSize += grafts[i].part->nodesSize - 1;
+    slotsSize += grafts[i].part->slotsSize - 1;
   }
 
-  if (prevData)
-    prevData->next = currentData->next;
-  else
-    currentNode->data = currentData->next;
+  if (!trieReserve((void **)&trie->nodes, &trie->nodesCapacity, nodesSize,
+                   sizeof(struct TrieNode)) ||
+      !trieReserve((void **)&trie->slots, &trie->slotsCapacity, slotsSize,
+                   sizeof(TrieIndex)))
+    return false;
+
+  for (size_t i = 0; i < count; ++i) {
+    const struct Trie *part = grafts[i].part;
+    assert(!part->nodes[TRIE_ROOT].data && part->freeNodes == TRIE_NONE);
 
-  // Use the dataNode deletion funcion, but before, make sure only currentData
-  // is freed.
-  currentData->next = NULL;
-  dataNodeDelete(currentData);
+    grafts[i].nodeBase = trie->nodesSize - 1;
+    grafts[i].slotBase = trie->slotsSize - 1;
+    trie->nodesSize += part->nodesSize - 1;
+    trie->slotsSize += part->slotsSize - 1;
+  }
+
+  // New blocks of the root are taken after all reserved ones.
+  for (size_t i = 0; i < count; ++i)
+    for (int digit = 0; digit < ALPHABET_SIZE; ++digit) {
+      TrieIndex child = trieChild(grafts[i].part, TRIE_ROOT, digit);
+      if (child != TRIE_NONE &&
+          !trieAttachChild(trie, TRIE_ROOT, digit, child + grafts[i].nodeBase))
+        return false;
+    }
 
-  // Because we handled the case when there is only one in a list.
-  assert(currentNode->data);
+  return true;
 }
 
-int trieValueUnderPrefixExists(struct TrieNode *root, const char *prefix,
-                               const char *value) {
-  struct TrieNode *currentNode = root;
+void trieGraftCopy(struct Trie *trie, const struct TrieGraft *graft) {
+  const struct Trie *part = graft->part;
 
-  for (const char *currentChar = prefix; (*currentChar) != '\0';
-       currentChar++) {
-    int currentBranchIdx = (*currentChar) - '0';
-    currentNode = currentNode->childs[currentBranchIdx];
-    if (!currentNode)
-      return 0;
+  for (TrieIndex i = 1; i < part->nodesSize; ++i) {
+    struct TrieNode node = part->nodes[i];
+    if (node.childs != TRIE_NONE)
+      node.childs += graft->slotBase;
+
+    trie->nodes[i + graft->nodeBase] = node;
   }
 
-  if (!currentNode)
-    return 0;
+  // Slots past the ends of blocks are never read, so they are copied as is.
+  for (TrieIndex i = 1; i < part->slotsSize; ++i) {
+    TrieIndex child = part->slots[i];
+    if (child != TRIE_NONE && child < part->nodesSize)
+      child += graft->nodeBase;
+
+    trie->slots[i + graft->slotBase] = child;
+  }
+}
 
-  struct DataNode *current = currentNode->data;
-  if (!value)
-    return (current != NULL);
+void trieSnapshotLayout(const struct Trie *trie,
+                        struct SnapshotTrieHeader *header, uint64_t *offset) {
+  header->nodesSize = trie->nodesSize;
+  header->slotsSize = trie->slotsSize;
+  header->freeNodes = trie->freeNodes;
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i)
+    header->freeSlots[i] = trie->freeSlots[i];
 
-  while (current) {
-    if (strcmp(current->text, value) == 0)
-      return 1;
+  header->nodesOffset = (*offset);
+  header->slotsOffset = header->nodesOffset + (uint64_t)trie->nodesSize *
+                                                  sizeof(struct SnapshotNode);
+  header->valuesOffset =
+      header->slotsOffset +
+      snapshotAlign((uint64_t)trie->slotsSize * sizeof(TrieIndex));
 
-    current = current->next;
+  header->valuesSize = 0;
+  header->valuesCount = 0;
+  for (TrieIndex i = 0; i < trie->nodesSize; ++i)
+    for (const struct DataNode *value = trie->nodes[i].data; value;
+         value = value->next) {
+      header->valuesSize += snapshotValueSize(dataNodeLength(value));
+      header->valuesCount++;
+    }
+
+  (*offset) = header->valuesOffset + header->valuesSize;
+}
+
+/// Rozmiar bufora, w którym rozpakowywane są zapisywane napisy.
+#define TRIE_UNPACK_BUFFER_SIZE (256)
+
+/// @brief Zapisuje napis wartości do pliku zrzutu.
+/// Plik zawsze przechowuje napisy niespakowane.
+/// @param[in,out] writer – zapisywany plik.
+/// @param[in] value – wartość.
+/// @param[in] length – długość napisu wartości.
+static void trieSnapshotWriteText(struct SnapshotWriter *writer,
+                                  const struct DataNode *value,
+                                  size_t length) {
+  if (!value->packed) {
+    snapshotWrite(writer, value->value, length + 1);
+    return;
+  }
+
+  // Digits are unpacked piece by piece, together with the final '\0'.
+  struct DataNodeCursor cursor;
+  dataNodeCursorInit(&cursor, value, NULL, 0);
+  char buffer[TRIE_UNPACK_BUFFER_SIZE];
+  size_t used = 0;
+  for (size_t position = 0; position <= length; ++position) {
+    buffer[used++] = dataNodeCursorNext(&cursor);
+    if (used == TRIE_UNPACK_BUFFER_SIZE) {
+      snapshotWrite(writer, buffer, used);
+      used = 0;
+    }
   }
 
-  return 0;
+  snapshotWrite(writer, buffer, used);
+}
+
+void trieSnapshotWrite(const struct Trie *trie,
+                       const struct SnapshotTrieHeader *header,
+                       const uint64_t *links, struct SnapshotWriter *writer) {
+  assert(writer->size == header->nodesOffset);
+  (void)header;
+
+  // Values are written in the order of nodes, so the offset of the first
+  // value of each node is known before any value is written.
+  uint64_t valueOffset = 0;
+  for (TrieIndex i = 0; i < trie->nodesSize; ++i) {
+    const struct TrieNode *node = &trie->nodes[i];
+    struct SnapshotNode record = {.childMask = node->childMask,
+                                  .labelLength = node->labelLength,
+                                  .reserved = 0,
+                                  .childs = node->childs,
+                                  .label = node->label,
+                                  .data = node->data ? valueOffset
+                                                     : SNAPSHOT_NONE};
+
+    for (const struct DataNode *value = node->data; value; value = value->next)
+      valueOffset += snapshotValueSize(dataNodeLength(value));
+
+    snapshotWrite(writer, &record, sizeof(record));
+  }
+
+  snapshotWrite(writer, trie->slots, trie->slotsSize * sizeof(TrieIndex));
+  snapshotWritePadding(writer);
+  assert(writer->size == header->valuesOffset);
+
+  valueOffset = 0;
+  uint64_t valueIdx = 0;
+  for (TrieIndex i = 0; i < trie->nodesSize; ++i)
+    for (const struct DataNode *value = trie->nodes[i].data; value;
+         value = value->next) {
+      size_t length = dataNodeLength(value);
+      uint64_t size = snapshotValueSize(length);
+      assert(length <= UINT32_MAX);
+
+      struct SnapshotValue record = {
+          .next = value->next ? valueOffset + size : SNAPSHOT_NONE,
+          .link = links ? links[valueIdx] : SNAPSHOT_NONE,
+          .length = (uint32_t)length};
+      snapshotWrite(writer, &record, offsetof(struct SnapshotValue, text));
+      trieSnapshotWriteText(writer, value, length);
+      snapshotWritePadding(writer);
+      valueOffset += size;
+      valueIdx++;
+    }
+
+  assert(valueOffset == header->valuesSize);
+}
+
+/// @brief Sprawdza wierzchołek z pliku zrzutu.
+/// @param[in] header – opis drzewa w pliku zrzutu.
+/// @param[in] record – sprawdzany wierzchołek.
+/// @param[in] slots – tablica bloków dzieci drzewa.
+/// @return @p true jeśli etykieta wierzchołka składa się z cyfr, a jego dzieci
+///         leżą w tablicach drzewa, @p false w przeciwnym wypadku.
+static bool trieSnapshotNodeValid(const struct SnapshotTrieHeader *header,
+                                  const struct SnapshotNode *record,
+                                  const TrieIndex *slots) {
+  if ((record->childMask >> ALPHABET_SIZE) != 0 ||
+      record->labelLength > TRIE_LABEL_CAPACITY)
+    return false;
+
+  for (int i = 0; i < record->labelLength; ++i)
+    if (((record->label >> (4 * i)) & 0xF) >= ALPHABET_SIZE)
+      return false;
+
+  // Nodes on the free list keep the index of the next one here.
+  if (record->childMask == 0)
+    return record->childs < header->nodesSize;
+
+  uint64_t end = (uint64_t)record->childs + bitCount(record->childMask);
+  if (record->childs == TRIE_NONE || end > header->slotsSize)
+    return false;
+
+  for (uint64_t slot = record->childs; slot < end; ++slot)
+    if (slots[slot] == TRIE_ROOT || slots[slot] >= header->nodesSize)
+      return false;
+
+  return true;
+}
+
+/// Stan wczytywania wartości drzewa z pliku zrzutu.
+struct TrieSnapshotValues {
+  /// Ciąg wartości drzewa w pliku.
+  const char *records;
+
+  /// Rozmiar ciągu @ref records w bajtach.
+  uint64_t size;
+
+  /// Liczba wartości drzewa zapisana w pliku.
+  uint64_t capacity;
+
+  /// Liczba dotąd wczytanych wartości.
+  uint64_t count;
+
+  /// Tablica na wczytane wartości, lub @p NULL.
+  struct DataNode **values;
+
+  /// Wartości, z którymi powiązane są wczytywane, lub @p NULL.
+  struct DataNode **linked;
+
+  /// Liczba elementów tablicy @ref linked.
+  size_t linkedCount;
+};
+
+/// @brief Wczytuje listę wartości z pliku zrzutu.
+/// @param[in,out] allocator – pamięć, z której przydzielane są wartości.
+/// @param[in,out] state – stan wczytywania wartości drzewa.
+/// @param[in] offset – przesunięcie pierwszej wartości listy, lub @ref
+///                     SNAPSHOT_NONE.
+/// @param[out] list – wskaźnik na pierwszy element wczytanej listy.
+/// @param[in] packed – czy wartości mają być przechowywane spakowane.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy lista jest
+///            niepoprawna lub nie udało się zaalokować pamięci.
+static bool trieSnapshotLoadValues(struct TrieAllocator *allocator,
+                                   struct TrieSnapshotValues *state,
+                                   uint64_t offset, struct DataNode **list,
+                                   bool packed) {
+  struct DataNode *last = NULL;
+  (*list) = NULL;
+
+  while (offset != SNAPSHOT_NONE) {
+    if (offset % SNAPSHOT_ALIGNMENT != 0 || offset >= state->size ||
+        state->size - offset < snapshotValueSize(0) ||
+        state->count == state->capacity)
+      return false;
+
+    const struct SnapshotValue *record =
+        (const struct SnapshotValue *)(state->records + offset);
+    if (record->length == 0 ||
+        snapshotValueSize(record->length) > state->size - offset ||
+        record->text[record->length] != '\0')
+      return false;
+
+    // Every value of the other trie may be linked only once.
+    struct DataNode *link = NULL;
+    if (state->linked) {
+      if (record->link >= state->linkedCount ||
+          !(link = state->linked[record->link]))
+        return false;
+    } else if (record->link != SNAPSHOT_NONE)
+      return false;
+
+    for (uint32_t i = 0; i < record->length; ++i)
+      if (!inRange(record->text[i], '0', '0' + ALPHABET_SIZE - 1))
+        return false;
+
+    // Values of a list are written one after another, so this also rules out
+    // cycles.
+    if (record->next != SNAPSHOT_NONE && record->next <= offset)
+      return false;
+
+    struct DataNode *value = packed ? dataNodeNewPacked(allocator, record->text)
+                                    : dataNodeNew(allocator, record->text);
+    if (!value)
+      return false;
+
+    if (link) {
+      value->link = link;
+      link->link = value;
+      state->linked[record->link] = NULL;
+    }
+
+    value->prev = last;
+    if (last)
+      last->next = value;
+    else
+      (*list) = value;
+
+    if (state->values)
+      state->values[state->count] = value;
+
+    last = value;
+    state->count++;
+    offset = record->next;
+  }
+
+  return true;
+}
+
+/// @brief Oznacza blok dzieci jako zajęty.
+/// @param[in] trie – drzewo, w którym leży blok.
+/// @param[in,out] slotsUsed – znaczniki zajętych pól @ref Trie.slots.
+/// @param[in] block – indeks pierwszego pola bloku.
+/// @param[in] blockClass – klasa bloku.
+/// @return @p true jeśli blok leży w tablicy i żadne jego pole nie było
+///         zajęte, @p false w przeciwnym wypadku.
+static bool trieSnapshotMarkBlock(const struct Trie *trie, uint8_t *slotsUsed,
+                                  TrieIndex block, int blockClass) {
+  int capacity = childBlockCapacity[blockClass];
+  if (block == TRIE_NONE || (uint64_t)block + capacity > trie->slotsSize)
+    return false;
+
+  for (int i = 0; i < capacity; ++i) {
+    if (slotsUsed[block + i])
+      return false;
+
+    slotsUsed[block + i] = 1;
+  }
+
+  return true;
+}
+
+/// @brief Sprawdza kształt wczytanego drzewa.
+/// Sprawdza, czy każdy wierzchołek jest albo osiągalny z korzenia dokładnie
+/// jedną krawędzią, której etykieta zaczyna się jego cyfrą, albo leży na
+/// liście wolnych, oraz czy bloki dzieci i wolne bloki się nie nakładają.
+/// Dzięki temu wczytane drzewo nie ma cykli i może być dalej modyfikowane.
+/// @param[in] trie – wczytane drzewo, którego indeksy zostały już sprawdzone
+///                   przez @ref trieSnapshotNodeValid.
+/// @return @p true jeśli drzewo jest poprawne, @p false, gdy nie jest lub nie
+///         udało się zaalokować pamięci.
+static bool trieSnapshotStructureValid(const struct Trie *trie) {
+  uint8_t *nodesUsed = calloc((size_t)trie->nodesSize + trie->slotsSize, 1);
+  TrieIndex *stack = malloc(sizeof(TrieIndex) * trie->nodesSize);
+  uint8_t *slotsUsed = nodesUsed + trie->nodesSize;
+  bool result = nodesUsed && stack && trie->nodes[TRIE_ROOT].labelLength == 0;
+
+  size_t stackSize = 0;
+  if (result) {
+    nodesUsed[TRIE_ROOT] = 1;
+    stack[stackSize++] = TRIE_ROOT;
+  }
+
+  while (result && stackSize > 0) {
+    TrieIndex node = stack[--stackSize];
+    unsigned int mask = trie->nodes[node].childMask;
+    if (mask == 0)
+      continue;
+
+    result = trieSnapshotMarkBlock(trie, slotsUsed, trie->nodes[node].childs,
+                                   childBlockClass(bitCount(mask)));
+
+    for (int digit = 0; digit < ALPHABET_SIZE && result; ++digit) {
+      TrieIndex child = trieChild(trie, node, digit);
+      if (child == TRIE_NONE)
+        continue;
+
+      const struct TrieNode *childNode = &trie->nodes[child];
+      result = !nodesUsed[child] && childNode->labelLength > 0 &&
+               trieLabelDigit(childNode, 0) == digit;
+      nodesUsed[child] = 1;
+      stack[stackSize++] = child;
+    }
+  }
+
+  // All the other nodes must be on the free list.
+  for (TrieIndex node = trie->freeNodes; result && node != TRIE_NONE;
+       node = trie->nodes[node].childs) {
+    result = !nodesUsed[node] && !trie->nodes[node].childMask &&
+             !trie->nodes[node].data;
+    nodesUsed[node] = 1;
+  }
+
+  for (TrieIndex node = 0; result && node < trie->nodesSize; ++node)
+    result = nodesUsed[node];
+
+  // The next free block is read only after the block is known to fit.
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i) {
+    TrieIndex block = trie->freeSlots[i];
+    while (result && block != TRIE_NONE) {
+      result = trieSnapshotMarkBlock(trie, slotsUsed, block, i);
+      if (result)
+        block = trie->slots[block];
+    }
+  }
+
+  free(nodesUsed);
+  free(stack);
+  return result;
+}
+
+bool trieSnapshotLoad(struct TrieAllocator *allocator, struct Trie *trie,
+                      const struct SnapshotTrieHeader *header,
+                      const char *image, struct DataNode **values,
+                      struct DataNode **linked, size_t linkedCount,
+                      bool packed) {
+  const struct SnapshotNode *records =
+      (const struct SnapshotNode *)(image + header->nodesOffset);
+  const TrieIndex *slots = (const TrieIndex *)(image + header->slotsOffset);
+  struct TrieSnapshotValues state = {.records = image + header->valuesOffset,
+                                     .size = header->valuesSize,
+                                     .capacity = header->valuesCount,
+                                     .count = 0,
+                                     .values = values,
+                                     .linked = linked,
+                                     .linkedCount = linkedCount};
+  (*trie) = (struct Trie){.nodes = NULL,
+                          .nodesSize = 0,
+                          .nodesCapacity = 0,
+                          .freeNodes = header->freeNodes,
+                          .slots = NULL,
+                          .slotsSize = 0,
+                          .slotsCapacity = 0};
+
+  if (trie->freeNodes >= header->nodesSize)
+    return false;
+
+  for (int i = 0; i < CHILD_BLOCK_CLASSES; ++i) {
+    trie->freeSlots[i] = header->freeSlots[i];
+    if (trie->freeSlots[i] >= header->slotsSize)
+      return false;
+  }
+
+  if (!trieReserve((void **)&trie->nodes, &trie->nodesCapacity,
+                   header->nodesSize, sizeof(struct TrieNode)) ||
+      !trieReserve((void **)&trie->slots, &trie->slotsCapacity,
+                   header->slotsSize, sizeof(TrieIndex))) {
+    trieFree(trie);
+    return false;
+  }
+
+  memcpy(trie->slots, slots, header->slotsSize * sizeof(TrieIndex));
+  trie->slotsSize = header->slotsSize;
+
+  for (TrieIndex i = 0; i < header->nodesSize; ++i) {
+    const struct SnapshotNode *record = &records[i];
+    struct TrieNode *node = &trie->nodes[i];
+    (*node) = (struct TrieNode){.childMask = record->childMask,
+                                .labelLength = record->labelLength,
+                                .childs = record->childs,
+                                .label = record->label,
+                                .data = NULL};
+
+    if (!trieSnapshotNodeValid(header, record, slots) ||
+        !trieSnapshotLoadValues(allocator, &state, record->data,
+                                &node->data, packed)) {
+      trieFree(trie);
+      return false;
+    }
+  }
+
+  trie->nodesSize = header->nodesSize;
+  if (state.count != state.capacity || !trieSnapshotStructureValid(trie)) {
+    trieFree(trie);
+    return false;
+  }
+
+  return true;
 }
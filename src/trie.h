@@ -11,143 +11,596 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "mem_pool.h"
+#include "util.h"
 
 /// Makro ustalające maksymalną liczbę dzieci w wierzchołku drzewa Trie.
 #define ALPHABET_SIZE (12)
 
-/// Struktura stanowiąca liste jednostronną napisów przechowywanych w Trie.
-struct DataNode {
-  /// Napis przechowywany w wierzchołku drzewa.
-  char *text;
+/// @brief Liczba klas rozmiarów obiektów DataNode.
+/// Obiekty pierwszych 32 klas zajmują kolejne wielokrotności 8 bajtów, a
+/// każdej następnej dwa razy więcej niż poprzedniej.
+#define DATA_NODE_SIZE_CLASSES (64)
+
+/// @brief Liczba klas rozmiarów bloków dzieci.
+/// Bloki mają pojemność 1, 2, 4, 8 lub 12 dzieci.
+#define CHILD_BLOCK_CLASSES (5)
+
+/// @brief Indeks korzenia drzewa w tablicy @ref Trie.nodes.
+/// Korzeń nie jest dzieckiem żadnego wierzchołka, a pierwszy element tablicy
+/// @ref Trie.slots nigdy nie jest przydzielany, więc ta wartość oznacza
+/// również brak wierzchołka lub bloku.
+#define TRIE_ROOT (0)
+
+/// Wartość oznaczająca brak wierzchołka lub bloku dzieci.
+#define TRIE_NONE TRIE_ROOT
 
+/// Maksymalna liczba cyfr etykiety krawędzi prowadzącej do wierzchołka.
+#define TRIE_LABEL_CAPACITY (16)
+
+/// Liczba początkowych cyfr napisu zakodowanych w kluczu @ref trieSortKey.
+#define TRIE_SORT_KEY_DIGITS (16)
+
+/// Indeks wierzchołka w tablicy @ref Trie.nodes lub pola w @ref Trie.slots.
+typedef uint32_t TrieIndex;
+
+/// Struktura stanowiąca liste dwustronną napisów przechowywanych w Trie.
+struct DataNode {
   /// Wskaźnik na następny element listy, lub @p NULL, gdy ten jest ostatni.
   struct DataNode *next;
+
+  /// Wskaźnik na poprzedni element listy, lub @p NULL, gdy ten jest pierwszy.
+  struct DataNode *prev;
+
+  /// @brief Powiązany wpis w innym drzewie, lub @p NULL.
+  /// Wpis ten leży w drugim drzewie pod napisem @ref value i wskazuje z
+  /// powrotem na tę strukturę. Jest usuwany razem z nią przez @ref
+  /// trieDeleteSubtree.
+  struct DataNode *link;
+
+  /// @brief Wersja, w której powstała struktura.
+  /// Struktury wersji starszych od @ref TrieAllocator.frozenVersion należą też
+  /// do migawek i nie mogą być zmieniane.
+  uint32_t version;
+
+  /// Klasa rozmiaru struktury w @ref TrieAllocator.dataNodes.
+  uint8_t sizeClass;
+
+  /// @brief Czy napis jest spakowany.
+  /// Spakowany napis zajmuje 4 bity na cyfrę: cyfra numer @p i, powiększona
+  /// o 1, leży w starszej połowie bajtu @p i/2 dla parzystych @p i, a w
+  /// młodszej dla nieparzystych. Napis kończy się zerową połową bajtu, więc
+  /// spakowane napisy są uporządkowane tak jak ich bajty.
+  bool packed;
+
+  /// @brief Napis przechowywany w wierzchołku drzewa, trzymany razem ze
+  /// strukturą.
+  /// Zakończony znakiem @p '\0' lub spakowany (@ref packed). Do napisu
+  /// niespakowanego można odwoływać się przez @ref dataNodeText.
+  unsigned char value[];
 };
 
 /// @brief Pojedyńczy wierzchołek Trie.
-/// Ma listę synów, rozmiaru `ALPHABET_SIZE`, wskaźnik na ojca, oraz na obiekt
-/// typu DataNode, jeśli do tego wierzchołka przypisana jest konkretna
-/// wartość. Do tego przechowywana jest wartość, ile dzieci dokładnie znajduje
-/// się w węźle.
+/// Drzewo jest skompresowane: krawędź prowadząca do wierzchołka jest
+/// etykietowana ciągiem do @ref TRIE_LABEL_CAPACITY cyfr, więc ciągi
+/// wierzchołków z jednym dzieckiem i bez wartości są zwinięte w jeden.
+/// Zamiast tablicy @p ALPHABET_SIZE wskaźników na dzieci, wierzchołek
+/// przechowuje maskę bitową istniejących dzieci i indeks spakowanej tablicy
+/// ich indeksów, która ma dokładnie tyle elementów ile bitów jest zapalonych
+/// w masce. Dziecko, którego etykieta zaczyna się cyfrą @p d, leży w tej
+/// tablicy na pozycji równej liczbie zapalonych bitów maski mniejszych od @p d.
 struct TrieNode {
-  /// @brief Informacja ile dzieci ma dany węzeł.
-  /// Pomocna przy usuwaniu, a aktualizowanie jej jest mniej kosztowne, niż
-  /// przechodzenie całej tablicy za każdym razem.
-  int nonNullChilds;
+  /// @brief Maska bitowa dzieci.
+  /// Bit @p d jest zapalony, gdy wierzchołek ma dziecko dla cyfry @p d.
+  uint16_t childMask;
 
-  /// Tablica rozmiaru `ALPHABET_SIZE` dzieci danego węzła.
-  struct TrieNode *childs[ALPHABET_SIZE];
+  /// Liczba cyfr etykiety krawędzi prowadzącej do wierzchołka. W korzeniu 0.
+  uint8_t labelLength;
 
-  /// Wskaźnik na ojca danego wierzchołka.
-  /// Może być @p NULL, gdy np. wierzchołek jest korzeniem drzewa.
-  struct TrieNode *parent;
+  /// @brief Indeks bloku dzieci w @ref Trie.slots.
+  /// Gdy wierzchołek nie ma dzieci ma wartość @ref TRIE_NONE. W wierzchołkach
+  /// na liście wolnych wierzchołków jest to indeks następnego wolnego.
+  TrieIndex childs;
+
+  /// @brief Etykieta krawędzi prowadzącej do wierzchołka.
+  /// Cyfra numer @p i etykiety zajmuje bity od @p 4i do @p 4i+3.
+  uint64_t label;
 
   /// Gdy nie @p NULL, wskazuje na początek listy elementów przypisanych do
   /// danego węzła.
   struct DataNode *data;
 };
 
+/// @brief Drzewo Trie.
+/// Wszystkie wierzchołki drzewa leżą w jednej tablicy i odwołują się do siebie
+/// 32-bitowymi indeksami. Spakowane tablice dzieci leżą w drugiej tablicy,
+/// przydzielane blokami kilku stałych pojemności. Usunięte wierzchołki i bloki
+/// trafiają na listy wolnych i są używane ponownie.
+///
+/// Drzewo może mieć migawki (@ref trieFreeze): korzenie poprzednich wersji,
+/// które współdzielą z bieżącą wszystkie niezmienione wierzchołki. Wierzchołki
+/// i bloki istniejące w chwili ostatniej migawki nie są wtedy zmieniane, tylko
+/// kopiowane razem z całą ścieżką od korzenia (path copying).
+struct Trie {
+  /// Tablica wierzchołków. Korzeń ma indeks @ref TRIE_ROOT.
+  struct TrieNode *nodes;
+
+  /// Liczba użytych elementów tablicy @ref nodes.
+  TrieIndex nodesSize;
+
+  /// Rozmiar zaalokowanej tablicy @ref nodes.
+  TrieIndex nodesCapacity;
+
+  /// Pierwszy wierzchołek listy wolnych, lub @ref TRIE_NONE.
+  TrieIndex freeNodes;
+
+  /// Tablica spakowanych bloków dzieci.
+  TrieIndex *slots;
+
+  /// Liczba użytych elementów tablicy @ref slots.
+  TrieIndex slotsSize;
+
+  /// Rozmiar zaalokowanej tablicy @ref slots.
+  TrieIndex slotsCapacity;
+
+  /// @brief Listy wolnych bloków, po jednej dla każdej klasy pojemności.
+  /// Pierwszy element wolnego bloku jest indeksem następnego.
+  TrieIndex freeSlots[CHILD_BLOCK_CLASSES];
+
+  /// @brief Liczba wierzchołków współdzielonych z migawkami.
+  /// Wierzchołki o mniejszych indeksach, poza korzeniem, nie mogą być
+  /// zmieniane ani zwalniane. Gdy drzewo nie ma migawek, wynosi 0.
+  TrieIndex frozenNodes;
+
+  /// Liczba pól bloków dzieci współdzielonych z migawkami, jak @ref
+  /// frozenNodes.
+  TrieIndex frozenSlots;
+};
+
+/// @brief Pamięć wartości drzew Trie.
+/// Pule, z których przydzielane są wszystkie wartości drzew Trie. Jedna
+/// struktura może być współdzielona przez kilka drzew; zwolnienie jej zwalnia
+/// wszystkie te wartości w czasie proporcjonalnym do liczby bloków pamięci.
+struct TrieAllocator {
+  /// Pule obiektów DataNode, po jednej na każdą klasę rozmiaru.
+  struct MemoryPool dataNodes[DATA_NODE_SIZE_CLASSES];
+
+  /// Wersja nadawana nowym wartościom.
+  uint32_t version;
+
+  /// @brief Najstarsza wersja wartości, które wolno zmieniać.
+  /// Wartości starszych wersji należą też do migawek, więc zamiast je zmieniać
+  /// drzewa kopiują całe ich listy. Gdy nie ma migawek, wynosi 0.
+  uint32_t frozenVersion;
+
+  /// Wartości usunięte z drzew, które mogą należeć do migawek.
+  struct DataNode **retired;
+
+  /// Liczba elementów tablicy @ref retired.
+  size_t retiredSize;
+
+  /// Rozmiar zaalokowanej tablicy @ref retired.
+  size_t retiredCapacity;
+};
+
+/// @brief Inicjalizuje pamięć drzew Trie.
+/// @param[out] allocator – wskaźnik na inicjalizowaną strukturę.
+void trieAllocatorInit(struct TrieAllocator *allocator);
+
+/// @brief Zwalnia całą pamięć drzew Trie.
+/// Wszystkie wartości przydzielone z @p allocator przestają być ważne. Nie
+/// przechodzi po drzewach.
+/// @param[in,out] allocator – wskaźnik na zwalnianą strukturę.
+void trieAllocatorClear(struct TrieAllocator *allocator);
+
+/// @brief Przenosi wszystkie wartości jednej pamięci drzew do drugiej.
+/// Wartości przydzielone z @p other należą odtąd do @p allocator, a @p other
+/// jest pusta.
+/// @param[in,out] allocator – pamięć, do której trafiają wartości.
+/// @param[in,out] other – opróżniana pamięć.
+void trieAllocatorMerge(struct TrieAllocator *allocator,
+                        struct TrieAllocator *other);
+
+/// @brief Zamraża wszystkie wartości.
+/// Od tej chwili wartości przydzielone wcześniej nie są zmieniane ani
+/// zwalniane, dopóki nie zostanie wywołana @ref trieAllocatorCollect.
+/// @param[in,out] allocator – pamięć drzew Trie.
+void trieAllocatorFreeze(struct TrieAllocator *allocator);
+
+/// @brief Zwalnia wartości, które należały tylko do migawek.
+/// Może być wywołana dopiero, gdy wszystkie migawki zostały usunięte, a
+/// drzewa uporządkowane przez @ref trieCollect.
+/// @param[in,out] allocator – pamięć drzew Trie.
+void trieAllocatorCollect(struct TrieAllocator *allocator);
+
 /// @brief Tworzy nową strukturę.
-/// Tworzy nową strukturę zawierającą wskaźnik na kopię napisu @p text.
+/// Tworzy nową strukturę zawierającą kopię napisu @p text.
+/// @param[in,out] allocator – pamięć, z której przydzielana jest struktura.
 /// @param[in] text – tekst jaki ma zawierać nowa struktura.
 /// @return Wskaźnik na nowo utworzoną strukturę lub NULL, gdy nie udało się
 /// zaalokować pamięci.
-struct DataNode *dataNodeNew(const char *text);
+struct DataNode *dataNodeNew(struct TrieAllocator *allocator,
+                             const char *text);
+
+/// @brief Tworzy nową strukturę ze spakowanym napisem.
+/// Działa jak @ref dataNodeNew, ale przechowuje napis spakowany (@ref
+/// DataNode.packed), w połowie miejsca. Wartości drzewa prefiksów nie są
+/// udostępniane na zewnątrz bez kopiowania, więc tylko one są pakowane.
+/// @param[in,out] allocator – pamięć, z której przydzielana jest struktura.
+/// @param[in] text – niepusty napis złożony z cyfr.
+/// @return Wskaźnik na nowo utworzoną strukturę lub NULL, gdy nie udało się
+/// zaalokować pamięci.
+struct DataNode *dataNodeNewPacked(struct TrieAllocator *allocator,
+                                   const char *text);
+
+/// @brief Zwraca niespakowany napis struktury.
+/// @param[in] node – struktura z niespakowanym napisem.
+/// @return Napis przechowywany w strukturze, ważny tak długo jak ona.
+static inline const char *dataNodeText(const struct DataNode *node) {
+  assert(!node->packed);
+  return (const char *)node->value;
+}
+
+/// @brief Zwraca długość napisu struktury.
+/// @param[in] node – struktura.
+/// @return Liczba cyfr napisu przechowywanego w strukturze.
+size_t dataNodeLength(const struct DataNode *node);
+
+/// @brief Kopiuje napis struktury.
+/// Rozpakowuje napis, jeśli jest spakowany.
+/// @param[in] node – struktura.
+/// @param[out] out – miejsce na @ref dataNodeLength(@p node) + 1 znaków, do
+///                   którego trafia napis zakończony znakiem @p '\0'.
+/// @return Liczba cyfr napisu.
+size_t dataNodeCopyText(const struct DataNode *node, char *out);
+
+/// @brief Porównuje napisy dwóch struktur z doklejonymi końcami.
+/// Działa jak @ref concatCompare, ale czyta napisy struktur w każdej postaci,
+/// bez rozpakowywania ich. Spakowane napisy są porównywane po dwie cyfry
+/// naraz, dopóki żaden się nie skończył.
+/// @param[in] first – pierwsza struktura, lub @p NULL dla pustego napisu.
+/// @param[in] firstSuffix – koniec pierwszego napisu, lub @p NULL.
+/// @param[in] second – druga struktura, lub @p NULL dla pustego napisu.
+/// @param[in] secondSuffix – koniec drugiego napisu, lub @p NULL.
+/// @return Liczbę ujemną, zero lub dodatnią, gdy pierwszy napis jest mniejszy
+///         leksykograficznie, równy, lub większy od drugiego.
+int dataNodeConcatCompare(const struct DataNode *first,
+                          const char *firstSuffix,
+                          const struct DataNode *second,
+                          const char *secondSuffix);
 
 /// @brief Usuwa strukturę.
 /// Usuwa całą zawartość struktury, do końca listy. Nic nie robi, jeśli
 /// @p node_to_delete jest @p NULL.
+/// @param[in,out] allocator – pamięć, z której przydzielono strukturę.
 /// @param[in] node_to_delete – Wskaźnik na pierwszy element do usunięcia.
-void dataNodeDelete(struct DataNode *node_to_delete);
-
-/// @brief Sprawdza czy choć jedna wartość przypisana do @p trieNode jest
-/// aktualna. Sprawdza aktualność listy wartości z @p trieNode z drzewem @p
-/// redirectionsRoot. Nieznajdujące się wartości zostają usunięte z listy. Nie
-/// sprawdza całej listy, przerywa sprawdzanie kiedy tylko znajdzie pierwszą
-/// pasującą wartość.
-/// @param [in] redirectionsRoot – wskaźnik na korzeń drzewa, w którym
-///                                szukane wartości.
-/// @param [in] trieNode – Wskaźnika na węzeł drzewa, którego aktualność
-///                        sprawdzamy.
-/// @return @p true jeśli choć jedna wartość z @p trieNode jest aktualna, to
-///            znaczy istnieje wartość pod tym prefiksem w drzewie @p
-///            redirectionsRoot, false w przeciwnym wypadku.
-bool dataListContaisEntryThatExists(struct TrieNode *redirectionsRoot,
-                                    struct TrieNode *trieNode);
+void dataNodeDelete(struct TrieAllocator *allocator,
+                    struct DataNode *node_to_delete);
 
-/// @brief Tworzy nową strukturę.
-/// Tworzy nową strukturę typu TrieNode, ustawiając wkaźnik na ojca
-/// tworzonego wierzchołka w drzewie trie. Wywołujący procedurę musi sam ustawić
-/// wskaźnik @p childs[index] w strukturze @p parent przy dodawaniu tego
-/// wierzchołka do drzewa. Alokuje pamięć, która musi być zwolniona używając
-/// free.
-/// @param[in] parent – wskaźnik na ojca danego wierzchołka, może być @p NULL,
-///                     gdy np. tworzony jest wierzchołek drzewa.
-/// @return Wskaźnik na zaalokowaną strukturę, lub @p NULL, gdy nie udało się
+/// @brief Sortuje listę wartości.
+/// Sortuje listę, której pierwszym elementem jest @p *list, rosnąco według
+/// napisów powstałych z doklejenia @p suffix do tekstu kolejnych elementów.
+/// Nie alokuje pamięci. Gdy lista jest już posortowana, działa w czasie
+/// liniowym.
+/// @param[in,out] list – wskaźnik na pierwszy element listy, zastępowany
+///                       pierwszym elementem posortowanej listy.
+/// @param[in] suffix – napis doklejany do porównywanych wartości.
+void dataListSort(struct DataNode **list, const char *suffix);
+
+/// @brief Tworzy nowe drzewo.
+/// Tworzy puste drzewo, składające się z samego korzenia.
+/// @param[out] trie – wskaźnik na inicjalizowaną strukturę.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci.
+bool trieInit(struct Trie *trie);
+
+/// @brief Zwalnia drzewo.
+/// Zwalnia tablice wierzchołków i bloków dzieci drzewa. Nie zwalnia wartości,
+/// które należą do struktury @ref TrieAllocator.
+/// @param[in,out] trie – wskaźnik na zwalniane drzewo.
+void trieFree(struct Trie *trie);
+
+/// @brief Tworzy migawkę drzewa.
+/// Kopiuje korzeń drzewa i zamraża wszystkie istniejące wierzchołki i bloki
+/// dzieci, więc działa w czasie stałym. Kolejne zmiany drzewa nie zmieniają
+/// drzewa o zwróconym korzeniu. Wartości należy zamrozić osobno, przez @ref
+/// trieAllocatorFreeze.
+/// @param[in,out] trie – drzewo.
+/// @return Indeks korzenia migawki, lub @ref TRIE_NONE, gdy nie udało się
 ///         zaalokować pamięci.
-struct TrieNode *trieNodeNew(struct TrieNode *parent);
+TrieIndex trieFreeze(struct Trie *trie);
+
+/// @brief Zwalnia wierzchołki i bloki, które należały tylko do migawek.
+/// Znajduje wszystkie wierzchołki i bloki osiągalne z korzenia i odbudowuje z
+/// pozostałych listy wolnych. Może być wywołana dopiero, gdy wszystkie
+/// migawki drzewa zostały usunięte.
+/// @param[in,out] trie – drzewo.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy drzewo pozostaje niezmienione.
+bool trieCollect(struct Trie *trie);
+
+/// @brief Zwraca dziecko wierzchołka.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra, od @p 0 do @p ALPHABET_SIZE - 1.
+/// @return Indeks dziecka wierzchołka @p node dla cyfry @p digit, lub @ref
+///         TRIE_NONE, gdy takiego nie ma.
+static inline TrieIndex trieChild(const struct Trie *trie, TrieIndex node,
+                                  int digit) {
+  unsigned int mask = trie->nodes[node].childMask;
+  if (!(mask & (1u << digit)))
+    return TRIE_NONE;
+
+  return trie->slots[trie->nodes[node].childs +
+                     bitCount(mask & ((1u << digit) - 1))];
+}
+
+/// @brief Zwraca cyfrę etykiety wierzchołka.
+/// @param[in] node – wskaźnik na wierzchołek.
+/// @param[in] position – numer cyfry, mniejszy od @ref
+///                       TrieNode.labelLength.
+/// @return Cyfrę etykiety na pozycji @p position.
+static inline int trieLabelDigit(const struct TrieNode *node, int position) {
+  return (int)((node->label >> (4 * position)) & 0xF);
+}
+
+/// @brief Schodzi o jedną krawędź w dół drzewa.
+/// Szuka dziecka wierzchołka @p node, którego cała etykieta jest prefiksem
+/// napisu @p text.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] text – niepusty napis, wzdłuż którego schodzimy.
+/// @param[out] labelLength – długość etykiety znalezionego dziecka, czyli
+///                           liczba znaków @p text, o które zeszliśmy.
+/// @return Indeks znalezionego dziecka, lub @ref TRIE_NONE, gdy takiego nie
+///         ma.
+TrieIndex trieDescend(const struct Trie *trie, TrieIndex node,
+                      const char *text, int *labelLength);
 
 /// @brief Dodaje tekst to Trie.
-/// Dodaje obiekt @p data do Trie wskazywanego przez @p tireRoot, pod prefiksem
-/// @p text.
-/// @param[in] trieRoot – Korzeń drzewa Trie do którego dodawana jest wartość.
+/// Dodaje obiekt @p data do drzewa @p trie, pod prefiksem @p text.
+/// @param[in,out] allocator – pamięć wartości drzewa.
+/// @param[in,out] trie – Drzewo Trie do którego dodawana jest wartość.
 /// @param[in] text – Prefiks pod jakim ma być dodana wartość Pamięć na
 ///                   wszystkie wierzchołki, których nie ma, zostaje
 ///                   zaalokowana.
 /// @param[in] data – Obiekt jaki ma zostać dodany.
-/// @param[in] append – Gdy @p true, wartość w @p data zostanie dodana na koniec
-///                     listy w wierzchołku pod prefiksem @p text. Gdy @p false
+/// @param[in] insert – Gdy @p true, wartość w @p data zostanie dodana na
+///                     początek listy w wierzchołku pod prefiksem @p text, w
+///                     czasie niezależnym od długości listy. Gdy @p false
 ///                     poprzednia wartość zostane zastąpiona obecną.
-/// @param[out] prevData – Jeśli @p append jest @p true, to poprzednia wartość
+/// @param[out] prevData – Jeśli @p insert jest @p false, to poprzednia wartość
 ///                        zostaje zapisana do tej zmiennej.  Wywołujący musi
 ///                        sam zwolnić ten obiekt, bo nie ma go już w
-///                        drzewie. Jeśli @p append jest @p false, ten wskaźnik
+///                        drzewie. Jeśli @p insert jest @p true, ten wskaźnik
 ///                        jest ignorowany.
 /// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
 ///            zaalokować pamięci.
-bool trieAddText(struct TrieNode *trieRoot, const char *text,
-                 struct DataNode *data, bool append,
+bool trieAddText(struct TrieAllocator *allocator, struct Trie *trie,
+                 const char *text, struct DataNode *data, bool insert,
                  struct DataNode **prevData);
 
 /// @brief Bezpiecznie usuwa poddrzewo.
-/// Usuwa poddrzewo, ale dba o to, żeby poprawna struktura drzewa została
-/// zachowana. Dokouje zmian w drzewie, potencjalnie zmienia korzeń usuwanego
-/// poddrzewa na wyższy, by zapewnić optymalne zarządzanie pamięcią, następnie
-/// wywołuje @ref trieFreeSubtree.
-/// @param[in] treeRoot – Wskaźnik na korzeń drzewa. Korzenia drzewa nie można
-///                       usunąć więc potrzebny jest wskaźnik, by nie zmienić na
-///                       niego usuwanego korzenia.
-/// @param[in] rootToDelete – Wskaźnik na korzeń usuwanego
-///                           poddrzewa. Potencjalnie może usunąć więcej
-///                           wierzchołków. Np. Gdy dane drzewo A -> B -> C ->
-///                           D, a tylko B i D mają przypisane wartośći, a @p
-///                           rootToDelete wskazuje na D, to usunięte zostanie
-///                           całe poddrzewo C -> D.
-void trieDeleteSubtree(struct TrieNode *treeRoot,
-                       struct TrieNode *rootToDelete);
+/// Usuwa wszystkie wartości znajdujące się pod napisami o prefiksie @p prefix,
+/// ale dba o to, żeby poprawna struktura drzewa została zachowana. Potencjalnie
+/// zmienia korzeń usuwanego poddrzewa na wyższy, by zapewnić optymalne
+/// zarządzanie pamięcią. Np. Gdy dane drzewo A -> B -> C -> D, a tylko B i D
+/// mają przypisane wartośći, a @p prefix prowadzi do D, to usunięte zostanie
+/// całe poddrzewo C -> D. Gdy po usunięciu wierzchołek bez wartości ma tylko
+/// jedno dziecko, zostaje z nim scalony. Gdy @p prefix jest pusty, usuwa całą
+/// zawartość drzewa poza samym korzeniem. Nic nie robi, gdy w drzewie nie ma
+/// prefiksu @p prefix. Gdy drzewa mają migawki, najpierw przygotowuje usunięcie
+/// powiązanych wpisów przez @ref triePrepareRemoveEntry, więc zmiana jest
+/// wykonywana w całości albo wcale.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartości drzewa.
+/// @param[in,out] trie – drzewo, z którego usuwamy poddrzewo.
+/// @param[in] prefix – Prefiks, pod którym znajduje się korzeń usuwanego
+///                     poddrzewa.
+/// @param[in,out] linked – Drzewo, w którym leżą powiązane wpisy (@ref
+///                         DataNode.link) usuwanych wartości. Każdy taki wpis
+///                         zostaje z niego usunięty, więc koszt jest liniowy
+///                         względem liczby usuniętych wartości. Może być @p
+///                         NULL, gdy wartości nie mają powiązanych wpisów.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci na kopie wierzchołków lub wartości należących
+///            do migawek. Wtedy zawartość obu drzew pozostaje niezmieniona.
+bool trieDeleteSubtree(struct TrieAllocator *allocator, struct Trie *trie,
+                       const char *prefix, struct Trie *linked);
+
+/// @brief Odwiedza wszystkie wartości poddrzewa.
+/// Wywołuje @p visit dla każdego wpisu wszystkich wierzchołków, których
+/// ścieżka zaczyna się napisem @p prefix, w dowolnej kolejności.
+/// @param[in] trie – przeszukiwane drzewo.
+/// @param[in] prefix – prefiks, pod którym leży poddrzewo.
+/// @param[in] visit – funkcja wywoływana dla każdego wpisu.
+/// @param[in,out] context – kontekst przekazywany do @p visit.
+/// @return @p true jeśli odwiedzone zostały wszystkie wpisy, @p false, gdy nie
+///         udało się zaalokować pamięci.
+bool trieVisitSubtree(const struct Trie *trie, const char *prefix,
+                      void (*visit)(void *context,
+                                    const struct DataNode *data),
+                      void *context);
+
+/// @brief Przygotowuje usunięcie wpisu z drzewa mającego migawki.
+/// Zastępuje kopiami wierzchołki należące do migawek na ścieżce do napisu @p
+/// text oraz listę wartości pod nim, jeśli należy do migawek. Kopie nie
+/// zmieniają zawartości drzewa, a po nich @ref trieRemoveEntry dla dowolnego
+/// wpisu spod @p text nie alokuje pamięci, nawet po usunięciu innych
+/// przygotowanych wpisów. Powiązane wartości wskazują odtąd na kopie. Gdy
+/// drzewo nie ma migawek, nic nie robi.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartości drzewa.
+/// @param[in,out] trie – drzewo, w którym leży wpis.
+/// @param[in] text – napis, pod którym znajduje się wpis.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy zawartość drzewa jest niezmieniona,
+///            ale usunięcie nie jest przygotowane.
+bool triePrepareRemoveEntry(struct TrieAllocator *allocator,
+                            struct Trie *trie, const char *text);
+
+/// @brief Znajduje listę wartości pod napisem.
+/// @param[in] trie – przeszukiwane drzewo.
+/// @param[in] text – szukany napis.
+/// @return Wskaźnik na pierwszą wartość pod napisem @p text, lub @p NULL, gdy
+///         nie ma pod nim wartości.
+const struct DataNode *trieFindData(const struct Trie *trie,
+                                    const char *text);
 
 /// @brief Usuwa dokładnie jedną wartość z drzewa.
-/// Usuwa dokładnie jedną wartość (@p entryToRemove) z drzewa wskazywanego przez
-/// @p root, znajdującego się pod prefiksem @p text. Zakłada że wartość ta
-/// znajduje się w drzewie!
-/// @param[in] root – Wskaźnik do drzewa z jakiego wartość ma zostać
-///                   usunięta.
+/// Odpina wpis @p entry z listy wartości wierzchołka pod napisem @p text w
+/// drzewie @p trie i zwalnia go. Gdy wpis nie jest pierwszy na liście, nie
+/// przechodzi drzewa. Gdy lista staje się pusta, wierzchołek zostaje usunięty
+/// lub scalony z dzieckiem. Zakłada że wpis znajduje się w drzewie! Gdy drzewo
+/// ma migawki, zakłada też, że usunięcie wpisu zostało przygotowane przez @ref
+/// triePrepareRemoveEntry, więc nigdy nie zawodzi.
+/// @param[in,out] allocator – pamięć, z której przydzielono wartości drzewa.
+/// @param[in,out] trie – Drzewo z jakiego wartość ma zostać usunięta.
 /// @param[in] text – Tekst pod jakim znajduje się wartość która ma
 ///                   zostać usunięta.
-/// @param[in] entryToRemove – Tekst, który ma zostać usunięty.
-void trieRemoveOneEntry(struct TrieNode *root, const char *text,
-                        const char *entryToRemove);
-
-/// @brief Sprawdza czy pod prefikes @p text znajduje się wartość @p value.
-/// Zwraca 1, gdy pod @p value znajduje sie w drzewie trie pod wskazanym
-/// prefikem
-/// @p text.
-/// @param[in] root – Korzeń drzewa trie.
-/// @param[in] prefix – Tekst pod, którym ma znajdować się wartość.
-/// @param[in] value – Wartość której istnienie sprwdzamy w drzewie, gdy jest
-///                    NULL, funcja zwraca 1, gdy jakikolwiek element znajduje
-///                    sie pod danum prefiksem.
-int trieValueUnderPrefixExists(struct TrieNode *root, const char *prefix,
-                               const char *value);
+/// @param[in] entry – Wpis, który ma zostać usunięty.
+void trieRemoveEntry(struct TrieAllocator *allocator, struct Trie *trie,
+                     const char *text, struct DataNode *entry);
+
+/// @brief Wyznacza klucz sortowania napisu.
+/// Każda z pierwszych @ref TRIE_SORT_KEY_DIGITS cyfr napisu zajmuje 4 bity,
+/// począwszy od najstarszych, jako jej wartość powiększona o 1. Zera oznaczają
+/// koniec napisu, więc klucze są uporządkowane tak jak napisy, a równe klucze
+/// napisów krótszych od @ref TRIE_SORT_KEY_DIGITS cyfr oznaczają równe napisy.
+/// @param[in] text – napis złożony z cyfr.
+/// @return Klucz sortowania napisu @p text.
+static inline uint64_t trieSortKey(const char *text) {
+  uint64_t result = 0;
+  for (int i = 0; i < TRIE_SORT_KEY_DIGITS; ++i) {
+    result <<= 4;
+    if ((*text) != '\0')
+      result |= (uint64_t)((*(text++)) - '0' + 1);
+  }
+
+  return result;
+}
+
+/// @brief Buduje drzewo z posortowanych kluczy.
+/// Wstawia do pustego drzewa wartości @p values pod kluczami @p keys jednym
+/// przebiegiem od korzenia, bez szukania miejsca dla każdego klucza od nowa.
+/// Każdy wierzchołek jest tworzony raz, z ostateczną etykietą i blokiem dzieci
+/// właściwej klasy, a wierzchołki leżą w tablicy drzewa w kolejności
+/// przechodzenia go od korzenia. Kształt drzewa i etykiety są wyznaczane z
+/// kluczy sortowania, więc napisy kluczy są czytane tylko za ich
+/// początkowymi @ref TRIE_SORT_KEY_DIGITS cyframi.
+/// @param[in,out] trie – drzewo zawierające sam korzeń, bez wartości.
+/// @param[in] keys – klucze posortowane rosnąco, bez powtórzeń.
+/// @param[in] sortKeys – klucze sortowania (@ref trieSortKey) kolejnych
+///                       kluczy.
+/// @param[in] values – listy wartości kolejnych kluczy, ze wskaźnikami @ref
+///                     DataNode.next i @ref DataNode.prev już ustawionymi.
+/// @param[in] count – liczba kluczy.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci. Wtedy drzewo trzeba zwolnić, a wartości,
+///            które do niego trafiły, wciąż należą do wywołującego.
+bool trieBuildSorted(struct Trie *trie, const char *const *keys,
+                     const uint64_t *sortKeys, struct DataNode *const *values,
+                     size_t count);
+
+/// Drzewo doklejane do innego przez @ref trieGraftPrepare.
+struct TrieGraft {
+  /// @brief Doklejane drzewo.
+  /// Korzeń drzewa nie może mieć wartości, a drzewo nie może mieć wolnych
+  /// wierzchołków ani bloków, jak drzewa zbudowane przez @ref
+  /// trieBuildSorted.
+  const struct Trie *part;
+
+  /// Różnica indeksów wierzchołków drzewa @ref part w drzewie docelowym.
+  TrieIndex nodeBase;
+
+  /// Różnica indeksów pól bloków drzewa @ref part w drzewie docelowym.
+  TrieIndex slotBase;
+};
+
+/// @brief Przygotowuje doklejenie drzew.
+/// Rezerwuje w tablicach drzewa @p trie miejsce na wierzchołki i bloki
+/// dzieci wszystkich drzew @p grafts, wyznacza różnice ich indeksów, i
+/// podpina dzieci ich korzeni pod korzeń @p trie. Wierzchołki trafiają na
+/// swoje miejsca dopiero w @ref trieGraftCopy, które musi zostać wywołane
+/// dla każdego drzewa przed użyciem @p trie.
+/// @param[in,out] trie – drzewo, do którego doklejane są drzewa. Jego
+///                       korzeń nie może mieć dzieci dla cyfr, dla których
+///                       mają je korzenie doklejanych drzew.
+/// @param[in,out] grafts – doklejane drzewa; uzupełniane są różnice indeksów.
+///                         Korzenie tych drzew nie mogą mieć dzieci dla tych
+///                         samych cyfr.
+/// @param[in] count – liczba doklejanych drzew.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            zaalokować pamięci lub drzewo byłoby zbyt duże. Wtedy drzewo
+///            @p trie trzeba zwolnić.
+bool trieGraftPrepare(struct Trie *trie, struct TrieGraft *grafts,
+                      size_t count);
+
+/// @brief Kopiuje doklejane drzewo na jego miejsce.
+/// Przenosi wierzchołki i bloki dzieci drzewa na miejsca zarezerwowane przez
+/// @ref trieGraftPrepare, przesuwając ich indeksy. Wywołania dla różnych
+/// drzew tego samego przygotowania mogą być wykonywane jednocześnie.
+/// @param[in,out] trie – drzewo, do którego doklejane jest drzewo.
+/// @param[in] graft – doklejane drzewo, przygotowane przez @ref
+///                    trieGraftPrepare.
+void trieGraftCopy(struct Trie *trie, const struct TrieGraft *graft);
+
+struct SnapshotTrieHeader;
+struct SnapshotWriter;
+
+/// @brief Wyznacza położenie drzewa w pliku zrzutu.
+/// Uzupełnia opis @p header rozmiarami tablic drzewa i przesunięciami jego
+/// sekcji, które zaczynają się na pozycji @p offset.
+/// @param[in] trie – zapisywane drzewo.
+/// @param[out] header – opis drzewa w pliku zrzutu.
+/// @param[in,out] offset – pozycja w pliku, zastępowana pozycją za ostatnią
+///                         sekcją drzewa.
+void trieSnapshotLayout(const struct Trie *trie,
+                        struct SnapshotTrieHeader *header, uint64_t *offset);
+
+/// @brief Zapisuje drzewo do pliku zrzutu.
+/// Zapisuje sekcje drzewa w miejscach wyznaczonych przez @ref
+/// trieSnapshotLayout. Wartości są zapisywane w kolejności indeksów
+/// wierzchołków, a w jednym wierzchołku w kolejności na liście.
+/// @param[in] trie – zapisywane drzewo.
+/// @param[in] header – opis drzewa wyznaczony przez @ref trieSnapshotLayout.
+/// @param[in] links – numery powiązanych wartości (@ref DataNode.link)
+///                    kolejnych wartości drzewa, lub @p NULL, gdy wartości
+///                    nie mają powiązań.
+/// @param[in,out] writer – zapis pliku zrzutu.
+void trieSnapshotWrite(const struct Trie *trie,
+                       const struct SnapshotTrieHeader *header,
+                       const uint64_t *links, struct SnapshotWriter *writer);
+
+/// @brief Wczytuje drzewo z pliku zrzutu.
+/// Odtwarza tablice drzewa jednym przebiegiem po tablicach z pliku, bez
+/// wstawiania kolejnych napisów. Sprawdza, czy wszystkie indeksy i
+/// przesunięcia mieszczą się w sekcjach drzewa, drzewo nie ma cykli, a
+/// wartości są numerami.
+/// @param[in,out] allocator – pamięć, z której przydzielane są wartości.
+/// @param[out] trie – wczytywane drzewo. Gdy operacja się nie powiedzie, nie
+///                   trzeba go zwalniać, ale przydzielone już wartości
+///                   pozostają w @p allocator.
+/// @param[in] header – opis drzewa, sprawdzony przez @ref
+///                     snapshotHeaderValid.
+/// @param[in] image – zawartość pliku zrzutu.
+/// @param[out] values – tablica na @ref SnapshotTrieHeader.valuesCount
+///                      wskaźników, do której trafiają kolejne wczytane
+///                      wartości, lub @p NULL.
+/// @param[in,out] linked – wartości drugiego drzewa, z którymi powiązane są
+///                         wartości tego, lub @p NULL, gdy wartości nie mają
+///                         powiązań. Każda użyta wartość jest zastępowana w
+///                         tablicy przez @p NULL, więc żadna nie może zostać
+///                         powiązana dwukrotnie.
+/// @param[in] linkedCount – liczba elementów tablicy @p linked.
+/// @param[in] packed – czy wartości mają być przechowywane spakowane (@ref
+///                     dataNodeNewPacked).
+/// @return @p true jeśli operacja powiodła się, @p false, gdy plik jest
+///            niepoprawny lub nie udało się zaalokować pamięci.
+bool trieSnapshotLoad(struct TrieAllocator *allocator, struct Trie *trie,
+                      const struct SnapshotTrieHeader *header,
+                      const char *image, struct DataNode **values,
+                      struct DataNode **linked, size_t linkedCount,
+                      bool packed);
 
 #endif /* __TRIE_H__ */
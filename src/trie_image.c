@@ -0,0 +1,151 @@
+/// @file
+/// Implementacja modułu drzew Trie tylko do odczytu, leżących w pliku zrzutu
+/// odwzorowanym w pamięci.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trie_image.h"
+#include "util.h"
+
+bool trieImageFileOpen(struct TrieImageFile *file, const char *path) {
+  if (!snapshotSupported())
+    return false;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat status;
+  void *address = MAP_FAILED;
+  if (fstat(fd, &status) == 0 &&
+      (uint64_t)status.st_size >= sizeof(struct SnapshotHeader) &&
+      (uint64_t)status.st_size <= SIZE_MAX)
+    address = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (address == MAP_FAILED)
+    return false;
+
+  const struct SnapshotHeader *header = address;
+  if (!snapshotHeaderValid(header, status.st_size)) {
+    munmap(address, status.st_size);
+    return false;
+  }
+
+  file->address = address;
+  file->size = status.st_size;
+  for (int i = 0; i < SNAPSHOT_TRIES; ++i) {
+    const struct SnapshotTrieHeader *trie = &header->tries[i];
+    const char *image = address;
+
+    file->tries[i] = (struct TrieImage){
+        .nodes = (const struct SnapshotNode *)(image + trie->nodesOffset),
+        .nodesSize = trie->nodesSize,
+        .slots = (const TrieIndex *)(image + trie->slotsOffset),
+        .slotsSize = trie->slotsSize,
+        .values = image + trie->valuesOffset,
+        .valuesSize = trie->valuesSize};
+  }
+
+  return true;
+}
+
+void trieImageFileClose(struct TrieImageFile *file) {
+  munmap(file->address, file->size);
+  file->address = NULL;
+  file->size = 0;
+}
+
+TrieIndex trieImageChild(const struct TrieImage *trie, TrieIndex node,
+                         int digit) {
+  assert(node < trie->nodesSize);
+  assert(inRange(digit, 0, ALPHABET_SIZE - 1));
+
+  const struct SnapshotNode *record = &trie->nodes[node];
+  unsigned int mask = record->childMask;
+  if (!(mask & (1u << digit)) || record->childs == TRIE_NONE)
+    return TRIE_NONE;
+
+  uint64_t slot =
+      (uint64_t)record->childs + bitCount(mask & ((1u << digit) - 1));
+  if (slot >= trie->slotsSize)
+    return TRIE_NONE;
+
+  TrieIndex child = trie->slots[slot];
+  if (child == TRIE_ROOT || child >= trie->nodesSize)
+    return TRIE_NONE;
+
+  return child;
+}
+
+TrieIndex trieImageDescend(const struct TrieImage *trie, TrieIndex node,
+                           const char *text, int *labelLength) {
+  int currentBranchIdx = text[0] - '0';
+  assert(inRange(currentBranchIdx, 0, ALPHABET_SIZE - 1));
+
+  TrieIndex child = trieImageChild(trie, node, currentBranchIdx);
+  if (child == TRIE_NONE)
+    return TRIE_NONE;
+
+  // A text shorter than the label differs from it at its '\0'.
+  const struct SnapshotNode *childNode = &trie->nodes[child];
+  if (childNode->labelLength == 0 ||
+      childNode->labelLength > TRIE_LABEL_CAPACITY)
+    return TRIE_NONE;
+
+  for (int i = 0; i < childNode->labelLength; ++i)
+    if (text[i] - '0' != trieImageLabelDigit(childNode, i))
+      return TRIE_NONE;
+
+  (*labelLength) = childNode->labelLength;
+  return child;
+}
+
+/// @brief Zwraca wartość leżącą pod danym przesunięciem.
+/// @param[in] trie – drzewo, w którym leży wartość.
+/// @param[in] offset – przesunięcie wartości w ciągu wartości drzewa, lub
+///                     @ref SNAPSHOT_NONE.
+/// @return Wskaźnik na wartość, lub @p NULL, gdy @p offset jest równy @ref
+///         SNAPSHOT_NONE, lub wartość nie mieści się w ciągu wartości.
+static const struct SnapshotValue *trieImageValueAt(
+    const struct TrieImage *trie, uint64_t offset) {
+  if (offset == SNAPSHOT_NONE || offset % SNAPSHOT_ALIGNMENT != 0 ||
+      offset >= trie->valuesSize ||
+      trie->valuesSize - offset < snapshotValueSize(0))
+    return NULL;
+
+  const struct SnapshotValue *value =
+      (const struct SnapshotValue *)(trie->values + offset);
+  if (snapshotValueSize(value->length) > trie->valuesSize - offset ||
+      value->text[value->length] != '\0')
+    return NULL;
+
+  return value;
+}
+
+const struct SnapshotValue *trieImageValue(const struct TrieImage *trie,
+                                           TrieIndex node) {
+  assert(node < trie->nodesSize);
+  return trieImageValueAt(trie, trie->nodes[node].data);
+}
+
+const struct SnapshotValue *
+trieImageValueNext(const struct TrieImage *trie,
+                   const struct SnapshotValue *value) {
+  // Values of a list lie one after another, so a list cannot have a cycle.
+  uint64_t offset = (uint64_t)((const char *)value - trie->values);
+  if (value->next <= offset)
+    return NULL;
+
+  return trieImageValueAt(trie, value->next);
+}
@@ -0,0 +1,130 @@
+/// @file
+/// Interfejs modułu drzew Trie tylko do odczytu, leżących w pliku zrzutu
+/// odwzorowanym w pamięci.
+///
+/// Drzewa są czytane bezpośrednio ze stron pliku, bez kopiowania ich do
+/// pamięci procesu, więc otwarcie pliku zajmuje stały czas, a procesy
+/// używające tego samego pliku współdzielą jego strony. Plik nie jest w całości
+/// sprawdzany przy otwarciu, dlatego każdy odczyt sprawdza, czy indeksy i
+/// przesunięcia mieszczą się w sekcjach drzewa.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __TRIE_IMAGE_H__
+#define __TRIE_IMAGE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "snapshot.h"
+#include "trie.h"
+
+/// Drzewo Trie tylko do odczytu, leżące w pliku zrzutu.
+struct TrieImage {
+  /// Tablica wierzchołków. Korzeń ma indeks @ref TRIE_ROOT.
+  const struct SnapshotNode *nodes;
+
+  /// Liczba elementów tablicy @ref nodes.
+  TrieIndex nodesSize;
+
+  /// Tablica spakowanych bloków dzieci.
+  const TrieIndex *slots;
+
+  /// Liczba elementów tablicy @ref slots.
+  TrieIndex slotsSize;
+
+  /// Ciąg wartości drzewa.
+  const char *values;
+
+  /// Rozmiar ciągu @ref values w bajtach.
+  uint64_t valuesSize;
+};
+
+/// Plik zrzutu odwzorowany w pamięci.
+struct TrieImageFile {
+  /// Początek odwzorowania.
+  void *address;
+
+  /// Rozmiar odwzorowania.
+  size_t size;
+
+  /// Drzewo przekierowań i drzewo prefiksów.
+  struct TrieImage tries[SNAPSHOT_TRIES];
+};
+
+/// @brief Odwzorowuje plik zrzutu w pamięci.
+/// Sprawdza jedynie nagłówek pliku, więc działa w czasie niezależnym od jego
+/// rozmiaru. W szczególności nie sprawdza sumy kontrolnej reszty pliku.
+/// @param[out] file – inicjalizowana struktura.
+/// @param[in] path – nazwa pliku zapisanego przez @ref phfwdSave.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///            odwzorować pliku lub jego nagłówek jest niepoprawny.
+bool trieImageFileOpen(struct TrieImageFile *file, const char *path);
+
+/// @brief Usuwa odwzorowanie pliku zrzutu.
+/// Wszystkie wskaźniki na zawartość pliku przestają być ważne.
+/// @param[in,out] file – odwzorowany plik.
+void trieImageFileClose(struct TrieImageFile *file);
+
+/// @brief Zwraca wierzchołek drzewa.
+/// @param[in] trie – drzewo.
+/// @param[in] node – indeks wierzchołka, mniejszy od @ref
+///                   TrieImage.nodesSize.
+/// @return Wskaźnik na wierzchołek.
+static inline const struct SnapshotNode *trieImageNode(
+    const struct TrieImage *trie, TrieIndex node) {
+  return &trie->nodes[node];
+}
+
+/// @brief Zwraca cyfrę etykiety wierzchołka.
+/// @param[in] node – wskaźnik na wierzchołek.
+/// @param[in] position – numer cyfry, mniejszy od @ref
+///                       SnapshotNode.labelLength.
+/// @return Cyfrę etykiety na pozycji @p position.
+static inline int trieImageLabelDigit(const struct SnapshotNode *node,
+                                      int position) {
+  return (int)((node->label >> (4 * position)) & 0xF);
+}
+
+/// @brief Zwraca dziecko wierzchołka.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] digit – cyfra, od @p 0 do @p ALPHABET_SIZE - 1.
+/// @return Indeks dziecka wierzchołka @p node dla cyfry @p digit, lub @ref
+///         TRIE_NONE, gdy takiego nie ma, lub plik jest niepoprawny.
+TrieIndex trieImageChild(const struct TrieImage *trie, TrieIndex node,
+                         int digit);
+
+/// @brief Schodzi o jedną krawędź w dół drzewa.
+/// Działa jak @ref trieDescend. Krawędzie z pustą etykietą są traktowane jak
+/// nieistniejące, więc każde zejście skraca @p text.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @param[in] text – niepusty napis, wzdłuż którego schodzimy.
+/// @param[out] labelLength – długość etykiety znalezionego dziecka.
+/// @return Indeks znalezionego dziecka, lub @ref TRIE_NONE, gdy takiego nie
+///         ma.
+TrieIndex trieImageDescend(const struct TrieImage *trie, TrieIndex node,
+                           const char *text, int *labelLength);
+
+/// @brief Zwraca pierwszą wartość wierzchołka.
+/// @param[in] trie – drzewo, w którym leży wierzchołek.
+/// @param[in] node – indeks wierzchołka.
+/// @return Wskaźnik na pierwszą wartość wierzchołka, lub @p NULL, gdy
+///         wierzchołek nie ma wartości, lub plik jest niepoprawny.
+const struct SnapshotValue *trieImageValue(const struct TrieImage *trie,
+                                           TrieIndex node);
+
+/// @brief Zwraca następną wartość listy.
+/// @param[in] trie – drzewo, w którym leży wartość.
+/// @param[in] value – wartość zwrócona przez @ref trieImageValue lub tę
+///                    funkcję.
+/// @return Wskaźnik na następną wartość listy, lub @p NULL, gdy lista się
+///         skończyła, lub plik jest niepoprawny.
+const struct SnapshotValue *
+trieImageValueNext(const struct TrieImage *trie,
+                   const struct SnapshotValue *value);
+
+#endif /* __TRIE_IMAGE_H__ */
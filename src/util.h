@@ -11,9 +11,11 @@
 #ifndef __UTIL_H__
 #define __UTIL_H__
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 /// @brief Zwraca kopię otrzymanego napisu.
 /// Alokuje pamięć do przechowywania napisu @p str_to_duplicate i zwraca jego
@@ -64,4 +66,66 @@ static inline bool inRange(const int value, const int min, const int max) {
   return (min <= value && value <= max);
 }
 
+/// @brief Liczy zapalone bity.
+/// Zwraca liczbę bitów ustawionych na 1 w @p value. Gdy kompilator to
+/// umożliwia, używa odpowiedniej instrukcji procesora.
+/// @param[in] value – wartość, której bity liczymy.
+/// @return Liczbę zapalonych bitów w @p value.
+static inline int bitCount(unsigned int value) {
+#ifdef __GNUC__
+  return __builtin_popcount(value);
+#else
+  int result = 0;
+  while (value) {
+    value &= value - 1;
+    result++;
+  }
+
+  return result;
+#endif
+}
+
+/// @brief Pobiera pamięć do pamięci podręcznej procesora.
+/// Jedynie podpowiedź dla procesora, że wkrótce będziemy czytać pamięć pod
+/// adresem @p address; nie zmienia działania programu. Gdy kompilator tego nie
+/// umożliwia, nic nie robi.
+/// @param[in] address – adres, który zostanie wkrótce odczytany.
+static inline void prefetch(const void *address) {
+#ifdef __GNUC__
+  __builtin_prefetch(address);
+#else
+  (void)address;
+#endif
+}
+
+/// @brief Porównuje leksykograficznie dwa złożenia napisów.
+/// Porównuje napis powstały ze sklejenia @p first i @p firstSuffix z napisem
+/// powstałym ze sklejenia @p second i @p secondSuffix, bez tworzenia ich w
+/// pamięci.
+/// @param[in] first        – początek pierwszego napisu.
+/// @param[in] firstSuffix  – koniec pierwszego napisu.
+/// @param[in] second       – początek drugiego napisu.
+/// @param[in] secondSuffix – koniec drugiego napisu.
+/// @return Liczbę ujemną, zero lub dodatnią, gdy pierwszy napis jest mniejszy
+///         leksykograficznie, równy, lub większy od drugiego.
+static inline int concatCompare(const char *first, const char *firstSuffix,
+                                const char *second, const char *secondSuffix) {
+  for (;;) {
+    if (*first == '\0' && firstSuffix) {
+      first = firstSuffix;
+      firstSuffix = NULL;
+    }
+    if (*second == '\0' && secondSuffix) {
+      second = secondSuffix;
+      secondSuffix = NULL;
+    }
+
+    if (*first != *second || *first == '\0')
+      return (unsigned char)*first - (unsigned char)*second;
+
+    first++;
+    second++;
+  }
+}
+
 #endif /* UTIL_H__ */
@@ -0,0 +1,565 @@
+/// @file
+/// Implementacja modułu dziennika zmian baz przekierowań.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "write_ahead_log.h"
+
+/// Długość napisu @ref WAL_MAGIC.
+#define WAL_MAGIC_SIZE (sizeof(WAL_MAGIC) - 1)
+
+/// Rozmiar sumy kontrolnej kończącej rekord.
+#define WAL_CHECKSUM_SIZE (4)
+
+/// Największa liczba bajtów długości argumentu zapisanej jako LEB128.
+#define WAL_LENGTH_SIZE ((sizeof(size_t) * 8 + 6) / 7)
+
+/// Przyrostek ścieżki pliku, do którego zapisywany jest punkt kontrolny.
+#define WAL_TEMPORARY_SUFFIX ".tmp"
+
+/// Bajty typu rekordu.
+enum WalRecordType {
+  WAL_NEW = 'N',           ///< Operacja @ref OT_ADD.
+  WAL_DEL_DATABASE = 'D',  ///< Operacja @ref OT_DEL_DATABASE.
+  WAL_DEL_PHONE_NUM = 'X', ///< Operacja @ref OT_DEL_PHONE_NUM.
+  WAL_REDIRECT = 'R',      ///< Operacja @ref OT_REDIRECT.
+  WAL_IMAGE = 'I'          ///< Zawartość bazy, zapisana przez @p LOAD.
+};
+
+/// Deskryptor pliku dziennika, lub -1, gdy dziennik nie jest otwarty.
+static int walFile = -1;
+
+/// Ścieżka do pliku dziennika.
+static char *walPath = NULL;
+
+/// Liczba bajtów zapisanych do pliku dziennika, bez zawartości bufora.
+static size_t walSize = 0;
+
+/// Rozmiar dziennika po ostatnim punkcie kontrolnym lub jego otwarciu.
+static size_t walCheckpointSize = 0;
+
+/// Rekordy czekające na zapis do pliku.
+static char walBuffer[WAL_BUFFER_SIZE];
+
+/// Liczba bajtów w @ref walBuffer.
+static size_t walBufferSize = 0;
+
+/// Liczba rekordów dopisanych od ostatniego wywołania @p fdatasync.
+static size_t walPending = 0;
+
+/// Wartość @p true, gdy nie udało się zapisać dziennika.
+static bool walFailed = false;
+
+/// @brief Wyznacza typ rekordu operacji.
+/// @param[in] type – typ operacji.
+/// @param[out] argsCount – liczba argumentów operacji.
+/// @return Typ rekordu, lub 0, gdy operacja nie zmienia baz.
+static char walRecordType(enum OperationType type, int *argsCount) {
+  (*argsCount) = 1;
+  switch (type) {
+  case OT_ADD:
+    return WAL_NEW;
+  case OT_DEL_DATABASE:
+    return WAL_DEL_DATABASE;
+  case OT_DEL_PHONE_NUM:
+    return WAL_DEL_PHONE_NUM;
+  case OT_REDIRECT:
+    (*argsCount) = 2;
+    return WAL_REDIRECT;
+  default:
+    return 0;
+  }
+}
+
+/// @brief Wyznacza typ operacji rekordu.
+/// Rekord zawartości bazy ma typ operacji @ref OT_LOAD.
+/// @param[in] recordType – bajt typu rekordu.
+/// @param[out] type – typ operacji.
+/// @param[out] argsCount – liczba argumentów rekordu.
+/// @return @p true jeśli @p recordType jest poprawnym typem rekordu, @p false
+///         w przeciwnym wypadku.
+static bool walOperationType(char recordType, enum OperationType *type,
+                             int *argsCount) {
+  (*argsCount) = 1;
+  switch (recordType) {
+  case WAL_NEW:
+    (*type) = OT_ADD;
+    return true;
+  case WAL_DEL_DATABASE:
+    (*type) = OT_DEL_DATABASE;
+    return true;
+  case WAL_DEL_PHONE_NUM:
+    (*type) = OT_DEL_PHONE_NUM;
+    return true;
+  case WAL_REDIRECT:
+    (*type) = OT_REDIRECT;
+    (*argsCount) = 2;
+    return true;
+  case WAL_IMAGE:
+    (*type) = OT_LOAD;
+    (*argsCount) = 2;
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// @brief Wyznacza sumę kontrolną rekordu.
+/// @param[in] record – wskaźnik na początek rekordu.
+/// @param[in] size – rozmiar rekordu bez sumy kontrolnej.
+/// @return 32 młodsze bity sumy kontrolnej.
+static uint32_t walChecksum(const char *record, size_t size) {
+  return (uint32_t)snapshotChecksum(SNAPSHOT_CHECKSUM_INIT, record, size);
+}
+
+/// @brief Zapisuje dane bezpośrednio do pliku dziennika.
+/// Powtarza wywołanie @p write, dopóki wszystkie bajty nie zostaną zapisane,
+/// lub nie wystąpi błąd inny niż przerwanie przez sygnał.
+/// @param[in] data – zapisywane dane.
+/// @param[in] size – liczba zapisywanych bajtów.
+/// @return @p true jeśli operacja powiodła się, @p false w przeciwnym
+///         wypadku.
+static bool walWriteAll(const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(walFile, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return false;
+    }
+
+    data += written;
+    size -= written;
+    walSize += written;
+  }
+
+  return true;
+}
+
+/// @brief Zapisuje zawartość bufora do pliku dziennika.
+/// Nie wywołuje @p fdatasync.
+/// @return @p true jeśli operacja powiodła się, @p false w przeciwnym
+///         wypadku.
+static bool walFlush() {
+  if (!walFailed && !walWriteAll(walBuffer, walBufferSize))
+    walFailed = true;
+
+  walBufferSize = 0;
+  return !walFailed;
+}
+
+/// @brief Zapisuje długość jako LEB128.
+/// @param[out] out – bufor na co najmniej @ref WAL_LENGTH_SIZE bajtów.
+/// @param[in] length – zapisywana długość.
+/// @return Liczba zapisanych bajtów.
+static size_t walEncodeLength(char *out, size_t length) {
+  size_t size = 0;
+  do {
+    unsigned char byte = length & 0x7F;
+    length >>= 7;
+    out[size++] = (char)(length ? (byte | 0x80) : byte);
+  } while (length);
+
+  return size;
+}
+
+/// @brief Odczytuje długość zapisaną jako LEB128.
+/// @param[in] data – wskaźnik na początek długości.
+/// @param[in] end – wskaźnik za koniec danych.
+/// @param[out] length – odczytana długość.
+/// @return Wskaźnik za odczytaną długość, lub @p NULL, gdy dane są za krótkie
+///         lub długość jest za duża.
+static const char *walDecodeLength(const char *data, const char *end,
+                                   size_t *length) {
+  (*length) = 0;
+  for (unsigned shift = 0; data < end && shift < 8 * sizeof(size_t);
+       shift += 7) {
+    unsigned char byte = (unsigned char)*(data++);
+    (*length) |= (size_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return data;
+  }
+
+  return NULL;
+}
+
+/// @brief Dopisuje rekord do dziennika.
+/// @param[in] type – bajt typu rekordu.
+/// @param[in] args – argumenty rekordu.
+/// @param[in] lengths – długości argumentów.
+/// @param[in] argsCount – liczba argumentów, co najwyżej 2.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///         zapisać dziennika.
+static bool walAppendRecord(char type, const char *const *args,
+                            const size_t *lengths, int argsCount) {
+  char header[1 + 2 * WAL_LENGTH_SIZE];
+  size_t headerSize = 0;
+  header[headerSize++] = type;
+  size_t recordSize = WAL_CHECKSUM_SIZE;
+  for (int i = 0; i < argsCount; ++i) {
+    headerSize += walEncodeLength(header + headerSize, lengths[i]);
+    recordSize += lengths[i];
+  }
+
+  recordSize += headerSize;
+
+  // The record is built in the buffer, where its checksum is computed. Only
+  // records longer than the whole buffer need memory of their own.
+  bool ownMemory = recordSize > WAL_BUFFER_SIZE;
+  char *record = walBuffer;
+  if (ownMemory) {
+    walFlush();
+    if (!(record = malloc(recordSize))) {
+      walFailed = true;
+      return false;
+    }
+  } else {
+    if (walBufferSize + recordSize > WAL_BUFFER_SIZE)
+      walFlush();
+
+    record += walBufferSize;
+  }
+
+  memcpy(record, header, headerSize);
+  size_t offset = headerSize;
+  for (int i = 0; i < argsCount; ++i) {
+    memcpy(record + offset, args[i], lengths[i]);
+    offset += lengths[i];
+  }
+
+  uint32_t checksum = walChecksum(record, offset);
+  for (int i = 0; i < WAL_CHECKSUM_SIZE; ++i)
+    record[offset + i] = (char)(checksum >> (8 * i));
+
+  if (ownMemory) {
+    if (!walFailed && !walWriteAll(record, recordSize))
+      walFailed = true;
+    free(record);
+  } else {
+    walBufferSize += recordSize;
+  }
+
+  if (++walPending >= WAL_GROUP_COMMIT_RECORDS)
+    walSync();
+
+  return !walFailed;
+}
+
+bool walAppend(const struct Operation *op) {
+  if (walFile < 0)
+    return true;
+
+  int argsCount;
+  char type = walRecordType(op->performed_operation, &argsCount);
+  if (!type)
+    return true;
+
+  size_t lengths[2];
+  for (int i = 0; i < argsCount; ++i) {
+    assert(op->args[i]);
+    lengths[i] = strlen(op->args[i]);
+  }
+
+  return walAppendRecord(type, (const char *const *)op->args, lengths,
+                         argsCount);
+}
+
+bool walAppendImage(const char *name, const char *image, size_t size) {
+  if (walFile < 0)
+    return true;
+
+  const char *args[2] = {name, image};
+  size_t lengths[2] = {strlen(name), size};
+  return walAppendRecord(WAL_IMAGE, args, lengths, 2);
+}
+
+bool walSync() {
+  if (walFile < 0 || walPending == 0)
+    return !walFailed;
+
+  if (walFlush() && fdatasync(walFile) != 0)
+    walFailed = true;
+
+  walPending = 0;
+  return !walFailed;
+}
+
+/// @brief Odtwarza rekordy dziennika.
+/// @param[in] data – zawartość pliku dziennika za napisem @ref WAL_MAGIC.
+/// @param[in] size – rozmiar @p data.
+/// @param[in] replay – funkcja wykonująca operację.
+/// @param[in] restore – funkcja zastępująca zawartość bazy.
+/// @param[out] validSize – rozmiar początku @p data złożonego z poprawnych
+///                         rekordów.
+/// @return @p true jeśli wszystkie poprawne rekordy zostały odtworzone, @p
+///         false, gdy jedna z operacji nie powiodła się lub nie udało się
+///         zaalokować pamięci.
+static bool walReplay(const char *data, size_t size,
+                      int (*replay)(const struct Operation *op),
+                      int (*restore)(const char *name, const char *image,
+                                     size_t size),
+                      size_t *validSize) {
+  const char *end = data + size;
+  const char *record = data;
+  char *args = NULL;
+  size_t argsCapacity = 0;
+  bool result = true;
+
+  while (record < end) {
+    enum OperationType type;
+    int argsCount;
+    if (!walOperationType(*record, &type, &argsCount))
+      break;
+
+    // A record cut by a crash is recognized by its lengths or checksum.
+    const char *current = record + 1;
+    size_t lengths[2];
+    size_t argsSize = 0;
+    for (int i = 0; i < argsCount && current; ++i) {
+      current = walDecodeLength(current, end, &lengths[i]);
+      // The second length may end past the space left for the first argument.
+      if (current && (argsSize > (size_t)(end - current) ||
+                      lengths[i] > (size_t)(end - current) - argsSize))
+        current = NULL;
+      else
+        argsSize += lengths[i];
+    }
+
+    if (!current || (size_t)(end - current) - argsSize < WAL_CHECKSUM_SIZE)
+      break;
+
+    const char *checksum = current + argsSize;
+
+    uint32_t expected = 0;
+    for (int i = 0; i < WAL_CHECKSUM_SIZE; ++i)
+      expected |= (uint32_t)(unsigned char)checksum[i] << (8 * i);
+
+    if (expected != walChecksum(record, checksum - record))
+      break;
+
+    // The contents of a database are read in place, only its name is copied.
+    int copied = type == OT_LOAD ? 1 : argsCount;
+    size_t copiedSize = type == OT_LOAD ? lengths[0] : argsSize;
+    if (copiedSize + copied > argsCapacity) {
+      char *newArgs = realloc(args, copiedSize + copied);
+      if (!newArgs) {
+        result = false;
+        break;
+      }
+
+      args = newArgs;
+      argsCapacity = copiedSize + copied;
+    }
+
+    // Arguments of operations are strings terminated by '\0'.
+    struct Operation op = {.args = {NULL, NULL},
+                           .performed_operation = type,
+                           .operator_idx = 0};
+    char *arg = args;
+    for (int i = 0; i < copied; ++i) {
+      memcpy(arg, current, lengths[i]);
+      arg[lengths[i]] = '\0';
+      op.args[i] = arg;
+      current += lengths[i];
+      arg += lengths[i] + 1;
+    }
+
+    if (type == OT_LOAD ? !restore(op.args[0], current, lengths[1])
+                        : !replay(&op)) {
+      result = false;
+      break;
+    }
+
+    record = checksum + WAL_CHECKSUM_SIZE;
+  }
+
+  free(args);
+  (*validSize) = record - data;
+  return result;
+}
+
+bool walOpen(const char *path, int (*replay)(const struct Operation *op),
+             int (*restore)(const char *name, const char *image,
+                            size_t size)) {
+  assert(walFile < 0);
+
+  if (!(walPath = malloc(strlen(path) + 1)))
+    return false;
+
+  strcpy(walPath, path);
+  int file = open(path, O_RDWR | O_CREAT, 0644);
+  if (file < 0) {
+    free(walPath);
+    walPath = NULL;
+    return false;
+  }
+
+  struct stat status;
+  char *data = NULL;
+  size_t size = 0;
+  bool result = fstat(file, &status) == 0;
+  if (result && status.st_size > 0) {
+    size = status.st_size;
+    result = (data = malloc(size)) != NULL;
+    for (size_t done = 0; result && done < size;) {
+      ssize_t read_ = read(file, data + done, size - done);
+      if (read_ < 0 && errno == EINTR)
+        continue;
+
+      result = read_ > 0;
+      done += read_;
+    }
+  }
+
+  // A file cut before the end of its magic has no records, so it is started
+  // from scratch like a new one. Any other short file is not a log and must
+  // not be overwritten.
+  size_t validSize = 0;
+  if (result && size > 0 && size < WAL_MAGIC_SIZE) {
+    result = memcmp(data, WAL_MAGIC, size) == 0;
+  } else if (result && size >= WAL_MAGIC_SIZE) {
+    result = memcmp(data, WAL_MAGIC, WAL_MAGIC_SIZE) == 0 &&
+             walReplay(data + WAL_MAGIC_SIZE, size - WAL_MAGIC_SIZE, replay,
+                       restore, &validSize);
+    validSize += WAL_MAGIC_SIZE;
+  }
+
+  free(data);
+
+  // The damaged tail is cut off, so that new records follow valid ones.
+  walFile = file;
+  walFailed = false;
+  walSize = validSize;
+  if (result && validSize < size)
+    result = ftruncate(file, validSize) == 0;
+  if (result)
+    result = lseek(file, validSize, SEEK_SET) >= 0;
+  if (result && validSize == 0)
+    result = walWriteAll(WAL_MAGIC, WAL_MAGIC_SIZE) && fsync(file) == 0;
+
+  walCheckpointSize = walSize;
+  if (!result) {
+    close(file);
+    walFile = -1;
+    free(walPath);
+    walPath = NULL;
+  }
+
+  return result;
+}
+
+bool walIsOpen() { return walFile >= 0; }
+
+bool walCheckpointDue() {
+  size_t size = walSize + walBufferSize;
+  return walFile >= 0 && !walFailed && size >= WAL_CHECKPOINT_SIZE &&
+         size / 2 > walCheckpointSize;
+}
+
+/// @brief Zapisuje na dysk zmiany katalogu zawierającego dziennik.
+/// Po zmianie nazwy pliku dopiero to gwarantuje, że po awarii w katalogu
+/// będzie nowy dziennik.
+/// @return @p true jeśli operacja powiodła się, @p false w przeciwnym
+///         wypadku.
+static bool walSyncDirectory() {
+  const char *slash = strrchr(walPath, '/');
+  char *directory = NULL;
+  if (slash) {
+    size_t length = slash == walPath ? 1 : (size_t)(slash - walPath);
+    if (!(directory = malloc(length + 1)))
+      return false;
+
+    memcpy(directory, walPath, length);
+    directory[length] = '\0';
+  }
+
+  int file = open(directory ? directory : ".", O_RDONLY | O_DIRECTORY);
+  free(directory);
+  if (file < 0)
+    return false;
+
+  bool result = fsync(file) == 0;
+  close(file);
+  return result;
+}
+
+bool walCheckpoint(int (*writeState)(void)) {
+  if (walFile < 0 || !walSync())
+    return false;
+
+  char *temporaryPath =
+      malloc(strlen(walPath) + sizeof(WAL_TEMPORARY_SUFFIX));
+  if (!temporaryPath)
+    return false;
+
+  strcpy(temporaryPath, walPath);
+  strcat(temporaryPath, WAL_TEMPORARY_SUFFIX);
+  int file = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (file < 0) {
+    free(temporaryPath);
+    walCheckpointSize = walSize;
+    return false;
+  }
+
+  // The records written by writeState() go to the new file, while the old one
+  // stays untouched until the new one replaces it.
+  int oldFile = walFile;
+  size_t oldSize = walSize;
+  walFile = file;
+  walSize = 0;
+  bool result = walWriteAll(WAL_MAGIC, WAL_MAGIC_SIZE) && writeState() &&
+                walFlush() && fdatasync(file) == 0 &&
+                rename(temporaryPath, walPath) == 0;
+
+  if (result) {
+    close(oldFile);
+    // Until the rename is on disk, a crash may bring back the old log, which
+    // lacks the records appended from now on, so they cannot be promised.
+    if (!walSyncDirectory()) {
+      walFailed = true;
+      result = false;
+    }
+  } else {
+    close(file);
+    unlink(temporaryPath);
+    walFile = oldFile;
+    walSize = oldSize;
+    walBufferSize = 0;
+    walFailed = false;
+  }
+
+  walPending = 0;
+  walCheckpointSize = walSize;
+  free(temporaryPath);
+  return result;
+}
+
+bool walClose() {
+  if (walFile < 0)
+    return true;
+
+  bool result = walSync();
+  if (close(walFile) != 0)
+    result = false;
+
+  walFile = -1;
+  walBufferSize = 0;
+  walPending = 0;
+  free(walPath);
+  walPath = NULL;
+  return result;
+}
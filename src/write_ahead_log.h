@@ -0,0 +1,129 @@
+/// @file
+/// Interfejs modułu dziennika zmian baz przekierowań.
+///
+/// Dziennik jest plikiem, do którego dopisywane są wszystkie udane operacje
+/// zmieniające bazy przekierowań: @p NEW, @p DEL i @p >, oraz zawartości
+/// baz. Zaczyna się napisem @ref WAL_MAGIC, po którym następują rekordy: bajt
+/// typu rekordu, dla każdego argumentu jego długość zapisana jako LEB128 i
+/// jego bajty, a na końcu 32 młodsze bity sumy kontrolnej rekordu (@ref
+/// snapshotChecksum) w porządku little-endian. Po uruchomieniu dziennik jest
+/// odtwarzany od początku.
+///
+/// Operacja @p LOAD jest zapisywana jako rekord zawartości bazy, z nazwą bazy
+/// i zawartością pliku zrzutu (@ref phfwdSaveImage) wczytanej struktury, więc
+/// odtworzenie nie zależy od późniejszych zmian wczytanego pliku. Gdy
+/// dziennik urośnie ponad dwukrotnie od ostatniego punktu kontrolnego i ma
+/// co najmniej @ref WAL_CHECKPOINT_SIZE bajtów, jest zastępowany nowym, który
+/// zawiera tylko zawartości wszystkich baz i wybór aktualnej bazy (@ref
+/// walCheckpoint).
+///
+/// Rekordy trafiają na dysk grupami: @p fdatasync jest wołane, gdy uzbiera
+/// się @ref WAL_GROUP_COMMIT_RECORDS rekordów, przed czekaniem na kolejny
+/// blok wejścia i przy zamykaniu dziennika.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __WRITE_AHEAD_LOG_H__
+#define __WRITE_AHEAD_LOG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "input_parser.h"
+
+/// Napis rozpoczynający każdy plik dziennika.
+#define WAL_MAGIC "PHFWWAL2"
+
+/// Rozmiar bufora zapisu dziennika.
+#define WAL_BUFFER_SIZE (64 * 1024)
+
+/// Największa liczba rekordów, które mogą czekać na zapis na dysk.
+#define WAL_GROUP_COMMIT_RECORDS (1024)
+
+#ifndef WAL_CHECKPOINT_SIZE
+/// Najmniejszy rozmiar dziennika, przy którym tworzony jest punkt kontrolny.
+/// Test dziennika ustawia mniejszy przy kompilacji.
+#define WAL_CHECKPOINT_SIZE (64 * 1024 * 1024)
+#endif
+
+/// @brief Otwiera dziennik i odtwarza zapisane w nim operacje.
+/// Tworzy plik @p path, jeśli nie istnieje. Każdą zapisaną operację przekazuje
+/// do @p replay, a każdą zapisaną zawartość bazy do @p restore. Niedokończony
+/// lub uszkodzony rekord na końcu pliku, który zostaje po przerwaniu
+/// programu, jest odcinany. Plik krótszy od @ref WAL_MAGIC jest zaczynany od
+/// nowa tylko wtedy, gdy jest początkiem tego napisu. Kolejne rekordy są
+/// dopisywane na końcu pliku.
+/// @param[in] path – ścieżka do pliku dziennika.
+/// @param[in] replay – funkcja wykonująca operację; zwraca 1, gdy operacja
+///                     powiodła się, 0 w przeciwnym wypadku.
+/// @param[in] restore – funkcja zastępująca zawartość bazy o podanej nazwie
+///                      zawartością pliku zrzutu, nie zmieniając aktualnej
+///                      bazy; zwraca 1, gdy operacja powiodła się, 0 w
+///                      przeciwnym wypadku.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///         otworzyć pliku, nie jest on plikiem dziennika, jedna z operacji nie
+///         powiodła się lub nie udało się zaalokować pamięci.
+bool walOpen(const char *path, int (*replay)(const struct Operation *op),
+             int (*restore)(const char *name, const char *image,
+                            size_t size));
+
+/// @brief Sprawdza, czy dziennik jest otwarty.
+/// @return @p true jeśli dziennik jest otwarty, @p false w przeciwnym
+///         wypadku.
+bool walIsOpen();
+
+/// @brief Dopisuje operację do dziennika.
+/// Operacje, które nie zmieniają baz, oraz wszystkie operacje, gdy dziennik
+/// nie jest otwarty, są pomijane. Rekord trafia do bufora i jest zapisywany
+/// na dysk razem z całą grupą.
+/// @param[in] op – wykonana z powodzeniem operacja.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy wcześniej nie
+///         udało się zapisać dziennika.
+bool walAppend(const struct Operation *op);
+
+/// @brief Dopisuje zawartość bazy do dziennika.
+/// Nic nie robi, gdy dziennik nie jest otwarty. Rekord jest zapisywany na
+/// dysk razem z całą grupą.
+/// @param[in] name – nazwa bazy.
+/// @param[in] image – zawartość pliku zrzutu bazy.
+/// @param[in] size – rozmiar @p image.
+/// @return @p true jeśli operacja powiodła się, @p false, gdy nie udało się
+///         zapisać dziennika.
+bool walAppendImage(const char *name, const char *image, size_t size);
+
+/// @brief Zapisuje na dysk wszystkie dopisane rekordy.
+/// Nic nie robi, gdy żaden rekord nie czeka na zapis.
+/// @return @p true jeśli wszystkie dopisane rekordy są na dysku, @p false,
+///         gdy wystąpił błąd zapisu.
+bool walSync();
+
+/// @brief Sprawdza, czy należy utworzyć punkt kontrolny.
+/// @return @p true jeśli dziennik jest otwarty i urósł od ostatniego punktu
+///         kontrolnego tak, że należy go zastąpić przez @ref walCheckpoint.
+bool walCheckpointDue();
+
+/// @brief Tworzy punkt kontrolny.
+/// Zapisuje nowy dziennik do pliku z przyrostkiem @p ".tmp", w którym rekordy
+/// dopisuje @p writeState przez @ref walAppend i @ref walAppendImage. Po
+/// zapisaniu go na dysk zastępuje nim dotychczasowy dziennik. Gdy się to nie
+/// uda, dotychczasowy dziennik pozostaje otwarty i aktualny, a kolejna próba
+/// nastąpi, gdy podwoi on swój rozmiar. Gdy nowy dziennik zastąpił już
+/// dotychczasowy, ale nie udało się zapisać na dysk tej zmiany (@p fsync
+/// katalogu), dziennik przechodzi w stan błędu: kolejne wywołania @ref
+/// walAppend, @ref walSync i @ref walClose zwracają @p false.
+/// @param[in] writeState – funkcja dopisująca rekordy odtwarzające bieżący
+///                         stan baz; zwraca 1, gdy operacja powiodła się, 0
+///                         w przeciwnym wypadku.
+/// @return @p true jeśli dziennik został zastąpiony, @p false w przeciwnym
+///         wypadku.
+bool walCheckpoint(int (*writeState)(void));
+
+/// @brief Zamyka dziennik.
+/// Zapisuje na dysk czekające rekordy. Nic nie robi, gdy dziennik nie jest
+/// otwarty.
+/// @return @p true jeśli wszystkie dopisane rekordy są na dysku, @p false,
+///         gdy wystąpił błąd zapisu.
+bool walClose();
+
+#endif /* __WRITE_AHEAD_LOG_H__ */
@@ -0,0 +1,238 @@
+/// @file
+/// Test budowy struktury z gotowego zbioru przekierowań.
+///
+/// Losuje tablicę przekierowań z powtarzającymi się prefiksami @p num1,
+/// niepoprawnymi numerami i parami o równych numerach. Sprawdza, że @ref
+/// phfwdBuildFromPairs i @ref phfwdBuildFromPairsParallel dla różnych liczb
+/// wątków odrzucają taką tablicę, a z jej poprawnych par budują strukturę o
+/// takich samych wynikach @ref phfwdGet, @ref phfwdReverse i @ref
+/// phfwdNonTrivialCount jak struktura, do której kolejno dodano wszystkie
+/// pary przez @ref phfwdAdd. Duże tablice przekraczają próg, od którego
+/// budowa odbywa się na wielu wątkach. Mniejsze tablice są porównywane także z
+/// modelem. Zbudowana struktura musi dalej działać po kolejnych zmianach.
+///
+/// Użycie: test_build_from_pairs [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (8)
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (12)
+
+/// Liczba przekierowań w dużych tablicach, większa od progu budowy na wielu
+/// wątkach.
+#define TEST_LARGE_COUNT (90000)
+
+/// Liczba przekierowań w małych tablicach, porównywanych z modelem.
+#define TEST_SMALL_COUNT (3000)
+
+/// Największa liczba wątków.
+#define TEST_MAX_THREADS (8)
+
+/// Liczba zapytań po każdej budowie.
+#define TEST_QUERIES (500)
+
+/// @brief Porównuje wyniki zapytań dwóch struktur.
+/// @param[in,out] state – stan generatora.
+/// @param[in,out] built – struktura zbudowana z tablicy.
+/// @param[in,out] expected – struktura o tej samej zawartości.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testCompare(uint64_t *state, struct PhoneForward *built,
+                        struct PhoneForward *expected, int maxLength,
+                        int digits) {
+  static const char *sets[] = {"0", "01", "012", "0123456789:;"};
+  char num[TEST_NUMBER_LENGTH + 1];
+  for (int q = 0; q < TEST_QUERIES; ++q) {
+    testRandomNumber(state, num, maxLength, digits);
+    TEST_CHECK(
+        testSameAndDelete(phfwdGet(built, num), phfwdGet(expected, num)));
+    TEST_CHECK(testSameAndDelete(phfwdReverse(built, num),
+                                 phfwdReverse(expected, num)));
+  }
+
+  for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s)
+    for (size_t length = 1; length <= TEST_NUMBER_LENGTH; length += 3)
+      TEST_CHECK(phfwdNonTrivialCount(built, sets[s], length) ==
+                 phfwdNonTrivialCount(expected, sets[s], length));
+}
+
+/// @brief Porównuje wyniki zapytań struktury z modelem.
+/// @param[in,out] state – stan generatora.
+/// @param[in,out] pf – struktura.
+/// @param[in] model – model o tej samej zawartości.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testCompareModel(uint64_t *state, struct PhoneForward *pf,
+                             const struct TestModel *model, int maxLength,
+                             int digits) {
+  char num[TEST_NUMBER_LENGTH + 1];
+  for (int q = 0; q < TEST_QUERIES / 4; ++q) {
+    testRandomNumber(state, num, maxLength, digits);
+    TEST_CHECK(testModelSameGet(model, num, phfwdGet(pf, num)));
+    TEST_CHECK(testModelSameReverse(model, num, phfwdReverse(pf, num)));
+    TEST_CHECK(phfwdNonTrivialCount(pf, "012", 4) ==
+               testModelNonTrivialCount(model, "012", 4));
+  }
+}
+
+/// @brief Zmienia obie struktury tak samo i porównuje ich wyniki.
+/// @param[in,out] state – stan generatora.
+/// @param[in,out] built – struktura zbudowana z tablicy.
+/// @param[in,out] expected – struktura o tej samej zawartości.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testChange(uint64_t *state, struct PhoneForward *built,
+                       struct PhoneForward *expected, int maxLength,
+                       int digits) {
+  char num1[TEST_NUMBER_LENGTH + 1];
+  char num2[TEST_NUMBER_LENGTH + 1];
+  for (int k = 0; k < 500; ++k) {
+    testRandomNumber(state, num1, maxLength, digits);
+    testRandomNumber(state, num2, maxLength, digits);
+    if (k % 10 == 0) {
+      num1[1 + testRandom(state) % 2] = '\0';
+      TEST_CHECK(phfwdRemove(built, num1) == phfwdRemove(expected, num1));
+    } else {
+      TEST_CHECK(phfwdAdd(built, num1, num2) == phfwdAdd(expected, num1, num2));
+    }
+  }
+
+  testCompare(state, built, expected, maxLength, digits);
+}
+
+/// @brief Losuje tablicę przekierowań.
+/// Co ósma para powtarza wcześniejsze @p num1, a rzadziej pojawiają się pary
+/// o równych numerach, napisy niebędące numerami i wskaźniki @p NULL.
+/// @param[in,out] state – stan generatora.
+/// @param[out] pairs – tablica przekierowań.
+/// @param[out] numbers – pamięć na numery, po dwa na parę.
+/// @param[in] count – liczba przekierowań.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testRandomPairs(uint64_t *state, struct PhoneForwardPair *pairs,
+                            char (*numbers)[TEST_NUMBER_LENGTH + 1],
+                            size_t count, int maxLength, int digits) {
+  for (size_t i = 0; i < count; ++i) {
+    char *num1 = numbers[2 * i];
+    char *num2 = numbers[2 * i + 1];
+    testRandomNumber(state, num1, maxLength, digits);
+    testRandomNumber(state, num2, maxLength, digits);
+    pairs[i].num1 = num1;
+    pairs[i].num2 = num2;
+
+    int kind = testRandom(state) % 64;
+    if (kind < 8 && i > 0)
+      strcpy(num1, numbers[2 * (testRandom(state) % i)]);
+    else if (kind == 8)
+      strcpy(num2, num1);
+    else if (kind == 9)
+      num1[testRandom(state) % strlen(num1)] = 'a';
+    else if (kind == 10)
+      num2[0] = '\0';
+    else if (kind == 11)
+      pairs[i].num2 = NULL;
+  }
+}
+
+/// @brief Dodaje kolejno przekierowania z tablicy do nowej struktury.
+/// @param[in] pairs – tablica przekierowań.
+/// @param[in] count – liczba przekierowań.
+/// @return Utworzona struktura.
+static struct PhoneForward *testAddAll(const struct PhoneForwardPair *pairs,
+                                       size_t count) {
+  struct PhoneForward *pf = phfwdNew();
+  TEST_CHECK(pf);
+  for (size_t i = 0; i < count; ++i)
+    TEST_CHECK(phfwdAdd(pf, pairs[i].num1, pairs[i].num2));
+
+  return pf;
+}
+
+/// @brief Porównuje zbudowaną strukturę z dodawaniem po jednym i zmienia ją.
+/// @param[in,out] state – stan generatora.
+/// @param[in,out] built – struktura zbudowana z tablicy, usuwana na końcu.
+/// @param[in] pairs – poprawne przekierowania z tablicy.
+/// @param[in] count – liczba przekierowań.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testBuilt(uint64_t *state, struct PhoneForward *built,
+                      const struct PhoneForwardPair *pairs, size_t count,
+                      int maxLength, int digits) {
+  TEST_CHECK(built);
+  struct PhoneForward *expected = testAddAll(pairs, count);
+  testCompare(state, built, expected, maxLength, digits);
+  testChange(state, built, expected, maxLength, digits);
+  phfwdDelete(built);
+  phfwdDelete(expected);
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – numer powtórzenia.
+static void testSeed(int seed) {
+  uint64_t state = (uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ull;
+  size_t count = seed % 2 ? TEST_LARGE_COUNT : TEST_SMALL_COUNT;
+  int digits = seed % 3 == 0 ? 12 : 3;
+  int maxLength = seed % 4 < 2 ? 6 : TEST_NUMBER_LENGTH;
+
+  struct PhoneForwardPair *pairs = malloc(count * sizeof(*pairs));
+  char(*numbers)[TEST_NUMBER_LENGTH + 1] = malloc(2 * count * sizeof(*numbers));
+  TEST_CHECK(pairs && numbers);
+  testRandomPairs(&state, pairs, numbers, count, maxLength, digits);
+
+  // Pairs rejected by phfwdAdd make the whole array invalid.
+  TEST_CHECK(!phfwdBuildFromPairs(pairs, count));
+  for (int threads = 1; threads <= TEST_MAX_THREADS; threads *= 2)
+    TEST_CHECK(!phfwdBuildFromPairsParallel(pairs, count, threads));
+
+  struct PhoneForward *expected = phfwdNew();
+  TEST_CHECK(expected);
+  struct TestModel model;
+  testModelInit(&model);
+  size_t valid = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bool added = phfwdAdd(expected, pairs[i].num1, pairs[i].num2);
+    if (count <= TEST_SMALL_COUNT)
+      TEST_CHECK(added == testModelAdd(&model, pairs[i].num1, pairs[i].num2));
+    if (added)
+      pairs[valid++] = pairs[i];
+  }
+  TEST_CHECK(valid < count);
+  if (count <= TEST_SMALL_COUNT)
+    testCompareModel(&state, expected, &model, maxLength, digits);
+  phfwdDelete(expected);
+  testModelFree(&model);
+
+  testBuilt(&state, phfwdBuildFromPairs(pairs, valid), pairs, valid, maxLength,
+            digits);
+  for (int threads = 1; threads <= TEST_MAX_THREADS; threads *= 2)
+    testBuilt(&state, phfwdBuildFromPairsParallel(pairs, valid, threads), pairs,
+              valid, maxLength, digits);
+
+  free(numbers);
+  free(pairs);
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int seeds = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_SEEDS;
+  for (int seed = 0; seed < seeds; ++seed)
+    testSeed(seed);
+
+  uint64_t state = 1;
+  struct PhoneForward *empty = phfwdBuildFromPairs(NULL, 0);
+  struct PhoneForward *expected = phfwdNew();
+  TEST_CHECK(empty && expected);
+  testChange(&state, empty, expected, 4, 3);
+  phfwdDelete(empty);
+  phfwdDelete(expected);
+  return 0;
+}
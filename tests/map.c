@@ -0,0 +1,124 @@
+/// @file
+/// Test struktury odwzorowanej z pliku przez @ref phfwdMap.
+///
+/// Zapisuje strukturę z losowymi przekierowaniami, odwzorowuje plik i
+/// porównuje wyniki @ref phfwdGet, @ref phfwdReverse, @ref
+/// phfwdReverseParallel i @ref phfwdNonTrivialCount z wynikami zapisanej
+/// struktury, a części zapytań także z modelem. Sprawdza też, że odwzorowanej
+/// struktury nie da się zmienić, a zapisanie jej daje plik, który odwzorowuje
+/// się na te same przekierowania.
+///
+/// Użycie: test_map [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (12)
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (12)
+
+/// Liczba zapytań porównywanych także z modelem.
+#define TEST_MODEL_QUERIES (200)
+
+/// Plik, do którego zapisywana jest struktura.
+#define TEST_FILE "test_map.bin"
+
+/// Plik, do którego zapisywana jest odwzorowana struktura.
+#define TEST_COPY_FILE "test_map_copy.bin"
+
+/// @brief Porównuje wyniki zapytań dwóch struktur.
+/// @param[in,out] state – stan generatora.
+/// @param[in,out] mapped – struktura odwzorowana z pliku.
+/// @param[in,out] expected – struktura o tej samej zawartości.
+/// @param[in] model – model o tej samej zawartości.
+/// @param[in] maxLength – największa długość numerów.
+/// @param[in] digits – liczba używanych cyfr.
+static void testCompare(uint64_t *state, struct PhoneForward *mapped,
+                        struct PhoneForward *expected,
+                        const struct TestModel *model, int maxLength,
+                        int digits) {
+  char num[TEST_NUMBER_LENGTH + 1];
+  for (int q = 0; q < 2000; ++q) {
+    testRandomNumber(state, num, maxLength, digits);
+    TEST_CHECK(
+        testSameAndDelete(phfwdGet(mapped, num), phfwdGet(expected, num)));
+    TEST_CHECK(testSameAndDelete(phfwdReverse(mapped, num),
+                                 phfwdReverse(expected, num)));
+    TEST_CHECK(testSameAndDelete(phfwdReverseParallel(mapped, num, 4),
+                                 phfwdReverse(expected, num)));
+
+    size_t length = 1 + testRandom(state) % 6;
+    TEST_CHECK(phfwdNonTrivialCount(mapped, num, length) ==
+               phfwdNonTrivialCount(expected, num, length));
+
+    if (q < TEST_MODEL_QUERIES) {
+      TEST_CHECK(testModelSameGet(model, num, phfwdGet(mapped, num)));
+      TEST_CHECK(testModelSameReverse(model, num, phfwdReverse(mapped, num)));
+      TEST_CHECK(phfwdNonTrivialCount(mapped, num, length) ==
+                 testModelNonTrivialCount(model, num, length));
+    }
+  }
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – numer powtórzenia.
+static void testSeed(int seed) {
+  uint64_t state = (uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ull;
+  int rules = seed % 4 == 0 ? 10 : 20000;
+  int digits = seed % 3 == 0 ? 12 : 3;
+  int maxLength = seed % 2 ? 5 : TEST_NUMBER_LENGTH;
+
+  struct PhoneForward *pf = phfwdNew();
+  TEST_CHECK(pf);
+  struct TestModel model;
+  testModelInit(&model);
+
+  char num1[TEST_NUMBER_LENGTH + 1];
+  char num2[TEST_NUMBER_LENGTH + 1];
+  for (int i = 0; i < rules; ++i) {
+    testRandomNumber(&state, num1, maxLength, digits);
+    testRandomNumber(&state, num2, maxLength, digits);
+    TEST_CHECK(phfwdAdd(pf, num1, num2) == testModelAdd(&model, num1, num2));
+    if (i % 13 == 0) {
+      testRandomNumber(&state, num1, 3, digits);
+      phfwdRemove(pf, num1);
+      testModelRemove(&model, num1);
+    }
+  }
+
+  TEST_CHECK(phfwdSave(pf, TEST_FILE));
+  struct PhoneForward *mapped = phfwdMap(TEST_FILE);
+  TEST_CHECK(mapped);
+
+  TEST_CHECK(!phfwdAdd(mapped, "1", "2"));
+  TEST_CHECK(!phfwdRemove(mapped, "1"));
+  testCompare(&state, mapped, pf, &model, maxLength, digits);
+
+  TEST_CHECK(phfwdSave(mapped, TEST_COPY_FILE));
+  struct PhoneForward *copy = phfwdMap(TEST_COPY_FILE);
+  TEST_CHECK(copy);
+  testCompare(&state, copy, pf, &model, maxLength, digits);
+
+  phfwdDelete(copy);
+  phfwdDelete(mapped);
+  phfwdDelete(pf);
+  testModelFree(&model);
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int seeds = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_SEEDS;
+  for (int seed = 0; seed < seeds; ++seed)
+    testSeed(seed);
+
+  remove(TEST_FILE);
+  remove(TEST_COPY_FILE);
+  return 0;
+}
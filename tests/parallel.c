@@ -0,0 +1,121 @@
+/// @file
+/// Test zapytań wykonywanych na wielu wątkach.
+///
+/// Porównuje wyniki @ref phfwdReverseParallel z @ref phfwdReverseConst oraz
+/// @ref phfwdNonTrivialCountParallel z @ref phfwdNonTrivialCountConst dla
+/// różnych liczb wątków, a wyniki jednowątkowe także z modelem.
+/// Przekierowania na jeden numer są tak liczne, że kandydaci są dzieleni
+/// między wątki, a zbiory cyfr obejmują zarówno niewielkie, jak i całe drzewa
+/// prefiksów.
+///
+/// Użycie: test_parallel [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (8)
+
+/// Największa liczba wątków.
+#define TEST_MAX_THREADS (8)
+
+/// Numer, na który jest wykonywana większość przekierowań.
+#define TEST_TARGET "5231234567012"
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (25)
+
+/// @brief Porównuje wyniki @ref phfwdReverseParallel.
+/// @param[in,out] state – stan generatora.
+/// @param[in] pf – struktura z przekierowaniami.
+/// @param[in] model – model o tej samej zawartości.
+/// @param[in] digits – liczba używanych cyfr.
+static void testReverse(uint64_t *state, const struct PhoneForward *pf,
+                        const struct TestModel *model, int digits) {
+  char num[2 * TEST_NUMBER_LENGTH];
+  for (int q = 0; q < 6; ++q) {
+    strcpy(num, TEST_TARGET);
+    if (q > 0) {
+      size_t length = 1 + testRandom(state) % strlen(TEST_TARGET);
+      testRandomNumber(state, num + length, 3, digits);
+    }
+
+    const struct PhoneNumbers *expected = phfwdReverseConst(pf, num);
+    for (int threads = 1; threads <= TEST_MAX_THREADS; threads *= 2) {
+      const struct PhoneNumbers *result =
+          phfwdReverseParallel(pf, num, threads);
+      TEST_CHECK(testSameNumbers(expected, result));
+      phnumDelete(result);
+    }
+    TEST_CHECK(testModelSameReverse(model, num, expected));
+  }
+}
+
+/// @brief Porównuje wyniki @ref phfwdNonTrivialCountParallel.
+/// @param[in] pf – struktura z przekierowaniami.
+/// @param[in] model – model o tej samej zawartości.
+static void testNonTrivialCount(const struct PhoneForward *pf,
+                                const struct TestModel *model) {
+  static const char *sets[] = {"0", "01", "0123", "13", ":;0", "0123456789:;"};
+  for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s)
+    for (size_t length = 1; length < 120; length += length / 2 + 1) {
+      size_t expected = phfwdNonTrivialCountConst(pf, sets[s], length);
+      TEST_CHECK(expected == testModelNonTrivialCount(model, sets[s], length));
+      for (int threads = 1; threads <= TEST_MAX_THREADS; threads *= 2)
+        TEST_CHECK(expected ==
+                   phfwdNonTrivialCountParallel(pf, sets[s], length, threads));
+    }
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – numer powtórzenia.
+static void testSeed(int seed) {
+  uint64_t state = (uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ull;
+  int rules = seed % 4 == 0 ? 100 : 40000;
+  int digits = seed % 3 == 0 ? 12 : 3;
+  int maxLength = seed % 2 ? 4 : 20;
+
+  struct PhoneForward *pf = phfwdNew();
+  TEST_CHECK(pf);
+  struct TestModel model;
+  testModelInit(&model);
+
+  char num1[TEST_NUMBER_LENGTH + 1];
+  char num2[TEST_NUMBER_LENGTH + 1];
+  for (int i = 0; i < rules; ++i) {
+    testRandomNumber(&state, num1, maxLength, digits);
+    if (testRandom(&state) % 4 == 0) {
+      testRandomNumber(&state, num2, 6, digits);
+    } else {
+      size_t length = 1 + testRandom(&state) % strlen(TEST_TARGET);
+      memcpy(num2, TEST_TARGET, length);
+      num2[length] = '\0';
+    }
+    TEST_CHECK(phfwdAdd(pf, num1, num2) == testModelAdd(&model, num1, num2));
+
+    if (i % 97 == 0) {
+      testRandomNumber(&state, num1, 2, digits);
+      phfwdRemove(pf, num1);
+      testModelRemove(&model, num1);
+    }
+  }
+
+  testReverse(&state, pf, &model, digits);
+  testNonTrivialCount(pf, &model);
+  phfwdDelete(pf);
+  testModelFree(&model);
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int seeds = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_SEEDS;
+  for (int seed = 0; seed < seeds; ++seed)
+    testSeed(seed);
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/// @file
+/// Test pamięci wyników włączanej przez @ref phfwdCacheEnable.
+///
+/// Wykonuje te same losowe zmiany i zapytania na dwóch strukturach, z których
+/// tylko jedna ma włączoną pamięć wyników, a także na modelu, i porównuje
+/// wyniki @ref phfwdGet oraz @ref phfwdReverse. Wyniki @ref phfwdGetConst,
+/// która pomija pamięć, są porównywane z modelem. Zapytania powtarzają się
+/// często, a zmiany dotyczą prefiksów wcześniej zadanych numerów, więc
+/// zapamiętane wyniki muszą być poprawnie unieważniane. Pamięć ma różne
+/// pojemności, także jednoelementową.
+///
+/// Użycie: test_result_cache [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (24)
+
+/// Liczba operacji w jednym powtórzeniu.
+#define TEST_OPERATIONS (20000)
+
+/// Liczba często zadawanych numerów.
+#define TEST_POOL_SIZE (64)
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (70)
+
+/// @brief Losuje prefiks jednego z często zadawanych numerów.
+/// @param[in,out] state – stan generatora.
+/// @param[out] out – bufor na co najmniej @p TEST_NUMBER_LENGTH + 1 znaków.
+/// @param[in] num – numer, którego prefiks jest losowany.
+/// @param[in] maxLength – największa długość prefiksu.
+static void testRandomPrefix(uint64_t *state, char *out, const char *num,
+                             size_t maxLength) {
+  size_t length = strlen(num);
+  if (length > maxLength)
+    length = maxLength;
+
+  length = 1 + testRandom(state) % length;
+  memcpy(out, num, length);
+  out[length] = '\0';
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – numer powtórzenia.
+static void testSeed(int seed) {
+  static const size_t capacities[] = {1, 16, 512, 4096};
+  uint64_t state = (uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ull;
+  int digits = seed % 3 == 0 ? 12 : (seed % 3 == 1 ? 2 : 4);
+  int maxLength = seed % 2 ? 6 : TEST_NUMBER_LENGTH;
+
+  struct PhoneForward *plain = phfwdNew();
+  struct PhoneForward *cached = phfwdNew();
+  TEST_CHECK(plain && cached);
+  TEST_CHECK(phfwdCacheEnable(cached, capacities[seed % 4]));
+  struct TestModel model;
+  testModelInit(&model);
+
+  char pool[TEST_POOL_SIZE][TEST_NUMBER_LENGTH + 1];
+  for (int i = 0; i < TEST_POOL_SIZE; ++i)
+    testRandomNumber(&state, pool[i], maxLength, digits);
+
+  char num1[TEST_NUMBER_LENGTH + 1];
+  char num2[TEST_NUMBER_LENGTH + 1];
+  for (int k = 0; k < TEST_OPERATIONS; ++k) {
+    int action = testRandom(&state) % 100;
+    const char *num = pool[testRandom(&state) % TEST_POOL_SIZE];
+
+    if (action < 15) {
+      if (testRandom(&state) % 2)
+        testRandomPrefix(&state, num1, num, TEST_NUMBER_LENGTH);
+      else
+        testRandomNumber(&state, num1, maxLength, digits);
+      testRandomPrefix(&state, num2, pool[testRandom(&state) % TEST_POOL_SIZE],
+                       TEST_NUMBER_LENGTH);
+      bool added = testModelAdd(&model, num1, num2);
+      TEST_CHECK(phfwdAdd(plain, num1, num2) == added);
+      TEST_CHECK(phfwdAdd(cached, num1, num2) == added);
+    } else if (action < 19) {
+      testRandomPrefix(&state, num1, num, 4);
+      phfwdRemove(plain, num1);
+      phfwdRemove(cached, num1);
+      testModelRemove(&model, num1);
+    } else {
+      if (testRandom(&state) % 3 == 0) {
+        testRandomNumber(&state, num1, maxLength, digits);
+        num = num1;
+      }
+
+      if (action % 2) {
+        TEST_CHECK(
+            testSameAndDelete(phfwdGet(plain, num), phfwdGet(cached, num)));
+        TEST_CHECK(testModelSameGet(&model, num, phfwdGet(cached, num)));
+        TEST_CHECK(testModelSameGet(&model, num, phfwdGetConst(cached, num)));
+      } else {
+        TEST_CHECK(testSameAndDelete(phfwdReverse(plain, num),
+                                     phfwdReverse(cached, num)));
+        TEST_CHECK(
+            testModelSameReverse(&model, num, phfwdReverse(cached, num)));
+      }
+    }
+  }
+
+  // Every query repeats often, so a working cache must have some hits.
+  struct PhoneForwardCacheStats stats;
+  phfwdCacheStats(cached, &stats);
+  TEST_CHECK(stats.getHits > 0 && stats.reverseHits > 0);
+
+  phfwdDelete(plain);
+  phfwdDelete(cached);
+  testModelFree(&model);
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int seeds = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_SEEDS;
+  for (int seed = 0; seed < seeds; ++seed)
+    testSeed(seed);
+
+  return 0;
+}
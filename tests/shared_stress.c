@@ -0,0 +1,169 @@
+/// @file
+/// Test struktury współdzielonej przez wiele wątków.
+///
+/// Wątki czytające bez przerwy wykonują zapytania @ref phfwdSharedGet, @ref
+/// phfwdSharedReverse i @ref phfwdSharedNonTrivialCount, a w tym czasie
+/// główny wątek dodaje i usuwa losowe przekierowania, wykonując te same
+/// zmiany na zwykłej strukturze i na modelu. Czytelnicy sprawdzają, czy każdy
+/// wynik jest poprawnie zbudowany, a na koniec wyniki obu struktur są
+/// porównywane ze sobą i z modelem. Test
+/// najlepiej uruchamiać w wersji zbudowanej z opcją @p SANITIZE, np. @p
+/// thread lub @p address.
+///
+/// Użycie: test_shared_stress [liczba czytelników] [liczba zmian]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "phone_forward_shared.h"
+#include "test_util.h"
+
+/// Domyślna liczba wątków czytających.
+#define TEST_DEFAULT_READERS (3)
+
+/// Największa liczba wątków czytających.
+#define TEST_MAX_READERS (16)
+
+/// Domyślna liczba zmian struktury.
+#define TEST_DEFAULT_WRITES (5000)
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (6)
+
+/// Liczba cyfr używanych w losowanych numerach.
+#define TEST_DIGITS (4)
+
+/// Badana struktura.
+static struct PhoneForwardShared *testShared;
+
+/// Czy czytelnicy mają zakończyć pracę.
+static atomic_bool testDone;
+
+/// @brief Sprawdza, czy wynik @ref phfwdSharedReverse jest poprawny.
+/// Wynik musi być posortowany ściśle rosnąco i zawierać dany numer.
+/// @param[in] result – wynik zapytania.
+/// @param[in] num – numer z zapytania.
+/// @return @p true, gdy wynik jest poprawny lub nie udało się go wyznaczyć.
+static bool testReverseWellFormed(const struct PhoneNumbers *result,
+                                  const char *num) {
+  if (!result)
+    return true;
+
+  bool found = false;
+  const char *previous = NULL;
+  const char *current;
+  for (size_t i = 0; (current = phnumGet(result, i)); ++i) {
+    if (previous && strcmp(previous, current) >= 0)
+      return false;
+    found |= strcmp(current, num) == 0;
+    previous = current;
+  }
+
+  return found;
+}
+
+/// @brief Wykonuje zapytania do chwili zakończenia zmian.
+/// @param[in] argument – ziarno generatora liczb losowych.
+/// @return @p NULL, gdy wszystkie wyniki były poprawne, w przeciwnym wypadku
+///         wskaźnik różny od @p NULL.
+static void *testReader(void *argument) {
+  uint64_t state = (uint64_t)(uintptr_t)argument;
+  char num[TEST_NUMBER_LENGTH + 1];
+  void *failed = NULL;
+
+  while (!atomic_load(&testDone)) {
+    testRandomNumber(&state, num, TEST_NUMBER_LENGTH, TEST_DIGITS);
+
+    const struct PhoneNumbers *result = phfwdSharedGet(testShared, num);
+    if (result && !phnumGet(result, 0))
+      failed = &testDone;
+    phnumDelete(result);
+
+    result = phfwdSharedReverse(testShared, num);
+    if (!testReverseWellFormed(result, num))
+      failed = &testDone;
+    phnumDelete(result);
+
+    phfwdSharedNonTrivialCount(testShared, "0123", 3);
+  }
+
+  return failed;
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba czytelników i liczba zmian.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int readers = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_READERS;
+  int writes = argc > 2 ? atoi(argv[2]) : TEST_DEFAULT_WRITES;
+  if (readers < 1 || readers > TEST_MAX_READERS)
+    readers = TEST_DEFAULT_READERS;
+
+  testShared = phfwdSharedNew();
+  struct PhoneForward *reference = phfwdNew();
+  TEST_CHECK(testShared && reference);
+  struct TestModel model;
+  testModelInit(&model);
+
+  pthread_t threads[TEST_MAX_READERS];
+  for (int i = 0; i < readers; ++i)
+    TEST_CHECK(pthread_create(&threads[i], NULL, testReader,
+                              (void *)(uintptr_t)(i + 1)) == 0);
+
+  uint64_t state = 42;
+  char num1[TEST_NUMBER_LENGTH + 1];
+  char num2[TEST_NUMBER_LENGTH + 1];
+  for (int i = 0; i < writes; ++i) {
+    testRandomNumber(&state, num1, TEST_NUMBER_LENGTH, TEST_DIGITS);
+    testRandomNumber(&state, num2, TEST_NUMBER_LENGTH, TEST_DIGITS);
+    if (testRandom(&state) % 5 == 0) {
+      num1[1 + testRandom(&state) % 2] = '\0';
+      TEST_CHECK(phfwdSharedRemove(testShared, num1));
+      phfwdRemove(reference, num1);
+      testModelRemove(&model, num1);
+    } else {
+      bool added = testModelAdd(&model, num1, num2);
+      TEST_CHECK(phfwdSharedAdd(testShared, num1, num2) == added);
+      TEST_CHECK(phfwdAdd(reference, num1, num2) == added);
+    }
+  }
+
+  atomic_store(&testDone, true);
+  bool readersFailed = false;
+  for (int i = 0; i < readers; ++i) {
+    void *failed;
+    TEST_CHECK(pthread_join(threads[i], &failed) == 0);
+    readersFailed |= failed != NULL;
+  }
+  TEST_CHECK(!readersFailed);
+
+  // Both copies are compared: the second one is in use after the next change.
+  for (int pass = 0; pass < 2; ++pass) {
+    state = 7;
+    for (int i = 0; i < 3000; ++i) {
+      testRandomNumber(&state, num1, TEST_NUMBER_LENGTH, TEST_DIGITS);
+      TEST_CHECK(testSameAndDelete(phfwdSharedGet(testShared, num1),
+                                   phfwdGet(reference, num1)));
+      TEST_CHECK(testSameAndDelete(phfwdSharedReverse(testShared, num1),
+                                   phfwdReverse(reference, num1)));
+      TEST_CHECK(testModelSameGet(&model, num1,
+                                  phfwdSharedGet(testShared, num1)));
+      TEST_CHECK(testModelSameReverse(&model, num1,
+                                      phfwdSharedReverse(testShared, num1)));
+    }
+    TEST_CHECK(phfwdSharedNonTrivialCount(testShared, "0123", 4) ==
+               phfwdNonTrivialCount(reference, "0123", 4));
+    TEST_CHECK(phfwdSharedNonTrivialCount(testShared, "0123", 4) ==
+               testModelNonTrivialCount(&model, "0123", 4));
+    TEST_CHECK(phfwdSharedRemove(testShared, "9"));
+  }
+
+  phfwdSharedDelete(testShared);
+  phfwdDelete(reference);
+  testModelFree(&model);
+  return 0;
+}
@@ -0,0 +1,204 @@
+/// @file
+/// Test migawek struktury.
+///
+/// Wykonuje losowe zmiany struktury, co jakiś czas tworząc i usuwając
+/// migawki. Dla każdej migawki buduje od nowa strukturę z tych samych zmian,
+/// wykonanych do chwili utworzenia migawki, i porównuje z nią wyniki @ref
+/// phfwdSnapshotGet, @ref phfwdSnapshotReverse i @ref
+/// phfwdSnapshotNonTrivialCount. Wyniki zmienianej struktury są porównywane
+/// ze strukturą, która nigdy nie miała migawek, oraz z modelem. Po usunięciu
+/// migawek struktura musi dać się zapisać i wczytać.
+///
+/// Użycie: test_snapshot [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (30)
+
+/// Największa liczba zmian w jednym powtórzeniu.
+#define TEST_MAX_OPERATIONS (1700)
+
+/// Największa liczba jednocześnie istniejących migawek.
+#define TEST_MAX_SNAPSHOTS (6)
+
+/// Największa długość losowanych numerów.
+#define TEST_NUMBER_LENGTH (9)
+
+/// Liczba cyfr używanych w losowanych numerach.
+#define TEST_DIGITS (3)
+
+/// Plik, do którego zapisywana jest struktura.
+#define TEST_FILE "test_snapshot.bin"
+
+/// Zmiana struktury.
+struct TestOperation {
+  /// Czy przekierowania są usuwane, a nie dodawane.
+  bool remove;
+
+  /// Pierwszy parametr @ref phfwdAdd lub parametr @ref phfwdRemove.
+  char num1[TEST_NUMBER_LENGTH + 1];
+
+  /// Drugi parametr @ref phfwdAdd.
+  char num2[TEST_NUMBER_LENGTH + 1];
+};
+
+/// Wszystkie zmiany bieżącego powtórzenia.
+static struct TestOperation testOperations[TEST_MAX_OPERATIONS];
+
+/// @brief Wykonuje zmianę struktury.
+/// @param[in,out] pf – zmieniana struktura.
+/// @param[in] operation – zmiana.
+static void testApply(struct PhoneForward *pf,
+                      const struct TestOperation *operation) {
+  if (operation->remove)
+    TEST_CHECK(phfwdRemove(pf, operation->num1));
+  else
+    phfwdAdd(pf, operation->num1, operation->num2);
+}
+
+/// @brief Wykonuje zmianę modelu.
+/// @param[in,out] model – zmieniany model.
+/// @param[in] operation – zmiana.
+static void testApplyModel(struct TestModel *model,
+                           const struct TestOperation *operation) {
+  if (operation->remove)
+    testModelRemove(model, operation->num1);
+  else
+    testModelAdd(model, operation->num1, operation->num2);
+}
+
+/// @brief Losuje zmianę struktury.
+/// Usuwane są często krótkie prefiksy, które obejmują wiele przekierowań.
+/// @param[in,out] state – stan generatora.
+/// @param[out] operation – wylosowana zmiana.
+/// @param[in] maxLength – największa długość numerów.
+static void testRandomOperation(uint64_t *state,
+                                struct TestOperation *operation,
+                                int maxLength) {
+  operation->remove = testRandom(state) % 4 == 0;
+  testRandomNumber(state, operation->num1, maxLength, TEST_DIGITS);
+  testRandomNumber(state, operation->num2, maxLength, TEST_DIGITS);
+  if (operation->remove && testRandom(state) % 3 == 0)
+    operation->num1[1] = '\0';
+}
+
+/// @brief Porównuje migawkę ze strukturą o tej samej zawartości.
+/// @param[in,out] state – stan generatora.
+/// @param[in] snapshot – migawka.
+/// @param[in] expected – struktura o zawartości migawki.
+/// @param[in] num – numer z zapytań.
+static void testCompareSnapshot(uint64_t *state,
+                                const struct PhoneForwardSnapshot *snapshot,
+                                struct PhoneForward *expected,
+                                const char *num) {
+  TEST_CHECK(testSameAndDelete(phfwdSnapshotGet(snapshot, num),
+                               phfwdGet(expected, num)));
+  TEST_CHECK(testSameAndDelete(phfwdSnapshotReverse(snapshot, num),
+                               phfwdReverse(expected, num)));
+
+  size_t length = 1 + testRandom(state) % 5;
+  TEST_CHECK(phfwdSnapshotNonTrivialCount(snapshot, "012", length) ==
+             phfwdNonTrivialCount(expected, "012", length));
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – ziarno generatora liczb losowych.
+static void testSeed(uint64_t seed) {
+  uint64_t state = seed;
+  struct PhoneForward *pf = phfwdNew();
+  struct PhoneForward *reference = phfwdNew();
+  TEST_CHECK(pf && reference);
+  struct TestModel model;
+  testModelInit(&model);
+
+  struct PhoneForwardSnapshot *snapshots[TEST_MAX_SNAPSHOTS] = {NULL};
+  struct PhoneForward *expected[TEST_MAX_SNAPSHOTS] = {NULL};
+  int operations = 200 + testRandom(&state) % (TEST_MAX_OPERATIONS - 200);
+  int maxLength = 2 + testRandom(&state) % (TEST_NUMBER_LENGTH - 3);
+  char num[TEST_NUMBER_LENGTH + 1];
+
+  for (int k = 0; k < operations; ++k) {
+    testRandomOperation(&state, &testOperations[k], maxLength);
+    testApply(pf, &testOperations[k]);
+    testApply(reference, &testOperations[k]);
+    testApplyModel(&model, &testOperations[k]);
+
+    int action = testRandom(&state) % 20;
+    int s = testRandom(&state) % TEST_MAX_SNAPSHOTS;
+    if (action < 2 && snapshots[s]) {
+      phfwdSnapshotDelete(snapshots[s]);
+      phfwdDelete(expected[s]);
+      snapshots[s] = NULL;
+    }
+    if (action == 0) {
+      snapshots[s] = phfwdSnapshot(pf);
+      expected[s] = phfwdNew();
+      TEST_CHECK(snapshots[s] && expected[s]);
+      for (int j = 0; j <= k; ++j)
+        testApply(expected[s], &testOperations[j]);
+    }
+
+    testRandomNumber(&state, num, maxLength + 2, TEST_DIGITS);
+    TEST_CHECK(testSameAndDelete(phfwdGet(pf, num), phfwdGet(reference, num)));
+    TEST_CHECK(
+        testSameAndDelete(phfwdReverse(pf, num), phfwdReverse(reference, num)));
+    TEST_CHECK(phfwdNonTrivialCount(pf, "0123", 3) ==
+               phfwdNonTrivialCount(reference, "0123", 3));
+    TEST_CHECK(testModelSameGet(&model, num, phfwdGet(pf, num)));
+    TEST_CHECK(testModelSameReverse(&model, num, phfwdReverse(pf, num)));
+    TEST_CHECK(phfwdNonTrivialCount(pf, "0123", 3) ==
+               testModelNonTrivialCount(&model, "0123", 3));
+    for (s = 0; s < TEST_MAX_SNAPSHOTS; ++s)
+      if (snapshots[s])
+        testCompareSnapshot(&state, snapshots[s], expected[s], num);
+  }
+
+  for (int s = 0; s < TEST_MAX_SNAPSHOTS; ++s)
+    if (snapshots[s]) {
+      phfwdSnapshotDelete(snapshots[s]);
+      phfwdDelete(expected[s]);
+    }
+
+  // The memory of replaced nodes is reclaimed, so the tries must be whole.
+  TEST_CHECK(phfwdSave(pf, TEST_FILE));
+  struct PhoneForward *loaded = phfwdLoad(TEST_FILE);
+  TEST_CHECK(loaded);
+  for (int k = 0; k < 300; ++k) {
+    struct TestOperation operation;
+    testRandomOperation(&state, &operation, maxLength);
+    testApply(pf, &operation);
+    testApply(reference, &operation);
+    testApply(loaded, &operation);
+    testApplyModel(&model, &operation);
+
+    testRandomNumber(&state, num, maxLength + 2, TEST_DIGITS);
+    TEST_CHECK(testSameAndDelete(phfwdGet(pf, num), phfwdGet(reference, num)));
+    TEST_CHECK(
+        testSameAndDelete(phfwdReverse(pf, num), phfwdReverse(reference, num)));
+    TEST_CHECK(testSameAndDelete(phfwdReverse(loaded, num),
+                                 phfwdReverse(reference, num)));
+    TEST_CHECK(testModelSameGet(&model, num, phfwdGet(loaded, num)));
+  }
+
+  phfwdDelete(pf);
+  phfwdDelete(reference);
+  phfwdDelete(loaded);
+  testModelFree(&model);
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  int seeds = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_SEEDS;
+  for (int seed = 1; seed <= seeds; ++seed)
+    testSeed((uint64_t)seed * 0x9E3779B97F4A7C15ull);
+
+  remove(TEST_FILE);
+  return 0;
+}
@@ -0,0 +1,368 @@
+/// @file
+/// Funkcje pomocnicze wspólne dla testów.
+///
+/// Każdy test jest osobnym programem, który porównuje wyniki badanych funkcji
+/// z wynikami prostszych funkcji o tej samej specyfikacji na losowych
+/// przekierowaniach. Program kończy się kodem 0, gdy wszystkie wyniki są
+/// zgodne, a w przeciwnym wypadku wypisuje pierwszą niezgodność i kończy się
+/// kodem 1.
+///
+/// Najprostszą z tych funkcji jest model (@ref TestModel): zwykła tablica par
+/// (@p num1, @p num2), w której każde zapytanie przegląda wszystkie pary. Nie
+/// korzysta z żadnego kodu struktury, więc wyniki struktury są z nim
+/// porównywane niezależnie od tego, czy są zgodne z innymi jej wariantami.
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#ifndef __TEST_UTIL_H__
+#define __TEST_UTIL_H__
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phone_forward.h"
+
+/// @brief Sprawdza warunek.
+/// Gdy warunek @p condition nie jest spełniony, wypisuje go wraz z miejscem
+/// w kodzie i kończy program kodem 1.
+/// @param[in] condition – sprawdzany warunek.
+#define TEST_CHECK(condition)                                                  \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+/// @brief Losuje liczbę generatorem xorshift.
+/// @param[in,out] state – niezerowy stan generatora.
+/// @return Kolejna liczba losowa.
+static inline uint64_t testRandom(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/// @brief Losuje numer.
+/// Numer ma od 1 do @p maxLength cyfr spośród @p digits pierwszych cyfr
+/// alfabetu @p "0123456789:;".
+/// @param[in,out] state – stan generatora.
+/// @param[out] out – bufor na co najmniej @p maxLength + 1 znaków.
+/// @param[in] maxLength – największa długość numeru.
+/// @param[in] digits – liczba używanych cyfr, od 1 do 12.
+static inline void testRandomNumber(uint64_t *state, char *out, int maxLength,
+                                    int digits) {
+  int length = 1 + (int)(testRandom(state) % (uint64_t)maxLength);
+  for (int i = 0; i < length; ++i)
+    out[i] = (char)('0' + testRandom(state) % (uint64_t)digits);
+
+  out[length] = '\0';
+}
+
+/// @brief Porównuje dwa ciągi numerów.
+/// @param[in] first – pierwszy ciąg.
+/// @param[in] second – drugi ciąg.
+/// @return @p true, gdy oba ciągi zawierają te same numery w tej samej
+///         kolejności, @p false w przeciwnym wypadku.
+static inline bool testSameNumbers(const struct PhoneNumbers *first,
+                                   const struct PhoneNumbers *second) {
+  for (size_t i = 0;; ++i) {
+    const char *a = phnumGet(first, i);
+    const char *b = phnumGet(second, i);
+    if (!a || !b)
+      return a == b;
+    if (strcmp(a, b) != 0)
+      return false;
+  }
+}
+
+/// @brief Porównuje wyniki i zwalnia je.
+/// @param[in] first – pierwszy ciąg.
+/// @param[in] second – drugi ciąg.
+/// @return Wynik @ref testSameNumbers.
+static inline bool testSameAndDelete(const struct PhoneNumbers *first,
+                                     const struct PhoneNumbers *second) {
+  bool result = testSameNumbers(first, second);
+  phnumDelete(first);
+  phnumDelete(second);
+  return result;
+}
+
+/// Model przekierowań: tablica par przeglądana w całości przy każdym
+/// zapytaniu.
+struct TestModel {
+  /// Prefiksy numerów przekierowywanych, parami różne.
+  char **num1;
+
+  /// Prefiksy numerów, na które są wykonywane przekierowania.
+  char **num2;
+
+  /// Liczba przekierowań.
+  size_t count;
+
+  /// Rozmiar tablic @p num1 i @p num2.
+  size_t capacity;
+};
+
+/// @brief Kopiuje napis.
+/// Kończy program kodem 1, gdy nie uda się zaalokować pamięci.
+/// @param[in] first – początek napisu.
+/// @param[in] second – dalsza część napisu, doklejana do @p first.
+/// @return Wskaźnik na kopię, który trzeba zwolnić.
+static inline char *testConcat(const char *first, const char *second) {
+  size_t firstLength = strlen(first);
+  size_t secondLength = strlen(second);
+  char *result = malloc(firstLength + secondLength + 1);
+  TEST_CHECK(result);
+  memcpy(result, first, firstLength);
+  memcpy(result + firstLength, second, secondLength + 1);
+  return result;
+}
+
+/// @brief Sprawdza, czy napis reprezentuje numer.
+/// @param[in] num – sprawdzany napis.
+/// @return @p true, gdy napis jest niepusty i składa się z cyfr @p 0 do @p ;.
+static inline bool testIsNumber(const char *num) {
+  if (!num || !*num)
+    return false;
+  for (; *num; ++num)
+    if (*num < '0' || *num > ';')
+      return false;
+
+  return true;
+}
+
+/// @brief Sprawdza, czy napis jest prefiksem numeru.
+/// @param[in] prefix – prefiks.
+/// @param[in] num – numer.
+/// @return Długość prefiksu lub 0, gdy @p prefix nie jest prefiksem @p num.
+static inline size_t testPrefixLength(const char *prefix, const char *num) {
+  size_t length = 0;
+  for (; prefix[length]; ++length)
+    if (prefix[length] != num[length])
+      return 0;
+
+  return length;
+}
+
+/// @brief Porównuje napisy na potrzeby @p qsort.
+/// @param[in] first – wskaźnik na pierwszy napis.
+/// @param[in] second – wskaźnik na drugi napis.
+/// @return Wynik @p strcmp dla obu napisów.
+static inline int testCompareStrings(const void *first, const void *second) {
+  return strcmp(*(char *const *)first, *(char *const *)second);
+}
+
+/// @brief Tworzy pusty model.
+/// @param[out] model – tworzony model.
+static inline void testModelInit(struct TestModel *model) {
+  model->num1 = NULL;
+  model->num2 = NULL;
+  model->count = 0;
+  model->capacity = 0;
+}
+
+/// @brief Usuwa model.
+/// @param[in,out] model – usuwany model.
+static inline void testModelFree(struct TestModel *model) {
+  for (size_t i = 0; i < model->count; ++i) {
+    free(model->num1[i]);
+    free(model->num2[i]);
+  }
+  free(model->num1);
+  free(model->num2);
+  testModelInit(model);
+}
+
+/// @brief Dodaje przekierowanie do modelu.
+/// @param[in,out] model – model.
+/// @param[in] num1 – prefiks numerów przekierowywanych.
+/// @param[in] num2 – prefiks numerów, na które jest wykonywane przekierowanie.
+/// @return Wynik, jaki powinno zwrócić @ref phfwdAdd, o ile uda mu się
+///         zaalokować pamięć.
+static inline bool testModelAdd(struct TestModel *model, const char *num1,
+                                const char *num2) {
+  if (!testIsNumber(num1) || !testIsNumber(num2) || strcmp(num1, num2) == 0)
+    return false;
+
+  for (size_t i = 0; i < model->count; ++i)
+    if (strcmp(model->num1[i], num1) == 0) {
+      free(model->num2[i]);
+      model->num2[i] = testConcat(num2, "");
+      return true;
+    }
+
+  if (model->count == model->capacity) {
+    model->capacity = 2 * model->capacity + 16;
+    model->num1 = realloc(model->num1, model->capacity * sizeof(char *));
+    model->num2 = realloc(model->num2, model->capacity * sizeof(char *));
+    TEST_CHECK(model->num1 && model->num2);
+  }
+  model->num1[model->count] = testConcat(num1, "");
+  model->num2[model->count] = testConcat(num2, "");
+  ++model->count;
+  return true;
+}
+
+/// @brief Usuwa z modelu przekierowania, których @p num1 ma prefiks @p num.
+/// @param[in,out] model – model.
+/// @param[in] num – prefiks.
+static inline void testModelRemove(struct TestModel *model, const char *num) {
+  if (!testIsNumber(num))
+    return;
+
+  for (size_t i = 0; i < model->count;) {
+    if (testPrefixLength(num, model->num1[i])) {
+      free(model->num1[i]);
+      free(model->num2[i]);
+      --model->count;
+      model->num1[i] = model->num1[model->count];
+      model->num2[i] = model->num2[model->count];
+    } else {
+      ++i;
+    }
+  }
+}
+
+/// @brief Porównuje ciąg numerów z posortowaną tablicą i zwalnia oba.
+/// Powtórzenia w tablicy są pomijane.
+/// @param[in] result – ciąg numerów.
+/// @param[in] numbers – posortowana tablica napisów, zwalniana wraz z nimi.
+/// @param[in] count – liczba elementów tablicy @p numbers.
+/// @return @p true, gdy oba zawierają te same numery w tej samej kolejności,
+///         @p false w przeciwnym wypadku.
+static inline bool testSameAsArray(const struct PhoneNumbers *result,
+                                   char **numbers, size_t count) {
+  bool same = result != NULL;
+  size_t index = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0 && strcmp(numbers[i - 1], numbers[i]) == 0)
+      continue;
+
+    const char *num = same ? phnumGet(result, index++) : NULL;
+    same = num && strcmp(num, numbers[i]) == 0;
+  }
+  same = same && !phnumGet(result, index);
+
+  for (size_t i = 0; i < count; ++i)
+    free(numbers[i]);
+  free(numbers);
+  phnumDelete(result);
+  return same;
+}
+
+/// @brief Porównuje wynik @ref phfwdGet z modelem i zwalnia go.
+/// @param[in] model – model.
+/// @param[in] num – numer z zapytania.
+/// @param[in] result – wynik zapytania.
+/// @return @p true, gdy wynik jest zgodny z modelem, @p false w przeciwnym
+///         wypadku.
+static inline bool testModelSameGet(const struct TestModel *model,
+                                    const char *num,
+                                    const struct PhoneNumbers *result) {
+  if (!testIsNumber(num))
+    return testSameAsArray(result, NULL, 0);
+
+  size_t best = 0;
+  const char *target = "";
+  for (size_t i = 0; i < model->count; ++i) {
+    size_t length = testPrefixLength(model->num1[i], num);
+    if (length > best) {
+      best = length;
+      target = model->num2[i];
+    }
+  }
+
+  char **numbers = malloc(sizeof(char *));
+  TEST_CHECK(numbers);
+  numbers[0] = testConcat(target, num + best);
+  return testSameAsArray(result, numbers, 1);
+}
+
+/// @brief Porównuje wynik @ref phfwdReverse z modelem i zwalnia go.
+/// @param[in] model – model.
+/// @param[in] num – numer z zapytania.
+/// @param[in] result – wynik zapytania.
+/// @return @p true, gdy wynik jest zgodny z modelem, @p false w przeciwnym
+///         wypadku.
+static inline bool testModelSameReverse(const struct TestModel *model,
+                                        const char *num,
+                                        const struct PhoneNumbers *result) {
+  if (!testIsNumber(num))
+    return testSameAsArray(result, NULL, 0);
+
+  char **numbers = malloc((model->count + 1) * sizeof(char *));
+  TEST_CHECK(numbers);
+  size_t count = 0;
+  numbers[count++] = testConcat(num, "");
+  for (size_t i = 0; i < model->count; ++i) {
+    size_t length = testPrefixLength(model->num2[i], num);
+    if (length)
+      numbers[count++] = testConcat(model->num1[i], num + length);
+  }
+
+  qsort(numbers, count, sizeof(char *), testCompareStrings);
+  return testSameAsArray(result, numbers, count);
+}
+
+/// @brief Oblicza wynik @ref phfwdNonTrivialCount na modelu.
+/// Numer jest nietrywialny, gdy ma prefiks @p num2 któregoś przekierowania.
+/// Zlicza więc numery o prefiksach @p num2 złożonych z cyfr zbioru,
+/// pomijając te @p num2, które same mają taki prefiks.
+/// @param[in] model – model.
+/// @param[in] set – zbiór cyfr.
+/// @param[in] len – długość numerów.
+/// @return Liczba nietrywialnych numerów modulo dwa do potęgi liczba bitów
+///         typu @p size_t.
+static inline size_t testModelNonTrivialCount(const struct TestModel *model,
+                                              const char *set, size_t len) {
+  if (!set || len == 0)
+    return 0;
+
+  bool allowed[CHAR_MAX + 1] = {false};
+  size_t digits = 0;
+  for (; *set; ++set)
+    if (*set >= '0' && *set <= ';' && !allowed[(int)*set]) {
+      allowed[(int)*set] = true;
+      ++digits;
+    }
+
+  char **prefixes = malloc((model->count + 1) * sizeof(char *));
+  TEST_CHECK(prefixes);
+  size_t count = 0;
+  for (size_t i = 0; i < model->count; ++i) {
+    const char *num2 = model->num2[i];
+    size_t length = 0;
+    while (num2[length] && allowed[(int)num2[length]])
+      ++length;
+    if (!num2[length] && length <= len)
+      prefixes[count++] = model->num2[i];
+  }
+
+  // After sorting, a prefix comes right before the numbers it covers.
+  qsort(prefixes, count, sizeof(char *), testCompareStrings);
+  size_t result = 0;
+  const char *covering = NULL;
+  for (size_t i = 0; i < count; ++i) {
+    if (covering && testPrefixLength(covering, prefixes[i]))
+      continue;
+
+    covering = prefixes[i];
+    size_t numbers = 1;
+    for (size_t k = strlen(covering); k < len; ++k)
+      numbers *= digits;
+    result += numbers;
+  }
+
+  free(prefixes);
+  return result;
+}
+
+#endif /* __TEST_UTIL_H__ */
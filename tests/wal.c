@@ -0,0 +1,270 @@
+/// @file
+/// Test dziennika zmian.
+///
+/// Uruchamia program z dziennikiem na losowym skrypcie poprawnych operacji i
+/// porównuje jego wyjście z wyjściem tego samego skryptu wykonanego w
+/// kilku uruchomieniach, między którymi ostatni rekord dziennika jest ucięty
+/// w środku, tak jak po przerwaniu programu w trakcie zapisu. Na koniec
+/// zawartości baz odtworzonych z obu dzienników są porównywane zapytaniami.
+/// Program jest zbudowany z małym @ref WAL_CHECKPOINT_SIZE, więc dzienniki
+/// przechodzą po drodze przez punkty kontrolne.
+///
+/// Użycie: test_wal program [liczba powtórzeń]
+///
+/// @author agent <agent@local>
+/// @date 16.10.2026
+
+#include "test_util.h"
+#include "write_ahead_log.h"
+
+/// Domyślna liczba powtórzeń z różnymi ziarnami.
+#define TEST_DEFAULT_SEEDS (16)
+
+/// Największa liczba operacji w skrypcie.
+#define TEST_MAX_OPERATIONS (1500)
+
+/// Największa długość jednej operacji.
+#define TEST_OPERATION_LENGTH (16)
+
+/// Długość napisu @ref WAL_MAGIC.
+#define TEST_MAGIC_SIZE (sizeof(WAL_MAGIC) - 1)
+
+/// Bajt typu rekordu zawartości bazy, którym zaczyna się punkt kontrolny.
+#define TEST_IMAGE_RECORD 'I'
+
+/// Dziennik przerywanego wykonania.
+#define TEST_LOG "test_wal.log"
+
+/// Dziennik nieprzerwanego wykonania.
+#define TEST_REFERENCE_LOG "test_wal_reference.log"
+
+/// Plik z fragmentem skryptu.
+#define TEST_INPUT "test_wal_input.txt"
+
+/// Plik z wyjściem programu.
+#define TEST_OUTPUT "test_wal_output.txt"
+
+/// Operacje bieżącego skryptu.
+static char testOperations[TEST_MAX_OPERATIONS][TEST_OPERATION_LENGTH];
+
+/// Ścieżka do badanego programu.
+static const char *testProgram;
+
+/// @brief Wczytuje zawartość pliku.
+/// @param[in] path – ścieżka do pliku.
+/// @param[out] size – rozmiar pliku.
+/// @return Zawartość pliku, którą trzeba zwolnić, zakończona znakiem @p '\0'.
+static char *testReadFile(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  TEST_CHECK(file);
+
+  size_t capacity = 4096;
+  char *data = malloc(capacity);
+  TEST_CHECK(data);
+  (*size) = 0;
+  size_t read;
+  while ((read = fread(data + *size, 1, capacity - *size - 1, file)) > 0) {
+    (*size) += read;
+    if (capacity - *size == 1) {
+      capacity *= 2;
+      TEST_CHECK(data = realloc(data, capacity));
+    }
+  }
+
+  TEST_CHECK(!ferror(file));
+  fclose(file);
+  data[*size] = '\0';
+  return data;
+}
+
+/// @brief Zapisuje dane do pliku, zastępując jego zawartość.
+/// @param[in] path – ścieżka do pliku.
+/// @param[in] data – zapisywane dane.
+/// @param[in] size – rozmiar danych.
+static void testWriteFile(const char *path, const char *data, size_t size) {
+  FILE *file = fopen(path, "wb");
+  TEST_CHECK(file);
+  TEST_CHECK(fwrite(data, 1, size, file) == size);
+  TEST_CHECK(fclose(file) == 0);
+}
+
+/// @brief Uruchamia program na fragmencie skryptu.
+/// Wyjście programu, łącznie z komunikatami o błędach, trafia do @ref
+/// TEST_OUTPUT.
+/// @param[in] log – ścieżka do dziennika.
+/// @param[in] from – indeks pierwszej wykonywanej operacji.
+/// @param[in] to – indeks za ostatnią wykonywaną operacją.
+/// @return Wyjście programu, które trzeba zwolnić.
+static char *testRun(const char *log, int from, int to) {
+  FILE *input = fopen(TEST_INPUT, "w");
+  TEST_CHECK(input);
+  for (int i = from; i < to; ++i)
+    fprintf(input, "%s\n", testOperations[i]);
+  TEST_CHECK(fclose(input) == 0);
+
+  char command[4096];
+  int length = snprintf(command, sizeof(command), "\"%s\" %s < %s > %s 2>&1",
+                        testProgram, log, TEST_INPUT, TEST_OUTPUT);
+  TEST_CHECK(length > 0 && (size_t)length < sizeof(command));
+  TEST_CHECK(system(command) == 0);
+
+  size_t size;
+  return testReadFile(TEST_OUTPUT, &size);
+}
+
+/// @brief Losuje krótki numer.
+/// @param[in,out] state – stan generatora.
+/// @param[out] out – bufor na co najmniej 5 znaków.
+static void testWalNumber(uint64_t *state, char *out) {
+  testRandomNumber(state, out, 4, 4);
+}
+
+/// @brief Losuje skrypt poprawnych operacji.
+/// Skrypt zaczyna się od utworzenia bazy, a aktualna baza nigdy nie jest
+/// usuwana, więc żadna operacja nie kończy się błędem. Pliki są wczytywane
+/// dopiero po zapisaniu ich w tym samym skrypcie.
+/// @param[in,out] state – stan generatora.
+/// @param[out] cut – indeks operacji, która jest przekierowaniem.
+/// @return Liczba operacji skryptu.
+static int testRandomScript(uint64_t *state, int *cut) {
+  int count = 20 + testRandom(state) % (TEST_MAX_OPERATIONS - 20);
+  (*cut) = 1 + testRandom(state) % (count - 1);
+  bool saved[2] = {false, false};
+  bool exists[2] = {true, false};
+  int current = 0;
+  char num1[5];
+  char num2[5];
+
+  strcpy(testOperations[0], "NEW a");
+  for (int i = 1; i < count; ++i) {
+    char *operation = testOperations[i];
+    int action = i == *cut ? 6 : testRandom(state) % 20;
+    int other = testRandom(state) % 2;
+    testWalNumber(state, num1);
+    do {
+      testWalNumber(state, num2);
+    } while (strcmp(num1, num2) == 0);
+
+    if (action == 0) {
+      sprintf(operation, "NEW %c", 'a' + other);
+      exists[other] = true;
+      current = other;
+    } else if (action == 1 && other != current && exists[other]) {
+      sprintf(operation, "DEL %c", 'a' + other);
+      exists[other] = false;
+    } else if (action == 2) {
+      sprintf(operation, "SAVE test_wal_%c", 'f' + other);
+      saved[other] = true;
+    } else if (action == 3 && saved[other]) {
+      sprintf(operation, "LOAD test_wal_%c", 'f' + other);
+    } else if (action < 6) {
+      sprintf(operation, "DEL %s", num1);
+    } else if (action < 14) {
+      sprintf(operation, "%s > %s", num1, num2);
+    } else if (action < 17) {
+      sprintf(operation, "%s ?", num1);
+    } else if (action < 19) {
+      sprintf(operation, "? %s", num1);
+    } else {
+      sprintf(operation, "@ %s", num1);
+    }
+  }
+
+  return count;
+}
+
+/// @brief Usuwa pliki utworzone przez test.
+static void testRemoveFiles() {
+  remove(TEST_LOG);
+  remove(TEST_LOG ".tmp");
+  remove(TEST_REFERENCE_LOG);
+  remove(TEST_REFERENCE_LOG ".tmp");
+  remove(TEST_INPUT);
+  remove(TEST_OUTPUT);
+  remove("test_wal_f");
+  remove("test_wal_g");
+}
+
+/// @brief Wykonuje jedno powtórzenie testu.
+/// @param[in] seed – numer powtórzenia.
+/// @return @p true, gdy nieprzerwane wykonanie zakończyło się z dziennikiem
+///         zaczynającym się od punktu kontrolnego.
+static bool testSeed(int seed) {
+  uint64_t state = (uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ull;
+  testRemoveFiles();
+  int cut;
+  int count = testRandomScript(&state, &cut);
+  char *expected = testRun(TEST_REFERENCE_LOG, 0, count);
+
+  size_t size;
+  char *log = testReadFile(TEST_REFERENCE_LOG, &size);
+  bool checkpointed =
+      size > TEST_MAGIC_SIZE && log[TEST_MAGIC_SIZE] == TEST_IMAGE_RECORD;
+  free(log);
+
+  // The same script is run again, interrupted while the record of the
+  // redirection at the cut is being written.
+  remove("test_wal_f");
+  remove("test_wal_g");
+  char *first = testRun(TEST_LOG, 0, cut);
+  size_t before;
+  char *logBefore = testReadFile(TEST_LOG, &before);
+  free(testRun(TEST_LOG, cut, cut + 1));
+  size_t after;
+  char *logAfter = testReadFile(TEST_LOG, &after);
+
+  // A checkpoint may have replaced the whole log; then nothing is cut and
+  // the redirection counts as done.
+  int rest = cut + 1;
+  if (after > before + 1 && memcmp(logBefore, logAfter, before) == 0) {
+    size_t length = before + 1 + testRandom(&state) % (after - before - 1);
+    testWriteFile(TEST_LOG, logAfter, length);
+    rest = cut;
+  }
+  free(logBefore);
+  free(logAfter);
+
+  char *second = testRun(TEST_LOG, rest, count);
+  char *result = testConcat(first, second);
+  TEST_CHECK(strcmp(result, expected) == 0);
+  free(first);
+  free(second);
+  free(result);
+  free(expected);
+
+  // Both logs must restore the same databases.
+  int queries = 0;
+  for (int k = 0; k < 2; ++k) {
+    sprintf(testOperations[queries++], "NEW %c", 'a' + k);
+    for (int q = 0; q < 40; ++q) {
+      char num[5];
+      testWalNumber(&state, num);
+      sprintf(testOperations[queries++], q % 2 ? "%s ?" : "? %s", num);
+    }
+  }
+  char *restored = testRun(TEST_LOG, 0, queries);
+  expected = testRun(TEST_REFERENCE_LOG, 0, queries);
+  TEST_CHECK(strcmp(restored, expected) == 0);
+  free(restored);
+  free(expected);
+  return checkpointed;
+}
+
+/// @brief Uruchamia test.
+/// @param[in] argc – liczba argumentów.
+/// @param[in] argv – argumenty: ścieżka do programu i liczba powtórzeń.
+/// @return 0 gdy wszystkie wyniki były zgodne, 1 w przeciwnym wypadku.
+int main(int argc, char **argv) {
+  TEST_CHECK(argc > 1);
+  testProgram = argv[1];
+  int seeds = argc > 2 ? atoi(argv[2]) : TEST_DEFAULT_SEEDS;
+
+  // Long scripts must reach the lowered checkpoint size.
+  int checkpoints = 0;
+  for (int seed = 0; seed < seeds; ++seed)
+    checkpoints += testSeed(seed);
+  TEST_CHECK(seeds == 0 || checkpoints > 0);
+
+  testRemoveFiles();
+  return 0;
+}